@@ -0,0 +1,120 @@
+#include "ai.h"
+
+#include <cmath>     // fabs, fmod
+
+// ===================== DIFFICULTY =====================
+
+static const AiParams difficultyParams[3] = {
+    //  reaction  aim error  speed cap
+    {   0.35f,    130.0f,    340.0f },   // Easy
+    {   0.22f,     95.0f,    440.0f },   // Medium
+    {   0.12f,     70.0f,    560.0f }    // Hard
+};
+
+AiParams aiParams(int difficulty) {
+    if (difficulty < 0) difficulty = 0;
+    if (difficulty > 2) difficulty = 2;
+    return difficultyParams[difficulty];
+}
+
+void aiInit(AiState& ai, int side, int difficulty, uint64_t seed) {
+    ai.side   = side;
+    ai.params = aiParams(difficulty);
+    rngSeed(ai.rng, seed ^ (side ? 0xA1A1A1A1A1A1A1A1ull : 0x5E5E5E5E5E5E5E5Eull));
+
+    ai.cachedVx      = 0.0f;
+    ai.cachedVy      = 0.0f;
+    ai.cachedGoals   = -1;
+    ai.hasPrediction = false;
+
+    ai.targetY    = ARENA_HEIGHT / 2.0f;
+    ai.pendingY   = ai.targetY;
+    ai.aimOffset  = 0.0f;
+    ai.reactTimer = 0.0f;
+}
+
+// ===================== PREDICTION =====================
+
+bool aiPredictIntercept(float x, float y, float vx, float vy, float radius,
+                        float planeX, float& outY) {
+    float dx = planeX - x;
+    if (vx == 0.0f || dx * vx < 0.0f) return false;
+
+    // Unfold the walls: the ball's y lives in [radius, H - radius]; bouncing
+    // between them is a triangle wave of period 2 * (H - 2 * radius).
+    float span = ARENA_HEIGHT - 2.0f * radius;
+    float u = (y - radius) + vy * (dx / vx);
+
+    float period = 2.0f * span;
+    u = std::fmod(u, period);
+    if (u < 0.0f) u += period;
+    if (u > span) u = period - u;
+
+    outY = radius + u;
+    return true;
+}
+
+// ===================== UPDATE =====================
+
+PaddleInput aiUpdate(AiState& ai, const MatchState& m, float dt) {
+    const Paddle& p    = (ai.side == 0) ? m.p1 : m.p2;
+    const Ball&   ball = m.ball;
+    PaddleInput   in   = { 0.0f, 0.0f };
+
+    // Predict only when the trajectory changes. A serve or paddle hit
+    // (vx or score changed) starts a new leg: fresh aim error, and the
+    // reaction delay starts over. A wall bounce only flips vy; the folded
+    // prediction already covered it, so the AI doesn't hesitate.
+    int  goals  = m.scoreP1 + m.scoreP2;
+    bool newLeg = !ai.hasPrediction || ball.vx != ai.cachedVx || goals != ai.cachedGoals;
+
+    if (newLeg || ball.vy != ai.cachedVy) {
+        ai.cachedVx      = ball.vx;
+        ai.cachedVy      = ball.vy;
+        ai.cachedGoals   = goals;
+        ai.hasPrediction = true;
+
+        // Plane the ball's center reaches when it touches our front face
+        float face = (ai.side == 0) ? p.x + p.width / 2 + ball.radius
+                                    : p.x - p.width / 2 - ball.radius;
+        float landY;
+        bool  incoming = aiPredictIntercept(ball.x, ball.y, ball.vx, ball.vy,
+                                            ball.radius, face, landY);
+
+        if (newLeg) {
+            // Aim error grows with flight time (1 s flight = full error)
+            float flight = incoming ? std::fabs((face - ball.x) / (ball.vx * m.speedFactor)) : 0.0f;
+            if (flight > 1.0f) flight = 1.0f;
+            ai.aimOffset  = (2.0f * rngFloat(ai.rng) - 1.0f) * ai.params.aimError * flight;
+            ai.reactTimer = ai.params.reactionDelay;
+        }
+
+        // Ball going away: recenter
+        ai.pendingY = incoming ? landY + ai.aimOffset : ARENA_HEIGHT / 2.0f;
+    }
+
+    if (ai.reactTimer > 0.0f) {
+        ai.reactTimer -= dt;
+        if (ai.reactTimer <= 0.0f) ai.targetY = ai.pendingY;
+    } else {
+        ai.targetY = ai.pendingY;
+    }
+
+    // Head for the target; land exactly on it when within one step
+    float step = p.speed * dt;
+    if (step <= 0.0f) return in;
+
+    float dy = ai.targetY - p.y;
+    if (dy > step)        in.moveY =  1.0f;
+    else if (dy < -step)  in.moveY = -1.0f;
+    else                  in.moveY = dy / step;
+
+    // Hold the home line
+    float homeX = (ai.side == 0) ? 80.0f : ARENA_WIDTH - 80.0f;
+    float dx = homeX - p.x;
+    if (dx > step)        in.moveX =  1.0f;
+    else if (dx < -step)  in.moveX = -1.0f;
+    else                  in.moveX = dx / step;
+
+    return in;
+}
@@ -0,0 +1,58 @@
+#ifndef PADDLE_RIVALS_AI_H
+#define PADDLE_RIVALS_AI_H
+
+// Intercept-predicting AI opponent.
+//
+// Instead of chasing ball.y, the AI solves where the ball will cross its
+// paddle's plane, folding top/bottom wall bounces in O(1). The prediction
+// is cached until the ball's trajectory changes (paddle hit, wall bounce,
+// serve), so most ticks cost a compare and a move.
+//
+// Difficulty is not raw speed alone: each level has a reaction delay
+// before it acts on a new trajectory, an aiming error, and a speed cap.
+// No GL here; the game, replays and the batch runner all use it.
+
+#include <cstdint>
+
+#include "match_engine.h"
+
+struct AiParams {
+    float reactionDelay;   // seconds before reacting to a new trajectory
+    float aimError;        // max intercept error (arena units) for a 1 s flight
+    float maxSpeed;        // paddle speed cap, units per second
+};
+
+// Params for difficulty 0..2 (Easy/Medium/Hard).
+AiParams aiParams(int difficulty);
+
+// Difficulty index of the Expert tier, which is the search AI in
+// search_ai.h rather than this one.
+const int expertDifficulty = 3;
+
+struct AiState {
+    int      side;             // 0 = left paddle, 1 = right paddle
+    AiParams params;
+    MatchRng rng;              // aim error; separate from the match RNG
+
+    // Trajectory the cached prediction was made for
+    float cachedVx, cachedVy;
+    int   cachedGoals;
+    bool  hasPrediction;
+
+    float targetY;             // where the paddle is heading now
+    float pendingY;            // newest prediction, applied after the delay
+    float aimOffset;           // aim error drawn for the current leg
+    float reactTimer;          // seconds until pendingY is used
+};
+
+void aiInit(AiState& ai, int side, int difficulty, uint64_t seed);
+
+// Input for this tick. Only reads the match.
+PaddleInput aiUpdate(AiState& ai, const MatchState& m, float dt);
+
+// Y at which a ball at (x, y) moving (vx, vy) reaches the vertical line
+// planeX, with wall bounces folded in. Returns false if it's moving away.
+bool aiPredictIntercept(float x, float y, float vx, float vy, float radius,
+                        float planeX, float& outY);
+
+#endif
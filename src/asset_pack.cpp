@@ -0,0 +1,189 @@
+#include "asset_pack.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct PackEntry {
+    uint32_t    offset, size;
+    std::string name;
+};
+
+static const uint8_t*         packBase = 0;
+static size_t                 packSize = 0;
+static std::vector<PackEntry> packIndex;          // sorted by name, as in the file
+static AssetStats             stats;
+
+#ifdef _WIN32
+static HANDLE packFile    = INVALID_HANDLE_VALUE;
+static HANDLE packMapping = 0;
+#endif
+
+static std::string                                  looseRoot;
+static std::mutex                                   looseLock;
+static std::map<std::string, std::vector<uint8_t> > looseFiles;   // read once, kept
+
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static unsigned le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+// ===================== MAPPING =====================
+
+static bool mapFile(const char* path) {
+#ifdef _WIN32
+    packFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if (packFile == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(packFile, &size) || size.QuadPart == 0) return false;
+    packMapping = CreateFileMappingA(packFile, 0, PAGE_READONLY, 0, 0, 0);
+    if (!packMapping) return false;
+    packBase = (const uint8_t*)MapViewOfFile(packMapping, FILE_MAP_READ, 0, 0, 0);
+    packSize = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* p = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);                                    // the mapping keeps the file
+    if (p == MAP_FAILED) return false;
+    packBase = (const uint8_t*)p;
+    packSize = (size_t)st.st_size;
+#endif
+    return packBase != 0;
+}
+
+static void unmapFile() {
+#ifdef _WIN32
+    if (packBase)                        UnmapViewOfFile(packBase);
+    if (packMapping)                     CloseHandle(packMapping);
+    if (packFile != INVALID_HANDLE_VALUE) CloseHandle(packFile);
+    packMapping = 0;
+    packFile    = INVALID_HANDLE_VALUE;
+#else
+    if (packBase) munmap((void*)packBase, packSize);
+#endif
+    packBase = 0;
+    packSize = 0;
+}
+
+// Checks the header and every entry against the file size.
+static bool readIndex() {
+    if (packSize < 16 || std::memcmp(packBase, "PRPK", 4) != 0) return false;
+    if (le32(packBase + 4) != assetPackVersion) return false;
+
+    uint32_t count      = le32(packBase + 8);
+    uint32_t indexBytes = le32(packBase + 12);
+    if (16 + (size_t)indexBytes > packSize) return false;
+    if (count > indexBytes / 10) return false;      // each entry takes at least 10 bytes
+
+    const uint8_t* p   = packBase + 16;
+    const uint8_t* end = p + indexBytes;
+    packIndex.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (end - p < 10) return false;
+        PackEntry& e = packIndex[i];
+        e.offset = le32(p);
+        e.size   = le32(p + 4);
+        unsigned len = le16(p + 8);
+        p += 10;
+        if ((size_t)(end - p) < len || (size_t)e.offset + e.size > packSize) return false;
+        e.name.assign((const char*)p, len);
+        p += len;
+    }
+    return true;
+}
+
+// ===================== API =====================
+
+bool assetsOpen(const char* packPath, const char* looseRoot_) {
+    assetsClose();
+    looseRoot = looseRoot_;
+
+    double start = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    bool ok = mapFile(packPath) && readIndex();
+    if (!ok) {
+        unmapFile();
+        packIndex.clear();
+    }
+    double end = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    stats.packed = ok;
+    stats.items  = (int)packIndex.size();
+    stats.bytes  = packSize;
+    stats.openMs = (end - start) * 1000.0;
+    return ok;
+}
+
+void assetsClose() {
+    unmapFile();
+    packIndex.clear();
+    std::lock_guard<std::mutex> guard(looseLock);
+    looseFiles.clear();
+    std::memset(&stats, 0, sizeof(stats));
+}
+
+bool assetGet(const char* name, AssetData& out) {
+    if (packBase) {
+        // Binary search over the sorted index
+        size_t lo = 0, hi = packIndex.size();
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            int c = packIndex[mid].name.compare(name);
+            if (c == 0) {
+                out.data = packBase + packIndex[mid].offset;
+                out.size = packIndex[mid].size;
+                return true;
+            }
+            if (c < 0) lo = mid + 1;
+            else       hi = mid;
+        }
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(looseLock);
+    std::map<std::string, std::vector<uint8_t> >::iterator it = looseFiles.find(name);
+    if (it == looseFiles.end()) {
+        std::string path = looseRoot + "/" + name;
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        std::vector<uint8_t> bytes;
+        uint8_t chunk[65536];
+        size_t  n;
+        while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+        std::fclose(f);
+        it = looseFiles.insert(std::make_pair(std::string(name), bytes)).first;
+    }
+    out.data = it->second.empty() ? 0 : &it->second[0];
+    out.size = it->second.size();
+    return true;
+}
+
+void assetPrefetch(const AssetData& a) {
+#ifndef _WIN32
+    if (!packBase || a.size == 0) return;
+    // madvise wants a page-aligned start
+    uintptr_t page  = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)a.data & ~(page - 1);
+    madvise((void*)start, (uintptr_t)a.data + a.size - start, MADV_WILLNEED);
+#endif
+}
+
+AssetStats assetsStats() {
+    return stats;
+}
@@ -0,0 +1,51 @@
+#ifndef PADDLE_RIVALS_ASSET_PACK_H
+#define PADDLE_RIVALS_ASSET_PACK_H
+
+// Game assets by name ("audio/bg_music.wav", "icons/icon.ico").
+//
+// Release builds ship one archive, assets.pak, made by pack_assets from
+// the assets/ folder. It is memory-mapped, not read: opening it only
+// parses the index, and assetGet() returns pointers straight into the
+// mapping, so an asset costs nothing until its pages are touched (by
+// whoever decodes it, e.g. the music streaming thread). Without an archive
+// (while developing) the same names are read from the loose files under
+// assets/ instead and kept in memory until assetsClose().
+//
+// Archive layout, little-endian:
+//   "PRPK" u32 version u32 count u32 indexBytes
+//   count x { u32 offset u32 size u16 nameLength name }   sorted by name
+//   data, every item starting on a 64-byte boundary
+//
+// assetGet() may be called from any thread.
+
+#include <cstddef>
+#include <cstdint>
+
+const uint32_t assetPackVersion = 1;
+const int      assetPackAlign   = 64;
+
+struct AssetData {
+    const uint8_t* data;
+    size_t         size;
+};
+
+struct AssetStats {
+    bool   packed;                    // from the archive (else loose files)
+    int    items;                     // in the archive
+    size_t bytes;                     // archive size
+    double openMs;                    // mapping it and reading the index
+};
+
+// Maps packPath; when it's missing or unreadable, assets come from files
+// under looseRoot. Returns true if the archive is used.
+bool assetsOpen(const char* packPath, const char* looseRoot);
+void assetsClose();
+
+bool assetGet(const char* name, AssetData& out);
+
+// Hints that an asset is about to be read start to end (readahead).
+void assetPrefetch(const AssetData& a);
+
+AssetStats assetsStats();
+
+#endif
@@ -0,0 +1,508 @@
+#include "audio.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "asset_pack.h"
+#include "audio_backend.h"
+#include "spsc_queue.h"
+
+static double nowSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ===================== WAV =====================
+
+// Over the asset's bytes in memory (mapped from the archive).
+struct WavReader {
+    const uint8_t* pcm;
+    int            channels, rate, bits;
+    uint32_t       dataBytes, position;   // position: bytes of data read
+};
+
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static unsigned le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+// Finds the fmt and data chunks of a PCM WAV.
+static bool wavOpen(const AssetData& a, WavReader& w) {
+    std::memset(&w, 0, sizeof(w));
+    if (a.size < 12 || std::memcmp(a.data, "RIFF", 4) || std::memcmp(a.data + 8, "WAVE", 4)) return false;
+
+    bool   haveFormat = false;
+    int    format     = 0;
+    size_t at         = 12;
+    while (!w.pcm && at + 8 <= a.size) {   // an odd last chunk's pad can overshoot
+        const uint8_t* h    = a.data + at;
+        uint32_t       size = le32(h + 4);
+        if (size > a.size - at - 8) size = (uint32_t)(a.size - at - 8);   // truncated file: what's there
+        if (!std::memcmp(h, "fmt ", 4) && size >= 16) {
+            format     = (int)le16(h + 8);
+            w.channels = (int)le16(h + 10);
+            w.rate     = (int)le32(h + 12);
+            w.bits     = (int)le16(h + 22);
+            haveFormat = true;
+        } else if (!std::memcmp(h, "data", 4)) {
+            w.pcm       = h + 8;
+            w.dataBytes = size;
+        }
+        at += 8 + (size_t)size + (size & 1);
+    }
+
+    return haveFormat && w.pcm && format == 1 && (w.channels == 1 || w.channels == 2) &&
+           (w.bits == 8 || w.bits == 16) && w.rate > 0;
+}
+
+// Reads up to maxFrames frames as 16-bit stereo. 0 at the end.
+static int wavRead(WavReader& w, int16_t* out, int maxFrames) {
+    unsigned frameBytes = (unsigned)(w.channels * w.bits / 8);
+    uint32_t left       = (w.dataBytes - w.position) / frameBytes;
+    int n = maxFrames < (int)left ? maxFrames : (int)left;
+    const uint8_t* raw = w.pcm + w.position;
+    w.position += (uint32_t)n * frameBytes;
+
+    for (int i = 0; i < n; ++i) {
+        int16_t s[2] = { 0, 0 };
+        for (int c = 0; c < w.channels; ++c) {
+            const uint8_t* p = raw + i * frameBytes + c * (w.bits / 8);
+            s[c] = w.bits == 8 ? (int16_t)((p[0] - 128) << 8) : (int16_t)le16(p);
+        }
+        out[i * 2]     = s[0];
+        out[i * 2 + 1] = w.channels == 2 ? s[1] : s[0];
+    }
+    return n;
+}
+
+static void wavRewind(WavReader& w) {
+    w.position = 0;
+}
+
+// ===================== EFFECTS =====================
+
+// A whole WAV as mono samples at audioRate (linear resampling).
+static bool loadEffect(const char* name, std::vector<int16_t>& out) {
+    AssetData a;
+    WavReader w;
+    if (!assetGet(name, a) || !wavOpen(a, w)) return false;
+
+    std::vector<int16_t> stereo;
+    int16_t chunk[1024 * 2];
+    int n;
+    while ((n = wavRead(w, chunk, 1024)) > 0) stereo.insert(stereo.end(), chunk, chunk + n * 2);
+
+    size_t frames = stereo.size() / 2;
+    if (frames == 0) return false;
+    double step = (double)w.rate / audioRate;
+    out.resize((size_t)((frames - 1) / step) + 1);
+    for (size_t i = 0; i < out.size(); ++i) {
+        double pos = i * step;
+        size_t j   = (size_t)pos;
+        size_t k   = j + 1 < frames ? j + 1 : j;
+        float  t   = (float)(pos - j);
+        float  a   = 0.5f * (stereo[j * 2] + stereo[j * 2 + 1]);
+        float  b   = 0.5f * (stereo[k * 2] + stereo[k * 2 + 1]);
+        out[i] = (int16_t)(a + (b - a) * t);
+    }
+    return true;
+}
+
+// A decaying tone of a few odd harmonics whose pitch slides from freq to
+// freq * slide, appended to out.
+static void synthesize(std::vector<int16_t>& out, float seconds, float freq, float slide,
+                       float decayPerSec, int harmonics) {
+    const float twoPi = 6.2831853f;
+    int   frames = (int)(seconds * audioRate);
+    float phase  = 0.0f;
+    for (int i = 0; i < frames; ++i) {
+        float t   = (float)i / audioRate;
+        float f   = freq * (1.0f + (slide - 1.0f) * t / seconds);
+        float env = std::exp(-decayPerSec * t);
+        if (t < 0.002f) env *= t / 0.002f;            // no click at the start
+        phase += twoPi * f / audioRate;
+
+        float s = 0.0f;
+        for (int h = 0; h < harmonics; ++h) s += std::sin(phase * (2 * h + 1)) / (2 * h + 1);
+        out.push_back((int16_t)(s * env * 0.35f * 32767.0f));
+    }
+}
+
+static void loadEffects(std::vector<int16_t>* effects) {
+    static const char* names[SOUND_COUNT] = { "audio/hit.wav", "audio/wall.wav", "audio/goal.wav" };
+    for (int i = 0; i < SOUND_COUNT; ++i) {
+        effects[i].clear();
+        if (loadEffect(names[i], effects[i])) continue;
+
+        switch (i) {
+            case SOUND_PADDLE_HIT: synthesize(effects[i], 0.07f, 880.0f, 0.7f, 40.0f, 3); break;
+            case SOUND_WALL:       synthesize(effects[i], 0.05f, 520.0f, 1.0f, 60.0f, 1); break;
+            case SOUND_GOAL:                                               // C E G
+                synthesize(effects[i], 0.09f, 523.25f, 1.0f, 8.0f, 2);
+                synthesize(effects[i], 0.09f, 659.25f, 1.0f, 8.0f, 2);
+                synthesize(effects[i], 0.30f, 783.99f, 1.0f, 6.0f, 2);
+                break;
+        }
+    }
+}
+
+// ===================== MUSIC STREAM =====================
+
+struct StereoFrame {
+    int16_t l, r;
+};
+
+const unsigned musicRingFrames = 16384;     // ~340 ms decoded ahead
+const int      musicChunkFrames = 1024;
+const float    musicGain        = 0.35f;
+
+// Decoded by its own thread into `ring`, which the mixer drains. The mixer
+// sets `released` when it lets go of the stream; only then is it deleted.
+struct MusicStream {
+    WavReader   wav;
+    bool        loop;
+    std::thread thread;
+    std::atomic<bool> stop, finished, released;
+    SpscQueue<StereoFrame, musicRingFrames> ring;
+
+    // Streaming thread only: source position and resampling state
+    int16_t     chunk[musicChunkFrames * 2];
+    int         chunkCount, chunkPos;
+    double      step, frac;
+    StereoFrame a, b;
+};
+
+static bool nextSourceFrame(MusicStream& m, StereoFrame& out) {
+    if (m.chunkPos == m.chunkCount) {
+        m.chunkPos   = 0;
+        m.chunkCount = wavRead(m.wav, m.chunk, musicChunkFrames);
+        if (m.chunkCount == 0 && m.loop) {
+            wavRewind(m.wav);
+            m.chunkCount = wavRead(m.wav, m.chunk, musicChunkFrames);
+        }
+        if (m.chunkCount == 0) return false;
+    }
+    out.l = m.chunk[m.chunkPos * 2];
+    out.r = m.chunk[m.chunkPos * 2 + 1];
+    m.chunkPos++;
+    return true;
+}
+
+static void streamLoop(MusicStream* m) {
+    bool more = nextSourceFrame(*m, m->a) && nextSourceFrame(*m, m->b);
+    while (more && !m->stop.load()) {
+        if (m->ring.size() > musicRingFrames - musicChunkFrames) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        for (int i = 0; i < musicChunkFrames && more; ++i) {
+            float t = (float)m->frac;
+            StereoFrame f;
+            f.l = (int16_t)(m->a.l + (m->b.l - m->a.l) * t);
+            f.r = (int16_t)(m->a.r + (m->b.r - m->a.r) * t);
+            m->ring.push(f);
+
+            m->frac += m->step;
+            while (m->frac >= 1.0 && more) {
+                m->frac -= 1.0;
+                m->a     = m->b;
+                more     = nextSourceFrame(*m, m->b);
+            }
+        }
+    }
+    m->finished.store(true);
+}
+
+// ===================== MIXER =====================
+
+enum AudioCommandType {
+    AUDIO_PLAY,
+    AUDIO_MUSIC                       // switch to `music` (0 = none)
+};
+
+struct AudioCommand {
+    int          type;
+    int          effect;
+    float        gainL, gainR;
+    double       time;                // when audioPlay() was called
+    MusicStream* music;
+};
+
+struct Voice {
+    const int16_t* samples;
+    int            length, position;
+    float          gainL, gainR;
+    bool           active;
+};
+
+const int maxVoices = 16;
+
+static std::string                  outputSpec;
+static std::thread                  mixerThread;
+static std::atomic<bool>            mixing(false);     // asked to run
+static std::atomic<bool>            mixerAlive(false); // hasn't given up on the device
+static std::vector<int16_t>         effects[SOUND_COUNT];
+static SpscQueue<AudioCommand, 256> commands;
+
+static MusicStream*                 currentMusic = 0;  // game thread's view
+static std::vector<MusicStream*>    retiredMusic;      // waiting for the mixer to let go
+static uint64_t                     queueFull = 0;     // game thread
+
+static std::mutex                   statsLock;
+static AudioStats                   sharedStats;
+
+static void clearStats(AudioStats& s) {
+    histogramClear(s.latencyUs);
+    histogramClear(s.mixUs);
+    s.played = s.dropped = s.underruns = s.musicStarved = 0;
+}
+
+static void raiseThreadPriority() {
+#ifdef _WIN32
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+#else
+    // Needs rtprio; without it the mixer stays a normal thread
+    sched_param p;
+    p.sched_priority = sched_get_priority_min(SCHED_FIFO) + 10;
+    pthread_setschedparam(pthread_self(), SCHED_FIFO, &p);
+#endif
+}
+
+static void mixerLoop() {
+    // Opening the device and decoding effects can take a while; the game's
+    // first frame shouldn't wait for it
+    AudioBackend* backend = audioOpenBackend(outputSpec.c_str(), audioRate, audioPeriodFrames, audioBufferPeriods);
+    if (!backend) {
+        mixerAlive.store(false);
+        return;
+    }
+    loadEffects(effects);
+    {
+        std::lock_guard<std::mutex> guard(statsLock);
+        sharedStats.backend = backend->name();
+    }
+    raiseThreadPriority();
+
+    Voice        voices[maxVoices];
+    MusicStream* music = 0;
+    float        mix[audioPeriodFrames * 2];
+    int16_t      out[audioPeriodFrames * 2];
+    double       startedAt[maxVoices];
+    AudioStats   local;
+    std::memset(voices, 0, sizeof(voices));
+    clearStats(local);
+
+    while (mixing.load(std::memory_order_relaxed)) {
+        // Mix at the last moment, so effects queued meanwhile still make it
+        backend->waitForRoom(audioPeriodFrames);
+        double mixStart = nowSeconds();
+        int    started  = 0;
+
+        AudioCommand c;
+        while (commands.pop(c)) {
+            if (c.type == AUDIO_MUSIC) {
+                if (music) music->released.store(true);
+                music = c.music;
+                continue;
+            }
+            Voice* v = 0;
+            for (int i = 0; i < maxVoices && !v; ++i) if (!voices[i].active) v = &voices[i];
+            if (!v) {
+                local.dropped++;
+                continue;
+            }
+            v->samples  = &effects[c.effect][0];
+            v->length   = (int)effects[c.effect].size();
+            v->position = 0;
+            v->gainL    = c.gainL;
+            v->gainR    = c.gainR;
+            v->active   = true;
+            startedAt[started++] = c.time;
+            local.played++;
+        }
+
+        std::memset(mix, 0, sizeof(mix));
+        if (music) {
+            StereoFrame f;
+            for (int i = 0; i < audioPeriodFrames; ++i) {
+                if (!music->ring.pop(f)) {
+                    if (!music->finished.load()) local.musicStarved++;
+                    break;
+                }
+                mix[i * 2]     += f.l * musicGain;
+                mix[i * 2 + 1] += f.r * musicGain;
+            }
+        }
+        for (int k = 0; k < maxVoices; ++k) {
+            Voice& v = voices[k];
+            if (!v.active) continue;
+            int n = v.length - v.position;
+            if (n > audioPeriodFrames) n = audioPeriodFrames;
+            const int16_t* s = v.samples + v.position;
+            for (int i = 0; i < n; ++i) {
+                mix[i * 2]     += s[i] * v.gainL;
+                mix[i * 2 + 1] += s[i] * v.gainR;
+            }
+            v.position += n;
+            if (v.position >= v.length) v.active = false;
+        }
+        for (int i = 0; i < audioPeriodFrames * 2; ++i) {
+            float s = mix[i];
+            out[i] = (int16_t)(s > 32767.0f ? 32767.0f : s < -32768.0f ? -32768.0f : s);
+        }
+
+        // The new effects start with this period, after what's queued
+        double now    = nowSeconds();
+        double audible = now + backend->queuedSeconds();
+        histogramAdd(local.mixUs, (uint64_t)((now - mixStart) * 1e6));
+        for (int i = 0; i < started; ++i) histogramAdd(local.latencyUs, (uint64_t)((audible - startedAt[i]) * 1e6));
+
+        if (!backend->write(out, audioPeriodFrames)) {
+            std::fprintf(stderr, "audio: lost the output device\n");
+            break;
+        }
+
+        // Never wait on the game thread; the numbers can go out next time
+        if (statsLock.try_lock()) {
+            histogramMerge(sharedStats.latencyUs, local.latencyUs);
+            histogramMerge(sharedStats.mixUs, local.mixUs);
+            sharedStats.played       += local.played;
+            sharedStats.dropped      += local.dropped;
+            sharedStats.musicStarved += local.musicStarved;
+            sharedStats.underruns     = backend->underruns();
+            statsLock.unlock();
+            clearStats(local);
+        }
+    }
+    if (music) music->released.store(true);
+    mixerAlive.store(false);
+    delete backend;
+}
+
+// ===================== API =====================
+
+static void retireMusic() {
+    if (!currentMusic) return;
+    currentMusic->stop.store(true);
+    retiredMusic.push_back(currentMusic);
+    currentMusic = 0;
+}
+
+// Frees retired streams the mixer has let go of (all of them once it's stopped).
+static void reapMusic(bool all) {
+    for (size_t i = 0; i < retiredMusic.size();) {
+        MusicStream* m = retiredMusic[i];
+        if (!all && !m->released.load()) {
+            ++i;
+            continue;
+        }
+        m->thread.join();
+        delete m;
+        retiredMusic.erase(retiredMusic.begin() + i);
+    }
+}
+
+void audioInit(const char* output) {
+    if (mixing.load()) return;
+
+    outputSpec = output;
+    clearStats(sharedStats);
+    sharedStats.backend = 0;
+    queueFull = 0;
+
+    mixing.store(true);
+    mixerAlive.store(true);
+    mixerThread = std::thread(mixerLoop);
+}
+
+void audioShutdown() {
+    if (!mixing.load()) return;
+
+    mixing.store(false);
+    mixerThread.join();
+    retireMusic();
+    reapMusic(true);
+
+    AudioStats s;
+    audioGetStats(s);
+    if (s.played > 0) {
+        std::printf("audio: %llu effects, hit-to-sound p50 %.1f ms  p99 %.1f ms, %llu underruns\n",
+                    (unsigned long long)s.played, histogramPercentile(s.latencyUs, 0.50) / 1e3,
+                    histogramPercentile(s.latencyUs, 0.99) / 1e3, (unsigned long long)s.underruns);
+    }
+}
+
+void audioPlay(SoundEffect effect, float gain, float pan) {
+    if (!mixerAlive.load()) return;
+
+    if (pan < -1.0f) pan = -1.0f;
+    if (pan >  1.0f) pan =  1.0f;
+
+    AudioCommand c;
+    c.type   = AUDIO_PLAY;
+    c.effect = effect;
+    c.gainL  = gain * (pan <= 0.0f ? 1.0f : 1.0f - pan);
+    c.gainR  = gain * (pan >= 0.0f ? 1.0f : 1.0f + pan);
+    c.time   = nowSeconds();
+    c.music  = 0;
+    if (!commands.push(c)) queueFull++;
+}
+
+bool audioPlayMusic(const char* name, bool loop) {
+    if (!mixerAlive.load()) return false;
+    reapMusic(false);
+
+    AssetData a;
+    MusicStream* m = new MusicStream;
+    if (!assetGet(name, a) || !wavOpen(a, m->wav)) {
+        delete m;
+        return false;
+    }
+    assetPrefetch(a);     // the streaming thread reads it front to back
+    m->loop       = loop;
+    m->stop       = false;
+    m->finished   = false;
+    m->released   = false;
+    m->chunkCount = m->chunkPos = 0;
+    m->step       = (double)m->wav.rate / audioRate;
+    m->frac       = 0.0;
+    m->thread     = std::thread(streamLoop, m);
+
+    retireMusic();
+    currentMusic = m;
+
+    AudioCommand c;
+    std::memset(&c, 0, sizeof(c));
+    c.type  = AUDIO_MUSIC;
+    c.music = m;
+    if (!commands.push(c)) queueFull++;    // kept until shutdown, silent
+    return true;
+}
+
+void audioStopMusic() {
+    if (!mixing.load() || !currentMusic) return;
+    retireMusic();
+
+    AudioCommand c;
+    std::memset(&c, 0, sizeof(c));
+    c.type = AUDIO_MUSIC;
+    if (!commands.push(c)) queueFull++;    // it stops anyway once decoded ahead runs out
+    reapMusic(false);
+}
+
+void audioGetStats(AudioStats& out) {
+    std::lock_guard<std::mutex> guard(statsLock);
+    out = sharedStats;
+    out.dropped += queueFull;
+}
@@ -0,0 +1,66 @@
+#ifndef PADDLE_RIVALS_AUDIO_H
+#define PADDLE_RIVALS_AUDIO_H
+
+// Audio engine: sound effects and background music, mixed on a thread of
+// its own.
+//
+// The mixer renders short periods (256 frames, ~5 ms at 48 kHz) and hands
+// them to a backend (audio_backend.h), whose blocking write paces it. The
+// game thread never touches the mixer's state: it pushes commands into a
+// lock-free queue that the mixer drains at the start of every period.
+// Sounds are assets (asset_pack.h). The mixer thread opens the device and
+// decodes the effects itself (audio/hit.wav, wall.wav, goal.wav, or
+// generated tones when those are missing), so audioInit() returns at once
+// and the first frame doesn't wait for either. Music is decoded from its
+// WAV a little ahead by a streaming thread, so the mixer never waits on the
+// disk.
+//
+// Every effect's latency is measured from the audioPlay() call to when
+// the device will play its first sample (the mix time plus what the
+// device still has queued).
+//
+// Call everything from one thread (the game's).
+
+#include "histogram.h"
+
+enum SoundEffect {
+    SOUND_PADDLE_HIT,
+    SOUND_WALL,
+    SOUND_GOAL,
+    SOUND_COUNT
+};
+
+const int audioRate          = 48000;
+const int audioPeriodFrames  = 256;
+const int audioBufferPeriods = 3;     // queued in the device: ~16 ms
+
+struct AudioStats {
+    const char* backend;              // "alsa", "winmm", "null", "file"; 0 until the output is open
+    Histogram   latencyUs;            // audioPlay() to audible, per effect
+    Histogram   mixUs;                // mixing one period
+    uint64_t    played;
+    uint64_t    dropped;              // queue full or no free voice
+    uint64_t    underruns;            // the device ran dry
+    uint64_t    musicStarved;         // periods the music stream wasn't ready for
+};
+
+// Starts the mixer, which opens the output ("auto", "alsa", "winmm",
+// "null", "file:PATH"); silence if it can't be opened. Call assetsOpen()
+// first.
+void audioInit(const char* output);
+
+// Stops the mixer and the music stream and closes the output.
+void audioShutdown();
+
+// gain 0..1, pan -1 (left) .. 1 (right). No-op before audioInit.
+void audioPlay(SoundEffect effect, float gain, float pan);
+
+// Streams an 8/16-bit PCM WAV asset (any rate, mono or stereo), replacing
+// the current music. False if the asset is missing or not such a WAV.
+bool audioPlayMusic(const char* name, bool loop);
+void audioStopMusic();
+
+// Totals since audioInit.
+void audioGetStats(AudioStats& out);
+
+#endif
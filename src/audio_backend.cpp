@@ -0,0 +1,378 @@
+#include "audio_backend.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>
+#else
+#include <dlfcn.h>
+#include <errno.h>
+#endif
+
+static double nowSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ===================== NULL / FILE =====================
+
+// A pretend device: plays `rate` frames a second from when it was opened
+// and holds bufferPeriods periods, so writes block like a real one.
+class PacedBackend : public AudioBackend {
+public:
+    PacedBackend() : rate(0), bufferFrames(0), startTime(0.0), written(0), dryCount(0) {}
+
+    bool open(int rate_, int periodFrames, int bufferPeriods) {
+        rate         = rate_;
+        bufferFrames = periodFrames * bufferPeriods;
+        startTime    = nowSeconds();
+        written      = 0;
+        return true;
+    }
+
+    void waitForRoom(int frames) {
+        double played = (nowSeconds() - startTime) * rate;
+        double excess = (double)(written + frames - bufferFrames) - played;
+        if (excess > 0.0) std::this_thread::sleep_for(std::chrono::microseconds((long long)(excess * 1e6 / rate)));
+    }
+
+    bool write(const int16_t* samples, int frames) {
+        waitForRoom(frames);
+        double played = (nowSeconds() - startTime) * rate;
+        if (played > (double)written) {
+            // Ran dry: it starts again from what we write now
+            if (written > 0) dryCount++;
+            startTime = nowSeconds() - (double)written / rate;
+        }
+        written += (uint64_t)frames;
+        return consume(samples, frames);
+    }
+
+    double queuedSeconds() {
+        double queued = (double)written / rate - (nowSeconds() - startTime);
+        return queued > 0.0 ? queued : 0.0;
+    }
+
+    uint64_t underruns() { return dryCount; }
+
+    const char* name() const { return "null"; }
+
+protected:
+    virtual bool consume(const int16_t*, int) { return true; }
+
+    int      rate;
+    int      bufferFrames;
+    double   startTime;
+    uint64_t written;
+    uint64_t dryCount;
+};
+
+// 16-bit stereo WAV; the sizes in the header are filled in on close.
+class FileBackend : public PacedBackend {
+public:
+    explicit FileBackend(const char* path_) : file(0), dataBytes(0) {
+        std::strncpy(path, path_, sizeof(path) - 1);
+        path[sizeof(path) - 1] = '\0';
+    }
+
+    ~FileBackend() {
+        if (!file) return;
+        writeHeader();
+        std::fclose(file);
+    }
+
+    bool open(int rate_, int periodFrames, int bufferPeriods) {
+        file = std::fopen(path, "wb");
+        if (!file) {
+            std::fprintf(stderr, "audio: could not write %s\n", path);
+            return false;
+        }
+        PacedBackend::open(rate_, periodFrames, bufferPeriods);
+        writeHeader();
+        return true;
+    }
+
+    const char* name() const { return "file"; }
+
+protected:
+    bool consume(const int16_t* samples, int frames) {
+        // The game only runs on little-endian machines, as WAV wants
+        size_t n = std::fwrite(samples, 4, (size_t)frames, file);
+        dataBytes += (uint32_t)n * 4;
+        return n == (size_t)frames;
+    }
+
+private:
+    void put32(uint8_t* p, uint32_t v) { p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; p[2] = (v >> 16) & 0xFF; p[3] = v >> 24; }
+    void put16(uint8_t* p, unsigned v) { p[0] = v & 0xFF; p[1] = (v >> 8) & 0xFF; }
+
+    void writeHeader() {
+        uint8_t h[44];
+        std::memcpy(h, "RIFF", 4);      put32(h + 4, 36 + dataBytes);
+        std::memcpy(h + 8, "WAVEfmt ", 8);
+        put32(h + 16, 16);              put16(h + 20, 1);          // PCM
+        put16(h + 22, 2);               put32(h + 24, (uint32_t)rate);
+        put32(h + 28, (uint32_t)rate * 4);
+        put16(h + 32, 4);               put16(h + 34, 16);
+        std::memcpy(h + 36, "data", 4); put32(h + 40, dataBytes);
+
+        long at = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        std::fwrite(h, 1, sizeof(h), file);
+        if (at > 0) std::fseek(file, at, SEEK_SET);
+    }
+
+    char     path[512];
+    FILE*    file;
+    uint32_t dataBytes;
+};
+
+// ===================== ALSA =====================
+
+#ifndef _WIN32
+
+// The few libasound calls we use, declared here so no ALSA headers are
+// needed to build
+typedef int  (*PfnPcmOpen)(void** pcm, const char* name, int stream, int mode);
+typedef int  (*PfnPcmSetParams)(void* pcm, int format, int access, unsigned channels,
+                                unsigned rate, int softResample, unsigned latencyUs);
+typedef long (*PfnPcmWritei)(void* pcm, const void* buffer, unsigned long frames);
+typedef int  (*PfnPcmRecover)(void* pcm, int err, int silent);
+typedef int  (*PfnPcmDelay)(void* pcm, long* frames);
+typedef int  (*PfnPcmWait)(void* pcm, int timeoutMs);
+typedef int  (*PfnPcmClose)(void* pcm);
+typedef const char* (*PfnStrError)(int err);
+
+const int alsaStreamPlayback     = 0;   // SND_PCM_STREAM_PLAYBACK
+const int alsaFormatS16LE        = 2;   // SND_PCM_FORMAT_S16_LE
+const int alsaAccessInterleaved  = 3;   // SND_PCM_ACCESS_RW_INTERLEAVED
+
+class AlsaBackend : public AudioBackend {
+public:
+    AlsaBackend() : lib(0), pcm(0), rate(0), dryCount(0) {}
+
+    ~AlsaBackend() {
+        if (pcm) pcmClose(pcm);
+        if (lib) dlclose(lib);
+    }
+
+    bool open(int rate_, int periodFrames, int bufferPeriods) {
+        lib = dlopen("libasound.so.2", RTLD_NOW);
+        if (!lib) return false;
+
+        pcmOpen      = (PfnPcmOpen)     dlsym(lib, "snd_pcm_open");
+        pcmSetParams = (PfnPcmSetParams)dlsym(lib, "snd_pcm_set_params");
+        pcmWritei    = (PfnPcmWritei)   dlsym(lib, "snd_pcm_writei");
+        pcmRecover   = (PfnPcmRecover)  dlsym(lib, "snd_pcm_recover");
+        pcmDelay     = (PfnPcmDelay)    dlsym(lib, "snd_pcm_delay");
+        pcmWait      = (PfnPcmWait)     dlsym(lib, "snd_pcm_wait");
+        pcmClose     = (PfnPcmClose)    dlsym(lib, "snd_pcm_close");
+        strError     = (PfnStrError)    dlsym(lib, "snd_strerror");
+        if (!pcmOpen || !pcmSetParams || !pcmWritei || !pcmRecover || !pcmDelay || !pcmWait || !pcmClose || !strError) {
+            return false;
+        }
+
+        int err = pcmOpen(&pcm, "default", alsaStreamPlayback, 0);
+        if (err < 0) {
+            std::fprintf(stderr, "audio: ALSA: %s\n", strError(err));
+            pcm = 0;
+            return false;
+        }
+        unsigned latencyUs = (unsigned)((double)periodFrames * bufferPeriods * 1e6 / rate_);
+        err = pcmSetParams(pcm, alsaFormatS16LE, alsaAccessInterleaved, 2, (unsigned)rate_, 1, latencyUs);
+        if (err < 0) {
+            std::fprintf(stderr, "audio: ALSA: %s\n", strError(err));
+            return false;
+        }
+        rate = rate_;
+        return true;
+    }
+
+    void waitForRoom(int) {
+        pcmWait(pcm, 20);     // until a period is free
+    }
+
+    bool write(const int16_t* samples, int frames) {
+        while (frames > 0) {
+            long n = pcmWritei(pcm, samples, (unsigned long)frames);
+            if (n < 0) {
+                if (n == -EPIPE) dryCount++;
+                if (pcmRecover(pcm, (int)n, 1) < 0) return false;
+                continue;
+            }
+            samples += n * 2;
+            frames  -= (int)n;
+        }
+        return true;
+    }
+
+    double queuedSeconds() {
+        long frames = 0;
+        if (pcmDelay(pcm, &frames) < 0 || frames < 0) return 0.0;
+        return (double)frames / rate;
+    }
+
+    uint64_t underruns() { return dryCount; }
+
+    const char* name() const { return "alsa"; }
+
+private:
+    void*    lib;
+    void*    pcm;
+    int      rate;
+    uint64_t dryCount;
+
+    PfnPcmOpen      pcmOpen;
+    PfnPcmSetParams pcmSetParams;
+    PfnPcmWritei    pcmWritei;
+    PfnPcmRecover   pcmRecover;
+    PfnPcmDelay     pcmDelay;
+    PfnPcmWait      pcmWait;
+    PfnPcmClose     pcmClose;
+    PfnStrError     strError;
+};
+
+#endif
+
+// ===================== WAVEOUT =====================
+
+#ifdef _WIN32
+
+// A ring of bufferPeriods waveOut buffers; write() waits for the oldest
+// to come back.
+class WinmmBackend : public AudioBackend {
+public:
+    WinmmBackend() : out(0), event(0), rate(0), period(0), next(0), started(false), dryCount(0) {}
+
+    ~WinmmBackend() {
+        if (out) {
+            waveOutReset(out);
+            for (size_t i = 0; i < headers.size(); ++i) waveOutUnprepareHeader(out, &headers[i], sizeof(WAVEHDR));
+            waveOutClose(out);
+        }
+        if (event) CloseHandle(event);
+    }
+
+    bool open(int rate_, int periodFrames, int bufferPeriods) {
+        WAVEFORMATEX fmt;
+        std::memset(&fmt, 0, sizeof(fmt));
+        fmt.wFormatTag      = WAVE_FORMAT_PCM;
+        fmt.nChannels       = 2;
+        fmt.nSamplesPerSec  = (DWORD)rate_;
+        fmt.wBitsPerSample  = 16;
+        fmt.nBlockAlign     = 4;
+        fmt.nAvgBytesPerSec = (DWORD)rate_ * 4;
+
+        event = CreateEvent(0, FALSE, FALSE, 0);
+        if (!event) return false;
+        if (waveOutOpen(&out, WAVE_MAPPER, &fmt, (DWORD_PTR)event, 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+            out = 0;
+            return false;
+        }
+
+        rate   = rate_;
+        period = periodFrames;
+        data.assign((size_t)periodFrames * 2 * bufferPeriods, 0);
+        headers.resize(bufferPeriods);
+        queued.assign(bufferPeriods, false);
+        for (int i = 0; i < bufferPeriods; ++i) {
+            WAVEHDR& h = headers[i];
+            std::memset(&h, 0, sizeof(h));
+            h.lpData         = (LPSTR)&data[(size_t)i * periodFrames * 2];
+            h.dwBufferLength = (DWORD)periodFrames * 4;
+            waveOutPrepareHeader(out, &h, sizeof(WAVEHDR));
+        }
+        return true;
+    }
+
+    void waitForRoom(int frames) {
+        if (queued[next] && !(headers[next].dwFlags & WHDR_DONE)) WaitForSingleObject(event, 20);
+    }
+
+    bool write(const int16_t* samples, int frames) {
+        while (frames > 0) {
+            WAVEHDR& h = headers[next];
+            while (queued[next] && !(h.dwFlags & WHDR_DONE)) WaitForSingleObject(event, 100);
+            if (inFlight() == 0 && started) dryCount++;
+
+            int n = frames < period ? frames : period;
+            std::memcpy(h.lpData, samples, (size_t)n * 4);
+            h.dwBufferLength = (DWORD)n * 4;
+            h.dwFlags       &= ~WHDR_DONE;
+            if (waveOutWrite(out, &h, sizeof(WAVEHDR)) != MMSYSERR_NOERROR) return false;
+
+            queued[next] = true;
+            started      = true;
+            next         = (next + 1) % (int)headers.size();
+            samples     += n * 2;
+            frames      -= n;
+        }
+        return true;
+    }
+
+    double queuedSeconds() { return (double)inFlight() * period / rate; }
+
+    uint64_t underruns() { return dryCount; }
+
+    const char* name() const { return "winmm"; }
+
+private:
+    int inFlight() const {
+        int n = 0;
+        for (size_t i = 0; i < headers.size(); ++i) {
+            if (queued[i] && !(headers[i].dwFlags & WHDR_DONE)) n++;
+        }
+        return n;
+    }
+
+    HWAVEOUT             out;
+    HANDLE               event;
+    int                  rate, period, next;
+    bool                 started;
+    uint64_t             dryCount;
+    std::vector<int16_t> data;
+    std::vector<WAVEHDR> headers;
+    std::vector<bool>    queued;
+};
+
+#endif
+
+// ===================== FACTORY =====================
+
+AudioBackend* audioOpenBackend(const char* spec, int rate, int periodFrames, int bufferPeriods) {
+    AudioBackend* b = 0;
+    bool automatic  = std::strcmp(spec, "auto") == 0;
+
+    if (std::strncmp(spec, "file:", 5) == 0) {
+        b = new FileBackend(spec + 5);
+#ifdef _WIN32
+    } else if (automatic || std::strcmp(spec, "winmm") == 0) {
+        b = new WinmmBackend;
+#else
+    } else if (automatic || std::strcmp(spec, "alsa") == 0) {
+        b = new AlsaBackend;
+#endif
+    } else if (std::strcmp(spec, "null") == 0) {
+        b = new PacedBackend;
+    } else {
+        std::fprintf(stderr, "audio: unknown output '%s'\n", spec);
+        return 0;
+    }
+
+    if (b->open(rate, periodFrames, bufferPeriods)) return b;
+    delete b;
+
+    if (automatic) {
+        std::fprintf(stderr, "audio: no sound device, playing silently\n");
+        b = new PacedBackend;
+        b->open(rate, periodFrames, bufferPeriods);
+        return b;
+    }
+    std::fprintf(stderr, "audio: could not open '%s'\n", spec);
+    return 0;
+}
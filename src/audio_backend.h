@@ -0,0 +1,43 @@
+#ifndef PADDLE_RIVALS_AUDIO_BACKEND_H
+#define PADDLE_RIVALS_AUDIO_BACKEND_H
+
+// Audio outputs for the mixer (audio.h).
+//
+// A backend takes interleaved 16-bit stereo periods; waiting for room in
+// the device is what paces the mixing thread. ALSA is loaded at run time
+// (like gl_ext does for GL), so the game builds and runs without libasound
+// and just stays silent. On Windows it's waveOut. The null backend throws
+// the samples away and the file backend writes a WAV; both keep real-time
+// pace like a device would, for headless tests.
+
+#include <cstdint>
+
+class AudioBackend {
+public:
+    virtual ~AudioBackend() {}
+
+    virtual bool open(int rate, int periodFrames, int bufferPeriods) = 0;
+
+    // Blocks until `frames` frames can be written without waiting (or a
+    // short timeout passes).
+    virtual void waitForRoom(int frames) = 0;
+
+    // Hands `frames` frames to the device, blocking if it is full. False
+    // when the device is gone.
+    virtual bool write(const int16_t* samples, int frames) = 0;
+
+    // Seconds of sound queued ahead of the next write: how long until it
+    // is heard.
+    virtual double queuedSeconds() = 0;
+
+    // Times the device ran dry since open().
+    virtual uint64_t underruns() = 0;
+
+    virtual const char* name() const = 0;
+};
+
+// "auto" (the platform's device, else null), "alsa", "winmm", "null", or
+// "file:PATH". Returns an opened backend, or 0 with a message on stderr.
+AudioBackend* audioOpenBackend(const char* spec, int rate, int periodFrames, int bufferPeriods);
+
+#endif
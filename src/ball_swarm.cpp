@@ -0,0 +1,515 @@
+#include "ball_swarm.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SWARM_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+// AVX is compiled per function and picked at run time, so the game doesn't
+// need -mavx and still runs on CPUs without it
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SWARM_HAVE_AVX 1
+#include <immintrin.h>
+#endif
+
+// ===================== TUNING =====================
+
+static const float minServeVx   = 180.0f;
+static const float serveVxRange = 240.0f;   // serves at 180..420 units/s across
+static const float maxVx        = minServeVx + serveVxRange;
+static const float maxVy        = 480.0f;   // with maxVx: < 11 units per 60 Hz step
+static const float spinBoost    = 90.0f;    // vy added per unit of hit offset
+
+static const float minRadius    = 4.0f;
+static const float maxRadius    = 7.0f;
+static const float cellSize     = 2.0f * maxRadius;   // touching balls are in adjacent cells
+
+// The per-step constants every kernel uses
+struct SwarmParams {
+    float dt;
+    float top;                               // arena height
+    float right;                             // arena width
+    float p1x, p1y, p1hw, p1hh, p1spin;      // spin: spinBoost / half height
+    float p2x, p2y, p2hw, p2hh, p2spin;
+};
+
+static int bitCount(unsigned m) {
+    int n = 0;
+    for (; m; m &= m - 1) n++;
+    return n;
+}
+
+// ===================== SERVING =====================
+
+static void serve(BallSwarm& s, int i) {
+    MatchRng& rng = s.rng;
+    s.x[i]  = ARENA_WIDTH / 2.0f;
+    s.y[i]  = ARENA_HEIGHT / 2.0f + (rngFloat(rng) - 0.5f) * 200.0f;
+    s.vx[i] = minServeVx + rngFloat(rng) * serveVxRange;
+    if (rngNext(rng) & 1) s.vx[i] = -s.vx[i];
+    s.vy[i] = (rngFloat(rng) * 2.0f - 1.0f) * 240.0f;
+    s.prevX[i] = s.x[i];
+    s.prevY[i] = s.y[i];
+}
+
+// Ball i left the arena this step
+static void scoreAndServe(BallSwarm& s, int i, SwarmEvents& ev) {
+    if (s.x[i] < 0.0f) ev.goalsP2++;
+    else               ev.goalsP1++;
+    serve(s, i);
+}
+
+void swarmInit(BallSwarm& s, int count, uint64_t seed) {
+    rngSeed(s.rng, seed);
+    s.count = count;
+    s.x.resize(count);  s.y.resize(count);
+    s.vx.resize(count); s.vy.resize(count);
+    s.radius.resize(count);
+    s.prevX.resize(count); s.prevY.resize(count);
+    s.collide = true;
+
+    SwarmGrid& g = s.grid;
+    g.cols = (int)std::ceil(ARENA_WIDTH / cellSize);
+    g.rows = (int)std::ceil(ARENA_HEIGHT / cellSize);
+    g.cellStart.resize(g.cols * g.rows + 1);
+    g.ballCell.resize(count);
+    g.order.resize(count);
+    g.scratch.resize(count);
+
+    for (int i = 0; i < count; ++i) {
+        serve(s, i);
+        // Spread over the middle of the field instead of one point
+        s.x[i] = ARENA_WIDTH  * (0.3f + 0.4f * rngFloat(s.rng));
+        s.y[i] = ARENA_HEIGHT * (0.05f + 0.9f * rngFloat(s.rng));
+        s.radius[i] = minRadius + (maxRadius - minRadius) * rngFloat(s.rng);
+        s.prevX[i]  = s.x[i];
+        s.prevY[i]  = s.y[i];
+    }
+}
+
+// ===================== SCALAR KERNEL =====================
+//
+// The reference: the vector kernels below do exactly this, lane by lane.
+
+static void stepScalar(BallSwarm& s, const SwarmParams& p, int begin, SwarmEvents& ev) {
+    float* X  = &s.x[0];
+    float* Y  = &s.y[0];
+    float* VX = &s.vx[0];
+    float* VY = &s.vy[0];
+    const float* R = &s.radius[0];
+
+    for (int i = begin; i < s.count; ++i) {
+        float r  = R[i];
+        float vx = VX[i], vy = VY[i];
+        float x  = X[i] + vx * p.dt;
+        float y  = Y[i] + vy * p.dt;
+
+        // Walls: reflect the overshoot
+        float lo = r, hi = p.top - r;
+        if (y < lo)      { y = (lo + lo) - y; vy =  std::fabs(vy); ev.walls++; }
+        else if (y > hi) { y = (hi + hi) - y; vy = -std::fabs(vy); ev.walls++; }
+
+        // P1 (front faces +x): overlapping, in front of its center, coming in
+        float dx = x - p.p1x, dy = y - p.p1y;
+        if (std::fabs(dx) < p.p1hw + r && std::fabs(dy) < p.p1hh + r && dx > 0.0f && vx < 0.0f) {
+            x  = p.p1x + (p.p1hw + r);
+            vx = -vx;
+            vy = vy + dy * p.p1spin;
+            ev.hitsP1++;
+        }
+        dx = x - p.p2x; dy = y - p.p2y;
+        if (std::fabs(dx) < p.p2hw + r && std::fabs(dy) < p.p2hh + r && dx < 0.0f && vx > 0.0f) {
+            x  = p.p2x - (p.p2hw + r);
+            vx = -vx;
+            vy = vy + dy * p.p2spin;
+            ev.hitsP2++;
+        }
+        vy = vy < -maxVy ? -maxVy : (vy > maxVy ? maxVy : vy);
+
+        X[i] = x; Y[i] = y; VX[i] = vx; VY[i] = vy;
+        if (x < 0.0f || x > p.right) scoreAndServe(s, i, ev);
+    }
+}
+
+// ===================== SSE2 KERNEL =====================
+
+#ifdef SWARM_HAVE_SSE2
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Returns the first ball it didn't do (the scalar kernel finishes the tail)
+static int stepSse2(BallSwarm& s, const SwarmParams& p, SwarmEvents& ev) {
+    float* X  = &s.x[0];
+    float* Y  = &s.y[0];
+    float* VX = &s.vx[0];
+    float* VY = &s.vy[0];
+    const float* R = &s.radius[0];
+
+    const __m128 absMask  = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    const __m128 zero  = _mm_setzero_ps();
+    const __m128 dt    = _mm_set1_ps(p.dt);
+    const __m128 top   = _mm_set1_ps(p.top);
+    const __m128 right = _mm_set1_ps(p.right);
+    const __m128 vyMin = _mm_set1_ps(-maxVy), vyMax = _mm_set1_ps(maxVy);
+    const __m128 p1x = _mm_set1_ps(p.p1x), p1y = _mm_set1_ps(p.p1y);
+    const __m128 p1hw = _mm_set1_ps(p.p1hw), p1hh = _mm_set1_ps(p.p1hh), p1spin = _mm_set1_ps(p.p1spin);
+    const __m128 p2x = _mm_set1_ps(p.p2x), p2y = _mm_set1_ps(p.p2y);
+    const __m128 p2hw = _mm_set1_ps(p.p2hw), p2hh = _mm_set1_ps(p.p2hh), p2spin = _mm_set1_ps(p.p2spin);
+
+    // Counted in locals: stores into ev could alias s.count and the arrays
+    int walls = 0, hitsP1 = 0, hitsP2 = 0;
+    int n = s.count;
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 r  = _mm_loadu_ps(R + i);
+        __m128 vx = _mm_loadu_ps(VX + i);
+        __m128 vy = _mm_loadu_ps(VY + i);
+        __m128 x  = _mm_add_ps(_mm_loadu_ps(X + i), _mm_mul_ps(vx, dt));
+        __m128 y  = _mm_add_ps(_mm_loadu_ps(Y + i), _mm_mul_ps(vy, dt));
+
+        __m128 lo    = r;
+        __m128 hi    = _mm_sub_ps(top, r);
+        __m128 below = _mm_cmplt_ps(y, lo);
+        __m128 above = _mm_andnot_ps(below, _mm_cmpgt_ps(y, hi));
+        __m128 absVy = _mm_and_ps(vy, absMask);
+        y  = select4(below, _mm_sub_ps(_mm_add_ps(lo, lo), y), y);
+        y  = select4(above, _mm_sub_ps(_mm_add_ps(hi, hi), y), y);
+        vy = select4(below, absVy, vy);
+        vy = select4(above, _mm_or_ps(absVy, signMask), vy);
+        walls += bitCount((unsigned)_mm_movemask_ps(_mm_or_ps(below, above)));
+
+        __m128 reach = _mm_add_ps(p1hw, r);
+        __m128 dx  = _mm_sub_ps(x, p1x), dy = _mm_sub_ps(y, p1y);
+        __m128 hit = _mm_and_ps(_mm_cmplt_ps(_mm_and_ps(dx, absMask), reach),
+                                _mm_cmplt_ps(_mm_and_ps(dy, absMask), _mm_add_ps(p1hh, r)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpgt_ps(dx, zero), _mm_cmplt_ps(vx, zero)));
+        x  = select4(hit, _mm_add_ps(p1x, reach), x);
+        vx = select4(hit, _mm_xor_ps(vx, signMask), vx);
+        vy = select4(hit, _mm_add_ps(vy, _mm_mul_ps(dy, p1spin)), vy);
+        hitsP1 += bitCount((unsigned)_mm_movemask_ps(hit));
+
+        reach = _mm_add_ps(p2hw, r);
+        dx  = _mm_sub_ps(x, p2x); dy = _mm_sub_ps(y, p2y);
+        hit = _mm_and_ps(_mm_cmplt_ps(_mm_and_ps(dx, absMask), reach),
+                         _mm_cmplt_ps(_mm_and_ps(dy, absMask), _mm_add_ps(p2hh, r)));
+        hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmplt_ps(dx, zero), _mm_cmpgt_ps(vx, zero)));
+        x  = select4(hit, _mm_sub_ps(p2x, reach), x);
+        vx = select4(hit, _mm_xor_ps(vx, signMask), vx);
+        vy = select4(hit, _mm_add_ps(vy, _mm_mul_ps(dy, p2spin)), vy);
+        hitsP2 += bitCount((unsigned)_mm_movemask_ps(hit));
+
+        vy = _mm_min_ps(_mm_max_ps(vy, vyMin), vyMax);
+
+        _mm_storeu_ps(X + i, x);
+        _mm_storeu_ps(Y + i, y);
+        _mm_storeu_ps(VX + i, vx);
+        _mm_storeu_ps(VY + i, vy);
+
+    }
+    ev.walls  += walls;
+    ev.hitsP1 += hitsP1;
+    ev.hitsP2 += hitsP2;
+
+    // Goals in a pass of their own: a call in the loop above would make
+    // the compiler keep all those constants in memory instead of registers
+    for (int j = 0; j < i; j += 4) {
+        __m128 x = _mm_loadu_ps(X + j);
+        unsigned out = (unsigned)_mm_movemask_ps(_mm_or_ps(_mm_cmplt_ps(x, zero), _mm_cmpgt_ps(x, right)));
+        for (int lane = 0; out; ++lane, out >>= 1) {
+            if (out & 1) scoreAndServe(s, j + lane, ev);
+        }
+    }
+    return i;
+}
+
+#endif
+
+// ===================== AVX KERNEL =====================
+
+#ifdef SWARM_HAVE_AVX
+
+// and/andnot/or rather than blendv: GCC folds blendv of a compare mask
+// into per-lane scalar selects
+__attribute__((target("avx")))
+static inline __m256 select8(__m256 mask, __m256 a, __m256 b) {
+    return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b));
+}
+
+// Same steps as stepSse2, 8 lanes
+__attribute__((target("avx")))
+static int stepAvx(BallSwarm& s, const SwarmParams& p, SwarmEvents& ev) {
+    float* X  = &s.x[0];
+    float* Y  = &s.y[0];
+    float* VX = &s.vx[0];
+    float* VY = &s.vy[0];
+    const float* R = &s.radius[0];
+
+    const __m256 absMask  = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    const __m256 zero  = _mm256_setzero_ps();
+    const __m256 dt    = _mm256_set1_ps(p.dt);
+    const __m256 top   = _mm256_set1_ps(p.top);
+    const __m256 right = _mm256_set1_ps(p.right);
+    const __m256 vyMin = _mm256_set1_ps(-maxVy), vyMax = _mm256_set1_ps(maxVy);
+    const __m256 p1x = _mm256_set1_ps(p.p1x), p1y = _mm256_set1_ps(p.p1y);
+    const __m256 p1hw = _mm256_set1_ps(p.p1hw), p1hh = _mm256_set1_ps(p.p1hh), p1spin = _mm256_set1_ps(p.p1spin);
+    const __m256 p2x = _mm256_set1_ps(p.p2x), p2y = _mm256_set1_ps(p.p2y);
+    const __m256 p2hw = _mm256_set1_ps(p.p2hw), p2hh = _mm256_set1_ps(p.p2hh), p2spin = _mm256_set1_ps(p.p2spin);
+
+    int walls = 0, hitsP1 = 0, hitsP2 = 0;
+    int n = s.count;
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 r  = _mm256_loadu_ps(R + i);
+        __m256 vx = _mm256_loadu_ps(VX + i);
+        __m256 vy = _mm256_loadu_ps(VY + i);
+        __m256 x  = _mm256_add_ps(_mm256_loadu_ps(X + i), _mm256_mul_ps(vx, dt));
+        __m256 y  = _mm256_add_ps(_mm256_loadu_ps(Y + i), _mm256_mul_ps(vy, dt));
+
+        __m256 lo    = r;
+        __m256 hi    = _mm256_sub_ps(top, r);
+        __m256 below = _mm256_cmp_ps(y, lo, _CMP_LT_OQ);
+        __m256 above = _mm256_andnot_ps(below, _mm256_cmp_ps(y, hi, _CMP_GT_OQ));
+        __m256 absVy = _mm256_and_ps(vy, absMask);
+        y  = select8(below, _mm256_sub_ps(_mm256_add_ps(lo, lo), y), y);
+        y  = select8(above, _mm256_sub_ps(_mm256_add_ps(hi, hi), y), y);
+        vy = select8(below, absVy, vy);
+        vy = select8(above, _mm256_or_ps(absVy, signMask), vy);
+        walls += bitCount((unsigned)_mm256_movemask_ps(_mm256_or_ps(below, above)));
+
+        __m256 reach = _mm256_add_ps(p1hw, r);
+        __m256 dx  = _mm256_sub_ps(x, p1x), dy = _mm256_sub_ps(y, p1y);
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_and_ps(dx, absMask), reach, _CMP_LT_OQ),
+                                   _mm256_cmp_ps(_mm256_and_ps(dy, absMask), _mm256_add_ps(p1hh, r), _CMP_LT_OQ));
+        hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(dx, zero, _CMP_GT_OQ),
+                                               _mm256_cmp_ps(vx, zero, _CMP_LT_OQ)));
+        x  = select8(hit, _mm256_add_ps(p1x, reach), x);
+        vx = select8(hit, _mm256_xor_ps(vx, signMask), vx);
+        vy = select8(hit, _mm256_add_ps(vy, _mm256_mul_ps(dy, p1spin)), vy);
+        hitsP1 += bitCount((unsigned)_mm256_movemask_ps(hit));
+
+        reach = _mm256_add_ps(p2hw, r);
+        dx  = _mm256_sub_ps(x, p2x); dy = _mm256_sub_ps(y, p2y);
+        hit = _mm256_and_ps(_mm256_cmp_ps(_mm256_and_ps(dx, absMask), reach, _CMP_LT_OQ),
+                            _mm256_cmp_ps(_mm256_and_ps(dy, absMask), _mm256_add_ps(p2hh, r), _CMP_LT_OQ));
+        hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(dx, zero, _CMP_LT_OQ),
+                                               _mm256_cmp_ps(vx, zero, _CMP_GT_OQ)));
+        x  = select8(hit, _mm256_sub_ps(p2x, reach), x);
+        vx = select8(hit, _mm256_xor_ps(vx, signMask), vx);
+        vy = select8(hit, _mm256_add_ps(vy, _mm256_mul_ps(dy, p2spin)), vy);
+        hitsP2 += bitCount((unsigned)_mm256_movemask_ps(hit));
+
+        vy = _mm256_min_ps(_mm256_max_ps(vy, vyMin), vyMax);
+
+        _mm256_storeu_ps(X + i, x);
+        _mm256_storeu_ps(Y + i, y);
+        _mm256_storeu_ps(VX + i, vx);
+        _mm256_storeu_ps(VY + i, vy);
+
+    }
+    ev.walls  += walls;
+    ev.hitsP1 += hitsP1;
+    ev.hitsP2 += hitsP2;
+
+    for (int j = 0; j < i; j += 8) {
+        __m256 x = _mm256_loadu_ps(X + j);
+        unsigned out = (unsigned)_mm256_movemask_ps(_mm256_or_ps(_mm256_cmp_ps(x, zero, _CMP_LT_OQ),
+                                                                 _mm256_cmp_ps(x, right, _CMP_GT_OQ)));
+        for (int lane = 0; out; ++lane, out >>= 1) {
+            if (out & 1) scoreAndServe(s, j + lane, ev);
+        }
+    }
+    return i;
+}
+
+#endif
+
+// ===================== BALL CONTACTS =====================
+
+static int cellIndex(float v, int cells) {
+    int c = (int)(v * (1.0f / cellSize));
+    return c < 0 ? 0 : (c >= cells ? cells - 1 : c);
+}
+
+// Puts field[order[k]] at k
+static void permute(std::vector<float>& field, const std::vector<int>& order, std::vector<float>& scratch, int n) {
+    for (int k = 0; k < n; ++k) scratch[k] = field[order[k]];
+    field.swap(scratch);
+}
+
+// Counting sort of the balls by cell, then every field is reordered to
+// match, so the balls of a cell (and of a row of cells) are next to each
+// other in memory.
+static void sortByCell(BallSwarm& s) {
+    SwarmGrid& g = s.grid;
+    int cells = g.cols * g.rows;
+    int n     = s.count;
+    int* start = &g.cellStart[0];
+    std::memset(start, 0, (cells + 1) * sizeof(int));
+
+    for (int i = 0; i < n; ++i) {
+        int c = cellIndex(s.y[i], g.rows) * g.cols + cellIndex(s.x[i], g.cols);
+        g.ballCell[i] = c;
+        start[c]++;
+    }
+    // Running totals: start[c] is where cell c ends...
+    for (int c = 1; c < cells; ++c) start[c] += start[c - 1];
+    start[cells] = n;
+    // ...and filling each cell from its end leaves it at the cell's start,
+    // with the balls of a cell in their old order
+    for (int i = n - 1; i >= 0; --i) g.order[--start[g.ballCell[i]]] = i;
+
+    permute(s.x,      g.order, g.scratch, n);
+    permute(s.y,      g.order, g.scratch, n);
+    permute(s.vx,     g.order, g.scratch, n);
+    permute(s.vy,     g.order, g.scratch, n);
+    permute(s.radius, g.order, g.scratch, n);
+    permute(s.prevX,  g.order, g.scratch, n);
+    permute(s.prevY,  g.order, g.scratch, n);
+}
+
+// Equal masses: push the two apart and swap their speeds along the line
+// between the centers, if they are closing in.
+static void resolveContact(BallSwarm& s, int i, int j, float dx, float dy, float d2, float rr) {
+    float d  = std::sqrt(d2);
+    float nx = dx / d, ny = dy / d;
+    float push = (rr - d) * 0.5f;
+    s.x[i] -= nx * push; s.y[i] -= ny * push;
+    s.x[j] += nx * push; s.y[j] += ny * push;
+
+    float vn = (s.vx[j] - s.vx[i]) * nx + (s.vy[j] - s.vy[i]) * ny;
+    if (vn >= 0.0f) return;
+    s.vx[i] += vn * nx; s.vy[i] += vn * ny;
+    s.vx[j] -= vn * nx; s.vy[j] -= vn * ny;
+
+    // Swapping can turn speed across into more speed along x or y than the
+    // tunnelling cap allows
+    int ball[2] = { i, j };
+    for (int k = 0; k < 2; ++k) {
+        float& vx = s.vx[ball[k]];
+        float& vy = s.vy[ball[k]];
+        vx = vx < -maxVx ? -maxVx : (vx > maxVx ? maxVx : vx);
+        vy = vy < -maxVy ? -maxVy : (vy > maxVy ? maxVy : vy);
+    }
+}
+
+// Ball i against balls [begin, end)
+static void collideRange(BallSwarm& s, int i, int begin, int end, SwarmEvents& ev) {
+    const float* X = &s.x[0];
+    const float* Y = &s.y[0];
+    const float* R = &s.radius[0];
+    float xi = X[i], yi = Y[i], ri = R[i];
+    for (int j = begin; j < end; ++j) {
+        float dx = X[j] - xi;
+        float dy = Y[j] - yi;
+        float rr = ri + R[j];
+        float d2 = dx * dx + dy * dy;
+        if (d2 >= rr * rr || d2 == 0.0f) continue;
+        resolveContact(s, i, j, dx, dy, d2, rr);
+        xi = X[i]; yi = Y[i];                   // moved apart
+        ev.contacts++;
+    }
+    ev.pairsTested += end - begin;
+}
+
+// Each ball against the rest of its cell and the cell to the right (one
+// run of indices), then the three cells above (another), so every pair is
+// seen once.
+static void collideBalls(BallSwarm& s, SwarmEvents& ev) {
+    sortByCell(s);
+    const SwarmGrid& g = s.grid;
+    const int* start = &g.cellStart[0];
+
+    for (int cy = 0; cy < g.rows; ++cy) {
+        for (int cx = 0; cx < g.cols; ++cx) {
+            int c        = cy * g.cols + cx;
+            int sideEnd  = start[cx + 1 < g.cols ? c + 2 : c + 1];
+            int upBegin  = 0, upEnd = 0;
+            if (cy + 1 < g.rows) {
+                int up  = c + g.cols;
+                upBegin = start[cx > 0 ? up - 1 : up];
+                upEnd   = start[cx + 1 < g.cols ? up + 2 : up + 1];
+            }
+            for (int i = start[c]; i < start[c + 1]; ++i) {
+                collideRange(s, i, i + 1, sideEnd, ev);
+                collideRange(s, i, upBegin, upEnd, ev);
+            }
+        }
+    }
+}
+
+// ===================== DISPATCH =====================
+
+static SwarmKernel currentKernel  = SWARM_KERNEL_COUNT;   // not picked yet
+
+bool swarmKernelAvailable(SwarmKernel k) {
+    switch (k) {
+        case SWARM_SCALAR: return true;
+#ifdef SWARM_HAVE_SSE2
+        case SWARM_SSE2:   return true;
+#endif
+#ifdef SWARM_HAVE_AVX
+        case SWARM_AVX:    return __builtin_cpu_supports("avx") != 0;
+#endif
+        default:           return false;
+    }
+}
+
+bool swarmSetKernel(SwarmKernel k) {
+    if (!swarmKernelAvailable(k)) return false;
+    currentKernel = k;
+    return true;
+}
+
+SwarmKernel swarmCurrentKernel() {
+    if (currentKernel == SWARM_KERNEL_COUNT) {
+        currentKernel = SWARM_SCALAR;
+        if (swarmKernelAvailable(SWARM_SSE2)) currentKernel = SWARM_SSE2;
+        if (swarmKernelAvailable(SWARM_AVX))  currentKernel = SWARM_AVX;
+    }
+    return currentKernel;
+}
+
+const char* swarmKernelName(SwarmKernel k) {
+    static const char* names[SWARM_KERNEL_COUNT] = { "scalar", "sse2", "avx" };
+    return k < SWARM_KERNEL_COUNT ? names[k] : "?";
+}
+
+void swarmStep(BallSwarm& s, const Paddle& p1, const Paddle& p2, float dt, SwarmEvents& ev) {
+    std::memset(&ev, 0, sizeof(ev));
+    if (s.count == 0) return;
+
+    std::memcpy(&s.prevX[0], &s.x[0], s.count * sizeof(float));
+    std::memcpy(&s.prevY[0], &s.y[0], s.count * sizeof(float));
+
+    SwarmParams p;
+    p.dt     = dt;
+    p.top    = ARENA_HEIGHT;
+    p.right  = ARENA_WIDTH;
+    p.p1x    = p1.x;            p.p1y  = p1.y;
+    p.p1hw   = p1.width * 0.5f; p.p1hh = p1.height * 0.5f;
+    p.p1spin = spinBoost / p.p1hh;
+    p.p2x    = p2.x;            p.p2y  = p2.y;
+    p.p2hw   = p2.width * 0.5f; p.p2hh = p2.height * 0.5f;
+    p.p2spin = spinBoost / p.p2hh;
+
+    int done = 0;
+    switch (swarmCurrentKernel()) {
+#ifdef SWARM_HAVE_AVX
+        case SWARM_AVX:  done = stepAvx(s, p, ev);  break;
+#endif
+#ifdef SWARM_HAVE_SSE2
+        case SWARM_SSE2: done = stepSse2(s, p, ev); break;
+#endif
+        default: break;
+    }
+    stepScalar(s, p, done, ev);
+
+    if (s.collide) collideBalls(s, ev);
+}
@@ -0,0 +1,77 @@
+#ifndef PADDLE_RIVALS_BALL_SWARM_H
+#define PADDLE_RIVALS_BALL_SWARM_H
+
+// Chaos mode: hundreds to thousands of extra balls in one arena.
+//
+// The balls are stored as structure-of-arrays (one array per field), so a
+// step is a few straight passes that run 4 (SSE2) or 8 (AVX) balls per
+// instruction. Every kernel does the same float operations in the same
+// order, so they give bit-identical results and a match looks the same on
+// any CPU.
+//
+// Unlike the match ball (match_engine.h), swarm balls are not swept: they
+// are capped below the speed at which a 60 Hz step could skip a paddle, and
+// a step is integrate, reflect off the walls, then one overlap test per
+// paddle. A ball that leaves the arena counts as a goal and is served again
+// from the center.
+//
+// Then the balls bounce off each other. Every step the balls are counting-
+// sorted into a uniform grid over the arena, and all their arrays are
+// reordered by cell, so only neighbouring balls are tested and they sit
+// next to each other in memory: the cost grows with the number of balls,
+// not the number of pairs. Ball indices are therefore not stable from one
+// step to the next. This pass is scalar and runs in a fixed order after
+// every kernel, so it keeps them identical.
+
+#include <vector>
+
+#include "match_engine.h"
+
+// After a step with contacts on, the balls of cell c are
+// cellStart[c] .. cellStart[c + 1] - 1, cells row by row from the bottom
+// left.
+struct SwarmGrid {
+    int                cols, rows;
+    std::vector<int>   cellStart;             // cols * rows + 1
+    std::vector<int>   ballCell;              // scratch for the sort, count each
+    std::vector<int>   order;
+    std::vector<float> scratch;
+};
+
+struct BallSwarm {
+    std::vector<float> x, y, vx, vy, radius;
+    std::vector<float> prevX, prevY;          // before the last step, for interpolation
+    int                count;
+    bool               collide;               // ball-ball contacts (on after swarmInit)
+    MatchRng           rng;
+    SwarmGrid          grid;
+};
+
+// What the last swarmStep() did.
+struct SwarmEvents {
+    int hitsP1, hitsP2;
+    int walls;
+    int goalsP1, goalsP2;                     // P1 scored: a ball left on the right
+    int pairsTested;                          // from the grid
+    int contacts;                             // of those, balls that touched
+};
+
+enum SwarmKernel {
+    SWARM_SCALAR,
+    SWARM_SSE2,
+    SWARM_AVX,
+    SWARM_KERNEL_COUNT
+};
+
+void swarmInit(BallSwarm& s, int count, uint64_t seed);
+
+void swarmStep(BallSwarm& s, const Paddle& p1, const Paddle& p2, float dt, SwarmEvents& ev);
+
+// The kernel swarmStep() uses; the best this build and CPU support by
+// default. False (and no change) if `k` isn't available.
+bool        swarmSetKernel(SwarmKernel k);
+bool        swarmKernelAvailable(SwarmKernel k);
+SwarmKernel swarmCurrentKernel();
+const char* swarmKernelName(SwarmKernel k);
+
+#endif
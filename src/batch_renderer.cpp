@@ -0,0 +1,239 @@
+#include "batch_renderer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <GL/gl.h>
+#include <cmath>
+#include <vector>
+
+// ===================== STATE =====================
+
+struct BatchVertex {
+    float         x, y;
+    float         u, v;
+    unsigned char r, g, b, a;
+};
+
+static std::vector<BatchVertex> vertices;   // reused every flush, never shrinks
+
+static unsigned char curR = 255, curG = 255, curB = 255, curA = 255;
+static bool  blendOn = false;
+static GLuint boundTexture = 0;
+
+static float scaleX = 1.0f, scaleY = 1.0f;
+static float offsetX = 0.0f, offsetY = 0.0f;
+
+static BatchStats frameStats = { 0, 0 };   // being counted
+static BatchStats lastStats  = { 0, 0 };   // last finished frame
+
+static unsigned char toByte(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 255;
+    return (unsigned char)(v * 255.0f + 0.5f);
+}
+
+void batchColor3f(float r, float g, float b) {
+    batchColor4f(r, g, b, 1.0f);
+}
+
+void batchColor4f(float r, float g, float b, float a) {
+    curR = toByte(r);
+    curG = toByte(g);
+    curB = toByte(b);
+    curA = toByte(a);
+}
+
+void batchCurrentColor(float out[4]) {
+    out[0] = curR / 255.0f;
+    out[1] = curG / 255.0f;
+    out[2] = curB / 255.0f;
+    out[3] = curA / 255.0f;
+}
+
+void batchSetBlend(bool alphaBlend) {
+    if (alphaBlend == blendOn) return;
+    batchFlush();
+    blendOn = alphaBlend;
+}
+
+void batchSetTexture(unsigned int texture) {
+    if (texture == boundTexture) return;
+    batchFlush();
+    boundTexture = texture;
+}
+
+void batchSetTransform(float sx, float sy, float ox, float oy) {
+    scaleX = sx;  scaleY = sy;
+    offsetX = ox; offsetY = oy;
+}
+
+void batchResetTransform() {
+    batchSetTransform(1.0f, 1.0f, 0.0f, 0.0f);
+}
+
+void batchGetTransform(float out[4]) {
+    out[0] = scaleX;  out[1] = scaleY;
+    out[2] = offsetX; out[3] = offsetY;
+}
+
+void batchTransformPoint(float& x, float& y) {
+    x = x * scaleX + offsetX;
+    y = y * scaleY + offsetY;
+}
+
+// ===================== SHAPES =====================
+
+static inline void pushVertex(float x, float y, float u = 0.0f, float v = 0.0f) {
+    BatchVertex vert;
+    vert.x = x * scaleX + offsetX;
+    vert.y = y * scaleY + offsetY;
+    vert.u = u;
+    vert.v = v;
+    vert.r = curR; vert.g = curG; vert.b = curB; vert.a = curA;
+    vertices.push_back(vert);
+}
+
+void batchQuad(float x, float y, float w, float h) {
+    pushVertex(x,     y);
+    pushVertex(x + w, y);
+    pushVertex(x + w, y + h);
+
+    pushVertex(x,     y);
+    pushVertex(x + w, y + h);
+    pushVertex(x,     y + h);
+}
+
+void batchTexturedQuad(float x, float y, float w, float h,
+                       float u0, float v0, float u1, float v1) {
+    pushVertex(x,     y,     u0, v0);
+    pushVertex(x + w, y,     u1, v0);
+    pushVertex(x + w, y + h, u1, v1);
+
+    pushVertex(x,     y,     u0, v0);
+    pushVertex(x + w, y + h, u1, v1);
+    pushVertex(x,     y + h, u0, v1);
+}
+
+void batchTriangle(float x1, float y1, float x2, float y2, float x3, float y3) {
+    pushVertex(x1, y1);
+    pushVertex(x2, y2);
+    pushVertex(x3, y3);
+}
+
+void batchFan(const float* xy, int n) {
+    for (int i = 1; i + 1 < n; ++i) {
+        pushVertex(xy[0],         xy[1]);
+        pushVertex(xy[2*i],       xy[2*i + 1]);
+        pushVertex(xy[2*(i + 1)], xy[2*(i + 1) + 1]);
+    }
+}
+
+void batchSprites(const float* x, const float* y, const float* r, const unsigned char* rgba, int n) {
+    size_t base = vertices.size();
+    vertices.resize(base + 6 * (size_t)n);
+    BatchVertex* out = &vertices[base];
+
+    BatchVertex v;
+    v.r = curR; v.g = curG; v.b = curB; v.a = curA;
+    for (int i = 0; i < n; ++i) {
+        if (rgba) {
+            v.r = rgba[4*i];     v.g = rgba[4*i + 1];
+            v.b = rgba[4*i + 2]; v.a = rgba[4*i + 3];
+        }
+        float cx = x[i] * scaleX + offsetX, hx = r[i] * scaleX;
+        float cy = y[i] * scaleY + offsetY, hy = r[i] * scaleY;
+        float x0 = cx - hx, x1 = cx + hx;
+        float y0 = cy - hy, y1 = cy + hy;
+
+        v.x = x0; v.y = y0; v.u = 0.0f; v.v = 0.0f; out[0] = v;
+        v.x = x1;           v.u = 1.0f;             out[1] = v;
+                  v.y = y1;             v.v = 1.0f; out[2] = v;
+        out[3] = out[0];
+        out[4] = out[2];
+        v.x = x0;           v.u = 0.0f;             out[5] = v;
+        out += 6;
+    }
+}
+
+unsigned int batchDiscTexture() {
+    static GLuint disc = 0;
+    if (disc) return disc;
+
+    const int size = 32;
+    unsigned char pixels[size * size * 4];
+    for (int j = 0; j < size; ++j) {
+        for (int i = 0; i < size; ++i) {
+            float dx = i + 0.5f - size * 0.5f;
+            float dy = j + 0.5f - size * 0.5f;
+            float edge = size * 0.5f - std::sqrt(dx * dx + dy * dy);   // pixels inside the rim
+            float a = edge < 0.0f ? 0.0f : (edge > 1.0f ? 1.0f : edge);
+            unsigned char* p = &pixels[(j * size + i) * 4];
+            p[0] = p[1] = p[2] = 255;
+            p[3] = toByte(a);
+        }
+    }
+
+    glGenTextures(1, &disc);
+    glBindTexture(GL_TEXTURE_2D, disc);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return disc;
+}
+
+// ===================== SUBMIT =====================
+
+void batchFlush() {
+    if (vertices.empty()) return;
+
+    if (blendOn) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    if (boundTexture) {
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, boundTexture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, sizeof(BatchVertex), &vertices[0].u);
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glVertexPointer(2, GL_FLOAT,         sizeof(BatchVertex), &vertices[0].x);
+    glColorPointer (4, GL_UNSIGNED_BYTE, sizeof(BatchVertex), &vertices[0].r);
+
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
+
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    if (boundTexture) {
+        glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glDisable(GL_TEXTURE_2D);
+    }
+
+    if (blendOn) glDisable(GL_BLEND);
+
+    frameStats.drawCalls++;
+    frameStats.vertices += (int)vertices.size();
+    vertices.clear();
+}
+
+void batchEndFrame() {
+    batchFlush();
+    lastStats  = frameStats;
+    frameStats.drawCalls = 0;
+    frameStats.vertices  = 0;
+}
+
+BatchStats batchFrameStats() {
+    return lastStats;
+}
@@ -0,0 +1,69 @@
+#ifndef PADDLE_RIVALS_BATCH_RENDERER_H
+#define PADDLE_RIVALS_BATCH_RENDERER_H
+
+// 2D shape batcher.
+//
+// Quads, polygons and triangles are collected as colored (optionally
+// textured) triangles in one dynamic vertex array and drawn with a single
+// glDrawArrays() per run of the same blend state and texture. Anything
+// that draws with GL directly (text, the 3D cube) must call batchFlush()
+// first so draw order is kept.
+//
+// Positions go through a CPU-side scale + offset (batchSetTransform), so
+// camera shake and the arena -> window mapping don't force a flush.
+
+// ===================== STATE =====================
+
+void batchColor3f(float r, float g, float b);
+void batchColor4f(float r, float g, float b, float a);
+void batchCurrentColor(float out[4]);
+
+// true = GL_SRC_ALPHA / GL_ONE_MINUS_SRC_ALPHA, false = opaque
+void batchSetBlend(bool alphaBlend);
+
+// GL texture for the following shapes (modulated by the color), 0 = none
+void batchSetTexture(unsigned int texture);
+
+// x' = x * sx + ox,  y' = y * sy + oy
+void batchSetTransform(float sx, float sy, float ox, float oy);
+void batchResetTransform();
+void batchGetTransform(float out[4]);     // sx, sy, ox, oy
+void batchTransformPoint(float& x, float& y);
+
+// ===================== SHAPES =====================
+
+void batchQuad(float x, float y, float w, float h);
+void batchTexturedQuad(float x, float y, float w, float h,
+                       float u0, float v0, float u1, float v1);
+void batchTriangle(float x1, float y1, float x2, float y2, float x3, float y3);
+
+// Triangle fan over n points (xy pairs), first point is the hub.
+void batchFan(const float* xy, int n);
+
+// n squares centered on (x[i], y[i]) with half size r[i], texture 0..1
+// across each, colored rgba[4*i .. 4*i+3] (or all in the current color if
+// rgba is 0). Meant for many small sprites kept as separate arrays (chaos
+// balls, particles), with batchDiscTexture().
+void batchSprites(const float* x, const float* y, const float* r, const unsigned char* rgba, int n);
+
+// White anti-aliased disc on a transparent background, made on first use
+// (needs a current GL context).
+unsigned int batchDiscTexture();
+
+// ===================== SUBMIT =====================
+
+// Draws everything queued so far.
+void batchFlush();
+
+// Flushes and closes the frame's counters (call right before swapping).
+void batchEndFrame();
+
+struct BatchStats {
+    int drawCalls;
+    int vertices;
+};
+
+// Counters of the last finished frame.
+BatchStats batchFrameStats();
+
+#endif
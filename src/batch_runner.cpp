@@ -0,0 +1,239 @@
+// Batch match runner: plays AI-vs-AI matches as fast as the CPU allows,
+// spread across a work-stealing thread pool, and prints aggregated stats.
+//
+//   batch_runner [--matches N] [--threads T] [--d1 0..3] [--d2 0..3]
+//                [--time SEC] [--max-score N] [--tick-hz HZ] [--seed S]
+//                [--rollouts N]
+//
+// Difficulty 3 (Expert) runs the search AI synchronously with a fixed
+// number of rollouts per decision, so results stay reproducible.
+//
+// Also checks that no step counts more than one paddle hit; the exit code
+// is 1 if one did.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+
+#include "ai.h"
+#include "match_engine.h"
+#include "search_ai.h"
+#include "thread_pool.h"
+
+// ===================== OPTIONS =====================
+
+struct BatchOptions {
+    int      matches;
+    int      threads;       // 0 = all hardware threads
+    int      difficulty1;   // left AI
+    int      difficulty2;   // right AI
+    float    gameTime;
+    int      maxScore;
+    int      tickHz;
+    uint64_t seed;
+    int      rollouts;      // Expert search rollouts per decision
+};
+
+static void printUsage() {
+    std::printf("usage: batch_runner [--matches N] [--threads T] [--d1 0..3] [--d2 0..3]\n"
+                "                    [--time SEC] [--max-score N] [--tick-hz HZ] [--seed S]\n"
+                "                    [--rollouts N]\n");
+}
+
+static bool parseOptions(int argc, char** argv, BatchOptions& o) {
+    o.matches     = 10000;
+    o.threads     = 0;
+    o.difficulty1 = 1;
+    o.difficulty2 = 2;
+    o.gameTime    = 90.0f;
+    o.maxScore    = 5;
+    o.tickHz      = 120;
+    o.seed        = 1;
+    o.rollouts    = 32;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+
+        if      (!std::strcmp(a, "--matches"))   o.matches     = std::atoi(v);
+        else if (!std::strcmp(a, "--threads"))   o.threads     = std::atoi(v);
+        else if (!std::strcmp(a, "--d1"))        o.difficulty1 = std::atoi(v);
+        else if (!std::strcmp(a, "--d2"))        o.difficulty2 = std::atoi(v);
+        else if (!std::strcmp(a, "--time"))      o.gameTime    = (float)std::atof(v);
+        else if (!std::strcmp(a, "--max-score")) o.maxScore    = std::atoi(v);
+        else if (!std::strcmp(a, "--tick-hz"))   o.tickHz      = std::atoi(v);
+        else if (!std::strcmp(a, "--seed"))      o.seed        = std::strtoull(v, 0, 10);
+        else if (!std::strcmp(a, "--rollouts"))  o.rollouts    = std::atoi(v);
+        else return false;
+    }
+
+    return o.matches > 0 && o.tickHz > 0 && o.rollouts > 0 &&
+           o.difficulty1 >= 0 && o.difficulty1 <= 3 &&
+           o.difficulty2 >= 0 && o.difficulty2 <= 3;
+}
+
+// ===================== PER-MATCH RESULT =====================
+
+const int rallyBuckets = 6;   // 0, 1, 2-3, 4-7, 8-15, 16+ hits
+const int maxScoreSlots = 16; // score distribution clamps above this
+
+struct MatchResult {
+    int scoreP1, scoreP2;
+    int rallies;
+    int rallyHits;                 // sum over finished rallies
+    int longestRally;
+    int rallyHist[rallyBuckets];
+    int multiHitSteps;             // steps where hitsInRally rose by more than 1
+};
+
+static int rallyBucket(int hits) {
+    if (hits <= 0)  return 0;
+    if (hits == 1)  return 1;
+    if (hits <= 3)  return 2;
+    if (hits <= 7)  return 3;
+    if (hits <= 15) return 4;
+    return 5;
+}
+
+static float sideSpeed(int difficulty) {
+    return difficulty == 3 ? searchAiSpeed : aiParams(difficulty).maxSpeed;
+}
+
+static PaddleInput sideInput(int difficulty, AiState& ai, SearchAi& search, int rollouts,
+                             const MatchState& m, float dt) {
+    if (difficulty == 3) return search.think(m, dt, rollouts);
+    return aiUpdate(ai, m, dt);
+}
+
+static void playMatch(const BatchOptions& o, uint64_t seed, MatchResult& r) {
+    MatchConfig cfg;
+    cfg.gameTime = o.gameTime;
+    cfg.maxScore = o.maxScore;
+    cfg.p1Speed  = sideSpeed(o.difficulty1);
+    cfg.p2Speed  = sideSpeed(o.difficulty2);
+
+    MatchState m;
+    matchInit(m, cfg, seed);
+
+    AiState ai1, ai2;
+    aiInit(ai1, 0, o.difficulty1, seed);
+    aiInit(ai2, 1, o.difficulty2, seed);
+
+    SearchAi search1, search2;
+    search1.reset(0, seed);
+    search2.reset(1, seed);
+
+    std::memset(&r, 0, sizeof(r));
+    float dt = 1.0f / (float)o.tickHz;
+
+    while (!m.over) {
+        PaddleInput in1 = sideInput(o.difficulty1, ai1, search1, o.rollouts, m, dt);
+        PaddleInput in2 = sideInput(o.difficulty2, ai2, search2, o.rollouts, m, dt);
+        int hitsBefore = m.hitsInRally;
+        matchStep(m, in1, in2, dt);
+
+        bool scored = (m.events & (EVENT_SCORE_P1 | EVENT_SCORE_P2)) != 0;
+        if ((scored ? m.lastRallyHits : m.hitsInRally) - hitsBefore > 1) r.multiHitSteps++;
+
+        if (scored) {
+            int hits = m.lastRallyHits;
+            r.rallies++;
+            r.rallyHits += hits;
+            if (hits > r.longestRally) r.longestRally = hits;
+            r.rallyHist[rallyBucket(hits)]++;
+        }
+    }
+
+    r.scoreP1 = m.scoreP1;
+    r.scoreP2 = m.scoreP2;
+}
+
+// ===================== MAIN =====================
+
+int main(int argc, char** argv) {
+    BatchOptions o;
+    if (!parseOptions(argc, argv, o)) {
+        printUsage();
+        return 1;
+    }
+
+    ThreadPool pool(o.threads);
+    std::vector<MatchResult> results(o.matches);
+
+    // Small chunks keep every worker busy; stealing evens out long matches
+    int grain = o.matches / (pool.size() * 16);
+    if (grain < 1) grain = 1;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+    pool.parallelFor(o.matches, grain, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) playMatch(o, o.seed + (uint64_t)i, results[i]);
+    });
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    // --- Aggregate ---
+    long winsP1 = 0, winsP2 = 0, draws = 0;
+    long rallies = 0, rallyHits = 0;
+    int  longestRally = 0;
+    long multiHitSteps = 0;
+    long rallyHist[rallyBuckets] = { 0 };
+    long scoreDist[maxScoreSlots][maxScoreSlots];
+    std::memset(scoreDist, 0, sizeof(scoreDist));
+
+    for (int i = 0; i < o.matches; ++i) {
+        const MatchResult& r = results[i];
+        if      (r.scoreP1 > r.scoreP2) winsP1++;
+        else if (r.scoreP2 > r.scoreP1) winsP2++;
+        else                            draws++;
+
+        rallies   += r.rallies;
+        rallyHits += r.rallyHits;
+        if (r.longestRally > longestRally) longestRally = r.longestRally;
+        multiHitSteps += r.multiHitSteps;
+        for (int b = 0; b < rallyBuckets; ++b) rallyHist[b] += r.rallyHist[b];
+
+        int s1 = r.scoreP1 < maxScoreSlots ? r.scoreP1 : maxScoreSlots - 1;
+        int s2 = r.scoreP2 < maxScoreSlots ? r.scoreP2 : maxScoreSlots - 1;
+        scoreDist[s1][s2]++;
+    }
+
+    const char* names[] = { "Easy", "Medium", "Hard", "Expert" };
+    double n = (double)o.matches;
+
+    std::printf("Matches     : %d  (%s vs %s, %.0fs, max score %d, %d Hz, %d threads)\n",
+                o.matches, names[o.difficulty1], names[o.difficulty2],
+                o.gameTime, o.maxScore, o.tickHz, pool.size());
+    std::printf("Wall time   : %.3f s\n", seconds);
+    std::printf("Throughput  : %.1f matches/s\n", n / seconds);
+    std::printf("\n");
+    std::printf("P1 wins     : %6.2f %%\n", 100.0 * winsP1 / n);
+    std::printf("P2 wins     : %6.2f %%\n", 100.0 * winsP2 / n);
+    std::printf("Draws       : %6.2f %%\n", 100.0 * draws / n);
+    std::printf("\n");
+    std::printf("Rallies     : %ld  (avg %.2f hits, longest %d)\n",
+                rallies, rallies ? (double)rallyHits / rallies : 0.0, longestRally);
+
+    const char* bucketNames[rallyBuckets] = { "0", "1", "2-3", "4-7", "8-15", "16+" };
+    for (int b = 0; b < rallyBuckets; ++b) {
+        std::printf("  %-5s hits : %6.2f %%\n", bucketNames[b],
+                    rallies ? 100.0 * rallyHist[b] / rallies : 0.0);
+    }
+
+    std::printf("\nFinal scores (P1 : P2)\n");
+    for (int s1 = 0; s1 < maxScoreSlots; ++s1) {
+        for (int s2 = 0; s2 < maxScoreSlots; ++s2) {
+            if (scoreDist[s1][s2] == 0) continue;
+            std::printf("  %2d : %-2d  %6.2f %%\n", s1, s2, 100.0 * scoreDist[s1][s2] / n);
+        }
+    }
+
+    if (multiHitSteps > 0) {
+        std::fprintf(stderr, "%ld steps counted more than one paddle hit\n", multiHitSteps);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,507 @@
+// Benchmark suite: physics (the match ball, the chaos-mode swarm and its
+// ball-ball contacts), AI,
+// serving, full matches and (optionally)
+// the drawGame / drawMainMenu render paths. Results are printed as JSON.
+//
+//   bench [--reps N] [--warmup N] [--filter TEXT] [--out FILE] [--render]
+//
+// Every benchmark runs `warmup` untimed repetitions, then `reps` timed
+// ones; each repetition runs the body a fixed number of times. Reported
+// numbers are per operation, with spread across repetitions.
+//
+// --render needs the game sources linked in (build with BENCH_RENDER and
+// PADDLE_RIVALS_NO_MAIN, see README). It opens a hidden GLUT window and
+// renders into an offscreen FBO, so with LIBGL_ALWAYS_SOFTWARE=1 it
+// measures Mesa llvmpipe like the kiosks run.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "ai.h"
+#include "ball_swarm.h"
+#include "match_engine.h"
+#include "search_ai.h"
+
+// ===================== HARNESS =====================
+
+struct BenchOptions {
+    int         reps;
+    int         warmup;
+    const char* filter;
+    const char* outPath;
+    bool        render;
+};
+
+struct BenchResult {
+    std::string name;
+    long   opsPerRep;
+    int    reps;
+    double meanNs, medianNs, minNs, maxNs, stddevNs;
+};
+
+static BenchOptions             options;
+static std::vector<BenchResult> results;
+static volatile float           sink;   // keeps results observable
+
+static double nowNs() {
+    using namespace std::chrono;
+    return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+static bool selected(const char* name) {
+    return !options.filter || std::strstr(name, options.filter);
+}
+
+// body(ops) must run `ops` operations.
+template <class Body>
+static void runBench(const char* name, long opsPerRep, Body body) {
+    if (!selected(name)) return;
+
+    for (int i = 0; i < options.warmup; ++i) body(opsPerRep);
+
+    std::vector<double> perOp(options.reps);
+    for (int i = 0; i < options.reps; ++i) {
+        double t0 = nowNs();
+        body(opsPerRep);
+        perOp[i] = (nowNs() - t0) / (double)opsPerRep;
+    }
+
+    BenchResult r;
+    r.name      = name;
+    r.opsPerRep = opsPerRep;
+    r.reps      = options.reps;
+
+    double sum = 0.0;
+    for (int i = 0; i < r.reps; ++i) sum += perOp[i];
+    r.meanNs = sum / r.reps;
+
+    double var = 0.0;
+    for (int i = 0; i < r.reps; ++i) var += (perOp[i] - r.meanNs) * (perOp[i] - r.meanNs);
+    r.stddevNs = r.reps > 1 ? std::sqrt(var / (r.reps - 1)) : 0.0;
+
+    std::sort(perOp.begin(), perOp.end());
+    r.minNs    = perOp.front();
+    r.maxNs    = perOp.back();
+    r.medianNs = perOp[r.reps / 2];
+
+    results.push_back(r);
+    std::fprintf(stderr, "%-36s %12.1f ns/op  (cv %.1f%%)\n",
+                 name, r.medianNs, r.meanNs > 0 ? 100.0 * r.stddevNs / r.meanNs : 0.0);
+}
+
+// ===================== FIXTURES =====================
+
+static const float benchDt = 1.0f / 120.0f;
+
+static MatchConfig benchConfig(int d1, int d2) {
+    MatchConfig cfg;
+    cfg.gameTime = 90.0f;
+    cfg.maxScore = 5;
+    cfg.p1Speed  = aiParams(d1).maxSpeed;
+    cfg.p2Speed  = aiParams(d2).maxSpeed;
+    return cfg;
+}
+
+// Medium (left) vs Hard (right) AI match.
+struct BenchMatch {
+    MatchState m;
+    AiState    ai1, ai2;
+};
+
+static void benchMatchStart(BenchMatch& b, uint64_t seed) {
+    matchInit(b.m, benchConfig(1, 2), seed);
+    aiInit(b.ai1, 0, 1, seed);
+    aiInit(b.ai2, 1, 2, seed);
+}
+
+static void benchMatchStep(BenchMatch& b) {
+    PaddleInput in1 = aiUpdate(b.ai1, b.m, benchDt);
+    PaddleInput in2 = aiUpdate(b.ai2, b.m, benchDt);
+    matchStep(b.m, in1, in2, benchDt);
+}
+
+// States sampled from a real AI-vs-AI match, so branches see realistic data.
+static std::vector<MatchState> sampleStates(int count) {
+    std::vector<MatchState> states;
+    BenchMatch b;
+    benchMatchStart(b, 42);
+
+    while ((int)states.size() < count) {
+        benchMatchStep(b);
+        states.push_back(b.m);
+        if (b.m.over) benchMatchStart(b, 42 + states.size());
+    }
+    return states;
+}
+
+// ===================== SIMULATION BENCHES =====================
+
+static void benchSimulation() {
+    std::vector<MatchState> states = sampleStates(4096);
+    const int mask = 4095;
+
+    // Swept ball step (walls + both paddles), then goals
+    runBench("physics/ball_integrate_collide", 1000000, [&](long ops) {
+        MatchState m = states[0];
+        for (long i = 0; i < ops; ++i) {
+            matchMoveBall(m, benchDt);
+            matchCheckGoals(m);
+        }
+        sink = m.ball.x;
+    });
+
+    // Worst case for the sweep: top speed, long 60 Hz ticks, moving paddles
+    runBench("physics/swept_fast_ball_60hz", 1000000, [&](long ops) {
+        float acc = 0.0f;
+        for (long i = 0; i < ops; ++i) {
+            MatchState& m = states[i & mask];
+            Ball  saved       = m.ball;
+            float savedFactor = m.speedFactor;
+            m.speedFactor = 2.0f;
+            matchMoveBall(m, 1.0f / 60.0f);
+            acc += m.ball.vx;
+            m.ball        = saved;
+            m.speedFactor = savedFactor;
+        }
+        sink = acc;
+    });
+
+    // The O(1) wall-folded prediction alone
+    runBench("ai/predict_intercept", 1000000, [&](long ops) {
+        float acc = 0.0f;
+        for (long i = 0; i < ops; ++i) {
+            const MatchState& m = states[i & mask];
+            float y;
+            if (aiPredictIntercept(m.ball.x, m.ball.y, m.ball.vx, m.ball.vy, m.ball.radius,
+                                   ARENA_WIDTH - 100.0f, y)) acc += y;
+        }
+        sink = acc;
+    });
+
+    // Per-tick AI over consecutive states, so the prediction cache behaves
+    // as in a match (mostly hits, a miss per hit/bounce/serve)
+    const char* aiNames[3] = { "ai/intercept_easy", "ai/intercept_medium", "ai/intercept_hard" };
+    for (int d = 0; d < 3; ++d) {
+        runBench(aiNames[d], 1000000, [&](long ops) {
+            AiState ai;
+            aiInit(ai, 1, d, 1);
+            float acc = 0.0f;
+            for (long i = 0; i < ops; ++i) {
+                PaddleInput in = aiUpdate(ai, states[i & mask], benchDt);
+                acc += in.moveX + in.moveY;
+            }
+            sink = acc;
+        });
+    }
+
+    // Expert search, synchronous: one op is a tick, which refines the plan
+    // with 32 rollouts at each decision step
+    runBench("ai/expert_think_32", 2000, [&](long ops) {
+        SearchAi expert;
+        expert.reset(1, 1);
+        float acc = 0.0f;
+        for (long i = 0; i < ops; ++i) {
+            PaddleInput in = expert.think(states[i & mask], benchDt, 32);
+            acc += in.moveY;
+        }
+        sink = acc;
+    });
+
+    runBench("engine/reset_ball", 1000000, [&](long ops) {
+        MatchState m = states[0];
+        for (long i = 0; i < ops; ++i) matchResetBall(m);
+        sink = m.ball.vx;
+    });
+
+    runBench("engine/match_step", 1000000, [&](long ops) {
+        BenchMatch b;
+        benchMatchStart(b, 7);
+        for (long i = 0; i < ops; ++i) {
+            benchMatchStep(b);
+            if (b.m.over) benchMatchStart(b, 7 + i);
+        }
+        sink = b.m.ball.x;
+    });
+
+    runBench("match/full_medium_vs_hard", 20, [&](long ops) {
+        int total = 0;
+        for (long i = 0; i < ops; ++i) {
+            BenchMatch b;
+            benchMatchStart(b, 1000 + i);
+            while (!b.m.over) benchMatchStep(b);
+            total += b.m.scoreP1 + b.m.scoreP2;
+        }
+        sink = (float)total;
+    });
+}
+
+// ===================== CHAOS MODE =====================
+
+static const int chaosBalls = 4096;
+
+// One op is one ball moved one tick. The baseline is today's path: every
+// ball its own MatchState, stepped by the swept scalar engine.
+static void benchChaos() {
+    std::vector<MatchState> states = sampleStates(chaosBalls);
+    runBench("chaos/match_ball_x4096", 100L * chaosBalls, [&](long ops) {
+        float acc = 0.0f;
+        for (long i = 0; i < ops; ++i) {
+            MatchState& m = states[i % chaosBalls];
+            matchMoveBall(m, benchDt);
+            matchCheckGoals(m);
+            acc += m.ball.x;
+        }
+        sink = acc;
+    });
+
+    // The swarm kernels against the same paddles
+    const MatchState& arena = states[0];
+    SwarmKernel saved = swarmCurrentKernel();
+    std::vector<float> finalX[SWARM_KERNEL_COUNT];
+    for (int k = 0; k < SWARM_KERNEL_COUNT; ++k) {
+        if (!swarmSetKernel((SwarmKernel)k)) continue;
+
+        char name[64];
+        std::sprintf(name, "chaos/swarm_%s_x4096", swarmKernelName((SwarmKernel)k));
+        runBench(name, 100L * chaosBalls, [&](long ops) {
+            BallSwarm s;
+            swarmInit(s, chaosBalls, 5);
+            s.collide = false;                  // the kernel alone
+            SwarmEvents ev;
+            for (long i = 0; i < ops; i += chaosBalls) swarmStep(s, arena.p1, arena.p2, benchDt, ev);
+            sink = s.x[0];
+        });
+
+        // Same start, same steps: every kernel must end bit-identical
+        BallSwarm s;
+        swarmInit(s, chaosBalls, 5);
+        SwarmEvents ev;
+        for (int i = 0; i < 1000; ++i) swarmStep(s, arena.p1, arena.p2, benchDt, ev);
+        finalX[k] = s.x;
+    }
+    swarmSetKernel(saved);
+
+    for (int k = 1; k < SWARM_KERNEL_COUNT; ++k) {
+        if (finalX[k].empty()) continue;
+        bool same = finalX[k].size() == finalX[0].size() &&
+                    std::memcmp(&finalX[k][0], &finalX[0][0], finalX[0].size() * sizeof(float)) == 0;
+        if (!same) std::fprintf(stderr, "chaos: %s kernel differs from scalar\n", swarmKernelName((SwarmKernel)k));
+    }
+
+    // Ball-ball contacts: the grid's cost per ball should stay flat as the
+    // swarm grows, where testing all pairs grows with the count
+    static const int contactCounts[] = { 1000, 2000, 4000, 8000 };
+    for (int c = 0; c < 4; ++c) {
+        int n = contactCounts[c];
+        char gridName[64], pairsName[64];
+        std::sprintf(gridName,  "chaos/grid_contacts_x%d", n);
+        std::sprintf(pairsName, "chaos/all_pairs_x%d", n);
+        bool runGrid  = selected(gridName);
+        bool runPairs = n <= 4000 && selected(pairsName);
+        if (!runGrid && !runPairs) continue;
+
+        BallSwarm s;
+        swarmInit(s, n, 5);
+        SwarmEvents ev;
+        for (int i = 0; i < 120; ++i) swarmStep(s, arena.p1, arena.p2, benchDt, ev);   // spread out
+
+        if (runGrid) {
+            runBench(gridName, 20L * n, [&](long ops) {
+                for (long i = 0; i < ops; i += n) swarmStep(s, arena.p1, arena.p2, benchDt, ev);
+                sink = s.x[0];
+            });
+            std::fprintf(stderr, "  %-34s %10.1f pairs tested/ball, %.2f contacts/ball\n",
+                         gridName, (double)ev.pairsTested / n, (double)ev.contacts / n);
+        }
+
+        if (!runPairs) continue;
+        runBench(pairsName, n, [&](long ops) {
+            int touching = 0;
+            for (long k = 0; k < ops; k += n) {
+                for (int i = 0; i < n; ++i) {
+                    for (int j = i + 1; j < n; ++j) {
+                        float dx = s.x[j] - s.x[i], dy = s.y[j] - s.y[i];
+                        float rr = s.radius[i] + s.radius[j];
+                        if (dx * dx + dy * dy < rr * rr) touching++;
+                    }
+                }
+            }
+            sink = (float)touching;
+        });
+    }
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i].name.compare(0, 6, "chaos/") != 0) continue;
+        std::fprintf(stderr, "  %-34s %10.0f balls/ms\n", results[i].name.c_str(), 1e6 / results[i].medianNs);
+    }
+}
+
+// ===================== RENDER BENCHES =====================
+
+#ifdef BENCH_RENDER
+
+#include <GL/freeglut.h>
+#include "batch_renderer.h"
+#include "gl_ext.h"
+#include "render_scale.h"
+#include "text_renderer.h"
+
+// From main.cpp (built with PADDLE_RIVALS_NO_MAIN)
+extern bool       isSinglePlayer;
+extern MatchState match;
+void reshapeCallback(int w, int h);
+void startNewMatch();
+void simulateTick(float dt);
+void drawGame();
+void drawMainMenu();
+
+static const int renderW = 1280;
+static const int renderH = 720;
+
+static bool initRenderContext(int argc, char** argv) {
+#ifndef _WIN32
+    if (!std::getenv("DISPLAY")) return false;   // freeglut would exit()
+#endif
+    glutInit(&argc, argv);
+    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+    glutInitWindowSize(renderW, renderH);
+    glutCreateWindow("Paddle Rivals bench");
+    glutHideWindow();
+
+    glExtInit();
+    if (!glExt.hasFramebuffers) return false;
+    textInit();
+
+    // Render into an FBO: a hidden window's back buffer may not be backed
+    GLuint color = 0, fbo = 0;
+    glGenTextures(1, &color);
+    glBindTexture(GL_TEXTURE_2D, color);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderW, renderH, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glExt.genFramebuffers(1, &fbo);
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glExt.framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    if (glExt.checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) return false;
+
+    reshapeCallback(renderW, renderH);
+    return true;
+}
+
+static void renderFrame(void (*draw)()) {
+    draw();
+    textFlush();
+    batchEndFrame();
+    glFinish();            // include the actual rasterization
+}
+
+// The same at a render scale: scene offscreen, upscaled, then the text
+static void renderScaledFrame(void (*draw)(), float scale) {
+    renderScaleBegin(renderW, renderH, scale);
+    draw();
+    renderScaleEnd();
+    renderFrame([] {});
+}
+
+static void benchRender(int argc, char** argv) {
+    if (!initRenderContext(argc, argv)) {
+        std::fprintf(stderr, "render benchmarks skipped: no display or no FBO support\n");
+        return;
+    }
+    std::fprintf(stderr, "GL renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+
+    isSinglePlayer = true;
+    startNewMatch();
+    for (int i = 0; i < 240; ++i) simulateTick(benchDt);
+
+    runBench("render/drawMainMenu", 50, [&](long ops) {
+        for (long i = 0; i < ops; ++i) renderFrame(drawMainMenu);
+    });
+
+    runBench("render/drawGame", 50, [&](long ops) {
+        for (long i = 0; i < ops; ++i) renderFrame(drawGame);
+    });
+
+    if (!renderScaleSupported()) return;
+    runBench("render/drawGame_scale75", 50, [&](long ops) {
+        for (long i = 0; i < ops; ++i) renderScaledFrame(drawGame, 0.75f);
+    });
+    runBench("render/drawGame_scale50", 50, [&](long ops) {
+        for (long i = 0; i < ops; ++i) renderScaledFrame(drawGame, 0.5f);
+    });
+}
+
+#endif
+
+// ===================== OUTPUT =====================
+
+static void writeJson(FILE* f) {
+    std::fprintf(f, "{\n");
+    std::fprintf(f, "  \"version\": 1,\n");
+    std::fprintf(f, "  \"unit\": \"ns/op\",\n");
+    std::fprintf(f, "  \"reps\": %d,\n", options.reps);
+    std::fprintf(f, "  \"warmup\": %d,\n", options.warmup);
+    std::fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        std::fprintf(f,
+            "    {\"name\": \"%s\", \"ops_per_rep\": %ld, \"reps\": %d, "
+            "\"mean\": %.3f, \"median\": %.3f, \"min\": %.3f, \"max\": %.3f, "
+            "\"stddev\": %.3f, \"cv\": %.5f}%s\n",
+            r.name.c_str(), r.opsPerRep, r.reps,
+            r.meanNs, r.medianNs, r.minNs, r.maxNs, r.stddevNs,
+            r.meanNs > 0 ? r.stddevNs / r.meanNs : 0.0,
+            i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(f, "  ]\n}\n");
+}
+
+// ===================== MAIN =====================
+
+int main(int argc, char** argv) {
+    options.reps    = 15;
+    options.warmup  = 3;
+    options.filter  = 0;
+    options.outPath = 0;
+    options.render  = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if      (!std::strcmp(a, "--reps")   && i + 1 < argc) options.reps    = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--warmup") && i + 1 < argc) options.warmup  = std::atoi(argv[++i]);
+        else if (!std::strcmp(a, "--filter") && i + 1 < argc) options.filter  = argv[++i];
+        else if (!std::strcmp(a, "--out")    && i + 1 < argc) options.outPath = argv[++i];
+        else if (!std::strcmp(a, "--render"))                 options.render  = true;
+        else {
+            std::fprintf(stderr, "usage: bench [--reps N] [--warmup N] [--filter TEXT] [--out FILE] [--render]\n");
+            return 1;
+        }
+    }
+    if (options.reps < 1) options.reps = 1;
+
+    benchSimulation();
+    benchChaos();
+
+    if (options.render) {
+#ifdef BENCH_RENDER
+        benchRender(argc, argv);
+#else
+        std::fprintf(stderr, "render benchmarks not built (compile with -DBENCH_RENDER)\n");
+#endif
+    }
+
+    FILE* out = options.outPath ? std::fopen(options.outPath, "w") : stdout;
+    if (!out) {
+        std::fprintf(stderr, "cannot open %s\n", options.outPath);
+        return 1;
+    }
+    writeJson(out);
+    if (out != stdout) std::fclose(out);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "frame_scheduler.h"
+
+#include <algorithm>   // nth_element
+
+// ===================== STATE =====================
+
+static const double defaultRefreshHz = 60.0;
+static const int    measureFrames    = 120;    // swaps timed to find the refresh rate
+
+static double period       = 1.0 / defaultRefreshHz;
+static bool   vsyncOn      = false;
+static bool   measuring    = false;            // vsync, rate not known yet
+
+static double measured[measureFrames];
+static int    measuredCount = 0;
+
+static double nextDeadline  = 0.0;             // paced mode: start of the next frame
+static double lastDone      = 0.0;
+
+static uint64_t frameCount  = 0;
+static uint64_t missedCount = 0;
+
+static double fpsWindowStart  = 0.0;
+static int    fpsWindowFrames = 0;
+static double fpsValue        = 0.0;
+
+void frameSchedulerInit(double refreshHz, bool vsync) {
+    period        = 1.0 / (refreshHz > 0.0 ? refreshHz : defaultRefreshHz);
+    vsyncOn       = vsync;
+    measuring     = vsync && refreshHz <= 0.0;
+    measuredCount = 0;
+
+    nextDeadline = 0.0;
+    lastDone     = 0.0;
+    frameCount   = 0;
+    missedCount  = 0;
+
+    fpsWindowStart  = 0.0;
+    fpsWindowFrames = 0;
+    fpsValue        = 0.0;
+}
+
+// ===================== SCHEDULING =====================
+
+double frameSchedulerWait(double now) {
+    if (vsyncOn || nextDeadline <= 0.0) return 0.0;   // the swap paces us
+    return nextDeadline > now ? nextDeadline - now : 0.0;
+}
+
+// Median swap interval; if the driver ignored the swap interval the frames
+// come much faster than any display, so pace them ourselves instead.
+static void finishMeasuring() {
+    std::nth_element(measured, measured + measureFrames / 2, measured + measureFrames);
+    double median = measured[measureFrames / 2];
+
+    measuring = false;
+    if (median < 1.0 / 400.0) {
+        vsyncOn      = false;
+        period       = 1.0 / defaultRefreshHz;
+        nextDeadline = 0.0;
+    } else {
+        period = std::min(median, 1.0 / 24.0);
+    }
+}
+
+void frameSchedulerFrameDone(double now) {
+    frameCount++;
+
+    if (lastDone > 0.0) {
+        double interval = now - lastDone;
+
+        if (measuring) {
+            measured[measuredCount++] = interval;
+            if (measuredCount == measureFrames) finishMeasuring();
+        } else if (vsyncOn) {
+            // Swaps land on vblanks; a gap of 1.5 periods or more skipped one
+            if (interval > 1.5 * period) missedCount++;
+        }
+    }
+    lastDone = now;
+
+    if (!vsyncOn && !measuring) {
+        if (nextDeadline <= 0.0) {
+            nextDeadline = now + period;
+        } else if (now > nextDeadline + period) {
+            // Still busy when the next frame was due: restart the schedule
+            // from now rather than bursting to catch up
+            missedCount++;
+            nextDeadline = now;
+        } else {
+            nextDeadline += period;
+        }
+    }
+
+    // FPS over roughly the last second
+    if (fpsWindowStart <= 0.0) fpsWindowStart = now;
+    fpsWindowFrames++;
+    if (now - fpsWindowStart >= 1.0) {
+        fpsValue        = fpsWindowFrames / (now - fpsWindowStart);
+        fpsWindowStart  = now;
+        fpsWindowFrames = 0;
+    }
+}
+
+void frameSchedulerIdle() {
+    lastDone     = 0.0;
+    nextDeadline = 0.0;
+}
+
+FrameSchedulerStats frameSchedulerStats() {
+    FrameSchedulerStats s;
+    s.refreshHz       = 1.0 / period;
+    s.vsync           = vsyncOn;
+    s.fps             = fpsValue;
+    s.frames          = frameCount;
+    s.missedDeadlines = missedCount;
+    return s;
+}
@@ -0,0 +1,41 @@
+#ifndef PADDLE_RIVALS_FRAME_SCHEDULER_H
+#define PADDLE_RIVALS_FRAME_SCHEDULER_H
+
+// Frame scheduler: decides when the next frame is drawn, independently of
+// the simulation tick rate.
+//
+// With vsync the swap itself paces frames to the display, so the scheduler
+// only watches frame times: it estimates the refresh rate from them and
+// counts frames that missed their vblank. Without vsync it paces frames to
+// a target rate with deadlines, and a frame still running when the next
+// one was due counts as missed (the schedule then restarts from now
+// instead of bursting to catch up).
+//
+// No GL here; the caller swaps buffers and reports when the frame is done.
+
+#include <cstdint>
+
+struct FrameSchedulerStats {
+    double   refreshHz;        // display rate (measured with vsync) or target rate
+    bool     vsync;
+    double   fps;              // average over the last second
+    uint64_t frames;
+    uint64_t missedDeadlines;
+};
+
+// refreshHz <= 0: unknown, measured from swap times (vsync) or 60 Hz.
+void frameSchedulerInit(double refreshHz, bool vsync);
+
+// Seconds until the next frame should start; 0 = draw now.
+double frameSchedulerWait(double now);
+
+// Call once per frame, right after the swap.
+void frameSchedulerFrameDone(double now);
+
+// Frames stop on purpose (nothing to redraw): the gap before the next
+// frame isn't a missed deadline.
+void frameSchedulerIdle();
+
+FrameSchedulerStats frameSchedulerStats();
+
+#endif
@@ -0,0 +1,86 @@
+#include "gl_ext.h"
+
+#include <GL/freeglut.h>
+#include <cstdlib>   // atoi
+#include <cstring>
+
+GlExt glExt;
+
+static bool hasExtension(const char* name) {
+    const char* list = (const char*)glGetString(GL_EXTENSIONS);
+    if (!list) return false;
+
+    size_t len = std::strlen(name);
+    for (const char* p = std::strstr(list, name); p; p = std::strstr(p + len, name)) {
+        bool startOk = (p == list) || p[-1] == ' ';
+        bool endOk   = p[len] == ' ' || p[len] == '\0';
+        if (startOk && endOk) return true;
+    }
+    return false;
+}
+
+static int glMajorVersion() {
+    const char* v = (const char*)glGetString(GL_VERSION);
+    return v ? std::atoi(v) : 1;
+}
+
+// Core (GL 3.0 / ARB_framebuffer_object) names first, then the EXT ones
+static void* loadProc(const char* core, const char* ext) {
+    void* p = (void*)glutGetProcAddress(core);
+    if (!p) p = (void*)glutGetProcAddress(ext);
+    return p;
+}
+
+void glExtInit() {
+    std::memset(&glExt, 0, sizeof(glExt));
+
+    int major = glMajorVersion();
+
+    glExt.hasNpotTextures = major >= 2 || hasExtension("GL_ARB_texture_non_power_of_two");
+
+    if (major >= 3 || hasExtension("GL_ARB_framebuffer_object") ||
+        hasExtension("GL_EXT_framebuffer_object")) {
+        glExt.genFramebuffers        = (PfnGenFramebuffers)       loadProc("glGenFramebuffers",        "glGenFramebuffersEXT");
+        glExt.deleteFramebuffers     = (PfnDeleteFramebuffers)    loadProc("glDeleteFramebuffers",     "glDeleteFramebuffersEXT");
+        glExt.bindFramebuffer        = (PfnBindFramebuffer)       loadProc("glBindFramebuffer",        "glBindFramebufferEXT");
+        glExt.framebufferTexture2D   = (PfnFramebufferTexture2D)  loadProc("glFramebufferTexture2D",   "glFramebufferTexture2DEXT");
+        glExt.checkFramebufferStatus = (PfnCheckFramebufferStatus)loadProc("glCheckFramebufferStatus", "glCheckFramebufferStatusEXT");
+
+        glExt.hasFramebuffers = glExt.genFramebuffers && glExt.deleteFramebuffers &&
+                                glExt.bindFramebuffer && glExt.framebufferTexture2D &&
+                                glExt.checkFramebufferStatus;
+
+        glExt.genRenderbuffers        = (PfnGenRenderbuffers)       loadProc("glGenRenderbuffers",        "glGenRenderbuffersEXT");
+        glExt.deleteRenderbuffers     = (PfnDeleteRenderbuffers)    loadProc("glDeleteRenderbuffers",     "glDeleteRenderbuffersEXT");
+        glExt.bindRenderbuffer        = (PfnBindRenderbuffer)       loadProc("glBindRenderbuffer",        "glBindRenderbufferEXT");
+        glExt.renderbufferStorage     = (PfnRenderbufferStorage)    loadProc("glRenderbufferStorage",     "glRenderbufferStorageEXT");
+        glExt.framebufferRenderbuffer = (PfnFramebufferRenderbuffer)loadProc("glFramebufferRenderbuffer", "glFramebufferRenderbufferEXT");
+
+        glExt.hasRenderbuffers = glExt.hasFramebuffers && glExt.genRenderbuffers &&
+                                 glExt.deleteRenderbuffers && glExt.bindRenderbuffer &&
+                                 glExt.renderbufferStorage && glExt.framebufferRenderbuffer;
+    }
+
+    // Swap control is a WGL/GLX extension, not a GL one
+#ifdef _WIN32
+    glExt.swapInterval = (PfnSwapInterval)glutGetProcAddress("wglSwapIntervalEXT");
+#else
+    glExt.swapInterval = (PfnSwapInterval)loadProc("glXSwapIntervalMESA", "glXSwapIntervalSGI");
+#endif
+}
+
+bool glExtSetSwapInterval(int interval) {
+    if (!glExt.swapInterval) return false;
+    // wglSwapIntervalEXT returns TRUE on success, the GLX ones return 0
+#ifdef _WIN32
+    return glExt.swapInterval(interval) != 0;
+#else
+    return glExt.swapInterval(interval) == 0;
+#endif
+}
+
+int glExtPow2(int v) {
+    int p = 1;
+    while (p < v) p <<= 1;
+    return p;
+}
@@ -0,0 +1,84 @@
+#ifndef PADDLE_RIVALS_GL_EXT_H
+#define PADDLE_RIVALS_GL_EXT_H
+
+// Minimal loader for the few post-1.1 GL entry points we use.
+// opengl32 on Windows only exports GL 1.1, so these are fetched at run time
+// through glutGetProcAddress. Everything here is optional: callers check
+// the has* flags and fall back to plain GL 1.1 paths.
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include <GL/gl.h>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER          0x8D40
+#define GL_COLOR_ATTACHMENT0    0x8CE0
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#define GL_FRAMEBUFFER_BINDING  0x8CA6
+#endif
+
+#ifndef GL_RENDERBUFFER
+#define GL_RENDERBUFFER         0x8D41
+#define GL_DEPTH_ATTACHMENT     0x8D00
+#endif
+
+#ifndef GL_DEPTH_COMPONENT16
+#define GL_DEPTH_COMPONENT16    0x81A5
+#endif
+
+typedef void   (APIENTRY *PfnGenFramebuffers)(GLsizei n, GLuint* ids);
+typedef void   (APIENTRY *PfnDeleteFramebuffers)(GLsizei n, const GLuint* ids);
+typedef void   (APIENTRY *PfnBindFramebuffer)(GLenum target, GLuint id);
+typedef void   (APIENTRY *PfnFramebufferTexture2D)(GLenum target, GLenum attachment,
+                                                   GLenum texTarget, GLuint tex, GLint level);
+typedef GLenum (APIENTRY *PfnCheckFramebufferStatus)(GLenum target);
+typedef void   (APIENTRY *PfnGenRenderbuffers)(GLsizei n, GLuint* ids);
+typedef void   (APIENTRY *PfnDeleteRenderbuffers)(GLsizei n, const GLuint* ids);
+typedef void   (APIENTRY *PfnBindRenderbuffer)(GLenum target, GLuint id);
+typedef void   (APIENTRY *PfnRenderbufferStorage)(GLenum target, GLenum format,
+                                                  GLsizei width, GLsizei height);
+typedef void   (APIENTRY *PfnFramebufferRenderbuffer)(GLenum target, GLenum attachment,
+                                                      GLenum rbTarget, GLuint rb);
+
+// wglSwapIntervalEXT / glXSwapIntervalMESA / glXSwapIntervalSGI
+typedef int    (APIENTRY *PfnSwapInterval)(int interval);
+
+struct GlExt {
+    bool hasFramebuffers;
+    bool hasNpotTextures;
+    bool hasRenderbuffers;          // depth buffers for FBOs
+
+    PfnGenFramebuffers        genFramebuffers;
+    PfnDeleteFramebuffers     deleteFramebuffers;
+    PfnBindFramebuffer        bindFramebuffer;
+    PfnFramebufferTexture2D   framebufferTexture2D;
+    PfnCheckFramebufferStatus checkFramebufferStatus;
+
+    PfnGenRenderbuffers        genRenderbuffers;
+    PfnDeleteRenderbuffers     deleteRenderbuffers;
+    PfnBindRenderbuffer        bindRenderbuffer;
+    PfnRenderbufferStorage     renderbufferStorage;
+    PfnFramebufferRenderbuffer framebufferRenderbuffer;
+
+    PfnSwapInterval swapInterval;   // null: vsync can't be changed
+};
+
+extern GlExt glExt;
+
+// Call once after the GL context exists.
+void glExtInit();
+
+// Sets the swap interval of the current window (1 = vsync, 0 = off).
+// Returns false if the driver has no swap control.
+bool glExtSetSwapInterval(int interval);
+
+// Smallest power of two >= v (used when NPOT textures aren't available).
+int glExtPow2(int v);
+
+#endif
@@ -0,0 +1,64 @@
+#include "histogram.h"
+
+#include <cstring>
+
+// Values below histogramSubBuckets get a bucket each; above that, bucket =
+// octave * sub + the next three bits under the leading one.
+static int bucketOf(uint64_t v) {
+    if (v < (uint64_t)histogramSubBuckets) return (int)v;
+
+    int top = 63;
+    while (!(v >> top)) top--;                     // leading bit, >= 3
+    int sub = (int)((v >> (top - 3)) & (histogramSubBuckets - 1));
+    int b   = (top - 2) * histogramSubBuckets + sub;
+    return b < histogramBuckets ? b : histogramBuckets - 1;
+}
+
+// Largest value that lands in bucket b.
+static uint64_t bucketTop(int b) {
+    if (b < histogramSubBuckets) return (uint64_t)b;
+
+    int top = b / histogramSubBuckets + 2;
+    int sub = b % histogramSubBuckets;
+    uint64_t base = (uint64_t)(histogramSubBuckets + sub) << (top - 3);
+    return base + ((uint64_t)1 << (top - 3)) - 1;
+}
+
+void histogramClear(Histogram& h) {
+    std::memset(&h, 0, sizeof(h));
+}
+
+void histogramAdd(Histogram& h, uint64_t value) {
+    h.counts[bucketOf(value)]++;
+    h.count++;
+    h.sum += value;
+    if (value > h.maxValue) h.maxValue = value;
+}
+
+void histogramMerge(Histogram& into, const Histogram& from) {
+    for (int b = 0; b < histogramBuckets; ++b) into.counts[b] += from.counts[b];
+    into.count += from.count;
+    into.sum   += from.sum;
+    if (from.maxValue > into.maxValue) into.maxValue = from.maxValue;
+}
+
+uint64_t histogramPercentile(const Histogram& h, double p) {
+    if (h.count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p * (double)h.count);
+    if (rank >= h.count) rank = h.count - 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < histogramBuckets; ++b) {
+        seen += h.counts[b];
+        if (seen > rank) {
+            uint64_t v = bucketTop(b);
+            return v < h.maxValue ? v : h.maxValue;
+        }
+    }
+    return h.maxValue;
+}
+
+double histogramMean(const Histogram& h) {
+    return h.count ? (double)h.sum / (double)h.count : 0.0;
+}
@@ -0,0 +1,33 @@
+#ifndef PADDLE_RIVALS_HISTOGRAM_H
+#define PADDLE_RIVALS_HISTOGRAM_H
+
+// Fixed-size latency histogram for the server tools.
+//
+// Values (nanoseconds, or any unsigned count) go into log-linear buckets:
+// every power of two is split into histogramSubBuckets, so percentiles are
+// within ~12 % at any scale, adding a value is a few instructions, and two
+// histograms merge by adding their counts.
+
+#include <cstdint>
+
+const int histogramSubBuckets = 8;
+const int histogramBuckets    = 41 * histogramSubBuckets;   // up to 2^40 (~18 min in ns)
+
+struct Histogram {
+    uint64_t counts[histogramBuckets];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t maxValue;
+};
+
+void histogramClear(Histogram& h);
+void histogramAdd(Histogram& h, uint64_t value);
+void histogramMerge(Histogram& into, const Histogram& from);
+
+// Value below which fraction p (0..1) of the samples lie: the upper edge of
+// that bucket, capped at the largest value seen. 0 when empty.
+uint64_t histogramPercentile(const Histogram& h, double p);
+
+double histogramMean(const Histogram& h);
+
+#endif
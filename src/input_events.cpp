@@ -0,0 +1,131 @@
+#include "input_events.h"
+
+#include <atomic>
+
+#include "replay.h"       // replaySubSteps
+#include "spsc_queue.h"
+
+struct InputEvent {
+    double  time;
+    int16_t key;
+    bool    special;
+    bool    down;
+};
+
+static SpscQueue<InputEvent, 1024> queue;
+static InputEvent                  next;               // popped, not applied yet
+static bool                        haveNext = false;
+
+// Keyboard as of the last applied event
+static bool keys[256];
+static bool specials[256];
+
+// Presses applied since the last present, waiting for it
+static const int maxWaiting = 64;
+static double    waiting[maxWaiting];
+static int       waitingCount = 0;
+
+static InputStats            stats;            // zeroed: an empty histogram
+static std::atomic<uint64_t> droppedEvents(0); // producer side
+
+// ===================== QUEUE =====================
+
+void inputKeyEvent(int key, bool special, bool down, double time) {
+    InputEvent e;
+    e.time    = time;
+    e.key     = (int16_t)(key & 0xFF);
+    e.special = special;
+    e.down    = down;
+    if (!queue.push(e)) droppedEvents++;
+}
+
+// The oldest event, if it happened before `before`.
+static bool peekBefore(double before, InputEvent& out) {
+    if (!haveNext) haveNext = queue.pop(next);
+    if (!haveNext || next.time >= before) return false;
+    out = next;
+    return true;
+}
+
+// Updates the keyboard; true if a key changed.
+static bool apply(const InputEvent& e) {
+    haveNext = false;
+    stats.events++;
+
+    bool& k = e.special ? specials[e.key] : keys[e.key];
+    if (k == e.down) return false;          // key repeat
+    k = e.down;
+    if (e.down && waitingCount < maxWaiting) waiting[waitingCount++] = e.time;
+    return true;
+}
+
+// ===================== TICKS =====================
+
+void inputSkipTo(double time) {
+    InputEvent e;
+    while (peekBefore(time, e)) apply(e);
+}
+
+static void addHeld(double* heldTime, uint8_t bits, double seconds) {
+    for (int i = 0; i < 8; ++i) {
+        if (bits & (1 << i)) heldTime[i] += seconds;
+    }
+}
+
+void inputConsumeTick(double start, double end, InputMapping map, InputTick& out) {
+    inputSkipTo(start);
+
+    uint8_t bits = map(keys, specials);
+    double  heldTime[8] = { 0.0 };
+    double  at = start;
+    bool    changed = false;
+
+    // Keys pressed this tick, to spot the ones released in it too
+    int     pressed[16];
+    int     pressedCount = 0;
+
+    out.bits = bits;
+    InputEvent e;
+    while (peekBefore(end, e)) {
+        addHeld(heldTime, bits, e.time - at);
+        at = e.time;
+        if (!apply(e)) continue;
+
+        int code = e.key | (e.special ? 256 : 0);
+        if (e.down && pressedCount < 16) pressed[pressedCount++] = code;
+        if (!e.down) {
+            for (int i = 0; i < pressedCount; ++i) {
+                if (pressed[i] == code) stats.subTickTaps++;
+            }
+        }
+        bits      = map(keys, specials);
+        out.bits |= bits;
+        changed   = true;
+    }
+    addHeld(heldTime, bits, end - at);
+
+    out.partial = false;
+    for (int i = 0; i < 8; ++i) {
+        int steps = (int)(heldTime[i] / (end - start) * replaySubSteps + 0.5);
+        if (steps > replaySubSteps) steps = replaySubSteps;
+        if (steps == 0 && (out.bits & (1 << i))) steps = 1;    // a tap always counts
+        out.held[i] = (uint8_t)steps;
+        if (steps != 0 && steps != replaySubSteps) out.partial = changed;
+    }
+}
+
+// ===================== LATENCY =====================
+
+void inputPresented(double time) {
+    for (int i = 0; i < waitingCount; ++i) {
+        double us = (time - waiting[i]) * 1e6;
+        histogramAdd(stats.latencyUs, us > 0.0 ? (uint64_t)us : 0);
+    }
+    waitingCount = 0;
+}
+
+InputStats inputStats() {
+    InputStats s = stats;
+    s.dropped = droppedEvents.load();
+    return s;
+}
@@ -0,0 +1,54 @@
+#ifndef PADDLE_RIVALS_INPUT_EVENTS_H
+#define PADDLE_RIVALS_INPUT_EVENTS_H
+
+// Timestamped keyboard input for the simulation.
+//
+// The GLUT key callbacks push every press and release with the time it
+// arrived into a lock-free queue. Each simulation tick covers a slice of
+// real time; inputConsumeTick() replays the events that fall inside that
+// slice and reports, per input bit, how much of the tick it was held. A key
+// tapped and released between two ticks is no longer lost, and a press
+// late in a tick only moves the paddle for the part of the tick after it.
+//
+// Input-to-present latency is measured per press: from its timestamp to
+// the end of the buffer swap of the first frame simulated past it.
+//
+// Call everything from the GLUT thread, except that inputKeyEvent() may be
+// called from one other thread instead.
+
+#include <cstdint>
+
+#include "histogram.h"
+
+// key: a character, or a GLUT_KEY_* code when `special`.
+void inputKeyEvent(int key, bool special, bool down, double time);
+
+// Input bits for a keyboard state (the game's key mapping).
+typedef uint8_t (*InputMapping)(const bool* keys, const bool* special);
+
+struct InputTick {
+    uint8_t bits;                     // held at any point of the tick
+    uint8_t held[8];                  // per bit, in replaySubSteps-ths of the tick
+    bool    partial;                  // some key changed mid-tick (else held is 0 or all)
+};
+
+// Applies the events before `end` and fills `out` for the tick [start, end).
+void inputConsumeTick(double start, double end, InputMapping map, InputTick& out);
+
+// Applies events before `time` without a tick (screens that don't simulate,
+// or time the simulation skipped).
+void inputSkipTo(double time);
+
+// A frame was presented (its swap returned) at `time`.
+void inputPresented(double time);
+
+struct InputStats {
+    Histogram latencyUs;              // press to present
+    uint64_t  events;
+    uint64_t  subTickTaps;            // pressed and released within one tick
+    uint64_t  dropped;                // queue full
+};
+
+InputStats inputStats();
+
+#endif
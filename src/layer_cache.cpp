@@ -0,0 +1,131 @@
+#include "layer_cache.h"
+
+#include "gl_ext.h"
+#include "batch_renderer.h"
+
+#include <GL/glu.h>
+
+// ===================== CACHE SLOTS =====================
+
+struct CachedLayer {
+    GLuint texture;
+    GLuint fbo;
+    int    theme;
+    int    width, height;      // window size the layer was built for
+    int    pixelW, pixelH;     // size it was rendered at (the viewport's)
+    int    texW, texH;         // allocated texture size (pow2 if needed)
+    bool   valid;
+};
+
+static CachedLayer layers[LAYER_COUNT];
+
+static void releaseLayer(CachedLayer& L) {
+    if (L.fbo)     glExt.deleteFramebuffers(1, &L.fbo);
+    if (L.texture) glDeleteTextures(1, &L.texture);
+    L.fbo     = 0;
+    L.texture = 0;
+    L.valid   = false;
+}
+
+void layerCacheInvalidate() {
+    for (int i = 0; i < LAYER_COUNT; ++i) releaseLayer(layers[i]);
+}
+
+// ===================== BUILD =====================
+
+static bool buildLayer(CachedLayer& L, int theme, int w, int h, int pw, int ph, void (*drawFn)()) {
+    releaseLayer(L);
+
+    L.texW = glExt.hasNpotTextures ? pw : glExtPow2(pw);
+    L.texH = glExt.hasNpotTextures ? ph : glExtPow2(ph);
+
+    glGenTextures(1, &L.texture);
+    glBindTexture(GL_TEXTURE_2D, L.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, L.texW, L.texH, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint prevFbo = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+
+    glExt.genFramebuffers(1, &L.fbo);
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, L.fbo);
+    glExt.framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, L.texture, 0);
+
+    if (glExt.checkFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        glExt.bindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+        releaseLayer(L);
+        return false;
+    }
+
+    // Render the layer in plain window space, at pw x ph pixels
+    GLint prevViewport[4];
+    glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+    glViewport(0, 0, pw, ph);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, w, 0, h);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    batchFlush();
+    batchResetTransform();
+    drawFn();
+    batchFlush();
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+
+    L.theme  = theme;
+    L.width  = w;
+    L.height = h;
+    L.pixelW = pw;
+    L.pixelH = ph;
+    L.valid  = true;
+    return true;
+}
+
+// ===================== DRAW =====================
+
+bool layerCacheDraw(LayerId id, int theme, int w, int h, void (*drawFn)()) {
+    if (!glExt.hasFramebuffers || w <= 0 || h <= 0) return false;
+
+    // Build at the resolution it's drawn at: the window's, or a smaller
+    // one at a render scale below 100% (render_scale.h)
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    int pw = viewport[2] > 0 ? viewport[2] : w;
+    int ph = viewport[3] > 0 ? viewport[3] : h;
+
+    CachedLayer& L = layers[id];
+    if (!L.valid || L.theme != theme || L.width != w || L.height != h ||
+        L.pixelW != pw || L.pixelH != ph) {
+        // Building resets the batch transform; keep the caller's one
+        float t[4];
+        batchGetTransform(t);
+        bool ok = buildLayer(L, theme, w, h, pw, ph, drawFn);
+        batchSetTransform(t[0], t[1], t[2], t[3]);
+        if (!ok) return false;
+    }
+
+    batchSetTexture(L.texture);
+    batchColor3f(1.0f, 1.0f, 1.0f);
+    batchTexturedQuad(0.0f, 0.0f, (float)w, (float)h,
+                      0.0f, 0.0f, (float)pw / L.texW, (float)ph / L.texH);
+    batchSetTexture(0);
+    return true;
+}
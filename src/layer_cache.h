@@ -0,0 +1,25 @@
+#ifndef PADDLE_RIVALS_LAYER_CACHE_H
+#define PADDLE_RIVALS_LAYER_CACHE_H
+
+// Offscreen cache for static background layers.
+//
+// A layer is rendered once into a texture (through an FBO) for the current
+// theme, window size and viewport size (the render resolution), then
+// composited each frame as one textured quad.
+// Call layerCacheInvalidate() when the window is resized or the theme
+// changes.
+
+enum LayerId {
+    LAYER_MENU_BACKGROUND,
+    LAYER_GAME_BACKGROUND,
+    LAYER_COUNT
+};
+
+// Draws (0,0)-(w,h) in pixel space from the cache, rendering it first with
+// drawFn if needed. Returns false if FBOs aren't available; the caller
+// should then just call drawFn itself.
+bool layerCacheDraw(LayerId id, int theme, int w, int h, void (*drawFn)());
+
+void layerCacheInvalidate();
+
+#endif
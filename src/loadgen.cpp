@@ -0,0 +1,584 @@
+// Load generator for the dedicated server: thousands of simulated clients
+// that join, hold random keys at the tick rate and measure what they get
+// back.
+//
+//   loadgen [--server HOST:PORT] [--clients N] [--vs-ai PCT] [--threads T]
+//           [--duration SEC] [--input-hz HZ] [--report SEC] [--no-rejoin]
+//           [--viewers N] [--watch MATCH]
+//
+// Clients are spread over --threads event loops, one UDP socket each.
+// --vs-ai percent of them ask for a match against the server's AI, the
+// rest get paired with each other. When a match ends a client joins again
+// (unless --no-rejoin), so the load stays constant. Every --report seconds
+// it prints join latency, input-to-state round trips (the server echoes
+// the newest input it had in each state) and packet rates.
+//
+// --viewers adds spectators, each on a socket of its own since the server
+// tells viewers apart by address. They watch match --watch (0, the
+// default: the newest one, and the next newest whenever it ends), decode
+// the stream and report frame rates, sizes and gaps.
+//
+// Linux only, like the server.
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "histogram.h"
+#include "match_engine.h"   // MatchRng
+#include "replay.h"         // REPLAY_P1_* key bits
+#include "server_protocol.h"
+#include "spectator.h"
+#include "udp_batch.h"
+
+// ===================== OPTIONS =====================
+
+struct LoadOptions {
+    sockaddr_in server;
+    int         clients;
+    float       vsAiPercent;
+    int         threads;
+    float       duration;      // seconds, 0 = until interrupted
+    int         inputHz;
+    float       reportSec;
+    bool        rejoin;
+    int         viewers;
+    uint32_t    watchId;       // 0 = the newest match
+};
+
+static void printUsage() {
+    std::printf("usage: loadgen [--server HOST:PORT] [--clients N] [--vs-ai PCT] [--threads T]\n"
+                "               [--duration SEC] [--input-hz HZ] [--report SEC] [--no-rejoin]\n"
+                "               [--viewers N] [--watch MATCH]\n");
+}
+
+static bool parseOptions(int argc, char** argv, LoadOptions& o) {
+    const char* server = "127.0.0.1";
+    o.clients     = 1000;
+    o.vsAiPercent = 50.0f;
+    o.threads     = 2;
+    o.duration    = 30.0f;
+    o.inputHz     = 120;
+    o.reportSec   = 5.0f;
+    o.rejoin      = true;
+    o.viewers     = 0;
+    o.watchId     = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (!std::strcmp(a, "--no-rejoin")) {
+            o.rejoin = false;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+
+        if      (!std::strcmp(a, "--server"))   server        = v;
+        else if (!std::strcmp(a, "--clients"))  o.clients     = std::atoi(v);
+        else if (!std::strcmp(a, "--vs-ai"))    o.vsAiPercent = (float)std::atof(v);
+        else if (!std::strcmp(a, "--threads"))  o.threads     = std::atoi(v);
+        else if (!std::strcmp(a, "--duration")) o.duration    = (float)std::atof(v);
+        else if (!std::strcmp(a, "--input-hz")) o.inputHz     = std::atoi(v);
+        else if (!std::strcmp(a, "--report"))   o.reportSec   = (float)std::atof(v);
+        else if (!std::strcmp(a, "--viewers"))  o.viewers     = std::atoi(v);
+        else if (!std::strcmp(a, "--watch"))    o.watchId     = (uint32_t)std::strtoul(v, 0, 10);
+        else return false;
+    }
+    if (!udpResolve(server, serverDefaultPort, o.server)) {
+        std::fprintf(stderr, "can't resolve %s\n", server);
+        return false;
+    }
+    return o.clients >= 0 && o.viewers >= 0 && o.threads > 0 && o.threads <= o.clients + o.viewers &&
+           o.inputHz > 0 && o.reportSec > 0.0f && o.duration >= 0.0f;
+}
+
+static uint64_t nowNs() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ===================== CLIENTS =====================
+
+enum ClientPhase {
+    CLIENT_JOINING,
+    CLIENT_PLAYING,
+    CLIENT_DONE
+};
+
+const int sentRing = 256;   // send times of the newest inputs, by seq
+
+struct Client {
+    int          phase;
+    uint32_t     nonce;         // thread-local index in the low 20 bits
+    bool         vsAi;
+    uint64_t     joinStartNs;
+    uint64_t     nextJoinNs;    // resend / retry time
+
+    ServerAssign assign;
+    sockaddr_in  shard;
+    uint32_t     seq;
+    uint32_t     lastAck;
+    uint64_t     sentNs[sentRing];
+    uint64_t     lastStateNs;
+
+    uint8_t      keys;
+    int          holdTicks;     // until the next key change
+};
+
+enum ViewerPhase {
+    VIEWER_ASKING,              // WATCH to the lobby until it says where
+    VIEWER_WATCHING
+};
+
+struct Viewer {
+    int           sock;
+    int           phase;
+    uint32_t      matchId;
+    sockaddr_in   shard;
+    uint64_t      nextSendNs;   // next WATCH (ask again, or renew)
+    uint64_t      lastFrameNs;
+    SpectatorFeed feed;
+};
+
+struct LoadStats {
+    Histogram joinNs;           // JOIN to ASSIGN
+    Histogram rttNs;            // INPUT to the first STATE that includes it
+    uint64_t  inputsSent, joinsSent, statesReceived;
+    uint64_t  matchesOver, timeouts, fullReplies;
+    int       joining, playing; // at the last tick
+
+    Histogram gapNs;            // between a viewer's frames
+    uint64_t  frames, frameBytes, keyframes, orphans;
+    int       watching;
+};
+
+static void clearStats(LoadStats& s) {
+    histogramClear(s.joinNs);
+    histogramClear(s.rttNs);
+    s.inputsSent = s.joinsSent = s.statesReceived = 0;
+    s.matchesOver = s.timeouts = s.fullReplies = 0;
+    s.joining = s.playing = 0;
+    histogramClear(s.gapNs);
+    s.frames = s.frameBytes = s.keyframes = s.orphans = 0;
+    s.watching = 0;
+}
+
+struct LoadThread {
+    int                  index;
+    int                  sock, epollFd, timerFd;
+    std::thread          thread;
+    std::vector<Client>  clients;
+    std::unordered_map<uint64_t, int> byMatch;   // matchId * 2 + slot -> client
+    std::vector<Viewer>  viewers;
+    std::unordered_map<int, int> viewerByFd;
+    MatchRng             rng;
+    uint32_t             generation;             // makes every JOIN nonce new
+    PacketBatch          batch;
+    LoadStats            local;
+
+    std::mutex           lock;
+    LoadStats            stats;                  // since the last report
+};
+
+const uint32_t nonceIndexMask = 0xFFFFF;
+
+static void startJoin(LoadThread& t, int index, uint64_t now) {
+    Client& c = t.clients[index];
+    t.generation++;
+    c.phase       = CLIENT_JOINING;
+    c.nonce       = (t.generation << 20) | (uint32_t)index;
+    c.joinStartNs = now;
+    c.nextJoinNs  = now;
+}
+
+static void queue(LoadThread& t, const sockaddr_in& to, const uint8_t* data, int size) {
+    int i = t.batch.add(to);
+    std::memcpy(t.batch.data[i], data, size);
+    t.batch.setSize(i, size);
+    if (t.batch.full()) udpSend(t.sock, t.batch);
+}
+
+// A random walk over the eight directions and standing still
+static uint8_t randomKeys(MatchRng& rng) {
+    static const uint8_t choices[] = {
+        0, REPLAY_P1_UP, REPLAY_P1_DOWN, REPLAY_P1_LEFT, REPLAY_P1_RIGHT,
+        REPLAY_P1_UP | REPLAY_P1_LEFT, REPLAY_P1_UP | REPLAY_P1_RIGHT,
+        REPLAY_P1_DOWN | REPLAY_P1_LEFT, REPLAY_P1_DOWN | REPLAY_P1_RIGHT
+    };
+    return choices[rngNext(rng) % 9];
+}
+
+static void clientTick(LoadThread& t, const LoadOptions& o, int index, uint64_t now) {
+    Client& c = t.clients[index];
+    uint8_t buf[udpMaxDatagram];
+
+    if (c.phase == CLIENT_JOINING) {
+        t.local.joining++;
+        if (now < c.nextJoinNs) return;
+        ServerJoin join;
+        join.nonce      = c.nonce;
+        join.vsAi       = c.vsAi;
+        join.difficulty = 2;
+        queue(t, o.server, buf, serverEncodeJoin(buf, join));
+        t.local.joinsSent++;
+        c.nextJoinNs = now + 250000000ULL;
+        return;
+    }
+    if (c.phase != CLIENT_PLAYING) return;
+    t.local.playing++;
+
+    // The server went quiet on us
+    if (now - c.lastStateNs > 5000000000ULL) {
+        t.local.timeouts++;
+        t.byMatch.erase((uint64_t)c.assign.matchId * 2 + c.assign.slot);
+        if (o.rejoin) startJoin(t, index, now);
+        else          c.phase = CLIENT_DONE;
+        return;
+    }
+
+    if (--c.holdTicks <= 0) {
+        c.keys      = randomKeys(t.rng);
+        c.holdTicks = 10 + (int)(rngNext(t.rng) % 60);
+    }
+
+    ServerInput in;
+    in.matchId = c.assign.matchId;
+    in.slot    = c.assign.slot;
+    in.token   = c.assign.token;
+    in.seq     = ++c.seq;
+    in.keys    = c.keys;
+    c.sentNs[c.seq % sentRing] = now;
+    queue(t, c.shard, buf, serverEncodeInput(buf, in));
+    t.local.inputsSent++;
+}
+
+static void handlePacket(LoadThread& t, const LoadOptions& o, const uint8_t* data, int size,
+                         uint64_t now) {
+    int type = serverPacketType(data, size);
+
+    if (type == SERVER_ASSIGN || type == SERVER_FULL) {
+        ServerAssign a;
+        uint32_t nonce;
+        if (type == SERVER_ASSIGN) {
+            if (!serverDecodeAssign(data, size, a)) return;
+            nonce = a.nonce;
+        } else if (!serverDecodeFull(data, size, nonce)) {
+            return;
+        }
+
+        uint32_t index = nonce & nonceIndexMask;
+        if (index >= t.clients.size()) return;
+        Client& c = t.clients[index];
+        if (c.phase != CLIENT_JOINING || c.nonce != nonce) return;   // stale answer
+
+        if (type == SERVER_FULL) {
+            t.local.fullReplies++;
+            c.nextJoinNs = now + 1000000000ULL;
+            return;
+        }
+        histogramAdd(t.local.joinNs, now - c.joinStartNs);
+        c.phase       = CLIENT_PLAYING;
+        c.assign      = a;
+        c.shard       = o.server;
+        c.shard.sin_port = htons(a.port);
+        c.seq         = 0;
+        c.lastAck     = 0;
+        c.lastStateNs = now;
+        c.holdTicks   = 0;
+        t.byMatch[(uint64_t)a.matchId * 2 + a.slot] = (int)index;
+        return;
+    }
+
+    ServerState st;
+    if (type != SERVER_STATE || !serverDecodeState(data, size, st)) return;
+    std::unordered_map<uint64_t, int>::iterator it = t.byMatch.find((uint64_t)st.matchId * 2 + st.slot);
+    if (it == t.byMatch.end()) return;
+
+    int index = it->second;
+    Client& c = t.clients[index];
+    t.local.statesReceived++;
+    c.lastStateNs = now;
+
+    // Round trip of the newest input this state includes, once per input
+    if ((int32_t)(st.ackSeq - c.lastAck) > 0 && c.seq - st.ackSeq < (uint32_t)sentRing) {
+        histogramAdd(t.local.rttNs, now - c.sentNs[st.ackSeq % sentRing]);
+        c.lastAck = st.ackSeq;
+    }
+
+    if (st.over) {
+        t.local.matchesOver++;
+        t.byMatch.erase(it);
+        if (o.rejoin) startJoin(t, index, now);
+        else          c.phase = CLIENT_DONE;
+    }
+}
+
+// ===================== VIEWERS =====================
+
+static void sendWatch(const Viewer& v, const sockaddr_in& to, uint32_t matchId) {
+    uint8_t buf[udpMaxDatagram];
+    int size = serverEncodeWatch(buf, matchId);
+    sendto(v.sock, buf, size, 0, (const sockaddr*)&to, sizeof(to));
+}
+
+static void viewerTick(LoadThread& t, const LoadOptions& o, Viewer& v, uint64_t now) {
+    if (v.phase == VIEWER_WATCHING) {
+        t.local.watching++;
+        // The match ended, or went quiet: find another
+        if (now - v.lastFrameNs > 3000000000ULL) v.phase = VIEWER_ASKING;
+    }
+    if (now < v.nextSendNs) return;
+
+    if (v.phase == VIEWER_ASKING) {
+        sendWatch(v, o.server, o.watchId);
+        v.nextSendNs = now + 500000000ULL;
+    } else {
+        sendWatch(v, v.shard, v.matchId);
+        v.nextSendNs = now + (uint64_t)(serverWatchRenewSec * 1e9);
+    }
+}
+
+static void receiveViewer(LoadThread& t, const LoadOptions& o, Viewer& v, uint64_t now) {
+    uint8_t buf[udpMaxDatagram];
+    ssize_t n;
+    while ((n = recv(v.sock, buf, sizeof(buf), 0)) > 0) {
+        int size = (int)n;
+        ServerWatchAt at;
+        uint32_t matchId;
+
+        if (serverPacketType(buf, size) == SERVER_WATCH_AT && serverDecodeWatchAt(buf, size, at)) {
+            if (v.phase != VIEWER_ASKING || at.port == 0) continue;   // nothing running yet: ask again
+            v.phase       = VIEWER_WATCHING;
+            v.matchId     = at.matchId;
+            v.shard       = o.server;
+            v.shard.sin_port = htons(at.port);
+            v.nextSendNs  = now;
+            v.lastFrameNs = now;
+            spectatorFeedInit(v.feed);
+        } else if (serverDecodeSpectateHeader(buf, size, matchId)) {
+            if (v.phase != VIEWER_WATCHING || matchId != v.matchId) continue;
+
+            SpectatorStats before = v.feed.stats;
+            bool added = spectatorDecode(v.feed, buf + serverSpectateHeaderSize, size - serverSpectateHeaderSize);
+            t.local.frameBytes += (uint64_t)size;
+            t.local.keyframes  += v.feed.stats.keyframes - before.keyframes;
+            t.local.orphans    += v.feed.stats.orphans - before.orphans;
+            if (!added) continue;
+
+            t.local.frames++;
+            histogramAdd(t.local.gapNs, now - v.lastFrameNs);
+            v.lastFrameNs = now;
+
+            const SpectatorFrame& f = v.feed.frames[v.feed.newestTick % spectatorRingSize];
+            if (f.v[SPEC_OVER]) {
+                v.phase      = VIEWER_ASKING;
+                v.nextSendNs = now + 250000000ULL;
+            }
+        }
+    }
+}
+
+static void publish(LoadThread& t) {
+    std::lock_guard<std::mutex> guard(t.lock);
+    histogramMerge(t.stats.joinNs, t.local.joinNs);
+    histogramMerge(t.stats.rttNs, t.local.rttNs);
+    t.stats.inputsSent     += t.local.inputsSent;
+    t.stats.joinsSent      += t.local.joinsSent;
+    t.stats.statesReceived += t.local.statesReceived;
+    t.stats.matchesOver    += t.local.matchesOver;
+    t.stats.timeouts       += t.local.timeouts;
+    t.stats.fullReplies    += t.local.fullReplies;
+    t.stats.joining         = t.local.joining;
+    t.stats.playing         = t.local.playing;
+    histogramMerge(t.stats.gapNs, t.local.gapNs);
+    t.stats.frames         += t.local.frames;
+    t.stats.frameBytes     += t.local.frameBytes;
+    t.stats.keyframes      += t.local.keyframes;
+    t.stats.orphans        += t.local.orphans;
+    t.stats.watching        = t.local.watching;
+    clearStats(t.local);
+}
+
+static void threadLoop(LoadThread& t, const LoadOptions& o, const std::atomic<bool>& running) {
+    epoll_event events[64];
+    while (running.load()) {
+        int n = epoll_wait(t.epollFd, events, 64, 100);
+        for (int e = 0; e < n; ++e) {
+            uint64_t now = nowNs();
+            if (events[e].data.fd == t.sock) {
+                int got;
+                do {
+                    got = udpReceive(t.sock, t.batch);
+                    for (int i = 0; i < got; ++i) {
+                        handlePacket(t, o, t.batch.data[i], (int)t.batch.msgs[i].msg_len, now);
+                    }
+                } while (got == udpBatchSize);
+            } else if (events[e].data.fd == t.timerFd) {
+                if (timerRead(t.timerFd) == 0) continue;
+                // One input per client per period, however late we are
+                t.batch.count = 0;
+                for (size_t i = 0; i < t.clients.size(); ++i) clientTick(t, o, (int)i, now);
+                udpSend(t.sock, t.batch);
+                for (size_t i = 0; i < t.viewers.size(); ++i) viewerTick(t, o, t.viewers[i], now);
+                publish(t);
+            } else {
+                std::unordered_map<int, int>::iterator it = t.viewerByFd.find(events[e].data.fd);
+                if (it != t.viewerByFd.end()) receiveViewer(t, o, t.viewers[it->second], now);
+            }
+        }
+    }
+
+    // Leave politely so the server doesn't wait for the idle timeout
+    uint8_t buf[udpMaxDatagram];
+    t.batch.count = 0;
+    for (size_t i = 0; i < t.clients.size(); ++i) {
+        const Client& c = t.clients[i];
+        if (c.phase != CLIENT_PLAYING) continue;
+        queue(t, c.shard, buf, serverEncodeLeave(buf, c.assign.matchId, c.assign.slot, c.assign.token));
+    }
+    udpSend(t.sock, t.batch);
+    for (size_t i = 0; i < t.viewers.size(); ++i) close(t.viewers[i].sock);
+}
+
+// ===================== MAIN =====================
+
+static void report(std::vector<LoadThread*>& threads, double elapsed, double intervalSec) {
+    LoadStats total;
+    clearStats(total);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        LoadThread& t = *threads[i];
+        std::lock_guard<std::mutex> guard(t.lock);
+        histogramMerge(total.joinNs, t.stats.joinNs);
+        histogramMerge(total.rttNs, t.stats.rttNs);
+        total.inputsSent     += t.stats.inputsSent;
+        total.joinsSent      += t.stats.joinsSent;
+        total.statesReceived += t.stats.statesReceived;
+        total.matchesOver    += t.stats.matchesOver;
+        total.timeouts       += t.stats.timeouts;
+        total.fullReplies    += t.stats.fullReplies;
+        total.joining        += t.stats.joining;
+        total.playing        += t.stats.playing;
+        histogramMerge(total.gapNs, t.stats.gapNs);
+        total.frames         += t.stats.frames;
+        total.frameBytes     += t.stats.frameBytes;
+        total.keyframes      += t.stats.keyframes;
+        total.orphans        += t.stats.orphans;
+        total.watching       += t.stats.watching;
+        int joining = t.stats.joining, playing = t.stats.playing, watching = t.stats.watching;
+        clearStats(t.stats);
+        t.stats.joining  = joining;
+        t.stats.playing  = playing;
+        t.stats.watching = watching;
+    }
+
+    std::printf("[%6.0f s] %d playing, %d joining  +%llu matches over  %llu timeouts  %llu full\n",
+                elapsed, total.playing, total.joining, (unsigned long long)total.matchesOver,
+                (unsigned long long)total.timeouts, (unsigned long long)total.fullReplies);
+    std::printf("           join  p50 %.2f  p99 %.2f ms   rtt  p50 %.2f  p99 %.2f  max %.2f ms\n",
+                histogramPercentile(total.joinNs, 0.50) / 1e6, histogramPercentile(total.joinNs, 0.99) / 1e6,
+                histogramPercentile(total.rttNs, 0.50) / 1e6, histogramPercentile(total.rttNs, 0.99) / 1e6,
+                total.rttNs.maxValue / 1e6);
+    std::printf("           inputs %.0f/s  joins %.0f/s  states %.0f/s\n",
+                total.inputsSent / intervalSec, total.joinsSent / intervalSec,
+                total.statesReceived / intervalSec);
+    if (total.watching > 0 || total.frames > 0) {
+        std::printf("           %d watching  frames %.0f/s  %.1f bytes/frame  %.1f%% keyframes  %llu orphans\n",
+                    total.watching, total.frames / intervalSec,
+                    total.frames ? (double)total.frameBytes / (double)total.frames : 0.0,
+                    total.frames ? 100.0 * total.keyframes / (double)total.frames : 0.0,
+                    (unsigned long long)total.orphans);
+        std::printf("           frame gap  p50 %.2f  p99 %.2f  max %.2f ms\n",
+                    histogramPercentile(total.gapNs, 0.50) / 1e6, histogramPercentile(total.gapNs, 0.99) / 1e6,
+                    total.gapNs.maxValue / 1e6);
+    }
+    std::fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    LoadOptions o;
+    if (!parseOptions(argc, argv, o)) {
+        printUsage();
+        return 1;
+    }
+
+    std::atomic<bool> running(true);
+    std::vector<LoadThread*> threads(o.threads);
+    uint64_t start = nowNs();
+    for (int i = 0; i < o.threads; ++i) {
+        LoadThread* t = new LoadThread;
+        t->index      = i;
+        t->sock       = udpOpen(0, 4 << 20);
+        t->timerFd    = timerOpen(1.0 / o.inputHz);
+        t->epollFd    = epoll_create1(0);
+        t->generation = 0;
+        t->batch.count = 0;
+        rngSeed(t->rng, start + (uint64_t)i);
+        clearStats(t->local);
+        clearStats(t->stats);
+        if (t->sock < 0 || t->timerFd < 0 || t->epollFd < 0) {
+            std::fprintf(stderr, "could not open a socket\n");
+            return 1;
+        }
+        epollWatch(t->epollFd, t->sock);
+        epollWatch(t->epollFd, t->timerFd);
+
+        // This thread's share of the clients, vs-AI ones spread evenly
+        int count = o.clients / o.threads + (i < o.clients % o.threads ? 1 : 0);
+        t->clients.resize(count);
+        for (int k = 0; k < count; ++k) {
+            Client& c = t->clients[k];
+            std::memset(&c, 0, sizeof(c));
+            c.vsAi = rngFloat(t->rng) * 100.0f < o.vsAiPercent;
+            startJoin(*t, k, start);
+            c.nextJoinNs  = start + (uint64_t)k * 1000000000ULL / (uint64_t)count;   // ramp up over 1 s
+            c.joinStartNs = c.nextJoinNs;
+        }
+
+        int viewers = o.viewers / o.threads + (i < o.viewers % o.threads ? 1 : 0);
+        t->viewers.resize(viewers);
+        for (int k = 0; k < viewers; ++k) {
+            Viewer& v = t->viewers[k];
+            std::memset(&v, 0, sizeof(v));
+            v.sock       = udpOpen(0, 256 << 10);
+            v.phase      = VIEWER_ASKING;
+            v.nextSendNs = start + 1000000000ULL + (uint64_t)k * 1000000000ULL / (uint64_t)viewers;   // after the players
+            if (v.sock < 0) {
+                std::fprintf(stderr, "could not open viewer socket %d (ulimit -n?)\n", k);
+                return 1;
+            }
+            epollWatch(t->epollFd, v.sock);
+            t->viewerByFd[v.sock] = k;
+        }
+        threads[i] = t;
+    }
+    for (int i = 0; i < o.threads; ++i) {
+        LoadThread* t = threads[i];
+        t->thread = std::thread([t, &o, &running]() { threadLoop(*t, o, running); });
+    }
+
+    std::printf("%d clients (%.0f%% vs AI) and %d viewers on %d thread(s), inputs at %d Hz\n",
+                o.clients, o.vsAiPercent, o.viewers, o.threads, o.inputHz);
+    std::fflush(stdout);
+
+    double elapsed = 0.0;
+    while (o.duration == 0.0f || elapsed < o.duration) {
+        double wait = o.reportSec;
+        if (o.duration > 0.0f && elapsed + wait > o.duration) wait = o.duration - elapsed;
+        std::this_thread::sleep_for(std::chrono::microseconds((long long)(wait * 1e6)));
+        elapsed = (nowNs() - start) / 1e9;
+        report(threads, elapsed, wait);
+    }
+
+    running = false;
+    for (int i = 0; i < o.threads; ++i) threads[i]->thread.join();
+    return 0;
+}
@@ -8,6 +8,30 @@
 #include <cstdlib>   // rand, srand, exit
 #include <cmath>     // cosf, sinf, fabs
 #include <ctime>     // time()
+#include <chrono>    // steady_clock (fixed timestep)
+#include <thread>    // sleep_for (frame pacing)
+#include <vector>
+
+#include "ai.h"
+#include "asset_pack.h"
+#include "audio.h"
+#include "ball_swarm.h"
+#include "input_events.h"
+#include "match_engine.h"
+#include "net_link.h"
+#include "netplay.h"
+#include "particles.h"
+#include "server_protocol.h"
+#include "spectator.h"
+#include "batch_renderer.h"
+#include "frame_scheduler.h"
+#include "gl_ext.h"
+#include "layer_cache.h"
+#include "text_renderer.h"
+#include "profiler.h"
+#include "render_scale.h"
+#include "replay.h"
+#include "search_ai.h"
 
 // ===================== GAME STATES =====================
 
@@ -30,13 +54,20 @@ enum GameState {
 
 GameState currentState = STATE_MAIN_MENU;
 
+const char* gameStateNames[] = {
+    "main menu", "mode select", "difficulty", "name (single)", "name (P1)", "name (P2)",
+    "avatar (single)", "avatar (P1)", "avatar (P2)", "how to play", "settings",
+    "playing", "paused", "game over"
+};
+
 // ===================== MENU SELECTION =====================
 
 int mainMenuIndex   = 0;   // 0..3 (Start, How to Play, Settings, Exit)
 int modeMenuIndex   = 0;   // 0: Single, 1: Multiplayer
-int difficultyIndex = 1;   // 0: Easy, 1: Medium, 2: Hard
+int difficultyIndex = 1;   // 0: Easy, 1: Medium, 2: Hard, 3: Expert
 
-// SETTINGS cursor: 0=GameTime, 1=MaxScore, 2=Theme, 3=Back
+// SETTINGS cursor: 0=GameTime, 1=MaxScore, 2=Theme, 3=SimRate, 4=MenuCube, 5=Chaos,
+// 6=RenderScale, 7=Back
 int settingsCursor  = 0;
 
 // For avatar selection
@@ -55,6 +86,40 @@ const char* themeNames[themeCount] = {
 
 // Spinning cube angle (for 3D bonus)
 float menuCubeAngle = 0.0f;
+const float cubeSpinSpeed = 42.0f;  // degrees per second
+
+// Cube animation: 0 = smooth, 1 = low power (the main menu is redrawn only
+// cubeLowPowerHz times a second), 2 = off (cube stands still)
+const int   cubeModeCount  = 3;
+const char* cubeModeNames[cubeModeCount] = { "Smooth", "Low Power", "Off" };
+int         cubeModeIndex  = 0;
+const int   cubeLowPowerHz = 12;
+
+// Chaos mode: extra balls in local matches and replays (ball_swarm.h)
+const int   chaosOptionCount = 4;
+const int   chaosOptions[chaosOptionCount] = { 0, 250, 1000, 4000 };
+int         chaosIndex = 0;
+
+// Internal render resolution in percent of the window (render_scale.h);
+// 0 = automatic, from measured frame times
+const int   renderScaleCount = 7;
+const int   renderScaleOptions[renderScaleCount] = { 100, 90, 80, 70, 60, 50, 0 };
+int         renderScaleIndex = 0;
+
+bool renderScaleIsAuto() {
+    return renderScaleOptions[renderScaleIndex] == 0;
+}
+
+float currentRenderScale() {
+    if (renderScaleIsAuto()) return renderScaleStats().autoScale;
+    return renderScaleOptions[renderScaleIndex] / 100.0f;
+}
+
+void advanceCube(float dt) {
+    if (cubeModeIndex == 2) return;
+    menuCubeAngle += cubeSpinSpeed * dt;
+    if (menuCubeAngle > 360.0f) menuCubeAngle = std::fmod(menuCubeAngle, 360.0f);
+}
 
 // ===================== WINDOW =====================
 
@@ -66,31 +131,23 @@ int winHeight = 600;
 bool keyDown[256]      = { false }; // normal keys
 bool specialDown[256]  = { false }; // special keys (arrows)
 
-// ===================== GAME DATA STRUCTURES =====================
-
-struct Paddle {
-    float x, y;
-    float width, height;
-    float speed;
-};
-
-struct Ball {
-    float x, y;
-    float radius;
-    float vx, vy;
-};
+// ===================== MATCH =====================
 
-Paddle p1, p2;
-Ball   ball;
+// The match itself (paddles, ball, scores, clock) lives in the engine,
+// in arena units. See match_engine.h.
+MatchState match;
+AiState    matchAi;     // single-player opponent (P2)
 
-// Game parameters
-int   scoreP1   = 0;
-int   scoreP2   = 0;
-float timeLeft  = 90.0f;   // set from settings
-int   maxScore  = 5;       // set from settings
+// Expert opponent: searches on worker threads, at most expertBudgetUs of
+// search per worker per tick. Workers start with the first Expert match.
+SearchAi  expertAi;
+bool      expertWorkersStarted = false;
+const int expertBudgetUs       = 1000;
 
 bool  isSinglePlayer = true;  // mode flag
 
+const float paddleSpeed = 480.0f; // human paddle speed (arena units / sec)
+
 // SETTINGS OPTIONS
 const int gameTimeOptions[]   = { 60, 90, 120 };
 const int gameTimeCount       = 3;
@@ -109,14 +166,6 @@ char player2Name[32] = "Player 2";
 char nameBuffer[32] = "";
 int  nameLength     = 0;
 
-// ===== Ball speed system =====
-float baseVx = 6.0f;    // base X speed
-float baseVy = 4.0f;    // base Y speed
-float speedFactor = 1.0f;   // grows in a rally
-int   hitsInRally = 0;
-
-float prevBallX = 0.0f, prevBallY = 0.0f;
-
 // ===== Avatars =====
 
 struct AvatarStyle {
@@ -133,17 +182,128 @@ AvatarStyle avatarStyles[4] = {
 int player1AvatarIndex = 0; // 0..3
 int player2AvatarIndex = 1; // 0..3
 
+// ===== Replays =====
+// Every match is recorded; the last one is written to lastReplayPath when
+// it ends. "--replay FILE" on the command line plays a recording back.
+Replay      matchReplay;
+bool        replayPlayback = false;
+const char* lastReplayPath = "last_match.prr";
+
 // ===== Screen flash on score =====
-int   flashFrames = 0;
+float flashTime = 0.0f;    // seconds left
 float flashR = 1.0f, flashG = 1.0f, flashB = 1.0f;
+const float flashDuration = 10.0f / 60.0f;
 
 // ===== Camera shake =====
-int   shakeFrames = 0;
+float shakeTime = 0.0f;    // seconds left
 float shakeIntensity = 0.0f;
+const float shakeDuration = 6.0f / 60.0f;
+
+// ===== Fixed timestep =====
+// Simulation runs at a fixed tick rate, independent of how often GLUT
+// calls us back. Real elapsed time is fed into an accumulator.
+const int tickRateOptions[]   = { 60, 120, 240 };
+const int tickRateCount       = 3;
+int       tickRateIndex       = 1;  // default 120 Hz
+
+const float maxCatchUpTime = 0.1f;  // max sim time advanced per callback
+double lastClockTime  = 0.0;
+double tickAccumulator = 0.0;
+double tickWallStart   = 0.0;       // real time the next tick starts at (input_events.h)
+
+double monotonicSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+// CPU time used by the whole process (all threads), in seconds.
+double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0.0;
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+    return (double)(k.QuadPart + u.QuadPart) * 1e-7;   // 100 ns units
+#else
+    return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+// ===== Frame scheduling =====
+// Frames are drawn at display rate (vsync when the driver allows it,
+// otherwise paced by frame_scheduler.h), not at the tick rate.
+int  targetFps    = 0;      // --fps N; 0 = display rate
+bool framePending = false;  // redisplay posted but not drawn yet
+
+// ===== On-demand redraw =====
+// Static screens are drawn once per change: input, reshape and timers set
+// needsRedraw. When nothing is dirty or animating the idle callback is
+// removed and GLUT sleeps until the next event.
+bool needsRedraw      = true;
+bool frameLoopRunning = false;
+
+void requestRedraw();   // forward decl
+bool screenAnimates();  // forward decl
+
+// ===== Startup =====
+// Time from main() to the first frame on screen, printed once. Nothing
+// slow runs before it: the asset archive is only mapped, and the audio
+// device and effects are opened on the mixer thread.
+double startupBegin    = 0.0;
+double startupWindowAt = 0.0;   // window created
+bool   startupReported = false;
+
+// ===== CPU usage =====
+// Process CPU time / wall time, sampled once a second by a GLUT timer (it
+// keeps running while the frame loop sleeps). Shown on F2; --cpu-log also
+// prints every sample with the current screen.
+bool  cpuLog          = false;
+float cpuUsagePercent = 0.0f;
+double lastCpuSeconds  = 0.0;
+double lastCpuWallTime = 0.0;
+
+// ===== Render interpolation =====
+// drawGame shows the field renderAlpha of the way from the previous tick
+// to the current one, so motion is smooth whatever the refresh rate.
+struct RenderSnapshot {
+    Paddle p1, p2;
+    Ball   ball;
+};
+
+RenderSnapshot prevTickState;
+float          renderAlpha = 1.0f;
+
+RenderSnapshot renderSnapshot(const MatchState& m) {
+    RenderSnapshot s = { m.p1, m.p2, m.ball };
+    return s;
+}
+
+// Next frame shows the match as it is now (new match, serve, replay start).
+void resetRenderInterpolation() {
+    prevTickState = renderSnapshot(match);
+    renderAlpha   = 1.0f;
+}
 
 // ===================== SIMPLE TEXT RENDERING =====================
 
+// Text normally goes through the glyph atlas (text_renderer.h). If that
+// isn't available it is drawn by GLUT directly: flush queued shapes first so
+// it lands on top, and pick up the batch color / transform.
+void beginDirectDraw(float& x, float& y) {
+    batchFlush();
+
+    float c[4];
+    batchCurrentColor(c);
+    glColor4fv(c);
+
+    batchTransformPoint(x, y);
+}
+
 void drawBitmapText(const char* text, float x, float y, void* font = GLUT_BITMAP_HELVETICA_18) {
+    if (textDraw(font, 1.0f, text, x, y)) return;
+
+    beginDirectDraw(x, y);
     glRasterPos2f(x, y);
     for (int i = 0; text[i] != '\0'; ++i) {
         glutBitmapCharacter(font, text[i]);
@@ -151,11 +311,19 @@ void drawBitmapText(const char* text, float x, float y, void* font = GLUT_BITMAP
 }
 
 void drawStrokeCentered(const char* text, float cx, float cy, float scale) {
+    float cachedWidth = textWidth(GLUT_STROKE_ROMAN, scale, text);
+    if (cachedWidth >= 0.0f) {
+        textDraw(GLUT_STROKE_ROMAN, scale, text, cx - cachedWidth / 2.0f, cy);
+        return;
+    }
+
     float width = 0.0f;
     for (int i = 0; text[i] != '\0'; ++i) {
         width += glutStrokeWidth(GLUT_STROKE_ROMAN, text[i]);
     }
 
+    beginDirectDraw(cx, cy);
+
     glPushMatrix();
         glTranslatef(cx - width * scale / 2.0f, cy, 0.0f);
         glScalef(scale, scale, 1.0f);
@@ -175,44 +343,44 @@ void setup2D() {
     glLoadIdentity();
 }
 
+// All 2D shapes go through the batcher (batch_renderer.h)
+
 void drawRect(float x, float y, float w, float h) {
-    glBegin(GL_QUADS);
-        glVertex2f(x,     y);
-        glVertex2f(x + w, y);
-        glVertex2f(x + w, y + h);
-        glVertex2f(x,     y + h);
-    glEnd();
+    batchQuad(x, y, w, h);
 }
 
 void drawCircle(float cx, float cy, float r) {
-    glBegin(GL_TRIANGLE_FAN);
+    float pts[2 * 50];
     for (int i = 0; i < 50; i++) {
         float a = i * 2.0f * 3.14159f / 50.0f;
-        glVertex2f(cx + cosf(a)*r, cy + sinf(a)*r);
+        pts[2*i]     = cx + cosf(a)*r;
+        pts[2*i + 1] = cy + sinf(a)*r;
     }
-    glEnd();
+    batchFan(pts, 50);
 }
 
 void drawHexagon(float cx, float cy, float r) {
-    glBegin(GL_POLYGON);
+    float pts[2 * 6];
     for (int i = 0; i < 6; ++i) {
         float a = i * 2.0f * 3.14159f / 6.0f;
-        glVertex2f(cx + cosf(a)*r, cy + sinf(a)*r);
+        pts[2*i]     = cx + cosf(a)*r;
+        pts[2*i + 1] = cy + sinf(a)*r;
     }
-    glEnd();
+    batchFan(pts, 6);
 }
 
 void drawTriangle(float cx, float cy, float r) {
-    glBegin(GL_TRIANGLES);
-        glVertex2f(cx,     cy + r);
-        glVertex2f(cx - r, cy - r);
-        glVertex2f(cx + r, cy - r);
-    glEnd();
+    batchTriangle(cx,     cy + r,
+                  cx - r, cy - r,
+                  cx + r, cy - r);
 }
 
 // =========== BACKGROUNDS (THEMED) ===========
 
-void drawMenuBackground() {
+// The *Layer functions build the static backgrounds; drawMenuBackground()
+// and drawGameBackground() composite them from the layer cache.
+
+void drawMenuBackgroundLayer() {
     // Darker gradients for all themes (better contrast)
     for (int i = 0; i < winHeight; i += 25) {
         float t = (float)i / (float)winHeight;
@@ -233,25 +401,25 @@ void drawMenuBackground() {
             b = 0.07f + 0.18f * (1.0f - t);
         }
 
-        glColor3f(r, g, b);
+        batchColor3f(r, g, b);
         drawRect(0, (float)i, (float)winWidth, 25.0f);
     }
 
     // Top highlight bar
-    if (themeIndex == 0)      glColor3f(0.2f, 0.9f, 1.0f);
-    else if (themeIndex == 1) glColor3f(0.7f, 0.8f, 1.0f);
-    else                      glColor3f(1.0f, 0.7f, 0.3f);
+    if (themeIndex == 0)      batchColor3f(0.2f, 0.9f, 1.0f);
+    else if (themeIndex == 1) batchColor3f(0.7f, 0.8f, 1.0f);
+    else                      batchColor3f(1.0f, 0.7f, 0.3f);
 
     drawRect(0, winHeight - 8, winWidth, 8);
 }
 
-void drawGameBackground() {
+void drawGameBackgroundLayer() {
     if (themeIndex == 2) {
         // Retro Grid: dark purple + neon grid
-        glColor3f(0.03f, 0.0f, 0.05f);
+        batchColor3f(0.03f, 0.0f, 0.05f);
         drawRect(0, 0, winWidth, winHeight);
 
-        glColor3f(0.5f, 0.0f, 0.7f);
+        batchColor3f(0.5f, 0.0f, 0.7f);
         for (int y = 0; y < winHeight; y += 30) {
             drawRect(0, (float)y, (float)winWidth, 1.5f);
         }
@@ -272,13 +440,13 @@ void drawGameBackground() {
                 g = 0.01f + 0.05f * (1.0f - t);
                 b = 0.10f + 0.30f * t;
             }
-            glColor3f(r, g, b);
+            batchColor3f(r, g, b);
             drawRect(0, (float)i, (float)winWidth, 20.0f);
         }
     }
 
     // Center dashed line
-    glColor3f(0.9f, 0.9f, 0.9f);
+    batchColor3f(0.9f, 0.9f, 0.9f);
     float cx = winWidth / 2.0f - 2.0f;
     float dashH = 16.0f;
     float gapH  = 10.0f;
@@ -287,9 +455,26 @@ void drawGameBackground() {
     }
 }
 
+void drawMenuBackground() {
+    PROFILE_SCOPE(PHASE_DRAW_MENU_BACKGROUND);
+
+    if (!layerCacheDraw(LAYER_MENU_BACKGROUND, themeIndex, winWidth, winHeight, drawMenuBackgroundLayer))
+        drawMenuBackgroundLayer();
+}
+
+void drawGameBackground() {
+    PROFILE_SCOPE(PHASE_DRAW_GAME_BACKGROUND);
+
+    if (!layerCacheDraw(LAYER_GAME_BACKGROUND, themeIndex, winWidth, winHeight, drawGameBackgroundLayer))
+        drawGameBackgroundLayer();
+}
+
 // ===================== 3D CUBES (BONUS) =====================
 
 void drawSpinningCube(float tx, float ty, float tz, float size, float angle) {
+    PROFILE_SCOPE(PHASE_DRAW_CUBE);
+
+    batchFlush();   // keep draw order with the 2D batch
     glEnable(GL_DEPTH_TEST);
 
     glMatrixMode(GL_PROJECTION);
@@ -366,76 +551,459 @@ void drawGameCube3D() {
 
 // ===================== GAME INIT =====================
 
-void resetBall() {
-    hitsInRally = 0;
-    speedFactor = 1.0f;
+uint64_t makeMatchSeed() {
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()
+         ^ ((uint64_t)time(0) << 32);
+}
 
-    ball.x = winWidth / 2.0f;
-    ball.y = winHeight / 2.0f;
+// ===================== CHAOS =====================
+// The extra balls bounce off the paddles and keep their own tally; the
+// match (its score, replay log and online state) only ever sees the real
+// ball. The swarm is seeded from the match seed, so a replay shows the
+// same chaos as the match did when played with the same setting.
+
+BallSwarm          chaos;                         // count 0 = off
+int                chaosGoalsP1 = 0, chaosGoalsP2 = 0;
+double             chaosStepUs  = 0.0;            // last step, for F2
+int                chaosContacts = 0;             // balls that touched in the last step
+std::vector<float> chaosDrawX, chaosDrawY;        // interpolated, reused every frame
+
+void startChaos(uint64_t seed) {
+    swarmInit(chaos, chaosOptions[chaosIndex], seed);
+    chaosGoalsP1 = chaosGoalsP2 = 0;
+}
 
-    float vx = baseVx;
-    float vy = baseVy;
+void stepChaos(float dt) {
+    double start = monotonicSeconds();
+    SwarmEvents ev;
+    swarmStep(chaos, match.p1, match.p2, dt, ev);
+    chaosStepUs   = (monotonicSeconds() - start) * 1e6;
+    chaosContacts = ev.contacts;
+
+    chaosGoalsP1 += ev.goalsP1;
+    chaosGoalsP2 += ev.goalsP2;
+
+    // Hundreds of bounces a tick: one quiet sound stands for all of them
+    if (ev.hitsP1 + ev.hitsP2 > 0) {
+        audioPlay(SOUND_PADDLE_HIT, 0.15f, ev.hitsP1 > ev.hitsP2 ? -0.6f : 0.6f);
+    } else if (ev.walls > 0) {
+        audioPlay(SOUND_WALL, 0.1f, 0.0f);
+    }
+}
 
-    ball.vx = (rand() % 2 == 0 ? vx : -vx);
-    ball.vy = (rand() % 2 == 0 ? vy : -vy);
+void startNewMatch() {
+    MatchConfig cfg;
+    cfg.gameTime = (float)gameTimeOptions[gameTimeIndex];
+    cfg.maxScore = maxScoreOptions[maxScoreIndex]; // 0 means infinite
+    cfg.p1Speed  = paddleSpeed;
+    cfg.p2Speed  = isSinglePlayer ? aiParams(difficultyIndex).maxSpeed : paddleSpeed;
+    if (isSinglePlayer && difficultyIndex == expertDifficulty) cfg.p2Speed = searchAiSpeed;
+
+    matchReplay.seed            = makeMatchSeed();
+    matchReplay.singlePlayer    = isSinglePlayer;
+    matchReplay.gameTimeIndex   = gameTimeIndex;
+    matchReplay.maxScoreIndex   = maxScoreIndex;
+    matchReplay.difficultyIndex = difficultyIndex;
+    matchReplay.tickRate        = tickRateOptions[tickRateIndex];
+    matchReplay.config          = cfg;
+
+    replayPlayback = false;
+    replayBegin(matchReplay, match, matchAi);
+    resetRenderInterpolation();
+    startChaos(matchReplay.seed);
+    particlesClear();
+
+    if (isSinglePlayer && difficultyIndex == expertDifficulty) {
+        expertAi.reset(1, matchReplay.seed);
+        if (!expertWorkersStarted) {
+            expertAi.startWorkers(0, expertBudgetUs);
+            expertWorkersStarted = true;
+        }
+    }
+}
+
+NetSession* netSession = 0;     // online match in progress (see ONLINE below)
+bool        spectating = false; // watching a server match (see SPECTATING below)
 
-    prevBallX = ball.x;
-    prevBallY = ball.y;
+
+// Saves the recording of the current match (also when it's abandoned).
+void saveMatchReplay() {
+    if (replayPlayback || spectating) return;
+    if (netSession) {
+        // Only what both sides confirmed; it replays like a local 1v1
+        matchReplay = netSession->log;
+        replayFinish(matchReplay, netConfirmedState(*netSession));
+    } else {
+        replayFinish(matchReplay, match);
+    }
+    if (!replaySave(matchReplay, lastReplayPath)) {
+        std::fprintf(stderr, "could not write %s\n", lastReplayPath);
+    }
 }
 
-void initRoundObjects(bool resetScores) {
-    // Paddles
-    p1.x = 80.0f;
-    p1.y = winHeight / 2.0f;
-    p1.width  = 16.0f;
-    p1.height = 100.0f;
-    p1.speed  = 8.0f;
+// Loads a recording and starts playing it with its original settings.
+bool startReplayPlayback(const char* path) {
+    if (!replayLoad(matchReplay, path)) {
+        std::fprintf(stderr, "could not load replay %s\n", path);
+        return false;
+    }
 
-    p2.x = winWidth - 80.0f;
-    p2.y = winHeight / 2.0f;
-    p2.width  = 16.0f;
-    p2.height = 100.0f;
-    p2.speed  = 8.0f;
+    int rateIndex = -1;
+    for (int i = 0; i < tickRateCount; ++i) {
+        if (tickRateOptions[i] == matchReplay.tickRate) rateIndex = i;
+    }
+    if (rateIndex < 0 ||
+        matchReplay.gameTimeIndex   >= gameTimeCount ||
+        matchReplay.maxScoreIndex   >= maxScoreCount ||
+        matchReplay.difficultyIndex > expertDifficulty) {
+        std::fprintf(stderr, "replay %s uses unsupported settings\n", path);
+        return false;
+    }
 
-    if (resetScores) {
-        scoreP1 = 0;
-        scoreP2 = 0;
+    isSinglePlayer  = matchReplay.singlePlayer;
+    gameTimeIndex   = matchReplay.gameTimeIndex;
+    maxScoreIndex   = matchReplay.maxScoreIndex;
+    difficultyIndex = matchReplay.difficultyIndex;
+    tickRateIndex   = rateIndex;
+
+    std::strcpy(player1Name, "Replay P1");
+    std::strcpy(player2Name, isSinglePlayer ? "Replay AI" : "Replay P2");
+
+    replayStart(matchReplay, match, matchAi);
+    resetRenderInterpolation();
+    startChaos(matchReplay.seed);
+    particlesClear();
+    replayPlayback = true;
+    currentState   = STATE_PLAYING;
+    return true;
+}
+
+// ===================== ONLINE =====================
+// --host PORT / --join HOST:PORT play a 1v1 over UDP with rollback
+// (netplay.h), using the host's settings; the host is P1 (left). Each
+// player steers their own paddle with WASD or the arrows.
+// --net-emu LAT,JITTER,LOSS sends our packets through the network
+// emulator, for testing two copies on one machine.
+
+UdpLink       netUdp;
+NetEmulator*  netEmulator   = 0;
+bool          netEmulate    = false;
+NetConditions netConditions = { 0.0f, 0.0f, 0.0f };
+int           netInputDelay = 1;     // ticks (host decides)
+
+// Connects (blocking, with console messages) and starts the match.
+// hostName == 0: host on `port`.
+bool startOnlineMatch(const char* hostName, int port) {
+    bool hosting = hostName == 0;
+    if (hosting ? !netUdp.listen(port) : !netUdp.connect(hostName, port)) {
+        std::fprintf(stderr, "could not open UDP %s:%d\n", hosting ? "port" : hostName, port);
+        return false;
+    }
+
+    MatchConfig cfg;
+    cfg.gameTime = (float)gameTimeOptions[gameTimeIndex];
+    cfg.maxScore = maxScoreOptions[maxScoreIndex];
+    cfg.p1Speed  = paddleSpeed;
+    cfg.p2Speed  = paddleSpeed;
+
+    Replay setup;
+    setup.seed            = makeMatchSeed();
+    setup.singlePlayer    = false;
+    setup.gameTimeIndex   = gameTimeIndex;
+    setup.maxScoreIndex   = maxScoreIndex;
+    setup.difficultyIndex = 0;
+    setup.tickRate        = tickRateOptions[tickRateIndex];
+    setup.config          = cfg;
+
+    NetLink* link = &netUdp;
+    if (netEmulate) {
+        netEmulator = new NetEmulator(&netUdp, netConditions, setup.seed);
+        link = netEmulator;
+    }
+
+    bool ok;
+    if (hosting) {
+        std::printf("Waiting for a player on UDP port %d...\n", port);
+        ok = netHostHandshake(*link, setup, netInputDelay, 120.0);
+    } else {
+        std::printf("Joining %s:%d...\n", hostName, port);
+        ok = netJoinHandshake(*link, setup, netInputDelay, 30.0);
+    }
+    if (!ok) {
+        std::fprintf(stderr, "no connection\n");
+        return false;
     }
 
-    ball.radius = 12.0f;
-    resetBall();
+    int rateIndex = -1;
+    for (int i = 0; i < tickRateCount; ++i) {
+        if (tickRateOptions[i] == setup.tickRate) rateIndex = i;
+    }
+    if (rateIndex < 0 || setup.gameTimeIndex >= gameTimeCount || setup.maxScoreIndex >= maxScoreCount) {
+        std::fprintf(stderr, "host uses unsupported settings\n");
+        return false;
+    }
+    gameTimeIndex = setup.gameTimeIndex;
+    maxScoreIndex = setup.maxScoreIndex;
+    tickRateIndex = rateIndex;
+
+    netSession = new NetSession;
+    netStart(*netSession, link, hosting ? 0 : 1, setup, netInputDelay);
+    std::printf("Connected: input delay %d tick(s)\n", netSession->inputDelay);
+
+    isSinglePlayer = false;
+    replayPlayback = false;
+    matchReplay    = setup;
+    match          = netSession->state;
+    std::strcpy(player1Name, hosting ? "You" : "Host");
+    std::strcpy(player2Name, hosting ? "Guest" : "You");
+
+    resetRenderInterpolation();
+    currentState = STATE_PLAYING;
+    return true;
 }
 
-void applySettingsToGame() {
-    timeLeft = (float)gameTimeOptions[gameTimeIndex];
-    maxScore = maxScoreOptions[maxScoreIndex]; // 0 means infinite
+void endOnlineMatch() {
+    if (!netSession) return;
+    netLeave(*netSession, monotonicSeconds());
+    delete netSession;
+    netSession = 0;
+    delete netEmulator;
+    netEmulator = 0;
 }
 
-void startNewMatch() {
-    applySettingsToGame();
-    initRoundObjects(true);
+// ===================== SPECTATING =====================
+// --watch HOST:PORT [--match ID] shows a match running on a dedicated
+// server (server.cpp) from its spectator stream (spectator.h). The lobby
+// says which shard runs the match (ID 0 or none: the newest one); we then
+// subscribe there and renew the subscription every few seconds. The feed
+// plays a little behind the stream and the usual game screen draws it.
+
+UdpLink       watchUdp;
+SpectatorFeed watchFeed;
+uint32_t      watchMatchId   = 0;
+double        watchRenewAt   = 0.0;
+double        watchLastHeard = 0.0;
+const double  watchTimeout   = 10.0;     // seconds without a frame: the server is gone
+
+void sendWatch(UdpLink& link, uint32_t matchId) {
+    uint8_t buf[16];
+    link.send(buf, serverEncodeWatch(buf, matchId), monotonicSeconds());
 }
 
-// ===================== Music =====================
+// Asks the lobby where the match runs (blocking, with console messages)
+// and subscribes to it.
+bool startSpectating(const char* hostName, int port, uint32_t matchId) {
+    UdpLink lobby;
+    if (!lobby.connect(hostName, port)) {
+        std::fprintf(stderr, "could not open UDP %s:%d\n", hostName, port);
+        return false;
+    }
+    std::printf("Looking for %s on %s:%d...\n", matchId ? "the match" : "a match", hostName, port);
+
+    ServerWatchAt at;
+    bool answered = false;
+    double start = monotonicSeconds(), lastAsk = -1.0;
+    while (!answered && monotonicSeconds() - start < 5.0) {
+        if (monotonicSeconds() - lastAsk > 0.5) {
+            sendWatch(lobby, matchId);
+            lastAsk = monotonicSeconds();
+        }
+        uint8_t buf[netMaxDatagram];
+        int n = lobby.receive(buf, sizeof(buf), monotonicSeconds());
+        if (n > 0 && serverPacketType(buf, n) == SERVER_WATCH_AT) answered = serverDecodeWatchAt(buf, n, at);
+        if (n == 0) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    if (!answered) {
+        std::fprintf(stderr, "no answer from the server\n");
+        return false;
+    }
+    if (at.port == 0) {
+        std::fprintf(stderr, "no such match running\n");
+        return false;
+    }
+
+    int rateIndex = -1;
+    for (int i = 0; i < tickRateCount; ++i) {
+        if (tickRateOptions[i] == at.tickRate) rateIndex = i;
+    }
+    if (rateIndex < 0) {
+        std::fprintf(stderr, "server ticks at an unsupported rate (%d Hz)\n", at.tickRate);
+        return false;
+    }
+    if (!watchUdp.connect(hostName, at.port)) {
+        std::fprintf(stderr, "could not open UDP %s:%d\n", hostName, at.port);
+        return false;
+    }
+    std::printf("Watching match %u\n", (unsigned)at.matchId);
 
-void stopBackgroundMusic(); // forward decl
+    tickRateIndex  = rateIndex;
+    watchMatchId   = at.matchId;
+    watchRenewAt   = 0.0;
+    watchLastHeard = monotonicSeconds();
+    spectatorFeedInit(watchFeed);
+
+    isSinglePlayer = false;
+    replayPlayback = false;
+    spectating     = true;
+
+    // Drawn until the first frame arrives
+    MatchConfig cfg;
+    cfg.gameTime = (float)gameTimeOptions[gameTimeIndex];
+    cfg.maxScore = maxScoreOptions[maxScoreIndex];
+    cfg.p1Speed  = paddleSpeed;
+    cfg.p2Speed  = paddleSpeed;
+    matchInit(match, cfg, 0);
+    std::strcpy(player1Name, "Left");
+    std::strcpy(player2Name, "Right");
+
+    resetRenderInterpolation();
+    currentState = STATE_PLAYING;
+    return true;
+}
+
+// Takes in the frames that arrived and shows the next one.
+void spectateTick() {
+    double now = monotonicSeconds();
+    if (now >= watchRenewAt) {
+        sendWatch(watchUdp, watchMatchId);
+        watchRenewAt = now + serverWatchRenewSec;
+    }
+
+    uint8_t buf[netMaxDatagram];
+    int n;
+    while ((n = watchUdp.receive(buf, sizeof(buf), now)) > 0) {
+        uint32_t matchId;
+        if (serverDecodeSpectateHeader(buf, n, matchId) && matchId == watchMatchId) {
+            spectatorDecode(watchFeed, buf + serverSpectateHeaderSize, n - serverSpectateHeaderSize);
+            watchLastHeard = now;
+        }
+    }
+
+    // At least 50 ms behind the newest frame, more if they come further apart
+    match.events = spectatorPlay(watchFeed, tickRateOptions[tickRateIndex] / 20, match);
+    if (now - watchLastHeard > watchTimeout) {
+        match.events |= EVENT_MATCH_OVER;
+        match.over    = true;
+    }
+}
+
+void endSpectating() {
+    spectating = false;
+}
+
+// ===================== Music & SOUND =====================
+// audio.h mixes on its own thread; --audio picks the output (auto, alsa,
+// winmm, null, file:PATH).
+
+const char* audioOutput = "auto";
+const char* musicPath   = "audio/bg_music.wav";   // asset name
 
 void startBackgroundMusic() {
-    BOOL ok = PlaySoundA("D:\\Prog\\C++\\Graphics\\Paddle Rivals\\bg_music.wav",
-                         NULL,
-                         SND_ASYNC | SND_LOOP | SND_FILENAME);
-    if (!ok) {
-        MessageBoxA(NULL, "Failed to load bg_music.wav", "ERROR", MB_OK);
+    static bool warned = false;
+    if (!audioPlayMusic(musicPath, true) && !warned) {
+        std::fprintf(stderr, "could not play %s\n", musicPath);
+        warned = true;
     }
 }
 
 void stopBackgroundMusic() {
-    PlaySoundA(NULL, NULL, 0); // stop any playing sound
+    audioStopMusic();
+}
+
+// Hits, bounces and goals of the tick just simulated, panned to where
+// they happened.
+void playMatchSounds(const MatchState& m) {
+    if (m.events & EVENT_HIT_P1) audioPlay(SOUND_PADDLE_HIT, 0.7f, -0.6f);
+    if (m.events & EVENT_HIT_P2) audioPlay(SOUND_PADDLE_HIT, 0.7f,  0.6f);
+    if (m.events & EVENT_WALL)   audioPlay(SOUND_WALL, 0.5f, m.ball.x / ARENA_WIDTH * 2.0f - 1.0f);
+    if (m.events & (EVENT_SCORE_P1 | EVENT_SCORE_P2)) {
+        audioPlay(SOUND_GOAL, 0.8f, (m.events & EVENT_SCORE_P1) ? 0.5f : -0.5f);
+    }
+}
+
+// ===================== PARTICLES =====================
+// Sparks, bursts and the ball trail (particles.h). Spawned per tick from
+// the match events, moved and drawn per frame in drawGame.
+
+double lastParticleTime = 0.0;
+
+ParticleBurst makeBurst(float x, float y, int count, float r, float g, float b) {
+    ParticleBurst p;
+    p.x = x; p.y = y;
+    p.angle    = 0.0f;
+    p.spread   = 2.0f * 3.14159f;
+    p.minSpeed = 0.0f;
+    p.maxSpeed = 0.0f;
+    p.life     = 0.5f;
+    p.size     = 3.0f;
+    p.r = r; p.g = g; p.b = b; p.a = 1.0f;
+    p.count    = count;
+    return p;
+}
+
+// `before`: the ball at the start of the tick (a goal has re-served it)
+void spawnMatchParticles(const MatchState& m, const Ball& before) {
+    const Ball& ball = m.ball;
+
+    if (m.events & (EVENT_HIT_P1 | EVENT_HIT_P2)) {
+        bool p1 = (m.events & EVENT_HIT_P1) != 0;
+        AvatarStyle s = avatarStyles[p1 ? player1AvatarIndex : player2AvatarIndex];
+        ParticleBurst p = makeBurst(ball.x, ball.y, 24, s.r, s.g, s.b);
+        p.angle    = p1 ? 0.0f : 3.14159f;          // away from the paddle
+        p.spread   = 1.6f;
+        p.minSpeed = 150.0f;
+        p.maxSpeed = 500.0f;
+        p.life     = 0.35f;
+        particlesSpawn(p);
+    }
+    if (m.events & EVENT_WALL) {
+        ParticleBurst p = makeBurst(ball.x, ball.y, 8, 1.0f, 1.0f, 1.0f);
+        p.angle    = ball.y > ARENA_HEIGHT / 2.0f ? -3.14159f / 2.0f : 3.14159f / 2.0f;
+        p.spread   = 2.2f;
+        p.minSpeed = 60.0f;
+        p.maxSpeed = 220.0f;
+        p.life     = 0.25f;
+        p.size     = 2.0f;
+        particlesSpawn(p);
+    }
+    if (m.events & (EVENT_SCORE_P1 | EVENT_SCORE_P2)) {
+        bool p1 = (m.events & EVENT_SCORE_P1) != 0;
+        ParticleBurst p = p1 ? makeBurst(before.x, before.y, 120, 0.2f, 0.5f, 1.0f)
+                             : makeBurst(before.x, before.y, 120, 1.0f, 0.2f, 0.2f);
+        p.minSpeed = 100.0f;
+        p.maxSpeed = 700.0f;
+        p.life     = 0.9f;
+        p.size     = 4.0f;
+        particlesSpawn(p);
+        return;                                   // no trail from the serve point
+    }
+
+    // Trail: one fading dot per tick where the ball is
+    ParticleBurst t;
+    if (themeIndex == 0)      t = makeBurst(ball.x, ball.y, 1, 0.2f, 1.0f, 1.0f);
+    else if (themeIndex == 1) t = makeBurst(ball.x, ball.y, 1, 0.7f, 0.7f, 1.0f);
+    else                      t = makeBurst(ball.x, ball.y, 1, 1.0f, 0.5f, 0.2f);
+    t.maxSpeed = 15.0f;
+    t.life     = 0.25f;
+    t.size     = ball.radius * 0.8f;
+    t.a        = 0.5f;
+    particlesSpawn(t);
+}
+
+// Advances the particles by the real time since the last drawn game frame
+void updateParticles() {
+    double now = monotonicSeconds();
+    float  dt  = lastParticleTime > 0.0 ? (float)(now - lastParticleTime) : 0.0f;
+    if (dt > 0.1f) dt = 0.1f;                     // back from pause: don't jump
+    lastParticleTime = now;
+    particlesUpdate(dt);
 }
 
 // ===================== MAIN MENU =====================
 
 void drawMainMenu() {
+    PROFILE_SCOPE(PHASE_DRAW_MAIN_MENU);
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     setup2D();
 
@@ -443,9 +1011,9 @@ void drawMainMenu() {
     drawMenuCube3D();
 
     // Title color per theme (high contrast)
-    if (themeIndex == 0)      glColor3f(1.0f, 0.3f, 0.9f);   // neon magenta
-    else if (themeIndex == 1) glColor3f(0.4f, 1.0f, 0.6f);   // lime
-    else                      glColor3f(0.3f, 1.0f, 1.0f);   // cyan
+    if (themeIndex == 0)      batchColor3f(1.0f, 0.3f, 0.9f);   // neon magenta
+    else if (themeIndex == 1) batchColor3f(0.4f, 1.0f, 0.6f);   // lime
+    else                      batchColor3f(0.3f, 1.0f, 1.0f);   // cyan
 
     drawStrokeCentered("PADDLE RIVALS", winWidth/2.0f, winHeight - 130.0f, 0.20f);
 
@@ -466,31 +1034,29 @@ void drawMainMenu() {
         if (i == mainMenuIndex) {
             // --- Highlight background bar ---
             if (themeIndex == 0) {          // Neon Night → bright cyan bar
-                glColor3f(0.0f, 1.0f, 0.7f);
+                batchColor3f(0.0f, 1.0f, 0.7f);
             } else if (themeIndex == 1) {   // Cosmic Field → blue bar
-                glColor3f(0.4f, 0.7f, 1.0f);
+                batchColor3f(0.4f, 0.7f, 1.0f);
             } else {                        // Retro Grid → orange bar
-                glColor3f(1.0f, 0.6f, 0.2f);
+                batchColor3f(1.0f, 0.6f, 0.2f);
             }
 
             // Background rectangle behind text
             drawRect(textX - 40.0f, y - 8.0f, 260.0f, 24.0f);
 
             // Optional: ">" arrow indicator
-            glColor3f(0.0f, 0.0f, 0.0f);
+            batchColor3f(0.0f, 0.0f, 0.0f);
             drawBitmapText(">", textX - 30.0f, y);
 
             // Selected text in dark color for contrast
-            glColor3f(0.0f, 0.0f, 0.0f);
+            batchColor3f(0.0f, 0.0f, 0.0f);
             drawBitmapText(options[i], textX, y);
         } else {
             // Non-selected options: light text, no bar
-            glColor3f(0.9f, 0.9f, 0.95f);
+            batchColor3f(0.9f, 0.9f, 0.95f);
             drawBitmapText(options[i], textX, y);
         }
     }
-
-    glutSwapBuffers();
 }
 
 void handleEnterOnMainMenu() {
@@ -508,12 +1074,14 @@ void handleEnterOnMainMenu() {
 // ===================== MODE SELECT =====================
 
 void drawModeSelectMenu() {
+    PROFILE_SCOPE(PHASE_DRAW_MODE_SELECT);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawMenuBackground();
 
-    glColor3f(0.9f, 0.9f, 1.0f);
+    batchColor3f(0.9f, 0.9f, 1.0f);
     drawBitmapText("SELECT MODE", winWidth/2 - 80, winHeight - 100);
 
     const char* modes[] = {
@@ -523,17 +1091,15 @@ void drawModeSelectMenu() {
 
     for (int i = 0; i < 2; ++i) {
         if (i == modeMenuIndex)
-            glColor3f(0.2f, 0.8f, 1.0f);
+            batchColor3f(0.2f, 0.8f, 1.0f);
         else
-            glColor3f(0.7f, 0.7f, 0.8f);
+            batchColor3f(0.7f, 0.7f, 0.8f);
 
         drawBitmapText(modes[i], winWidth/2 - 80, winHeight/2 + 20 - i * 40);
     }
 
-    glColor3f(0.6f, 0.6f, 0.7f);
+    batchColor3f(0.6f, 0.6f, 0.7f);
     drawBitmapText("Press ESC to go back", 20, 20);
-
-    glutSwapBuffers();
 }
 
 void handleEnterOnModeMenu() {
@@ -550,56 +1116,56 @@ void handleEnterOnModeMenu() {
 // ===================== DIFFICULTY SELECT =====================
 
 void drawDifficultySelect() {
+    PROFILE_SCOPE(PHASE_DRAW_DIFFICULTY);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawMenuBackground();
 
-    glColor3f(0.9f, 0.9f, 1.0f);
+    batchColor3f(0.9f, 0.9f, 1.0f);
     drawBitmapText("SELECT DIFFICULTY", winWidth/2 - 110, winHeight - 90);
 
-    const char* labels[] = { "Easy", "Medium", "Hard" };
+    const char* labels[] = { "Easy", "Medium", "Hard", "Expert" };
     float startY = winHeight / 2.0f + 40.0f;
 
-    for (int i = 0; i < 3; ++i) {
+    for (int i = 0; i < 4; ++i) {
         if (i == difficultyIndex)
-            glColor3f(0.2f, 0.8f, 1.0f);
+            batchColor3f(0.2f, 0.8f, 1.0f);
         else
-            glColor3f(0.7f, 0.7f, 0.8f);
+            batchColor3f(0.7f, 0.7f, 0.8f);
 
         drawBitmapText(labels[i], winWidth/2 - 40, startY - i * 40);
     }
 
-    glColor3f(0.6f, 0.6f, 0.7f);
+    batchColor3f(0.6f, 0.6f, 0.7f);
     drawBitmapText("Use Up/Down to choose, Enter to continue, ESC to go back", 60, 40);
-
-    glutSwapBuffers();
 }
 
 // ===================== NAME INPUT SCREENS =====================
 
 void drawNameInputScreen(const char* title, const char* label) {
+    PROFILE_SCOPE(PHASE_DRAW_NAME_INPUT);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawMenuBackground();
 
-    glColor3f(0.9f, 0.9f, 1.0f);
+    batchColor3f(0.9f, 0.9f, 1.0f);
     drawBitmapText(title, winWidth/2 - 100, winHeight - 80);
 
-    glColor3f(0.8f, 0.8f, 0.9f);
+    batchColor3f(0.8f, 0.8f, 0.9f);
     drawBitmapText(label, winWidth/2 - 150, winHeight/2 + 20);
 
-    glColor3f(0.2f, 0.2f, 0.3f);
+    batchColor3f(0.2f, 0.2f, 0.3f);
     drawRect(winWidth/2 - 150, winHeight/2 - 10, 300, 30);
 
-    glColor3f(1.0f, 1.0f, 1.0f);
+    batchColor3f(1.0f, 1.0f, 1.0f);
     drawBitmapText(nameBuffer, winWidth/2 - 140, winHeight/2);
 
-    glColor3f(0.6f, 0.6f, 0.7f);
+    batchColor3f(0.6f, 0.6f, 0.7f);
     drawBitmapText("Type name, Enter to confirm, ESC to cancel/back", winWidth/2 - 170, 40);
-
-    glutSwapBuffers();
 }
 
 void finishSingleNameInput() {
@@ -640,36 +1206,40 @@ void drawAvatarPreview(float cx, float cy, int index, bool highlight) {
     AvatarStyle style = avatarStyles[index];
 
     if (highlight) {
-        glColor3f(1.0f, 1.0f, 1.0f);
+        batchColor3f(1.0f, 1.0f, 1.0f);
         drawCircle(cx, cy, 40.0f);
     }
 
-    glColor3f(style.r, style.g, style.b);
+    batchColor3f(style.r, style.g, style.b);
 
     switch (index) {
         case 0: // Circle logo
             drawCircle(cx, cy, 28.0f);
-            glColor3f(0.0f, 0.0f, 0.0f);
+            batchColor3f(0.0f, 0.0f, 0.0f);
             drawCircle(cx, cy, 12.0f);
             break;
-        case 1: // Shield
-            glBegin(GL_POLYGON);
-                glVertex2f(cx - 22.0f, cy + 24.0f);
-                glVertex2f(cx + 22.0f, cy + 24.0f);
-                glVertex2f(cx + 18.0f, cy - 10.0f);
-                glVertex2f(cx,          cy - 28.0f);
-                glVertex2f(cx - 18.0f, cy - 10.0f);
-            glEnd();
+        case 1: { // Shield
+            float pts[] = {
+                cx - 22.0f, cy + 24.0f,
+                cx + 22.0f, cy + 24.0f,
+                cx + 18.0f, cy - 10.0f,
+                cx,         cy - 28.0f,
+                cx - 18.0f, cy - 10.0f
+            };
+            batchFan(pts, 5);
             break;
-        case 2: // Star
-            glBegin(GL_TRIANGLE_FAN);
+        }
+        case 2: { // Star
+            float pts[2 * 10];
             for (int i = 0; i < 10; ++i) {
                 float a = i * 2.0f * 3.14159f / 10.0f;
                 float r = (i % 2 == 0) ? 30.0f : 14.0f;
-                glVertex2f(cx + cosf(a)*r, cy + sinf(a)*r);
+                pts[2*i]     = cx + cosf(a)*r;
+                pts[2*i + 1] = cy + sinf(a)*r;
             }
-            glEnd();
+            batchFan(pts, 10);
             break;
+        }
         case 3: // Hexagon
             drawHexagon(cx, cy, 28.0f);
             break;
@@ -677,12 +1247,14 @@ void drawAvatarPreview(float cx, float cy, int index, bool highlight) {
 }
 
 void drawAvatarSelectScreen(const char* title, const char* subtitle) {
+    PROFILE_SCOPE(PHASE_DRAW_AVATAR_SELECT);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawMenuBackground();
 
-    glColor3f(0.9f, 0.9f, 1.0f);
+    batchColor3f(0.9f, 0.9f, 1.0f);
     drawBitmapText(title,    winWidth/2 - 100, winHeight - 80);
     drawBitmapText(subtitle, winWidth/2 - 150, winHeight - 120);
 
@@ -695,10 +1267,8 @@ void drawAvatarSelectScreen(const char* title, const char* subtitle) {
         drawAvatarPreview(startX + i*spacing, centerY, i, highlight);
     }
 
-    glColor3f(0.8f, 0.8f, 0.9f);
+    batchColor3f(0.8f, 0.8f, 0.9f);
     drawBitmapText("Use LEFT/RIGHT to choose, ENTER to confirm, ESC to go back", 80, 60);
-
-    glutSwapBuffers();
 }
 
 void finishAvatarSingle() {
@@ -706,7 +1276,8 @@ void finishAvatarSingle() {
 
     if      (difficultyIndex == 0) std::strcpy(player2Name, "AI (Easy)");
     else if (difficultyIndex == 1) std::strcpy(player2Name, "AI (Medium)");
-    else                           std::strcpy(player2Name, "AI (Hard)");
+    else if (difficultyIndex == 2) std::strcpy(player2Name, "AI (Hard)");
+    else                           std::strcpy(player2Name, "AI (Expert)");
 
     isSinglePlayer = true;
     startNewMatch();
@@ -732,15 +1303,17 @@ void finishAvatarMultiP2() {
 // ===================== HOW TO PLAY =====================
 
 void drawHowToPlay() {
+    PROFILE_SCOPE(PHASE_DRAW_HOW_TO_PLAY);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawMenuBackground();
 
-    glColor3f(0.9f, 0.9f, 1.0f);
+    batchColor3f(0.9f, 0.9f, 1.0f);
     drawBitmapText("HOW TO PLAY", winWidth/2 - 70, winHeight - 80);
 
-    glColor3f(0.8f, 0.8f, 0.9f);
+    batchColor3f(0.8f, 0.8f, 0.9f);
     int y = winHeight - 140;
     drawBitmapText("- Paddle Rivals is a 3D Pong-style rivalry game.",                60, y); y -= 30;
     drawBitmapText("- Player 1: W/S for up/down, A/D for left/right.",               60, y); y -= 30;
@@ -751,21 +1324,21 @@ void drawHowToPlay() {
     drawBitmapText("- Game Time & Max Score can be set from Settings.",              60, y); y -= 30;
     drawBitmapText("- Difficulty affects only the AI in Single Player.",             60, y); y -= 30;
 
-    glColor3f(0.6f, 0.6f, 0.7f);
+    batchColor3f(0.6f, 0.6f, 0.7f);
     drawBitmapText("Press ESC to return to Main Menu", 60, 40);
-
-    glutSwapBuffers();
 }
 
 // ===================== SETTINGS =====================
 
 void drawSettings() {
+    PROFILE_SCOPE(PHASE_DRAW_SETTINGS);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawMenuBackground();
 
-    glColor3f(0.9f, 0.9f, 1.0f);
+    batchColor3f(0.9f, 0.9f, 1.0f);
     drawBitmapText("SETTINGS", winWidth/2 - 50, winHeight - 80);
 
     char line[64];
@@ -773,15 +1346,15 @@ void drawSettings() {
     int y = winHeight - 150;
 
     // Game Time
-    if (settingsCursor == 0) glColor3f(0.2f, 0.8f, 1.0f);
-    else                     glColor3f(0.9f, 0.9f, 0.95f);
+    if (settingsCursor == 0) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
     std::sprintf(line, "Game Time: %d sec", gameTimeOptions[gameTimeIndex]);
     drawBitmapText(line, 80, y);
 
     // Max Score
     y -= 40;
-    if (settingsCursor == 1) glColor3f(0.2f, 0.8f, 1.0f);
-    else                     glColor3f(0.9f, 0.9f, 0.95f);
+    if (settingsCursor == 1) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
     int msVal = maxScoreOptions[maxScoreIndex];
     if (msVal == 0) std::sprintf(line, "Max Score: Infinite");
     else            std::sprintf(line, "Max Score: %d", msVal);
@@ -789,21 +1362,51 @@ void drawSettings() {
 
     // Theme
     y -= 40;
-    if (settingsCursor == 2) glColor3f(0.2f, 0.8f, 1.0f);
-    else                     glColor3f(0.9f, 0.9f, 0.95f);
+    if (settingsCursor == 2) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
     std::sprintf(line, "Theme: %s", themeNames[themeIndex]);
     drawBitmapText(line, 80, y);
 
+    // Simulation tick rate
+    y -= 40;
+    if (settingsCursor == 3) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
+    std::sprintf(line, "Sim Rate: %d Hz", tickRateOptions[tickRateIndex]);
+    drawBitmapText(line, 80, y);
+
+    // Cube animation
+    y -= 40;
+    if (settingsCursor == 4) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
+    std::sprintf(line, "Menu Cube: %s", cubeModeNames[cubeModeIndex]);
+    drawBitmapText(line, 80, y);
+
+    // Chaos balls
+    y -= 40;
+    if (settingsCursor == 5) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
+    if (chaosOptions[chaosIndex] == 0) std::sprintf(line, "Chaos Balls: Off");
+    else                               std::sprintf(line, "Chaos Balls: %d", chaosOptions[chaosIndex]);
+    drawBitmapText(line, 80, y);
+
+    // Render scale
+    y -= 40;
+    if (settingsCursor == 6) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
+    if (!renderScaleSupported())  std::sprintf(line, "Render Scale: 100%% (no FBO support)");
+    else if (renderScaleIsAuto()) std::sprintf(line, "Render Scale: Auto (%d%%)",
+                                                (int)(renderScaleStats().autoScale * 100.0f + 0.5f));
+    else                          std::sprintf(line, "Render Scale: %d%%", renderScaleOptions[renderScaleIndex]);
+    drawBitmapText(line, 80, y);
+
     // Back
     y -= 40;
-    if (settingsCursor == 3) glColor3f(0.2f, 0.8f, 1.0f);
-    else                     glColor3f(0.9f, 0.9f, 0.95f);
+    if (settingsCursor == 7) batchColor3f(0.2f, 0.8f, 1.0f);
+    else                     batchColor3f(0.9f, 0.9f, 0.95f);
     drawBitmapText("Back to Main Menu", 80, y);
 
-    glColor3f(0.6f, 0.6f, 0.7f);
+    batchColor3f(0.6f, 0.6f, 0.7f);
     drawBitmapText("Use Up/Down to select, Left/Right to change, Enter/ESC to go back.", 40, 40);
-
-    glutSwapBuffers();
 }
 
 // ===================== GAME RENDERING =====================
@@ -811,27 +1414,74 @@ void drawSettings() {
 void drawAvatarHUD(float x, float y, int avatarIndex) {
     AvatarStyle style = avatarStyles[avatarIndex];
 
-    glColor3f(0.0f, 0.0f, 0.0f);
+    batchColor3f(0.0f, 0.0f, 0.0f);
     drawCircle(x + 4, y - 4, 22.0f);
 
-    glColor3f(style.r, style.g, style.b);
+    batchColor3f(style.r, style.g, style.b);
     switch (avatarIndex) {
         case 0: drawCircle(x, y, 20.0f); break;
-        case 1:
-            glBegin(GL_POLYGON);
-                glVertex2f(x - 18.0f, y + 20.0f);
-                glVertex2f(x + 18.0f, y + 20.0f);
-                glVertex2f(x + 14.0f, y - 5.0f);
-                glVertex2f(x,          y - 20.0f);
-                glVertex2f(x - 14.0f, y - 5.0f);
-            glEnd();
+        case 1: {
+            float pts[] = {
+                x - 18.0f, y + 20.0f,
+                x + 18.0f, y + 20.0f,
+                x + 14.0f, y - 5.0f,
+                x,         y - 20.0f,
+                x - 14.0f, y - 5.0f
+            };
+            batchFan(pts, 5);
             break;
+        }
         case 2: drawTriangle(x, y, 22.0f); break;
         case 3: drawHexagon(x, y, 20.0f);  break;
     }
 }
 
+float lerpf(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+Paddle lerpPaddle(const Paddle& a, const Paddle& b, float t) {
+    Paddle p = b;
+    p.x = lerpf(a.x, b.x, t);
+    p.y = lerpf(a.y, b.y, t);
+    return p;
+}
+
+Ball lerpBall(const Ball& a, const Ball& b, float t) {
+    Ball ball = b;
+    ball.x = lerpf(a.x, b.x, t);
+    ball.y = lerpf(a.y, b.y, t);
+    return ball;
+}
+
+// Online and spectated matches have no chaos balls
+bool chaosActive() {
+    return chaos.count > 0 && !netSession && !spectating;
+}
+
+// One draw call for the whole swarm
+void drawChaos() {
+    int n = chaos.count;
+    chaosDrawX.resize(n);
+    chaosDrawY.resize(n);
+    for (int i = 0; i < n; ++i) {
+        chaosDrawX[i] = lerpf(chaos.prevX[i], chaos.x[i], renderAlpha);
+        chaosDrawY[i] = lerpf(chaos.prevY[i], chaos.y[i], renderAlpha);
+    }
+
+    batchSetBlend(true);
+    batchSetTexture(batchDiscTexture());
+    if (themeIndex == 0)      batchColor4f(0.4f, 1.0f, 1.0f, 0.85f);
+    else if (themeIndex == 1) batchColor4f(0.8f, 0.8f, 1.0f, 0.85f);
+    else                      batchColor4f(1.0f, 0.7f, 0.4f, 0.85f);
+    batchSprites(&chaosDrawX[0], &chaosDrawY[0], &chaos.radius[0], 0, n);
+    batchSetTexture(0);
+    batchSetBlend(false);
+}
+
 void drawGame() {
+    PROFILE_SCOPE(PHASE_DRAW_GAME);
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     // 3D object behind the field
@@ -841,18 +1491,25 @@ void drawGame() {
 
     // --- Camera shake offsets ---
     float ox = 0.0f, oy = 0.0f;
-    if (shakeFrames > 0) {
+    if (shakeTime > 0.0f) {
         ox = ((rand() % 100) / 100.0f - 0.5f) * shakeIntensity;
         oy = ((rand() % 100) / 100.0f - 0.5f) * shakeIntensity;
     }
 
-    glPushMatrix();
-    glTranslatef(ox, oy, 0.0f);
+    batchSetTransform(1.0f, 1.0f, ox, oy);
 
     drawGameBackground();
 
+    // Field objects are in arena units; map the arena onto the window
+    batchSetTransform(winWidth / ARENA_WIDTH, winHeight / ARENA_HEIGHT, ox, oy);
+
+    // Between the last two ticks, so motion doesn't judder
+    Paddle p1   = lerpPaddle(prevTickState.p1, match.p1, renderAlpha);
+    Paddle p2   = lerpPaddle(prevTickState.p2, match.p2, renderAlpha);
+    Ball   ball = lerpBall(prevTickState.ball, match.ball, renderAlpha);
+
     // Shadows for 3D-ish feel
-    glColor3f(0.0f, 0.0f, 0.0f);
+    batchColor3f(0.0f, 0.0f, 0.0f);
     drawRect(p1.x - p1.width/2 + 6, p1.y - p1.height/2 - 6, p1.width, p1.height);
     drawRect(p2.x - p2.width/2 + 6, p2.y - p2.height/2 - 6, p2.width, p2.height);
     drawCircle(ball.x + 5, ball.y - 5, ball.radius);
@@ -860,105 +1517,310 @@ void drawGame() {
     AvatarStyle s1 = avatarStyles[player1AvatarIndex];
     AvatarStyle s2 = avatarStyles[player2AvatarIndex];
 
-    glColor3f(s1.r, s1.g, s1.b);
+    batchColor3f(s1.r, s1.g, s1.b);
     drawRect(p1.x - p1.width/2, p1.y - p1.height/2, p1.width, p1.height);
 
-    glColor3f(s2.r, s2.g, s2.b);
+    batchColor3f(s2.r, s2.g, s2.b);
     drawRect(p2.x - p2.width/2, p2.y - p2.height/2, p2.width, p2.height);
 
+    if (chaosActive()) drawChaos();
+
+    {
+        PROFILE_SCOPE(PHASE_PARTICLES);
+        updateParticles();
+        particlesDraw();
+    }
+
     // Ball glow (theme-based)
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    if (themeIndex == 0)      glColor4f(0.2f, 1.0f, 1.0f, 0.4f);
-    else if (themeIndex == 1) glColor4f(0.7f, 0.7f, 1.0f, 0.4f);
-    else                      glColor4f(1.0f, 0.5f, 0.2f, 0.4f);
+    batchSetBlend(true);
+    if (themeIndex == 0)      batchColor4f(0.2f, 1.0f, 1.0f, 0.4f);
+    else if (themeIndex == 1) batchColor4f(0.7f, 0.7f, 1.0f, 0.4f);
+    else                      batchColor4f(1.0f, 0.5f, 0.2f, 0.4f);
     drawCircle(ball.x, ball.y, ball.radius + 8.0f);
-    glDisable(GL_BLEND);
+    batchSetBlend(false);
 
     // Ball core
-    glColor3f(1.0f, 1.0f, 1.0f);
+    batchColor3f(1.0f, 1.0f, 1.0f);
     drawCircle(ball.x, ball.y, ball.radius);
 
+    batchSetTransform(1.0f, 1.0f, ox, oy);
+
     // HUD
     drawAvatarHUD(60.0f, winHeight - 45.0f, player1AvatarIndex);
-    glColor3f(1.0f, 1.0f, 1.0f);
+    batchColor3f(1.0f, 1.0f, 1.0f);
     drawBitmapText(player1Name, 100.0f, winHeight - 52.0f);
 
     drawAvatarHUD(winWidth - 60.0f, winHeight - 45.0f, player2AvatarIndex);
     drawBitmapText(player2Name, winWidth - 200.0f, winHeight - 52.0f);
 
     char scoreText[64];
-    std::sprintf(scoreText, "%d  :  %d", scoreP1, scoreP2);
+    std::sprintf(scoreText, "%d  :  %d", match.scoreP1, match.scoreP2);
     drawBitmapText(scoreText, winWidth/2 - 20, winHeight - 52.0f);
 
     char timeText[32];
-    std::sprintf(timeText, "Time: %d", (int)timeLeft);
+    std::sprintf(timeText, "Time: %d", (int)match.timeLeft);
     drawBitmapText(timeText, winWidth/2 - 40, winHeight - 80.0f);
 
+    if (replayPlayback) {
+        batchColor3f(1.0f, 0.8f, 0.2f);
+        char replayText[64];
+        std::sprintf(replayText, "REPLAY  tick %u / %u",
+                     (unsigned)match.tick, (unsigned)matchReplay.inputs.size());
+        drawBitmapText(replayText, winWidth/2 - 80, winHeight - 108.0f);
+    }
+
+    if (chaosActive()) {
+        batchColor3f(1.0f, 0.5f, 0.9f);
+        char chaosText[64];
+        std::sprintf(chaosText, "CHAOS  %d balls  %d : %d", chaos.count, chaosGoalsP1, chaosGoalsP2);
+        drawBitmapText(chaosText, winWidth/2 - 90, 20.0f);
+    }
+
+    if (netSession) {
+        const NetStats& ns = netSession->stats;
+        batchColor3f(ns.desync ? 1.0f : 0.4f, ns.desync ? 0.3f : 1.0f, 0.4f);
+        char netText[96];
+        std::sprintf(netText, "ONLINE  ping %.0f ms  rollback %d%s",
+                     ns.rttMs, ns.maxRollback, ns.desync ? "  DESYNC" : "");
+        drawBitmapText(netText, winWidth/2 - 100, winHeight - 108.0f);
+    }
+
+    if (spectating) {
+        const SpectatorStats& ws = watchFeed.stats;
+        double behindTicks = watchFeed.playing ? watchFeed.newestTick - watchFeed.playTick : 0.0;
+        batchColor3f(1.0f, 0.4f, 0.4f);
+        char watchText[96];
+        std::sprintf(watchText, "LIVE  delay %.0f ms  keyframes %llu  lost %llu",
+                     1000.0 * behindTicks / tickRateOptions[tickRateIndex],
+                     (unsigned long long)ws.keyframes, (unsigned long long)ws.orphans);
+        drawBitmapText(watchText, winWidth/2 - 120, winHeight - 108.0f);
+    }
+
     // Screen flash overlay (also shaken)
-    if (flashFrames > 0) {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        glColor4f(flashR, flashG, flashB, 0.25f);
+    if (flashTime > 0.0f) {
+        batchSetBlend(true);
+        batchColor4f(flashR, flashG, flashB, 0.25f);
         drawRect(0, 0, winWidth, winHeight);
-        glDisable(GL_BLEND);
+        batchSetBlend(false);
     }
 
-    glPopMatrix();
-
-    glutSwapBuffers();
+    batchResetTransform();
 }
 
 // ===================== PAUSED & GAME OVER =====================
 
 void drawPaused() {
+    PROFILE_SCOPE(PHASE_DRAW_PAUSED);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawGameBackground();
 
-    glColor3f(0.0f, 0.0f, 0.0f);
+    batchColor3f(0.0f, 0.0f, 0.0f);
     drawRect(winWidth/2 - 160, winHeight/2 - 80, 320, 160);
 
-    glColor3f(0.9f, 0.9f, 1.0f);
+    batchColor3f(0.9f, 0.9f, 1.0f);
     drawBitmapText("PAUSED", winWidth/2 - 40, winHeight/2 + 40);
 
-    glColor3f(0.7f, 0.7f, 0.8f);
+    batchColor3f(0.7f, 0.7f, 0.8f);
     drawBitmapText("Press ESC to Resume",        winWidth/2 - 80, winHeight/2);
     drawBitmapText("Press M to go to Main Menu", winWidth/2 - 110, winHeight/2 - 30);
-
-    glutSwapBuffers();
 }
 
 void drawGameOver() {
+    PROFILE_SCOPE(PHASE_DRAW_GAME_OVER);
+
     glClear(GL_COLOR_BUFFER_BIT);
     setup2D();
 
     drawGameBackground();
 
-    glColor3f(0.0f, 0.0f, 0.0f);
+    batchColor3f(0.0f, 0.0f, 0.0f);
     drawRect(winWidth/2 - 200, winHeight/2 - 90, 400, 180);
 
-    glColor3f(1.0f, 0.8f, 0.8f);
+    batchColor3f(1.0f, 0.8f, 0.8f);
     drawBitmapText("GAME OVER", winWidth/2 - 60, winHeight/2 + 40);
 
-    char result[64];
+    int scoreP1 = match.scoreP1;
+    int scoreP2 = match.scoreP2;
+
+    char result[96];         // a 31-char name and two full ints fit
     if (scoreP1 > scoreP2)
-        std::sprintf(result, "Winner: %s (%d : %d)", player1Name, scoreP1, scoreP2);
+        std::snprintf(result, sizeof(result), "Winner: %s (%d : %d)", player1Name, scoreP1, scoreP2);
     else if (scoreP2 > scoreP1)
-        std::sprintf(result, "Winner: %s (%d : %d)", player2Name, scoreP2, scoreP1);
+        std::snprintf(result, sizeof(result), "Winner: %s (%d : %d)", player2Name, scoreP2, scoreP1);
     else
-        std::sprintf(result, "Draw! (%d : %d)", scoreP1, scoreP2);
+        std::snprintf(result, sizeof(result), "Draw! (%d : %d)", scoreP1, scoreP2);
 
     drawBitmapText(result, winWidth/2 - 140, winHeight/2 - 10);
     drawBitmapText("Press M for Main Menu",      winWidth/2 - 90,  winHeight/2 - 40);
+}
+
+// ===================== RENDER STATS (F2) =====================
+
+bool showRenderStats = false;
+
+// One line of the stats box, row 0 at the bottom
+void drawRenderStatsRow(const char* line, int row) {
+    float y = 8.0f + 24.0f * row;
+    batchColor3f(0.0f, 0.0f, 0.0f);
+    drawRect(winWidth - 330.0f, y, 322.0f, 22.0f);
+    batchColor3f(0.4f, 1.0f, 0.4f);
+    drawBitmapText(line, winWidth - 324.0f, y + 6.0f, GLUT_BITMAP_HELVETICA_12);
+}
 
-    glutSwapBuffers();
+void drawRenderStats() {
+    setup2D();
+
+    // Counters are from the previous frame (this one isn't finished yet)
+    BatchStats st = batchFrameStats();
+    TextStats  ts = textStats();
+    char line[96];
+    std::sprintf(line, "Draw calls: %d  Vertices: %d  Text layouts: %d",
+                 st.drawCalls, st.vertices, ts.layouts);
+    drawRenderStatsRow(line, 0);
+
+    FrameSchedulerStats fs = frameSchedulerStats();
+    std::sprintf(line, "Display: %.0f Hz %s  FPS: %.1f  Missed: %llu",
+                 fs.refreshHz, fs.vsync ? "(vsync)" : "(paced)", fs.fps,
+                 (unsigned long long)fs.missedDeadlines);
+    drawRenderStatsRow(line, 1);
+
+    std::sprintf(line, "CPU: %.1f%%  Redraw: %s", cpuUsagePercent,
+                 screenAnimates() ? "every frame" : "on change");
+    drawRenderStatsRow(line, 2);
+
+    InputStats is = inputStats();
+    std::sprintf(line, "Input: key-to-screen %.1f / %.1f ms  Taps: %llu",
+                 histogramPercentile(is.latencyUs, 0.50) / 1e3,
+                 histogramPercentile(is.latencyUs, 0.99) / 1e3, (unsigned long long)is.subTickTaps);
+    drawRenderStatsRow(line, 3);
+
+    int row = 4;
+    RenderScaleStats rs = renderScaleStats();
+    if (rs.active || renderScaleIsAuto()) {
+        std::sprintf(line, "Render: %d x %d of %d x %d%s", rs.width, rs.height, winWidth, winHeight,
+                     renderScaleIsAuto() ? "  (auto)" : "");
+        drawRenderStatsRow(line, row++);
+    }
+
+    AudioStats as;
+    audioGetStats(as);
+    if (as.backend) {
+        std::sprintf(line, "Audio: %s  hit-to-sound %.1f / %.1f ms  Xruns: %llu",
+                     as.backend, histogramPercentile(as.latencyUs, 0.50) / 1e3,
+                     histogramPercentile(as.latencyUs, 0.99) / 1e3, (unsigned long long)as.underruns);
+        drawRenderStatsRow(line, row++);
+    }
+
+    ParticleStats ps = particlesStats();
+    if (ps.live > 0 || ps.culled > 0) {
+        std::sprintf(line, "Particles: %d / %d  spawned %llu  culled %llu",
+                     ps.live, particleCapacity, (unsigned long long)ps.spawned, (unsigned long long)ps.culled);
+        drawRenderStatsRow(line, row++);
+    }
+
+    if (chaosActive()) {
+        std::sprintf(line, "Chaos: %d balls  %s  step %.0f us  contacts %d",
+                     chaos.count, swarmKernelName(swarmCurrentKernel()), chaosStepUs, chaosContacts);
+        drawRenderStatsRow(line, row++);
+    }
+
+    if (expertWorkersStarted) {
+        SearchStats ss = expertAi.stats();
+        std::sprintf(line, "Expert AI: %.0f rollouts / tick",
+                     ss.slices ? (double)ss.rollouts / (double)ss.slices : 0.0);
+        drawRenderStatsRow(line, row++);
+    }
+}
+
+// ===================== PROFILER OVERLAY (F3, F4 = CSV) =====================
+
+bool showProfilerOverlay = false;
+
+const int   graphFrames = 240;
+const float graphMsToPx = 3.0f;     // 33 ms = ~100 px
+
+void drawProfilerOverlay() {
+    PROFILE_SCOPE(PHASE_DRAW_OVERLAY);
+    setup2D();
+
+    // Percentiles are refreshed twice a second, not every frame
+    static float p50[PHASE_COUNT + 1], p99[PHASE_COUNT + 1];
+    static int   framesUntilRefresh = 0;
+    if (--framesUntilRefresh <= 0) {
+        for (int p = 0; p <= PHASE_COUNT; ++p) profilerPercentiles(p, p50[p], p99[p]);
+        framesUntilRefresh = 30;
+    }
+
+    static FrameSample samples[graphFrames];
+    int n = profilerSamples(samples, graphFrames);
+
+    int   rows   = 0;
+    for (int p = 0; p < PHASE_COUNT; ++p) if (p99[p] > 0.0f) rows++;
+
+    float x0     = 10.0f;
+    float graphY = 40.0f;
+    float graphH = 100.0f;
+    float panelW = 420.0f;
+    float panelH = graphH + 50.0f + rows * 14.0f;
+
+    batchSetBlend(true);
+    batchColor4f(0.0f, 0.0f, 0.0f, 0.75f);
+    drawRect(x0, graphY - 10.0f, panelW, panelH);
+    batchSetBlend(false);
+
+    // Frame-time graph, newest on the right
+    for (int i = 0; i < n; ++i) {
+        float ms = samples[i].frameMs;
+        if      (ms < 17.0f) batchColor3f(0.3f, 1.0f, 0.4f);
+        else if (ms < 34.0f) batchColor3f(1.0f, 0.9f, 0.3f);
+        else                 batchColor3f(1.0f, 0.3f, 0.3f);
+
+        float h = ms * graphMsToPx;
+        if (h > graphH) h = graphH;
+        drawRect(x0 + 10.0f + (graphFrames - n + i) * 1.5f, graphY, 1.5f, h);
+    }
+
+    // 16.7 ms / 33.3 ms guides
+    batchColor3f(0.6f, 0.6f, 0.6f);
+    drawRect(x0 + 10.0f, graphY + 16.7f * graphMsToPx, graphFrames * 1.5f, 1.0f);
+    drawRect(x0 + 10.0f, graphY + 33.3f * graphMsToPx, graphFrames * 1.5f, 1.0f);
+
+    char line[96];
+    float y = graphY + graphH + 22.0f + rows * 14.0f;
+
+    batchColor3f(1.0f, 1.0f, 1.0f);
+    std::sprintf(line, "frame  p50 %.2f ms  p99 %.2f ms", p50[PHASE_COUNT], p99[PHASE_COUNT]);
+    drawBitmapText(line, x0 + 10.0f, y, GLUT_BITMAP_HELVETICA_12);
+
+    batchColor3f(0.8f, 0.8f, 0.9f);
+    for (int p = 0; p < PHASE_COUNT; ++p) {
+        if (p99[p] <= 0.0f) continue;
+        y -= 14.0f;
+        std::sprintf(line, "%-22s p50 %7.0f us  p99 %7.0f us",
+                     profilerPhaseName((ProfilePhase)p), p50[p], p99[p]);
+        drawBitmapText(line, x0 + 10.0f, y, GLUT_BITMAP_HELVETICA_12);
+    }
+}
+
+void dumpProfilerCsv() {
+    char path[64];
+    std::sprintf(path, "profile_%ld.csv", (long)time(0));
+    if (profilerWriteCsv(path)) std::printf("Profiler samples written to %s\n", path);
+    else                        std::printf("Could not write %s\n", path);
 }
 
 // ===================== DISPLAY CALLBACK =====================
 
 void displayCallback() {
+    double frameStart = monotonicSeconds();
+
+    // The screens draw in window pixels; at a render scale below 100% that
+    // lands in a smaller offscreen target, stretched over the window below
+    renderScaleBegin(winWidth, winHeight, currentRenderScale());
+
     switch (currentState) {
         case STATE_MAIN_MENU:              drawMainMenu();                        break;
         case STATE_MODE_SELECT:            drawModeSelectMenu();                  break;
@@ -975,6 +1837,51 @@ void displayCallback() {
         case STATE_PAUSED:                 drawPaused();                          break;
         case STATE_GAME_OVER:              drawGameOver();                        break;
     }
+
+    {
+        PROFILE_SCOPE(PHASE_UPSCALE);
+        renderScaleEnd();
+    }
+
+    // Overlays and the queued text are drawn at full resolution
+    if (showRenderStats)     drawRenderStats();
+    if (showProfilerOverlay) drawProfilerOverlay();
+
+    {
+        PROFILE_SCOPE(PHASE_TEXT_FLUSH);
+        textFlush();
+    }
+    {
+        PROFILE_SCOPE(PHASE_BATCH_FLUSH);
+        batchEndFrame();
+    }
+    {
+        PROFILE_SCOPE(PHASE_SWAP);
+        if (renderScaleIsAuto()) {
+            // Wait for the GL so the time covers the whole render, not
+            // just the submit, and judge it against one refresh
+            glFinish();
+            renderScaleAuto((monotonicSeconds() - frameStart) * 1000.0,
+                            1000.0 / frameSchedulerStats().refreshHz);
+        }
+        glutSwapBuffers();
+    }
+    inputPresented(monotonicSeconds());
+
+    if (!startupReported) {
+        AssetStats as = assetsStats();
+        double     now = monotonicSeconds();
+        std::printf("startup: first frame after %.0f ms (window %.0f ms), assets: %s\n",
+                    (now - startupBegin) * 1000.0, (startupWindowAt - startupBegin) * 1000.0,
+                    as.packed ? "assets.pak" : "loose files");
+        if (as.packed) std::printf("  %d items, %.1f MB mapped in %.2f ms\n", as.items, as.bytes / 1e6, as.openMs);
+        startupReported = true;
+    }
+
+    profilerEndFrame();
+    frameSchedulerFrameDone(monotonicSeconds());
+    framePending = false;
+    needsRedraw  = false;
 }
 
 // ===================== RESHAPE =====================
@@ -983,6 +1890,8 @@ void reshapeCallback(int w, int h) {
     winWidth  = (w > 0) ? w : 1;
     winHeight = (h > 0) ? h : 1;
     glViewport(0, 0, winWidth, winHeight);
+    layerCacheInvalidate();
+    requestRedraw();
 }
 
 // ===================== NAME INPUT KEYBOARD =====================
@@ -1016,7 +1925,10 @@ void handleNameInputKey(unsigned char key) {
 // ===================== KEYBOARD INPUT =====================
 
 void keyboardCallback(unsigned char key, int x, int y) {
+    PROFILE_SCOPE(PHASE_INPUT);
+
     keyDown[(unsigned char)key] = true;
+    inputKeyEvent(key, false, true, monotonicSeconds());
 
     switch (currentState) {
         case STATE_MAIN_MENU:
@@ -1065,7 +1977,7 @@ void keyboardCallback(unsigned char key, int x, int y) {
 
         case STATE_SETTINGS:
             if (key == 27) currentState = STATE_MAIN_MENU;
-            else if (key == 13 && settingsCursor == 3) currentState = STATE_MAIN_MENU;
+            else if (key == 13 && settingsCursor == 7) currentState = STATE_MAIN_MENU;
             break;
 
         case STATE_PLAYING:
@@ -1077,6 +1989,10 @@ void keyboardCallback(unsigned char key, int x, int y) {
                 currentState = STATE_PLAYING;
             } else if (key == 'm' || key == 'M') {
                 stopBackgroundMusic();            // 🔇 back to menu
+                saveMatchReplay();
+                endOnlineMatch();
+                endSpectating();
+                replayPlayback = false;
                 currentState = STATE_MAIN_MENU;
             }
             break;
@@ -1084,21 +2000,34 @@ void keyboardCallback(unsigned char key, int x, int y) {
         case STATE_GAME_OVER:
             if (key == 'm' || key == 'M') {
                 stopBackgroundMusic();            // 🔇 back to menu
+                endOnlineMatch();
+                endSpectating();
+                replayPlayback = false;
                 currentState = STATE_MAIN_MENU;
             }
             break;
     }
 
-    glutPostRedisplay();
+    requestRedraw();
 }
 
 void keyboardUpCallback(unsigned char key, int x, int y) {
+    PROFILE_SCOPE(PHASE_INPUT);
+
     keyDown[(unsigned char)key] = false;
+    inputKeyEvent(key, false, false, monotonicSeconds());
 }
 
 // Special keys (arrows)
 void specialCallback(int key, int x, int y) {
+    PROFILE_SCOPE(PHASE_INPUT);
+
     specialDown[key] = true;
+    inputKeyEvent(key, true, true, monotonicSeconds());
+
+    if (key == GLUT_KEY_F2) showRenderStats = !showRenderStats;
+    if (key == GLUT_KEY_F3) showProfilerOverlay = !showProfilerOverlay;
+    if (key == GLUT_KEY_F4) dumpProfilerCsv();
 
     switch (currentState) {
         case STATE_MAIN_MENU:
@@ -1120,20 +2049,20 @@ void specialCallback(int key, int x, int y) {
         case STATE_DIFFICULTY_SELECT:
             if (key == GLUT_KEY_UP) {
                 difficultyIndex--;
-                if (difficultyIndex < 0) difficultyIndex = 2;
+                if (difficultyIndex < 0) difficultyIndex = expertDifficulty;
             } else if (key == GLUT_KEY_DOWN) {
                 difficultyIndex++;
-                if (difficultyIndex > 2) difficultyIndex = 0;
+                if (difficultyIndex > expertDifficulty) difficultyIndex = 0;
             }
             break;
 
         case STATE_SETTINGS:
             if (key == GLUT_KEY_UP) {
                 settingsCursor--;
-                if (settingsCursor < 0) settingsCursor = 3;
+                if (settingsCursor < 0) settingsCursor = 7;
             } else if (key == GLUT_KEY_DOWN) {
                 settingsCursor++;
-                if (settingsCursor > 3) settingsCursor = 0;
+                if (settingsCursor > 7) settingsCursor = 0;
             } else if (key == GLUT_KEY_LEFT) {
                 if (settingsCursor == 0) {
                     gameTimeIndex--;
@@ -1144,6 +2073,19 @@ void specialCallback(int key, int x, int y) {
                 } else if (settingsCursor == 2) {
                     themeIndex--;
                     if (themeIndex < 0) themeIndex = themeCount - 1;
+                    layerCacheInvalidate();
+                } else if (settingsCursor == 3) {
+                    tickRateIndex--;
+                    if (tickRateIndex < 0) tickRateIndex = tickRateCount - 1;
+                } else if (settingsCursor == 4) {
+                    cubeModeIndex--;
+                    if (cubeModeIndex < 0) cubeModeIndex = cubeModeCount - 1;
+                } else if (settingsCursor == 5) {
+                    chaosIndex--;
+                    if (chaosIndex < 0) chaosIndex = chaosOptionCount - 1;
+                } else if (settingsCursor == 6) {
+                    renderScaleIndex--;
+                    if (renderScaleIndex < 0) renderScaleIndex = renderScaleCount - 1;
                 }
             } else if (key == GLUT_KEY_RIGHT) {
                 if (settingsCursor == 0) {
@@ -1155,6 +2097,19 @@ void specialCallback(int key, int x, int y) {
                 } else if (settingsCursor == 2) {
                     themeIndex++;
                     if (themeIndex >= themeCount) themeIndex = 0;
+                    layerCacheInvalidate();
+                } else if (settingsCursor == 3) {
+                    tickRateIndex++;
+                    if (tickRateIndex >= tickRateCount) tickRateIndex = 0;
+                } else if (settingsCursor == 4) {
+                    cubeModeIndex++;
+                    if (cubeModeIndex >= cubeModeCount) cubeModeIndex = 0;
+                } else if (settingsCursor == 5) {
+                    chaosIndex++;
+                    if (chaosIndex >= chaosOptionCount) chaosIndex = 0;
+                } else if (settingsCursor == 6) {
+                    renderScaleIndex++;
+                    if (renderScaleIndex >= renderScaleCount) renderScaleIndex = 0;
                 }
             }
             break;
@@ -1175,223 +2130,322 @@ void specialCallback(int key, int x, int y) {
             break;
     }
 
-    glutPostRedisplay();
+    requestRedraw();
 }
 
 void specialUpCallback(int key, int x, int y) {
+    PROFILE_SCOPE(PHASE_INPUT);
+
     specialDown[key] = false;
+    inputKeyEvent(key, true, false, monotonicSeconds());
 }
 
 // ===================== TIMER / GAME LOOP =====================
 
-void timerCallback(int value) {
-    // 3D cube spin
-    menuCubeAngle += 0.7f;
-    if (menuCubeAngle > 360.0f) menuCubeAngle -= 360.0f;
-
-    if (currentState == STATE_PLAYING) {
-
-        // --- PLAYER 1 movement (no double-speed bug) ---
-        float moveX1 = 0.0f, moveY1 = 0.0f;
+// A keyboard state as replay input bits. Single player (and online, where
+// only our own paddle is local) steers P1 with WASD or the arrows; in local
+// multiplayer the arrows belong to P2.
+uint8_t inputBitsFor(const bool* keys, const bool* special) {
+    uint8_t bits = 0;
+
+    if (keys['w'] || keys['W']) bits |= REPLAY_P1_UP;
+    if (keys['s'] || keys['S']) bits |= REPLAY_P1_DOWN;
+    if (keys['a'] || keys['A']) bits |= REPLAY_P1_LEFT;
+    if (keys['d'] || keys['D']) bits |= REPLAY_P1_RIGHT;
+
+    uint8_t arrows = 0;
+    if (special[GLUT_KEY_UP])    arrows |= REPLAY_P2_UP;
+    if (special[GLUT_KEY_DOWN])  arrows |= REPLAY_P2_DOWN;
+    if (special[GLUT_KEY_LEFT])  arrows |= REPLAY_P2_LEFT;
+    if (special[GLUT_KEY_RIGHT]) arrows |= REPLAY_P2_RIGHT;
+
+    // P2 bits are 4 above the matching P1 bits
+    if (isSinglePlayer || netSession) bits |= arrows >> 4;
+    else                bits |= arrows;
+    return bits;
+}
 
-        if (keyDown['w'] || keyDown['W']) moveY1 += 1.0f;
-        if (keyDown['s'] || keyDown['S']) moveY1 -= 1.0f;
-        if (keyDown['a'] || keyDown['A']) moveX1 -= 1.0f;
-        if (keyDown['d'] || keyDown['D']) moveX1 += 1.0f;
+// Advances the whole game by exactly dt seconds.
+void simulateTick(float dt) {
+    prevTickState = renderSnapshot(match);
 
-        if (isSinglePlayer) {
-            if (specialDown[GLUT_KEY_UP])    moveY1 += 1.0f;
-            if (specialDown[GLUT_KEY_DOWN])  moveY1 -= 1.0f;
-            if (specialDown[GLUT_KEY_LEFT])  moveX1 -= 1.0f;
-            if (specialDown[GLUT_KEY_RIGHT]) moveX1 += 1.0f;
-        }
+    // Key events inside this tick's slice of real time, every tick so the
+    // queue keeps draining on menus too
+    InputTick keys;
+    inputConsumeTick(tickWallStart, tickWallStart + dt, inputBitsFor, keys);
+    tickWallStart += dt;
 
-        if (moveX1 > 1.0f)  moveX1 = 1.0f;
-        if (moveX1 < -1.0f) moveX1 = -1.0f;
-        if (moveY1 > 1.0f)  moveY1 = 1.0f;
-        if (moveY1 < -1.0f) moveY1 = -1.0f;
-
-        p1.x += moveX1 * p1.speed;
-        p1.y += moveY1 * p1.speed;
-
-        // --- PLAYER 2 movement ---
-        if (isSinglePlayer) {
-            float aiBaseSpeed;
-            if      (difficultyIndex == 0) aiBaseSpeed = 5.0f;
-            else if (difficultyIndex == 1) aiBaseSpeed = 8.0f;
-            else                           aiBaseSpeed = 11.0f;
-
-            float dy = ball.y - p2.y;
-            float ay = aiBaseSpeed;
-            if (dy > ay)        p2.y += ay;
-            else if (dy < -ay)  p2.y -= ay;
-            else                p2.y = ball.y;
-
-            float p2MinX = winWidth / 2.0f + 60.0f;
-            float p2MaxX = winWidth - 40.0f;
-            float targetX;
-
-            if (ball.x > winWidth / 2.0f) {
-                targetX = ball.x;
-                if (targetX < p2MinX) targetX = p2MinX;
-                if (targetX > p2MaxX) targetX = p2MaxX;
-            } else {
-                targetX = winWidth - 80.0f;
+    // 3D cube spin
+    advanceCube(dt);
+
+    // Online: the peer keeps playing through our pause menu, and after the
+    // end we keep answering so it can confirm the last ticks too
+    if (netSession && currentState == STATE_GAME_OVER) netService(*netSession, monotonicSeconds());
+
+    if (currentState == STATE_PLAYING || ((netSession || spectating) && currentState == STATE_PAUSED)) {
+
+        if (spectating) {
+            // The server's match goes on while our menu is open
+            spectateTick();
+        } else if (netSession) {
+            netTick(*netSession, currentState == STATE_PLAYING ? keys.bits : 0, monotonicSeconds());
+            match = netSession->state;
+            // Only a confirmed end counts; a predicted goal can still be undone
+            match.over = netConfirmedOver(*netSession) || netSession->peerLeft;
+        } else if (replayPlayback) {
+            // Recorded keys instead of the keyboard; stop where the log ends
+            if (!replaySeek(matchReplay, match, matchAi, match.tick + 1)) {
+                match.events = EVENT_MATCH_OVER;
+                match.over   = true;
             }
-
-            float dx = targetX - p2.x;
-            float ax = aiBaseSpeed * 0.7f;
-            if (dx > ax)        p2.x += ax;
-            else if (dx < -ax)  p2.x -= ax;
-            else                p2.x = targetX;
         } else {
-            if (specialDown[GLUT_KEY_UP])    p2.y += p2.speed;
-            if (specialDown[GLUT_KEY_DOWN])  p2.y -= p2.speed;
-            if (specialDown[GLUT_KEY_LEFT])  p2.x -= p2.speed;
-            if (specialDown[GLUT_KEY_RIGHT]) p2.x += p2.speed;
+            uint8_t bits = keys.bits;
+            if (isSinglePlayer && difficultyIndex == expertDifficulty) {
+                uint8_t ai = replayEncodeP2(expertAi.act(match, dt));
+                bits |= ai;
+                for (int i = 4; i < 8; ++i) keys.held[i] = (ai & (1 << i)) ? replaySubSteps : 0;
+            }
+            // Keys that changed mid-tick count for the part they were held
+            if (keys.partial) replayRecordSubTick(matchReplay, match, matchAi, bits, keys.held);
+            else              replayRecordTick(matchReplay, match, matchAi, bits);
         }
 
-        // Clamp paddles
-        float p1MinX = 40.0f;
-        float p1MaxX = winWidth / 2.0f - 60.0f;
-        float p2MinX = winWidth / 2.0f + 60.0f;
-        float p2MaxX = winWidth - 40.0f;
-
-        if (p1.x < p1MinX) p1.x = p1MinX;
-        if (p1.x > p1MaxX) p1.x = p1MaxX;
-        if (p2.x < p2MinX) p2.x = p2MinX;
-        if (p2.x > p2MaxX) p2.x = p2MaxX;
-
-        if (p1.y < p1.height/2)              p1.y = p1.height/2;
-        if (p1.y > winHeight - p1.height/2)  p1.y = winHeight - p1.height/2;
-        if (p2.y < p2.height/2)              p2.y = p2.height/2;
-        if (p2.y > winHeight - p2.height/2)  p2.y = winHeight - p2.height/2;
-
-        // Ball movement
-        prevBallX = ball.x;
-        prevBallY = ball.y;
-
-        ball.x += ball.vx * speedFactor;
-        ball.y += ball.vy * speedFactor;
-
-        if (ball.y < ball.radius) {
-            ball.y = ball.radius;
-            ball.vy *= -1.0f;
-        } else if (ball.y > winHeight - ball.radius) {
-            ball.y = winHeight - ball.radius;
-            ball.vy *= -1.0f;
+        if (chaosActive()) stepChaos(dt);
+
+        // Goals
+        if (match.events & EVENT_SCORE_P2) {
+            flashTime = flashDuration;
+            flashR = 1.0f; flashG = 0.2f; flashB = 0.2f;   // red flash
+            // trigger shake
+            shakeTime      = shakeDuration;
+            shakeIntensity = 3.0f * match.speedFactor;
+        }
+        if (match.events & EVENT_SCORE_P1) {
+            flashTime = flashDuration;
+            flashR = 0.2f; flashG = 0.5f; flashB = 1.0f;   // blue flash
+            // trigger shake
+            shakeTime      = shakeDuration;
+            shakeIntensity = 3.0f * match.speedFactor;
         }
 
-        // Left paddle collision
-        {
-            float px = p1.x;
-            float py = p1.y;
-            float pw = p1.width;
-            float ph = p1.height;
+        playMatchSounds(match);
+        spawnMatchParticles(match, prevTickState.ball);
 
-            bool overlapY =
-                (ball.y + ball.radius >= py - ph/2) &&
-                (ball.y - ball.radius <= py + ph/2);
+        // The ball was re-served; don't draw it sliding back to the center
+        if (match.events & (EVENT_SCORE_P1 | EVENT_SCORE_P2)) resetRenderInterpolation();
 
-            float paddleRight = px + pw/2;
+        // Time up or max score reached
+        if (match.over) {
+            currentState = STATE_GAME_OVER;
+            stopBackgroundMusic();      // 🔇 stop when the match ends
+            saveMatchReplay();
+        }
+    }
 
-            bool crossingX =
-                (prevBallX - ball.radius >= paddleRight && ball.x - ball.radius <= paddleRight) ||
-                (ball.x - ball.radius <= paddleRight && ball.x - ball.radius >= px - pw/2);
+    // dec flash & shake
+    if (flashTime > 0.0f) flashTime -= dt;
+    if (shakeTime > 0.0f) shakeTime -= dt;
+}
 
-            if (overlapY && crossingX) {
-                ball.x = paddleRight + ball.radius;
-                ball.vx = std::fabs(ball.vx);
+// Runs the ticks real time has accumulated; the leftover fraction of a
+// tick becomes renderAlpha.
+void advanceSimulation() {
+    double now = monotonicSeconds();
+    tickAccumulator += now - lastClockTime;
+    lastClockTime = now;
+
+    int   tickRate = tickRateOptions[tickRateIndex];
+    float dt       = 1.0f / (float)tickRate;
+
+    // Cap catch-up so a long stall doesn't turn into a burst of ticks;
+    // anything beyond the cap is dropped (game slows down instead).
+    int maxSteps = (int)std::ceil(maxCatchUpTime * tickRate);
+    int steps = 0;
+    tickWallStart = now - tickAccumulator;
+    {
+        PROFILE_SCOPE(PHASE_SIMULATION);
+        while (tickAccumulator >= dt && steps < maxSteps) {
+            simulateTick(dt);
+            tickAccumulator -= dt;
+            steps++;
+        }
+    }
+    if (tickAccumulator >= dt) {
+        tickAccumulator = 0.0;
+        inputSkipTo(now);          // keys during the dropped time just change state
+    }
 
-                float offset = (ball.y - py) / (ph * 0.5f);
-                ball.vy += offset * 1.5f;
+    renderAlpha = (float)(tickAccumulator / dt);
+}
 
-                if (speedFactor < 2.0f) speedFactor += 0.05f;
-                hitsInRally++;
+// Screens that change every frame without input
+bool screenAnimates() {
+    if (currentState == STATE_PLAYING || netSession || spectating) return true;
+    if (currentState == STATE_MAIN_MENU && cubeModeIndex == 0) return true;
+    return showProfilerOverlay;     // its frame graph needs frames
+}
 
-            }
-        }
+void idleCallback();
 
-        // Right paddle collision
-        {
-            float px = p2.x;
-            float py = p2.y;
-            float pw = p2.width;
-            float ph = p2.height;
+void cubeTimerCallback(int value);
+bool cubeTimerPending = false;
 
-            bool overlapY =
-                (ball.y + ball.radius >= py - ph/2) &&
-                (ball.y - ball.radius <= py + ph/2);
+// Nothing to draw: drop the idle callback so GLUT blocks on events.
+void stopFrameLoop() {
+    glutIdleFunc(NULL);
+    frameLoopRunning = false;
+    frameSchedulerIdle();
 
-            float paddleLeft = px - pw/2;
+    if (currentState == STATE_MAIN_MENU && cubeModeIndex == 1 && !cubeTimerPending) {
+        cubeTimerPending = true;
+        glutTimerFunc(1000 / cubeLowPowerHz, cubeTimerCallback, 0);
+    }
+}
 
-            bool crossingX =
-                (prevBallX + ball.radius <= paddleLeft && ball.x + ball.radius >= paddleLeft) ||
-                (ball.x + ball.radius >= paddleLeft && ball.x + ball.radius <= px + pw/2);
+void requestRedraw() {
+    needsRedraw = true;
+    if (frameLoopRunning) return;
 
-            if (overlapY && crossingX) {
-                ball.x = paddleLeft - ball.radius;
-                ball.vx = -std::fabs(ball.vx);
+    // Only the cube moved while we slept; don't replay the gap as ticks
+    double now = monotonicSeconds();
+    advanceCube((float)(now - lastClockTime));
+    lastClockTime = now;
 
-                float offset = (ball.y - py) / (ph * 0.5f);
-                ball.vy += offset * 1.5f;
+    frameLoopRunning = true;
+    glutIdleFunc(idleCallback);
+}
 
-                if (speedFactor < 2.0f) speedFactor += 0.05f;
-                hitsInRally++;
+void cubeTimerCallback(int value) {
+    cubeTimerPending = false;
+    if (currentState == STATE_MAIN_MENU && cubeModeIndex == 1) requestRedraw();
+}
 
+void cpuSampleCallback(int value) {
+    double wall = monotonicSeconds();
+    double cpu  = processCpuSeconds();
+    if (lastCpuWallTime > 0.0 && wall > lastCpuWallTime) {
+        cpuUsagePercent = (float)(100.0 * (cpu - lastCpuSeconds) / (wall - lastCpuWallTime));
+        if (cpuLog) std::printf("cpu %5.1f%%  %s\n", cpuUsagePercent, gameStateNames[currentState]);
+    }
+    lastCpuSeconds  = cpu;
+    lastCpuWallTime = wall;
 
-            }
-        }
+    if (showRenderStats) requestRedraw();
+    glutTimerFunc(1000, cpuSampleCallback, 0);
+}
 
-        // Goals
-        if (ball.x < 0.0f) {
-            scoreP2++;
-            resetBall();
-            flashFrames = 10;
-            flashR = 1.0f; flashG = 0.2f; flashB = 0.2f;   // red flash
-             // trigger shake
-                shakeFrames    = 6;
-                shakeIntensity = 3.0f * speedFactor;
-        }
-        if (ball.x > (float)winWidth) {
-            scoreP1++;
-            resetBall();
-            flashFrames = 10;
-            flashR = 0.2f; flashG = 0.5f; flashB = 1.0f;   // blue flash
-             // trigger shake
-                shakeFrames    = 6;
-                shakeIntensity = 3.0f * speedFactor;
-        }
+// Called whenever GLUT has no events: waits for the next frame slot, then
+// simulates up to now and draws. With vsync the slot is always open and
+// the swap blocks until the display is ready.
+void idleCallback() {
+    if (framePending) {
+        // Not drawn yet (e.g. minimized); don't spin
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return;
+    }
 
-        // Timer
-        timeLeft -= 0.016f;
-        if (timeLeft <= 0.0f) {
-            timeLeft = 0.0f;
-            currentState = STATE_GAME_OVER;
-            stopBackgroundMusic();      // 🔇 stop when match ends by time
-        }
+    if (!needsRedraw && !screenAnimates()) {
+        stopFrameLoop();
+        return;
+    }
 
-        // Max score (0 = infinite)
-        if (maxScore > 0 && (scoreP1 >= maxScore || scoreP2 >= maxScore)) {
-            currentState = STATE_GAME_OVER;
-            stopBackgroundMusic();      // 🔇 stop when someone reaches max score
+    double wait = frameSchedulerWait(monotonicSeconds());
+    if (wait > 0.0) {
+        // Sleep most of it and come back; the last millisecond is polled so
+        // the frame starts on time despite coarse sleeps
+        if (wait > 0.002) {
+            std::this_thread::sleep_for(std::chrono::microseconds((long)((wait - 0.001) * 1e6)));
         }
+        return;
     }
 
-    // dec flash & shake
-    if (flashFrames > 0) flashFrames--;
-    if (shakeFrames > 0) shakeFrames--;
-
+    advanceSimulation();
+    framePending = true;
     glutPostRedisplay();
-    glutTimerFunc(16, timerCallback, 0);
+}
+
+// Refresh rate the OS reports, or 0 if unknown (then it's measured).
+double displayRefreshHz() {
+#ifdef _WIN32
+    HDC dc = GetDC(NULL);
+    int hz = GetDeviceCaps(dc, VREFRESH);
+    ReleaseDC(NULL, dc);
+    return hz > 1 ? (double)hz : 0.0;   // 0 and 1 mean "hardware default"
+#else
+    return 0.0;
+#endif
 }
 
 // ===================== MAIN =====================
 
+// Tools that reuse the renderer (bench) build with PADDLE_RIVALS_NO_MAIN.
+#ifndef PADDLE_RIVALS_NO_MAIN
+
+#ifdef _WIN32
+// The window icon, from the .ico asset: the largest image in it.
+static HICON loadIconAsset(const char* name) {
+    AssetData a;
+    if (!assetGet(name, a) || a.size < 6) return 0;
+
+    const BYTE* p     = a.data;
+    int         count = p[4] | (p[5] << 8);
+    int         best  = -1, bestSize = 0;
+    for (int i = 0; i < count && 6 + (size_t)(i + 1) * 16 <= a.size; ++i) {
+        int size = p[6 + i * 16] ? p[6 + i * 16] : 256;   // 0 means 256
+        if (size > bestSize) { best = i; bestSize = size; }
+    }
+    if (best < 0) return 0;
+
+    const BYTE* e      = p + 6 + best * 16;
+    DWORD       bytes  = e[8]  | (e[9]  << 8) | (e[10] << 16) | ((DWORD)e[11] << 24);
+    DWORD       offset = e[12] | (e[13] << 8) | (e[14] << 16) | ((DWORD)e[15] << 24);
+    if ((size_t)offset + bytes > a.size) return 0;
+    return CreateIconFromResourceEx((PBYTE)(p + offset), bytes, TRUE, 0x00030000, 0, 0, LR_DEFAULTCOLOR);
+}
+#endif
+
 int main(int argc, char** argv) {
+    startupBegin = monotonicSeconds();
     srand((unsigned)time(0));
 
+    // assets.pak next to the game when it's been packed, else assets/
+    assetsOpen("assets.pak", "assets");
+
     glutInit(&argc, argv);
+
+    // Online (connects before the window opens):  --host PORT | --join HOST:PORT [--net-delay TICKS] [--net-emu LAT,JITTER,LOSS]
+    // Spectating:  --watch HOST:PORT [--match ID]
+    const char* hostArg  = 0;
+    const char* joinArg  = 0;
+    const char* watchArg = 0;
+    uint32_t    watchId  = 0;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--watch") == 0)     watchArg = argv[i + 1];
+        if (std::strcmp(argv[i], "--match") == 0)     watchId  = (uint32_t)std::strtoul(argv[i + 1], 0, 10);
+        if (std::strcmp(argv[i], "--host") == 0)      hostArg = argv[i + 1];
+        if (std::strcmp(argv[i], "--join") == 0)      joinArg = argv[i + 1];
+        if (std::strcmp(argv[i], "--net-delay") == 0) netInputDelay = std::atoi(argv[i + 1]);
+        if (std::strcmp(argv[i], "--net-emu") == 0) {
+            netEmulate = netParseConditions(argv[i + 1], netConditions);
+            if (!netEmulate) std::fprintf(stderr, "bad --net-emu, expected LAT,JITTER,LOSS\n");
+        }
+    }
+    if (hostArg || joinArg || watchArg) {
+        bool started;
+        if (hostArg) {
+            started = startOnlineMatch(0, std::atoi(hostArg));
+        } else {
+            char hostName[256];
+            std::strncpy(hostName, joinArg ? joinArg : watchArg, sizeof(hostName) - 1);
+            hostName[sizeof(hostName) - 1] = '\0';
+            char* colon = std::strrchr(hostName, ':');
+            if (colon) *colon = '\0';
+            if (!colon)        started = false;
+            else if (joinArg)  started = startOnlineMatch(hostName, std::atoi(colon + 1));
+            else               started = startSpectating(hostName, std::atoi(colon + 1), watchId);
+        }
+        if (!started) return 1;
+    }
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
 
     int screenW = glutGet(GLUT_SCREEN_WIDTH);
@@ -1399,6 +2453,9 @@ int main(int argc, char** argv) {
     glutInitWindowSize(screenW, screenH);
     glutInitWindowPosition(0, 0);
     glutCreateWindow("Paddle Rivals");
+    glExtInit();
+    textInit();
+    startupWindowAt = monotonicSeconds();
 
 #ifdef _WIN32
     // 👇 Set custom window icon (taskbar + title bar)
@@ -1406,14 +2463,8 @@ int main(int argc, char** argv) {
     // 1) Get the HWND of the GLUT window by its title
     HWND hwnd = FindWindowA(NULL, "Paddle Rivals");
 
-    // 2) Load the .ico file from disk
-    HICON hIcon = (HICON)LoadImageA(
-        NULL,
-        "D:\\Prog\\C++\\Graphics\\Paddle Rivals\\icon.ico",
-        IMAGE_ICON,
-        0, 0,
-        LR_LOADFROMFILE | LR_DEFAULTSIZE
-    );
+    // 2) Load the icon from the game's assets
+    HICON hIcon = loadIconAsset("icons/icon.ico");
 
     if (hwnd && hIcon) {
         SendMessage(hwnd, WM_SETICON, ICON_BIG,   (LPARAM)hIcon);
@@ -1429,7 +2480,31 @@ int main(int argc, char** argv) {
     glutKeyboardUpFunc(keyboardUpCallback);
     glutSpecialFunc(specialCallback);
     glutSpecialUpFunc(specialUpCallback);
-    glutTimerFunc(16, timerCallback, 0);
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--replay") == 0) startReplayPlayback(argv[i + 1]);
+        if (std::strcmp(argv[i], "--fps") == 0)    targetFps = std::atoi(argv[i + 1]);
+        if (std::strcmp(argv[i], "--audio") == 0)  audioOutput = argv[i + 1];
+    }
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cpu-log") == 0) cpuLog = true;
+    }
+
+    // Vsync unless a frame rate was asked for
+    bool vsync = false;
+    if (targetFps > 0) glExtSetSwapInterval(0);
+    else               vsync = glExtSetSwapInterval(1);
+    frameSchedulerInit(targetFps > 0 ? (double)targetFps : displayRefreshHz(), vsync);
+
+#ifdef _WIN32
+    timeBeginPeriod(1);     // 1 ms sleeps for frame pacing
+#endif
+
+    audioInit(audioOutput);
+    std::atexit(audioShutdown);
+
+    lastClockTime = monotonicSeconds();
+    requestRedraw();
+    glutTimerFunc(1000, cpuSampleCallback, 0);
 
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -1437,3 +2512,4 @@ int main(int argc, char** argv) {
     return 0;
 }
 
+#endif
@@ -0,0 +1,397 @@
+#include "match_engine.h"
+
+#include <cmath>     // fabs, sqrt
+
+// ===================== TUNING (per second) =====================
+
+static const float baseVx          = 360.0f;  // serve X speed
+static const float baseVy          = 240.0f;  // serve Y speed
+static const float paddleSpinBoost = 90.0f;   // vy added per unit of hit offset
+static const float maxSpeedFactor  = 2.0f;
+static const float speedFactorStep = 0.05f;
+
+// ===================== RNG =====================
+
+void rngSeed(MatchRng& rng, uint64_t seed) {
+    rng.state = seed;
+}
+
+uint32_t rngNext(MatchRng& rng) {
+    uint64_t z = (rng.state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (uint32_t)((z ^ (z >> 31)) >> 32);
+}
+
+float rngFloat(MatchRng& rng) {
+    return (rngNext(rng) >> 8) * (1.0f / 16777216.0f);
+}
+
+// ===================== INIT =====================
+
+void matchResetBall(MatchState& m) {
+    m.hitsInRally = 0;
+    m.speedFactor = 1.0f;
+
+    m.ball.x = ARENA_WIDTH  / 2.0f;
+    m.ball.y = ARENA_HEIGHT / 2.0f;
+
+    m.ball.vx = (rngNext(m.rng) & 1) ? baseVx : -baseVx;
+    m.ball.vy = (rngNext(m.rng) & 1) ? baseVy : -baseVy;
+
+    m.prevBallX = m.ball.x;
+    m.prevBallY = m.ball.y;
+}
+
+void matchInit(MatchState& m, const MatchConfig& cfg, uint64_t seed) {
+    rngSeed(m.rng, seed);
+
+    m.p1.x = 80.0f;
+    m.p1.y = ARENA_HEIGHT / 2.0f;
+    m.p1.width  = 16.0f;
+    m.p1.height = 100.0f;
+    m.p1.speed  = cfg.p1Speed;
+
+    m.p2.x = ARENA_WIDTH - 80.0f;
+    m.p2.y = ARENA_HEIGHT / 2.0f;
+    m.p2.width  = 16.0f;
+    m.p2.height = 100.0f;
+    m.p2.speed  = cfg.p2Speed;
+
+    m.scoreP1  = 0;
+    m.scoreP2  = 0;
+    m.timeLeft = cfg.gameTime;
+    m.maxScore = cfg.maxScore;
+
+    m.lastRallyHits = 0;
+    m.tick   = 0;
+    m.events = 0;
+    m.over   = false;
+
+    m.prevP1 = m.p1;
+    m.prevP2 = m.p2;
+
+    m.ball.radius = 12.0f;
+    matchResetBall(m);
+}
+
+// ===================== STEP PHASES =====================
+
+static float clampAxis(float v) {
+    if (v >  1.0f) return  1.0f;
+    if (v < -1.0f) return -1.0f;
+    return v;
+}
+
+void matchMovePaddles(MatchState& m, const PaddleInput& in1, const PaddleInput& in2, float dt) {
+    m.prevP1 = m.p1;
+    m.prevP2 = m.p2;
+
+    m.p1.x += clampAxis(in1.moveX) * m.p1.speed * dt;
+    m.p1.y += clampAxis(in1.moveY) * m.p1.speed * dt;
+    m.p2.x += clampAxis(in2.moveX) * m.p2.speed * dt;
+    m.p2.y += clampAxis(in2.moveY) * m.p2.speed * dt;
+
+    // Each paddle stays in its own half
+    float p1MinX = 40.0f;
+    float p1MaxX = ARENA_WIDTH / 2.0f - 60.0f;
+    float p2MinX = ARENA_WIDTH / 2.0f + 60.0f;
+    float p2MaxX = ARENA_WIDTH - 40.0f;
+
+    if (m.p1.x < p1MinX) m.p1.x = p1MinX;
+    if (m.p1.x > p1MaxX) m.p1.x = p1MaxX;
+    if (m.p2.x < p2MinX) m.p2.x = p2MinX;
+    if (m.p2.x > p2MaxX) m.p2.x = p2MaxX;
+
+    if (m.p1.y < m.p1.height/2)                m.p1.y = m.p1.height/2;
+    if (m.p1.y > ARENA_HEIGHT - m.p1.height/2) m.p1.y = ARENA_HEIGHT - m.p1.height/2;
+    if (m.p2.y < m.p2.height/2)                m.p2.y = m.p2.height/2;
+    if (m.p2.y > ARENA_HEIGHT - m.p2.height/2) m.p2.y = ARENA_HEIGHT - m.p2.height/2;
+}
+
+// ===================== SWEPT COLLISION =====================
+//
+// The ball is moved as a circle sweeping through the tick. Within the tick
+// paddles move linearly from their start-of-step position (prevP1/prevP2)
+// to the current one, so against a paddle the ball's motion *relative* to
+// it is a straight line and the first contact is a ray vs rounded box test
+// (the paddle box grown by the ball radius). Walls are planes. The ball is
+// advanced to the earliest contact, bounced, and the rest of the tick is
+// swept again, so nothing tunnels however fast the ball or low the tick rate.
+
+static const int   maxContactsPerStep = 8;
+static const float separationSpeed    = 1.0f;   // min speed away from a paddle after a hit
+
+struct Contact {
+    float t;            // seconds from the start of the sub-step
+    float nx, ny;       // surface normal at the contact
+};
+
+// Earliest t in [0, tMax] where the circle |o + d*t - k| touches r, if
+// the ray starts outside and moves inward.
+static bool rayCircle(float ox, float oy, float dx, float dy, float kx, float ky,
+                      float r, float tMax, float& t) {
+    float px = ox - kx, py = oy - ky;
+    float a = dx*dx + dy*dy;
+    float b = px*dx + py*dy;
+    float c = px*px + py*py - r*r;
+    if (a <= 0.0f || b >= 0.0f) return false;     // not approaching
+    float disc = b*b - a*c;
+    if (disc < 0.0f) return false;
+    float hit = (-b - std::sqrt(disc)) / a;
+    if (hit < 0.0f) hit = 0.0f;
+    if (hit > tMax) return false;
+    t = hit;
+    return true;
+}
+
+// Ray from (ox, oy) (relative to the box center) along (dx, dy) against a
+// box of half-extents (hx, hy) rounded by r.
+static bool sweepCircleBox(float ox, float oy, float dx, float dy, float hx, float hy,
+                           float r, float tMax, Contact& c) {
+    float ex = hx + r, ey = hy + r;
+    float tEnter = -1e30f, tExit = tMax;
+    float nx = 0.0f, ny = 0.0f;
+
+    // Slabs of the expanded box
+    if (dx == 0.0f) {
+        if (ox < -ex || ox > ex) return false;
+    } else {
+        float t0 = (-ex - ox) / dx, t1 = (ex - ox) / dx;
+        float n = -1.0f;
+        if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; n = 1.0f; }
+        if (t0 > tEnter) { tEnter = t0; nx = n; ny = 0.0f; }
+        if (t1 < tExit) tExit = t1;
+    }
+    if (dy == 0.0f) {
+        if (oy < -ey || oy > ey) return false;
+    } else {
+        float t0 = (-ey - oy) / dy, t1 = (ey - oy) / dy;
+        float n = -1.0f;
+        if (t0 > t1) { float tmp = t0; t0 = t1; t1 = tmp; n = 1.0f; }
+        if (t0 > tEnter) { tEnter = t0; nx = 0.0f; ny = n; }
+        if (t1 < tExit) tExit = t1;
+    }
+    if (tEnter > tExit) return false;
+
+    // Starting inside the expanded box is only free space in its corner
+    // squares; anywhere else the ball overlaps and depenetrate() handles it.
+    float px = ox, py = oy;
+    if (tEnter >= 0.0f) {
+        px += dx * tEnter;
+        py += dy * tEnter;
+    } else if (std::fabs(ox) <= hx || std::fabs(oy) <= hy) {
+        return false;
+    }
+
+    // Entered through a face, or through a corner square?
+    if (tEnter >= 0.0f && (std::fabs(px) <= hx || std::fabs(py) <= hy)) {
+        c.t = tEnter; c.nx = nx; c.ny = ny;
+        return true;
+    }
+
+    float kx = px < 0.0f ? -hx : hx;
+    float ky = py < 0.0f ? -hy : hy;
+    float t;
+    if (!rayCircle(ox, oy, dx, dy, kx, ky, r, tMax, t)) return false;
+    c.t  = t;
+    c.nx = (ox + dx * t - kx) / r;
+    c.ny = (oy + dy * t - ky) / r;
+    return true;
+}
+
+// Pushes the ball out of a paddle it already overlaps (the paddle was
+// moved onto it, or a serve landed on it). Returns the push normal.
+static bool depenetrate(Ball& ball, float cx, float cy, float hx, float hy, Contact& c) {
+    float ox = ball.x - cx, oy = ball.y - cy;
+    float qx = ox < -hx ? -hx : (ox > hx ? hx : ox);
+    float qy = oy < -hy ? -hy : (oy > hy ? hy : oy);
+    float dx = ox - qx, dy = oy - qy;
+    float d2 = dx*dx + dy*dy;
+    if (d2 >= ball.radius * ball.radius) return false;
+
+    if (d2 > 0.0f) {
+        float d = std::sqrt(d2);
+        c.nx = dx / d;
+        c.ny = dy / d;
+        ball.x = cx + qx + c.nx * ball.radius;
+        ball.y = cy + qy + c.ny * ball.radius;
+    } else if (hx - std::fabs(ox) < hy - std::fabs(oy)) {   // center inside: nearest face
+        c.nx = ox < 0.0f ? -1.0f : 1.0f;
+        c.ny = 0.0f;
+        ball.x = cx + c.nx * (hx + ball.radius);
+    } else {
+        c.nx = 0.0f;
+        c.ny = oy < 0.0f ? -1.0f : 1.0f;
+        ball.y = cy + c.ny * (hy + ball.radius);
+    }
+    c.t = 0.0f;
+    return true;
+}
+
+static void onPaddleHit(MatchState& m, const Paddle& p, float paddleY) {
+    float offset = (m.ball.y - paddleY) / (p.height * 0.5f);
+    m.ball.vy += offset * paddleSpinBoost;
+
+    if (m.speedFactor < maxSpeedFactor) m.speedFactor += speedFactorStep;
+    m.hitsInRally++;
+}
+
+// Bounces the ball off paddle `side` at contact normal n. py is the
+// paddle's center height at the contact (for spin) and (ux, uy) its
+// velocity in units/s. Hits on the front face (and its corners) return the
+// ball with spin like before; hits on the top, bottom or back just bounce
+// off that face. Either way the ball leaves faster than the paddle follows,
+// but it still sits at contact distance, so the same paddle can come up
+// again within the step: `struck` makes a front-face hit count (spin,
+// speed-up, rally hit) once per step.
+static void bouncePaddle(MatchState& m, int side, const Contact& n,
+                         float py, float ux, float uy, bool& struck) {
+    Ball& ball = m.ball;
+    float front = (side == 0) ? 1.0f : -1.0f;
+
+    if (std::fabs(n.nx) >= std::fabs(n.ny)) {
+        float dir = n.nx < 0.0f ? -1.0f : 1.0f;
+        if (dir == front && !struck) {
+            onPaddleHit(m, side == 0 ? m.p1 : m.p2, py);
+            struck = true;
+        }
+        float away = std::fabs(ball.vx);
+        float minAway = (dir * ux + separationSpeed) / m.speedFactor;
+        ball.vx = dir * (away > minAway ? away : minAway);
+    } else {
+        float dir = n.ny < 0.0f ? -1.0f : 1.0f;
+        float away = std::fabs(ball.vy);
+        float minAway = (dir * uy + separationSpeed) / m.speedFactor;
+        ball.vy = dir * (away > minAway ? away : minAway);
+    }
+
+    m.events |= (side == 0) ? EVENT_HIT_P1 : EVENT_HIT_P2;
+}
+
+void matchMoveBall(MatchState& m, float dt) {
+    Ball& ball = m.ball;
+
+    m.prevBallX = ball.x;
+    m.prevBallY = ball.y;
+
+    const Paddle* paddles[2] = { &m.p1, &m.p2 };
+    const Paddle* starts[2]  = { &m.prevP1, &m.prevP2 };
+    float ux[2], uy[2];                      // paddle velocities this step
+    for (int i = 0; i < 2; ++i) {
+        ux[i] = dt > 0.0f ? (paddles[i]->x - starts[i]->x) / dt : 0.0f;
+        uy[i] = dt > 0.0f ? (paddles[i]->y - starts[i]->y) / dt : 0.0f;
+    }
+
+    bool struck[2] = { false, false };       // front-face hit counted this step
+    float t = 0.0f;                          // time already simulated
+    for (int contacts = 0; t < dt; ++contacts) {
+        float remaining = dt - t;
+        float vx = ball.vx * m.speedFactor;
+        float vy = ball.vy * m.speedFactor;
+
+        if (contacts == maxContactsPerStep) {
+            ball.x += vx * remaining;
+            ball.y += vy * remaining;
+            break;
+        }
+
+        Contact first = { remaining, 0.0f, 0.0f };
+        int hit = -1;                        // 0/1 paddle, 2 wall, -1 none
+
+        for (int i = 0; i < 2; ++i) {
+            const Paddle& p = *paddles[i];
+            float cx = starts[i]->x + ux[i] * t;
+            float cy = starts[i]->y + uy[i] * t;
+            float hx = p.width * 0.5f, hy = p.height * 0.5f;
+
+            // Quick reject: bounds of everything ball and paddle sweep through
+            float reachX = hx + ball.radius + std::fabs(vx - ux[i]) * remaining;
+            float reachY = hy + ball.radius + std::fabs(vy - uy[i]) * remaining;
+            if (std::fabs(ball.x - cx) > reachX || std::fabs(ball.y - cy) > reachY) continue;
+
+            // A ball already moving away from the paddle (say, rounding
+            // left it a hair inside right after a bounce) only gets pushed out
+            Contact c;
+            if (depenetrate(ball, cx, cy, hx, hy, c) ||
+                sweepCircleBox(ball.x - cx, ball.y - cy, vx - ux[i], vy - uy[i],
+                               hx, hy, ball.radius, first.t, c)) {
+                float closing = (vx - ux[i]) * c.nx + (vy - uy[i]) * c.ny;
+                if (closing < 0.0f && c.t <= first.t) {
+                    first = c;
+                    hit = i;
+                }
+            }
+        }
+
+        float wallT = -1.0f;
+        if (vy < 0.0f)      wallT = (ball.radius - ball.y) / vy;
+        else if (vy > 0.0f) wallT = (ARENA_HEIGHT - ball.radius - ball.y) / vy;
+        if (wallT >= 0.0f && wallT < first.t) {
+            first.t = wallT;
+            hit = 2;
+        } else if (wallT < 0.0f && vy != 0.0f) {
+            first.t = 0.0f;                  // already past the wall
+            hit = 2;
+        }
+
+        ball.x += vx * first.t;
+        ball.y += vy * first.t;
+        t += first.t;
+
+        if (hit == 2) {
+            ball.vy = (vy < 0.0f) ? std::fabs(ball.vy) : -std::fabs(ball.vy);
+            m.events |= EVENT_WALL;
+        } else if (hit >= 0) {
+            bouncePaddle(m, hit, first, starts[hit]->y + uy[hit] * t, ux[hit], uy[hit], struck[hit]);
+        } else {
+            break;                           // free flight to the end of the tick
+        }
+    }
+
+    // A paddle can pin the ball against a wall; never leave the arena
+    if (ball.y < ball.radius)                ball.y = ball.radius;
+    if (ball.y > ARENA_HEIGHT - ball.radius) ball.y = ARENA_HEIGHT - ball.radius;
+}
+
+void matchCheckGoals(MatchState& m) {
+    if (m.ball.x < 0.0f) {
+        m.scoreP2++;
+        m.lastRallyHits = m.hitsInRally;
+        matchResetBall(m);
+        m.events |= EVENT_SCORE_P2;
+    }
+    if (m.ball.x > ARENA_WIDTH) {
+        m.scoreP1++;
+        m.lastRallyHits = m.hitsInRally;
+        matchResetBall(m);
+        m.events |= EVENT_SCORE_P1;
+    }
+}
+
+void matchAdvanceClock(MatchState& m, float dt) {
+    m.timeLeft -= dt;
+    if (m.timeLeft <= 0.0f) {
+        m.timeLeft = 0.0f;
+        m.over = true;
+    }
+
+    // Max score (0 = infinite)
+    if (m.maxScore > 0 && (m.scoreP1 >= m.maxScore || m.scoreP2 >= m.maxScore)) {
+        m.over = true;
+    }
+
+    if (m.over) m.events |= EVENT_MATCH_OVER;
+}
+
+void matchStep(MatchState& m, const PaddleInput& in1, const PaddleInput& in2, float dt) {
+    m.events = 0;
+    if (m.over) return;
+
+    matchMovePaddles(m, in1, in2, dt);
+    matchMoveBall(m, dt);
+    matchCheckGoals(m);
+    matchAdvanceClock(m, dt);
+
+    m.tick++;
+}
@@ -0,0 +1,100 @@
+#ifndef PADDLE_RIVALS_MATCH_ENGINE_H
+#define PADDLE_RIVALS_MATCH_ENGINE_H
+
+// Headless match simulation. No GL / GLUT in here: the game, the tools and
+// the tests all step matches through these functions.
+//
+// Everything is in logical arena units (ARENA_WIDTH x ARENA_HEIGHT, origin
+// bottom-left) and per-second speeds. All state lives in MatchState, so any
+// number of matches can run side by side on different threads.
+
+#include <cstdint>
+
+// ===================== ARENA =====================
+
+const float ARENA_WIDTH  = 1600.0f;
+const float ARENA_HEIGHT = 900.0f;
+
+// ===================== GAME DATA STRUCTURES =====================
+
+struct Paddle {
+    float x, y;
+    float width, height;
+    float speed;           // units per second
+};
+
+struct Ball {
+    float x, y;
+    float radius;
+    float vx, vy;          // units per second (before speedFactor)
+};
+
+// Small per-match PRNG (splitmix64) so matches are reproducible from a seed.
+struct MatchRng {
+    uint64_t state;
+};
+
+void     rngSeed(MatchRng& rng, uint64_t seed);
+uint32_t rngNext(MatchRng& rng);
+float    rngFloat(MatchRng& rng);    // [0, 1)
+
+// Movement request for one paddle for one tick.
+// Axes are in [-1, 1] and get scaled by the paddle's speed.
+struct PaddleInput {
+    float moveX, moveY;
+};
+
+struct MatchConfig {
+    float gameTime;        // seconds
+    int   maxScore;        // 0 means infinite
+    float p1Speed;         // paddle speeds, units per second
+    float p2Speed;
+};
+
+// Bit flags raised by the last matchStep() call.
+enum MatchEvent {
+    EVENT_HIT_P1     = 1 << 0,   // ball bounced off the left paddle
+    EVENT_HIT_P2     = 1 << 1,   // ball bounced off the right paddle
+    EVENT_WALL       = 1 << 2,   // ball bounced off top/bottom
+    EVENT_SCORE_P1   = 1 << 3,   // P1 scored (ball left on the right)
+    EVENT_SCORE_P2   = 1 << 4,   // P2 scored (ball left on the left)
+    EVENT_MATCH_OVER = 1 << 5
+};
+
+struct MatchState {
+    Paddle p1, p2;
+    Paddle prevP1, prevP2;     // paddles at the start of the last step
+    Ball   ball;
+    float  prevBallX, prevBallY;
+
+    int   scoreP1, scoreP2;
+    float timeLeft;
+    int   maxScore;            // 0 means infinite
+
+    float speedFactor;         // grows in a rally (+0.05 per paddle hit)
+    int   hitsInRally;
+    int   lastRallyHits;       // hits of the rally that ended with the last goal
+
+    uint32_t tick;
+    unsigned events;           // MatchEvent flags of the last step
+    bool     over;
+
+    MatchRng rng;
+};
+
+// ===================== ENGINE =====================
+
+void matchInit(MatchState& m, const MatchConfig& cfg, uint64_t seed);
+void matchResetBall(MatchState& m);
+
+// One fixed simulation step of dt seconds.
+void matchStep(MatchState& m, const PaddleInput& in1, const PaddleInput& in2, float dt);
+
+// The individual phases matchStep() runs, in order. Exposed for tools and
+// benchmarks; game code should just call matchStep().
+void matchMovePaddles(MatchState& m, const PaddleInput& in1, const PaddleInput& in2, float dt);
+void matchMoveBall(MatchState& m, float dt);    // swept: walls and paddles
+void matchCheckGoals(MatchState& m);
+void matchAdvanceClock(MatchState& m, float dt);
+
+#endif
@@ -0,0 +1,191 @@
+#include "net_link.h"
+
+#include <cstdio>
+#include <cstdlib>   // strtod
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef int socklen_t;
+typedef SOCKET NativeSocket;
+static const intptr_t invalidSocket = (intptr_t)INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int NativeSocket;
+static const intptr_t invalidSocket = -1;
+#endif
+
+// ===================== UDP =====================
+
+UdpLink::UdpLink() : sock(invalidSocket), peerLen(0) {
+    std::memset(peerAddr, 0, sizeof(peerAddr));
+}
+
+UdpLink::~UdpLink() {
+    if (sock == invalidSocket) return;
+#ifdef _WIN32
+    closesocket((NativeSocket)sock);
+#else
+    close((NativeSocket)sock);
+#endif
+}
+
+bool UdpLink::open() {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+        started = true;
+    }
+    sock = (intptr_t)socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == invalidSocket) return false;
+    u_long nonBlocking = 1;
+    ioctlsocket((NativeSocket)sock, FIONBIO, &nonBlocking);
+#else
+    sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock == invalidSocket) return false;
+    fcntl((NativeSocket)sock, F_SETFL, fcntl((NativeSocket)sock, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    return true;
+}
+
+bool UdpLink::listen(int port) {
+    if (!open()) return false;
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons((unsigned short)port);
+    return bind((NativeSocket)sock, (const sockaddr*)&addr, sizeof(addr)) == 0;
+}
+
+bool UdpLink::connect(const char* host, int port) {
+    if (!open()) return false;
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    char service[16];
+    std::sprintf(service, "%d", port);
+
+    addrinfo* found = 0;
+    if (getaddrinfo(host, service, &hints, &found) != 0 || !found) return false;
+    std::memcpy(peerAddr, found->ai_addr, found->ai_addrlen);
+    peerLen = (int)found->ai_addrlen;
+    freeaddrinfo(found);
+    return true;
+}
+
+void UdpLink::send(const uint8_t* data, int size, double) {
+    if (sock == invalidSocket || peerLen == 0) return;
+    sendto((NativeSocket)sock, (const char*)data, size, 0, (const sockaddr*)peerAddr, (socklen_t)peerLen);
+}
+
+int UdpLink::receive(uint8_t* buf, int max, double) {
+    if (sock == invalidSocket) return 0;
+
+    sockaddr_in from;
+    socklen_t   fromLen = sizeof(from);
+    int n = (int)recvfrom((NativeSocket)sock, (char*)buf, max, 0, (sockaddr*)&from, &fromLen);
+    if (n <= 0) return 0;
+
+    // The host talks to whoever reached it first
+    if (peerLen == 0) {
+        std::memcpy(peerAddr, &from, fromLen);
+        peerLen = (int)fromLen;
+    } else {
+        const sockaddr_in* peer = (const sockaddr_in*)peerAddr;
+        if (peer->sin_port != from.sin_port || peer->sin_addr.s_addr != from.sin_addr.s_addr) {
+            return 0;   // a stranger
+        }
+    }
+    return n;
+}
+
+// ===================== LOOPBACK =====================
+
+LoopbackLink::LoopbackLink() : other(0) {}
+
+void LoopbackLink::connect(LoopbackLink& a, LoopbackLink& b) {
+    a.other = &b;
+    b.other = &a;
+}
+
+void LoopbackLink::send(const uint8_t* data, int size, double) {
+    if (other) other->inbox.push_back(std::vector<uint8_t>(data, data + size));
+}
+
+int LoopbackLink::receive(uint8_t* buf, int max, double) {
+    if (inbox.empty()) return 0;
+
+    int n = (int)inbox.front().size();
+    if (n > max) n = 0;
+    else         std::memcpy(buf, &inbox.front()[0], n);
+    inbox.pop_front();
+    return n;
+}
+
+// ===================== EMULATOR =====================
+
+bool netParseConditions(const char* text, NetConditions& out) {
+    float v[3] = { 0.0f, 0.0f, 0.0f };
+    const char* p = text;
+    for (int i = 0; i < 3 && *p; ++i) {
+        char* end;
+        v[i] = (float)std::strtod(p, &end);
+        if (end == p || v[i] < 0.0f) return false;
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    out.latencyMs   = v[0];
+    out.jitterMs    = v[1];
+    out.lossPercent = v[2];
+    return true;
+}
+
+NetEmulator::NetEmulator(NetLink* inner, const NetConditions& conditions, uint64_t seed)
+    : inner(inner), conditions(conditions), droppedCount(0) {
+    rngSeed(rng, seed);
+}
+
+void NetEmulator::send(const uint8_t* data, int size, double now) {
+    if (rngFloat(rng) * 100.0f < conditions.lossPercent) {
+        droppedCount++;
+    } else {
+        float delayMs = conditions.latencyMs + (2.0f * rngFloat(rng) - 1.0f) * conditions.jitterMs;
+        Delayed d;
+        d.due = now + (delayMs > 0.0f ? delayMs : 0.0f) / 1000.0;
+        d.data.assign(data, data + size);
+
+        // Keep the queue in delivery order
+        std::vector<Delayed>::iterator at = queue.end();
+        while (at != queue.begin() && (at - 1)->due > d.due) --at;
+        queue.insert(at, d);
+    }
+    flush(now);
+}
+
+int NetEmulator::receive(uint8_t* buf, int max, double now) {
+    flush(now);
+    return inner->receive(buf, max, now);
+}
+
+void NetEmulator::flush(double now) {
+    size_t due = 0;
+    while (due < queue.size() && queue[due].due <= now) {
+        inner->send(&queue[due].data[0], (int)queue[due].data.size(), now);
+        due++;
+    }
+    queue.erase(queue.begin(), queue.begin() + due);
+}
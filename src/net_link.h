@@ -0,0 +1,112 @@
+#ifndef PADDLE_RIVALS_NET_LINK_H
+#define PADDLE_RIVALS_NET_LINK_H
+
+// Datagram links for online play.
+//
+// A NetLink sends and receives whole datagrams without blocking. There is
+// a UDP socket, an in-process loopback pair, and NetEmulator, which wraps
+// either of them and delays, reorders and drops outgoing datagrams like a
+// real network would. That's enough to develop and test netplay on one
+// machine with no network at all.
+//
+// Calls take the current time in seconds; only the emulator uses it, so
+// headless tests can drive it with a simulated clock.
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "match_engine.h"   // MatchRng
+
+const int netMaxDatagram = 1200;   // stays under typical MTUs
+
+class NetLink {
+public:
+    virtual ~NetLink() {}
+
+    // `now` is the caller's clock in seconds; only the emulator uses it.
+    virtual void send(const uint8_t* data, int size, double now) = 0;
+
+    // Copies the next datagram into buf; returns its size, or 0 if none is
+    // waiting (or it was larger than max).
+    virtual int  receive(uint8_t* buf, int max, double now) = 0;
+};
+
+// ===================== UDP =====================
+
+class UdpLink : public NetLink {
+public:
+    UdpLink();
+    ~UdpLink();
+
+    // Host: binds the port and answers whoever sends first.
+    bool listen(int port);
+
+    // Join: sends to host:port ("1.2.3.4" or a name) from any local port.
+    bool connect(const char* host, int port);
+
+    void send(const uint8_t* data, int size, double now);
+    int  receive(uint8_t* buf, int max, double now);
+
+private:
+    bool open();
+
+    intptr_t sock;
+    uint8_t  peerAddr[32];            // sockaddr_in of the peer
+    int      peerLen;                 // 0 until the peer is known
+};
+
+// ===================== LOOPBACK =====================
+
+// Two ends of an in-process link; what one sends, the other receives.
+class LoopbackLink : public NetLink {
+public:
+    LoopbackLink();
+
+    static void connect(LoopbackLink& a, LoopbackLink& b);
+
+    void send(const uint8_t* data, int size, double now);
+    int  receive(uint8_t* buf, int max, double now);
+
+private:
+    LoopbackLink*                    other;
+    std::deque<std::vector<uint8_t>> inbox;
+};
+
+// ===================== EMULATOR =====================
+
+// One-way conditions applied to what this end sends.
+struct NetConditions {
+    float latencyMs;                  // base delay
+    float jitterMs;                   // +- uniform on top (reorders packets)
+    float lossPercent;                // dropped outright
+};
+
+// "80,10,2" = 80 ms latency, 10 ms jitter, 2 % loss. Missing fields are 0.
+bool netParseConditions(const char* text, NetConditions& out);
+
+class NetEmulator : public NetLink {
+public:
+    NetEmulator(NetLink* inner, const NetConditions& conditions, uint64_t seed);
+
+    void send(const uint8_t* data, int size, double now);
+    int  receive(uint8_t* buf, int max, double now);
+
+    uint64_t dropped() const { return droppedCount; }
+
+private:
+    struct Delayed {
+        double               due;
+        std::vector<uint8_t> data;
+    };
+
+    void flush(double now);           // hands due datagrams to the inner link
+
+    NetLink*             inner;
+    NetConditions        conditions;
+    MatchRng             rng;
+    std::vector<Delayed> queue;       // by delivery time
+    uint64_t             droppedCount;
+};
+
+#endif
@@ -0,0 +1,233 @@
+// Netplay simulator: plays online matches between two AI-driven peers in
+// one process, through the network emulator, and checks that both ends
+// agree on every confirmed tick.
+//
+//   net_sim [--latency MS] [--jitter MS] [--loss PCT] [--delay TICKS]
+//           [--matches N] [--time SEC] [--tick-hz HZ] [--seed S]
+//           [--drift PCT] [--udp PORT]
+//
+// Latency, jitter and loss are one way and apply in both directions. Time
+// is simulated (the peers tick on their own schedules, the joining one
+// --drift percent slower), so a run is reproducible and much faster than
+// real time. --udp sends through real sockets on 127.0.0.1 instead of the
+// in-process loopback, handshake included.
+//
+// Exits with 1 on a desync, a replay that doesn't verify, or a match that
+// never finished.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "ai.h"
+#include "match_engine.h"
+#include "net_link.h"
+#include "netplay.h"
+#include "replay.h"
+
+struct SimOptions {
+    NetConditions conditions;
+    int      delay;
+    int      matches;
+    float    gameTime;
+    int      tickHz;
+    uint64_t seed;
+    float    driftPercent;
+    int      udpPort;           // 0 = in-process loopback
+};
+
+static void printUsage() {
+    std::printf("usage: net_sim [--latency MS] [--jitter MS] [--loss PCT] [--delay TICKS]\n"
+                "               [--matches N] [--time SEC] [--tick-hz HZ] [--seed S]\n"
+                "               [--drift PCT] [--udp PORT]\n");
+}
+
+static bool parseOptions(int argc, char** argv, SimOptions& o) {
+    o.conditions.latencyMs   = 40.0f;
+    o.conditions.jitterMs    = 5.0f;
+    o.conditions.lossPercent = 1.0f;
+    o.delay        = 1;
+    o.matches      = 1;
+    o.gameTime     = 90.0f;
+    o.tickHz       = 120;
+    o.seed         = 1;
+    o.driftPercent = 0.5f;
+    o.udpPort      = 0;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+
+        if      (!std::strcmp(a, "--latency")) o.conditions.latencyMs   = (float)std::atof(v);
+        else if (!std::strcmp(a, "--jitter"))  o.conditions.jitterMs    = (float)std::atof(v);
+        else if (!std::strcmp(a, "--loss"))    o.conditions.lossPercent = (float)std::atof(v);
+        else if (!std::strcmp(a, "--delay"))   o.delay        = std::atoi(v);
+        else if (!std::strcmp(a, "--matches")) o.matches      = std::atoi(v);
+        else if (!std::strcmp(a, "--time"))    o.gameTime     = (float)std::atof(v);
+        else if (!std::strcmp(a, "--tick-hz")) o.tickHz       = std::atoi(v);
+        else if (!std::strcmp(a, "--seed"))    o.seed         = std::strtoull(v, 0, 10);
+        else if (!std::strcmp(a, "--drift"))   o.driftPercent = (float)std::atof(v);
+        else if (!std::strcmp(a, "--udp"))     o.udpPort      = std::atoi(v);
+        else return false;
+    }
+    return o.matches > 0 && o.tickHz > 0 && o.delay >= 0 && o.delay <= netMaxDelay;
+}
+
+// Same thresholds as replay_tool: the AI's analog input as held keys
+static NetKeys quantize(const PaddleInput& in) {
+    NetKeys keys = 0;
+    if (in.moveY >  0.5f) keys |= REPLAY_P1_UP;
+    if (in.moveY < -0.5f) keys |= REPLAY_P1_DOWN;
+    if (in.moveX >  0.5f) keys |= REPLAY_P1_RIGHT;
+    if (in.moveX < -0.5f) keys |= REPLAY_P1_LEFT;
+    return keys;
+}
+
+// ===================== ONE MATCH =====================
+
+struct Peer {
+    NetSession* session;
+    AiState     player;         // plays this side, seeing this peer's (predicted) state
+    double      nextTick;
+    double      tickDt;
+};
+
+static void printPeer(const char* name, const NetSession& s, uint64_t dropped) {
+    const NetStats& st = s.stats;
+    double ticks = (double)s.state.tick;
+    std::printf("  %s: rollbacks %llu (avg %.1f, max %d ticks)  predicted %.1f%%  mispredicted %.1f%%\n",
+                name, (unsigned long long)st.rollbacks,
+                st.rollbacks ? (double)st.resimulatedTicks / st.rollbacks : 0.0, st.maxRollback,
+                ticks > 0 ? 100.0 * st.predictedTicks / ticks : 0.0,
+                ticks > 0 ? 100.0 * st.mispredictedTicks / ticks : 0.0);
+    std::printf("  %*s  waits %llu stall + %llu sync  rtt %.1f ms  packets %llu sent (%llu dropped), %llu received\n",
+                (int)std::strlen(name), "",
+                (unsigned long long)st.stallTicks, (unsigned long long)st.syncTicks, st.rttMs,
+                (unsigned long long)st.packetsSent, (unsigned long long)dropped,
+                (unsigned long long)st.packetsReceived);
+}
+
+static bool runMatch(const SimOptions& o, uint64_t seed) {
+    Replay setup;
+    setup.seed            = seed;
+    setup.singlePlayer    = false;
+    setup.gameTimeIndex   = 1;
+    setup.maxScoreIndex   = 1;
+    setup.difficultyIndex = 0;
+    setup.tickRate        = o.tickHz;
+    setup.config.gameTime = o.gameTime;
+    setup.config.maxScore = 5;
+    setup.config.p1Speed  = 480.0f;
+    setup.config.p2Speed  = 480.0f;
+
+    // Links: either an in-process pair or two sockets on 127.0.0.1
+    LoopbackLink loopA, loopB;
+    UdpLink      udpA, udpB;
+    NetLink*     rawA = &loopA;
+    NetLink*     rawB = &loopB;
+
+    Replay joined      = setup;
+    int    joinedDelay = o.delay;
+    if (o.udpPort) {
+        if (!udpA.listen(o.udpPort) || !udpB.connect("127.0.0.1", o.udpPort)) {
+            std::fprintf(stderr, "could not open UDP port %d\n", o.udpPort);
+            return false;
+        }
+        bool hostOk = false;
+        std::thread host([&]() { hostOk = netHostHandshake(udpA, setup, o.delay, 5.0); });
+        bool joinOk = netJoinHandshake(udpB, joined, joinedDelay, 5.0);
+        host.join();
+        if (!hostOk || !joinOk) {
+            std::fprintf(stderr, "handshake failed\n");
+            return false;
+        }
+        rawA = &udpA;
+        rawB = &udpB;
+    } else {
+        LoopbackLink::connect(loopA, loopB);
+    }
+
+    NetEmulator linkA(rawA, o.conditions, seed * 2 + 1);
+    NetEmulator linkB(rawB, o.conditions, seed * 2 + 2);
+
+    // Sessions are large (snapshot rings); keep them off the stack
+    NetSession* sessionA = new NetSession;
+    NetSession* sessionB = new NetSession;
+    netStart(*sessionA, &linkA, 0, setup, o.delay);
+    netStart(*sessionB, &linkB, 1, joined, joinedDelay);
+
+    Peer peers[2];
+    peers[0].session  = sessionA;
+    peers[0].nextTick = 0.0;
+    peers[0].tickDt   = 1.0 / o.tickHz;
+    peers[1].session  = sessionB;
+    peers[1].nextTick = 0.5 / o.tickHz;                    // out of phase
+    peers[1].tickDt   = 1.0 / o.tickHz * (1.0 + o.driftPercent / 100.0);
+    aiInit(peers[0].player, 0, 2, seed + 11);
+    aiInit(peers[1].player, 1, 2, seed + 12);
+
+    // Until both have confirmed the end (or far too long)
+    double limit = o.gameTime * 3.0 + 10.0;
+    double now   = 0.0;
+    while (!(netConfirmedOver(*sessionA) && netConfirmedOver(*sessionB)) && now < limit) {
+        Peer& p = peers[0].nextTick <= peers[1].nextTick ? peers[0] : peers[1];
+        now = p.nextTick;
+        p.nextTick += p.tickDt;
+
+        NetSession& s = *p.session;
+        if (netConfirmedOver(s)) {
+            netService(s, now);
+        } else {
+            float dt = 1.0f / (float)o.tickHz;
+            netTick(s, quantize(aiUpdate(p.player, s.state, dt)), now);
+        }
+    }
+
+    bool finished = netConfirmedOver(*sessionA) && netConfirmedOver(*sessionB);
+    bool same     = sessionA->log.inputs == sessionB->log.inputs;
+
+    replayFinish(sessionA->log, sessionA->state);
+    replayFinish(sessionB->log, sessionB->state);
+    MatchState check;
+    bool verified = replayVerify(sessionA->log, check) && replayVerify(sessionB->log, check);
+    bool desync   = sessionA->stats.desync || sessionB->stats.desync ||
+                    sessionA->log.finalHash != sessionB->log.finalHash;
+
+    std::printf("match seed %llu: %d:%d after %u ticks (%.1f s simulated)  %s%s%s%s\n",
+                (unsigned long long)seed, sessionA->state.scoreP1, sessionA->state.scoreP2,
+                (unsigned)sessionA->state.tick, now,
+                finished ? "finished" : "DID NOT FINISH",
+                same ? ", inputs agree" : ", INPUTS DIFFER",
+                verified ? ", replays verify" : ", REPLAY MISMATCH",
+                desync ? ", DESYNC" : "");
+    printPeer("host", *sessionA, linkA.dropped());
+    printPeer("join", *sessionB, linkB.dropped());
+
+    bool ok = finished && same && verified && !desync;
+    delete sessionA;
+    delete sessionB;
+    return ok;
+}
+
+// ===================== MAIN =====================
+
+int main(int argc, char** argv) {
+    SimOptions o;
+    if (!parseOptions(argc, argv, o)) {
+        printUsage();
+        return 1;
+    }
+
+    std::printf("one way %.0f ms +- %.0f ms, %.1f%% loss; input delay %d tick(s) (%.1f ms) at %d Hz\n",
+                o.conditions.latencyMs, o.conditions.jitterMs, o.conditions.lossPercent,
+                o.delay, 1000.0 * o.delay / o.tickHz, o.tickHz);
+
+    int failures = 0;
+    for (int i = 0; i < o.matches; ++i) {
+        if (!runMatch(o, o.seed + i)) failures++;
+    }
+    if (o.matches > 1) std::printf("%d / %d matches OK\n", o.matches - failures, o.matches);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+#ifndef PADDLE_RIVALS_NET_WIRE_H
+#define PADDLE_RIVALS_NET_WIRE_H
+
+// Packet encoding shared by netplay and the dedicated server.
+//
+// Little-endian fields behind a three-letter magic and a type byte, e.g.
+// "PRN" + type for peer-to-peer packets. Writes past netMaxDatagram and
+// reads past the end are dropped / flagged instead of overrunning.
+
+#include <cstdint>
+#include <cstring>
+
+#include "net_link.h"   // netMaxDatagram
+
+struct NetWriter {
+    uint8_t buf[netMaxDatagram];
+    int     size;
+
+    NetWriter(const char* magic, int type) : size(0) {
+        u8(magic[0]); u8(magic[1]); u8(magic[2]); u8(type);
+    }
+    void u8(unsigned v)   { if (size < netMaxDatagram) buf[size++] = (uint8_t)v; }
+    void u16(unsigned v)  { u8(v & 0xFF); u8((v >> 8) & 0xFF); }
+    void u32(uint32_t v)  { u16(v & 0xFFFF); u16(v >> 16); }
+    void u64(uint64_t v)  { u32((uint32_t)v); u32((uint32_t)(v >> 32)); }
+    void f32(float f) {
+        uint32_t v;
+        std::memcpy(&v, &f, 4);
+        u32(v);
+    }
+};
+
+struct NetReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+    NetReader(const uint8_t* data, int size) : p(data), end(data + size), ok(true) {}
+
+    unsigned u8() {
+        if (p >= end) { ok = false; return 0; }
+        return *p++;
+    }
+    unsigned u16() { unsigned lo = u8(); return lo | (u8() << 8); }
+    uint32_t u32() { uint32_t lo = u16(); return lo | ((uint32_t)u16() << 16); }
+    uint64_t u64() { uint64_t lo = u32(); return lo | ((uint64_t)u32() << 32); }
+    float f32() {
+        uint32_t v = u32();
+        float f;
+        std::memcpy(&f, &v, 4);
+        return f;
+    }
+};
+
+// Packet type after the magic, or 0 if the packet isn't one of those.
+inline int netPacketType(NetReader& r, const char* magic) {
+    if (r.u8() != (uint8_t)magic[0] || r.u8() != (uint8_t)magic[1] || r.u8() != (uint8_t)magic[2]) return 0;
+    int type = (int)r.u8();
+    return r.ok ? type : 0;
+}
+
+#endif
@@ -0,0 +1,366 @@
+#include "netplay.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "net_wire.h"
+
+// ===================== PACKETS =====================
+//
+// Little-endian, every packet starts with "PRN" and a type byte:
+//
+//   HELLO    u16 version
+//   WELCOME  u16 version u8 inputDelay u64 seed u8 gameTimeIndex
+//            u8 maxScoreIndex u16 tickRate f32 gameTime i32 maxScore
+//            f32 p1Speed f32 p2Speed
+//   INPUT    u32 firstTick u8 count, count key bytes (ticks firstTick..),
+//            u32 ack (we have the peer's keys below this tick),
+//            u32 hashTick u64 hash (latest confirmed-state hash, 0 = none),
+//            i16 advantage (sender's ticks ahead, x16)
+//   BYE
+
+enum NetPacketType {
+    PACKET_HELLO   = 1,
+    PACKET_WELCOME = 2,
+    PACKET_INPUT   = 3,
+    PACKET_BYE     = 4
+};
+
+static const uint32_t noRollback = 0xFFFFFFFFu;
+
+static const char* netMagic = "PRN";
+
+static void sendWelcome(NetLink& link, const Replay& setup, int inputDelay, double now) {
+    NetWriter w(netMagic, PACKET_WELCOME);
+    w.u16(netVersion);
+    w.u8(inputDelay);
+    w.u64(setup.seed);
+    w.u8(setup.gameTimeIndex);
+    w.u8(setup.maxScoreIndex);
+    w.u16(setup.tickRate);
+    w.f32(setup.config.gameTime);
+    w.u32((uint32_t)setup.config.maxScore);
+    w.f32(setup.config.p1Speed);
+    w.f32(setup.config.p2Speed);
+    link.send(w.buf, w.size, now);
+}
+
+// ===================== HANDSHAKE =====================
+
+static double clockSeconds() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+bool netHostHandshake(NetLink& link, const Replay& setup, int inputDelay, double timeoutSec) {
+    double start = clockSeconds();
+    uint8_t buf[netMaxDatagram];
+
+    while (clockSeconds() - start < timeoutSec) {
+        double now = clockSeconds();
+        int n;
+        while ((n = link.receive(buf, sizeof(buf), now)) > 0) {
+            NetReader r(buf, n);
+            if (netPacketType(r, netMagic) == PACKET_HELLO && r.u16() == netVersion && r.ok) {
+                // A lost WELCOME is answered again by the session (the
+                // joining side keeps sending HELLO until it gets one)
+                sendWelcome(link, setup, inputDelay, now);
+                return true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+bool netJoinHandshake(NetLink& link, Replay& setup, int& inputDelay, double timeoutSec) {
+    double start    = clockSeconds();
+    double lastSent = -1.0;
+    uint8_t buf[netMaxDatagram];
+
+    while (clockSeconds() - start < timeoutSec) {
+        double now = clockSeconds();
+        if (now - lastSent >= 0.1) {
+            NetWriter w(netMagic, PACKET_HELLO);
+            w.u16(netVersion);
+            link.send(w.buf, w.size, now);
+            lastSent = now;
+        }
+
+        int n;
+        while ((n = link.receive(buf, sizeof(buf), now)) > 0) {
+            NetReader r(buf, n);
+            if (netPacketType(r, netMagic) != PACKET_WELCOME || r.u16() != netVersion) continue;
+
+            int delay = (int)r.u8();
+            setup.seed            = r.u64();
+            setup.gameTimeIndex   = (int)r.u8();
+            setup.maxScoreIndex   = (int)r.u8();
+            setup.tickRate        = (int)r.u16();
+            setup.config.gameTime = r.f32();
+            setup.config.maxScore = (int)r.u32();
+            setup.config.p1Speed  = r.f32();
+            setup.config.p2Speed  = r.f32();
+            if (!r.ok || setup.tickRate <= 0 || delay > netMaxDelay) continue;
+
+            setup.singlePlayer    = false;
+            setup.difficultyIndex = 0;
+            inputDelay            = delay;
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+// ===================== SESSION =====================
+
+void netStart(NetSession& s, NetLink* link, int side, const Replay& setup, int inputDelay) {
+    s.link       = link;
+    s.side       = side;
+    s.inputDelay = inputDelay < 0 ? 0 : (inputDelay > netMaxDelay ? netMaxDelay : inputDelay);
+
+    s.log              = setup;
+    s.log.singlePlayer = false;
+    replayBegin(s.log, s.state, s.noAi);
+
+    std::memset(s.localKeys,  0, sizeof(s.localKeys));
+    std::memset(s.remoteKeys, 0, sizeof(s.remoteKeys));
+    std::memset(s.usedKeys,   0, sizeof(s.usedKeys));
+    for (int i = 0; i < netRingSize; ++i) s.sentAt[i] = 0.0;
+
+    // Keys for the first inputDelay ticks are "nothing held" on both sides
+    s.localCount     = (uint32_t)s.inputDelay;
+    s.remoteCount    = 0;
+    s.peerAck        = 0;
+    s.peerLocalCount = 0;
+    s.rollbackFrom   = noRollback;
+
+    s.advantage     = 0.0f;
+    s.peerAdvantage = 0.0f;
+    s.syncCooldown  = 0;
+
+    s.hashCount = 0;
+    s.peerLeft  = false;
+    std::memset(&s.stats, 0, sizeof(s.stats));
+}
+
+static NetKeys predictedKeys(const NetSession& s, uint32_t tick) {
+    if (tick < s.remoteCount) return s.remoteKeys[tick % netRingSize];
+    return s.remoteCount ? s.remoteKeys[(s.remoteCount - 1) % netRingSize] : 0;
+}
+
+static uint8_t combinedBits(const NetSession& s, NetKeys local, NetKeys remote) {
+    return s.side == 0 ? (uint8_t)(local | (remote << 4)) : (uint8_t)(remote | (local << 4));
+}
+
+// Steps s.state (at tick t) with the local keys and the best remote keys.
+static void simulate(NetSession& s) {
+    uint32_t t    = s.state.tick;
+    int      slot = t % netRingSize;
+
+    s.snapshots[slot] = s.state;
+    s.usedKeys[slot]  = predictedKeys(s, t);
+
+    PaddleInput in1, in2;
+    replayTickInputs(s.log, s.state, s.noAi,
+                     combinedBits(s, s.localKeys[slot], s.usedKeys[slot]), 0, in1, in2);
+    matchStep(s.state, in1, in2, 1.0f / (float)s.log.tickRate);
+}
+
+static const MatchState& stateAt(const NetSession& s, uint32_t tick) {
+    return tick == s.state.tick ? s.state : s.snapshots[tick % netRingSize];
+}
+
+// Moves ticks whose keys are known on both sides into the log.
+static void confirm(NetSession& s) {
+    uint32_t c = (uint32_t)s.log.inputs.size();
+    while (c < s.remoteCount && c < s.state.tick) {
+        int slot = c % netRingSize;
+        s.log.inputs.push_back(combinedBits(s, s.localKeys[slot], s.remoteKeys[slot]));
+        c++;
+
+        if (c % netHashInterval == 0) {
+            int i = s.hashCount++ % 4;
+            s.hashTick[i] = c;
+            s.hash[i]     = replayStateHash(stateAt(s, c));
+        }
+    }
+}
+
+static void checkPeerHash(NetSession& s, uint32_t tick, uint64_t hash) {
+    if (tick == 0) return;
+    for (int i = 0; i < 4 && i < s.hashCount; ++i) {
+        if (s.hashTick[i] == tick && s.hash[i] != hash) s.stats.desync = true;
+    }
+}
+
+static void handleInput(NetSession& s, NetReader& r, double now) {
+    uint32_t first = r.u32();
+    int      count = (int)r.u8();
+    NetKeys  keys[255];
+    for (int i = 0; i < count; ++i) keys[i] = (NetKeys)(r.u8() & 0x0F);
+    uint32_t ack      = r.u32();
+    uint32_t hashTick = r.u32();
+    uint64_t hash     = r.u64();
+    int16_t  peerAdv  = (int16_t)r.u16();
+    if (!r.ok) return;
+    s.peerAdvantage = peerAdv / 16.0f;
+
+    // Packets repeat everything unacknowledged, so new keys always start at
+    // or before remoteCount; anything past a gap would be a bug upstream.
+    for (int i = 0; i < count; ++i) {
+        uint32_t t = first + i;
+        if (t != s.remoteCount) continue;
+
+        int slot = t % netRingSize;
+        s.remoteKeys[slot] = keys[i];
+        s.remoteCount++;
+
+        if (t < s.state.tick && keys[i] != s.usedKeys[slot]) {
+            s.stats.mispredictedTicks++;
+            if (t < s.rollbackFrom) s.rollbackFrom = t;
+        }
+    }
+    if (first + count > s.peerLocalCount) s.peerLocalCount = first + count;
+
+    if (ack > s.peerAck && ack <= s.localCount) {
+        float sample = (float)((now - s.sentAt[(ack - 1) % netRingSize]) * 1000.0);
+        s.stats.rttMs = s.stats.rttMs > 0.0f ? 0.9f * s.stats.rttMs + 0.1f * sample : sample;
+        s.peerAck = ack;
+    }
+
+    checkPeerHash(s, hashTick, hash);
+}
+
+static void receiveAll(NetSession& s, double now) {
+    uint8_t buf[netMaxDatagram];
+    int n;
+    while ((n = s.link->receive(buf, sizeof(buf), now)) > 0) {
+        NetReader r(buf, n);
+        s.stats.packetsReceived++;
+
+        switch (netPacketType(r, netMagic)) {
+            case PACKET_INPUT: handleInput(s, r, now);                          break;
+            case PACKET_HELLO: sendWelcome(*s.link, s.log, s.inputDelay, now);  break;
+            case PACKET_BYE:   s.peerLeft = true;                               break;
+            default:                                                            break;
+        }
+    }
+}
+
+static void rollback(NetSession& s) {
+    if (s.rollbackFrom == noRollback) return;
+
+    uint32_t from = s.rollbackFrom;
+    uint32_t to   = s.state.tick;
+    s.rollbackFrom = noRollback;
+
+    s.state = s.snapshots[from % netRingSize];
+    while (s.state.tick < to && !s.state.over) simulate(s);
+
+    int depth = (int)(to - from);
+    s.stats.rollbacks++;
+    s.stats.resimulatedTicks += depth;
+    if (depth > s.stats.maxRollback) s.stats.maxRollback = depth;
+}
+
+static void sendInputs(NetSession& s, double now) {
+    NetWriter w(netMagic, PACKET_INPUT);
+    uint32_t first = s.peerAck;
+    int      count = (int)(s.localCount - first);
+    if (count > 255) count = 255;
+
+    w.u32(first);
+    w.u8(count);
+    for (int i = 0; i < count; ++i) w.u8(s.localKeys[(first + i) % netRingSize]);
+    w.u32(s.remoteCount);
+
+    int latest = s.hashCount ? (s.hashCount - 1) % 4 : -1;
+    w.u32(latest >= 0 ? s.hashTick[latest] : 0);
+    w.u64(latest >= 0 ? s.hash[latest] : 0);
+
+    float adv = s.advantage * 16.0f;
+    w.u16((uint16_t)(int16_t)(adv > 32767.0f ? 32767.0f : (adv < -32768.0f ? -32768.0f : adv)));
+
+    s.link->send(w.buf, w.size, now);
+    s.stats.packetsSent++;
+}
+
+// Whether this tick has to wait for the peer.
+static bool mustWait(NetSession& s) {
+    // Can't predict further than the snapshots reach
+    if (s.state.tick >= s.remoteCount + netMaxRollback) {
+        s.stats.stallTicks++;
+        return true;
+    }
+    // Unacknowledged keys must stay in the ring (the peer can be up to
+    // netMaxRollback + delay ahead of what it has from us, and we can be as
+    // far ahead of it, hence netRingSize)
+    if (s.localCount - s.peerAck >= (uint32_t)netRingSize - 1) {
+        s.stats.stallTicks++;
+        return true;
+    }
+
+    // Time sync: the peer should be at its last reported tick plus half a
+    // round trip. Both sides smooth how far ahead they are and compare
+    // notes; network jitter shows up on both and cancels out. The one
+    // ahead by more than a tick skips one, then lets the averages settle.
+    if (s.peerLocalCount > 0) {
+        double peerTick = (double)s.peerLocalCount - s.inputDelay
+                        + s.stats.rttMs / 2000.0 * s.log.tickRate;
+        s.advantage = 0.95f * s.advantage + 0.05f * (float)((double)s.state.tick - peerTick);
+
+        if (s.syncCooldown > 0) {
+            s.syncCooldown--;
+        } else if ((s.advantage - s.peerAdvantage) / 2.0f > 1.0f) {
+            s.syncCooldown = 20;
+            s.stats.syncTicks++;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool netTick(NetSession& s, NetKeys keys, double now) {
+    receiveAll(s, now);
+    rollback(s);
+    confirm(s);
+
+    bool advanced = false;
+    if (!s.state.over && !s.peerLeft && !mustWait(s)) {
+        int slot = s.localCount % netRingSize;
+        s.localKeys[slot] = (NetKeys)(keys & 0x0F);
+        s.sentAt[slot]    = now;
+        s.localCount++;
+
+        if (s.state.tick >= s.remoteCount) s.stats.predictedTicks++;
+        simulate(s);
+        confirm(s);
+        advanced = true;
+    }
+
+    sendInputs(s, now);
+    return advanced;
+}
+
+void netService(NetSession& s, double now) {
+    receiveAll(s, now);
+    rollback(s);
+    confirm(s);
+    sendInputs(s, now);
+}
+
+const MatchState& netConfirmedState(const NetSession& s) {
+    return stateAt(s, (uint32_t)s.log.inputs.size());
+}
+
+bool netConfirmedOver(const NetSession& s) {
+    return netConfirmedState(s).over;
+}
+
+void netLeave(NetSession& s, double now) {
+    NetWriter w(netMagic, PACKET_BYE);
+    for (int i = 0; i < 3; ++i) s.link->send(w.buf, w.size, now);
+}
@@ -0,0 +1,121 @@
+#ifndef PADDLE_RIVALS_NETPLAY_H
+#define PADDLE_RIVALS_NETPLAY_H
+
+// Online 1v1 with rollback.
+//
+// Both peers run the same deterministic match from the same seed and
+// settings. Each tick the local keys are sent to the peer and applied
+// inputDelay ticks later. The peer's keys for ticks that haven't arrived
+// yet are predicted: same as the last keys we got. The state at the start
+// of each tick is kept in a ring (a MatchState is a couple hundred bytes),
+// and when the real keys differ from the prediction the session restores
+// that tick's snapshot and re-simulates to the present in one go. If the
+// peer falls netMaxRollback ticks behind, the session waits instead.
+//
+// Every packet repeats the inputs the peer hasn't acknowledged, so a lost
+// packet costs no round trip. Peers drift apart in time: each one tracks
+// how many ticks it runs ahead of the other (smoothed, and exchanged so
+// jitter cancels out), and the one ahead skips a tick now and then. They
+// also exchange hashes of confirmed states and flag a desync if those
+// differ.
+//
+// The confirmed inputs of both players form an ordinary multiplayer Replay,
+// which is also how the final state is stepped: replays of online matches
+// verify like any other.
+
+#include <cstdint>
+
+#include "ai.h"
+#include "match_engine.h"
+#include "net_link.h"
+#include "replay.h"
+
+const int      netMaxRollback  = 30;    // ticks re-simulated at most (250 ms at 120 Hz)
+const int      netMaxDelay     = 8;     // input delay, ticks
+const int      netRingSize     = 128;   // > 2 * (netMaxRollback + netMaxDelay + 1)
+const int      netHashInterval = 32;    // ticks between desync checks
+const uint16_t netVersion      = 1;
+
+// Own-paddle keys, as the low nibble of ReplayInputBits (REPLAY_P1_*).
+typedef uint8_t NetKeys;
+
+struct NetStats {
+    uint64_t rollbacks;                 // corrections
+    uint64_t resimulatedTicks;
+    int      maxRollback;               // deepest correction, ticks
+    uint64_t predictedTicks;            // simulated before the peer's keys arrived
+    uint64_t mispredictedTicks;
+    uint64_t stallTicks;                // waited: peer too far behind
+    uint64_t syncTicks;                 // waited: we were too far ahead
+    uint64_t packetsSent, packetsReceived;
+    float    rttMs;                     // smoothed round trip
+    bool     desync;
+};
+
+struct NetSession {
+    NetLink* link;
+    int      side;                      // 0 = host (left paddle), 1 = joined
+    int      inputDelay;                // ticks
+
+    Replay   log;                       // settings + confirmed inputs of both players
+    AiState  noAi;                      // replayTickInputs wants one; unused in 1v1
+
+    MatchState state;                   // the present, possibly predicted
+    MatchState snapshots[netRingSize];  // state at the start of tick t, at t % netRingSize
+
+    NetKeys  localKeys[netRingSize];
+    NetKeys  remoteKeys[netRingSize];
+    NetKeys  usedKeys[netRingSize];     // remote keys tick t was simulated with
+    double   sentAt[netRingSize];       // when local keys for tick t were first sent
+    uint32_t localCount;                // local keys known for ticks [0, localCount)
+    uint32_t remoteCount;               // remote keys received for [0, remoteCount)
+    uint32_t peerAck;                   // peer has our keys for [0, peerAck)
+    uint32_t peerLocalCount;            // peer's localCount in its latest packet
+    uint32_t rollbackFrom;              // earliest wrong tick, or UINT32_MAX
+
+    float    advantage;                 // ticks we run ahead of the peer (smoothed)
+    float    peerAdvantage;             // the peer's view of the same
+    int      syncCooldown;              // ticks until we may skip again
+
+    // Desync check: hashes of the confirmed state every netHashInterval ticks
+    uint32_t hashTick[4];
+    uint64_t hash[4];
+    int      hashCount;
+
+    bool     peerLeft;
+    NetStats stats;
+};
+
+// ===================== SETUP =====================
+
+// Host: waits (blocking, up to timeoutSec) for a peer and sends it the
+// match settings in `setup` (seed, config, indices, tick rate; inputs are
+// ignored). Join: waits for those settings and fills `setup` from them.
+bool netHostHandshake(NetLink& link, const Replay& setup, int inputDelay, double timeoutSec);
+bool netJoinHandshake(NetLink& link, Replay& setup, int& inputDelay, double timeoutSec);
+
+// Starts the session on an already connected link. setup.singlePlayer must
+// be false.
+void netStart(NetSession& s, NetLink* link, int side, const Replay& setup, int inputDelay);
+
+// ===================== PER TICK =====================
+
+// Receives what arrived, rolls back if a prediction was wrong, then (unless
+// it has to wait for the peer) advances one tick with the local keys.
+// Always sends. Returns true if a tick was simulated.
+bool netTick(NetSession& s, NetKeys keys, double now);
+
+// Receives and sends without advancing (e.g. while the match is paused
+// locally or over).
+void netService(NetSession& s, double now);
+
+// State at the end of the confirmed inputs: what s.log replays to.
+const MatchState& netConfirmedState(const NetSession& s);
+
+// True once the match is over in the confirmed state.
+bool netConfirmedOver(const NetSession& s);
+
+// Tells the peer we're leaving (best effort).
+void netLeave(NetSession& s, double now);
+
+#endif
@@ -0,0 +1,215 @@
+// Asset packer: builds the archive the game maps at startup (asset_pack.h).
+//
+//   pack_assets [--root DIR] [--out FILE] [SUBDIR...]
+//
+// Packs every file under the SUBDIRs of --root (default: assets/audio and
+// assets/icons; screenshots and videos are for the README, not the game),
+// named by their path below the root with '/' separators. Hidden files
+// (.gitkeep) are skipped. The archive is read back through the game's own
+// loader and compared byte for byte before the tool reports success.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "asset_pack.h"
+
+struct PackOptions {
+    std::string              root;
+    std::string              out;
+    std::vector<std::string> subdirs;
+};
+
+static void printUsage() {
+    std::printf("usage: pack_assets [--root DIR] [--out FILE] [SUBDIR...]\n");
+}
+
+static bool parseOptions(int argc, char** argv, PackOptions& o) {
+    o.root = "assets";
+    o.out  = "assets.pak";
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (a[0] != '-') {
+            o.subdirs.push_back(a);
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+
+        if      (!std::strcmp(a, "--root")) o.root = v;
+        else if (!std::strcmp(a, "--out"))  o.out  = v;
+        else return false;
+    }
+    if (o.subdirs.empty()) {
+        o.subdirs.push_back("audio");
+        o.subdirs.push_back("icons");
+    }
+    return true;
+}
+
+// ===================== FILES =====================
+
+struct PackItem {
+    std::string          name;       // below the root, '/' separated
+    std::vector<uint8_t> bytes;
+};
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& out) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    uint8_t chunk[65536];
+    size_t  n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), f)) > 0) out.insert(out.end(), chunk, chunk + n);
+    std::fclose(f);
+    return true;
+}
+
+// Adds the files under root/name, recursively.
+static bool collect(const std::string& root, const std::string& name, std::vector<PackItem>& items) {
+    std::string dir = root + "/" + name;
+    std::vector<std::string> children;
+    std::vector<bool>        isDir;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE h = FindFirstFileA((dir + "/*").c_str(), &found);
+    if (h == INVALID_HANDLE_VALUE) return false;
+    do {
+        children.push_back(found.cFileName);
+        isDir.push_back((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+    } while (FindNextFileA(h, &found));
+    FindClose(h);
+#else
+    DIR* d = opendir(dir.c_str());
+    if (!d) return false;
+    while (dirent* e = readdir(d)) {
+        struct stat st;
+        if (stat((dir + "/" + e->d_name).c_str(), &st) != 0) continue;
+        children.push_back(e->d_name);
+        isDir.push_back(S_ISDIR(st.st_mode));
+    }
+    closedir(d);
+#endif
+
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (children[i][0] == '.') continue;           // ., .., .gitkeep
+        std::string child = name + "/" + children[i];
+        if (isDir[i]) {
+            if (!collect(root, child, items)) return false;
+            continue;
+        }
+        PackItem item;
+        item.name = child;
+        if (!readFile(root + "/" + child, item.bytes)) {
+            std::fprintf(stderr, "could not read %s/%s\n", root.c_str(), child.c_str());
+            return false;
+        }
+        items.push_back(item);
+    }
+    return true;
+}
+
+static bool byName(const PackItem& a, const PackItem& b) {
+    return a.name < b.name;
+}
+
+// ===================== ARCHIVE =====================
+
+static void put32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+static void put16(std::vector<uint8_t>& out, unsigned v) {
+    out.push_back((uint8_t)(v & 0xFF));
+    out.push_back((uint8_t)(v >> 8));
+}
+
+static size_t alignUp(size_t v) {
+    return (v + assetPackAlign - 1) / assetPackAlign * assetPackAlign;
+}
+
+static bool writeArchive(const std::string& path, const std::vector<PackItem>& items) {
+    size_t indexBytes = 0;
+    for (size_t i = 0; i < items.size(); ++i) indexBytes += 10 + items[i].name.size();
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), "PRPK", "PRPK" + 4);
+    put32(out, assetPackVersion);
+    put32(out, (uint32_t)items.size());
+    put32(out, (uint32_t)indexBytes);
+
+    size_t offset = alignUp(16 + indexBytes);
+    for (size_t i = 0; i < items.size(); ++i) {
+        put32(out, (uint32_t)offset);
+        put32(out, (uint32_t)items[i].bytes.size());
+        put16(out, (unsigned)items[i].name.size());
+        out.insert(out.end(), items[i].name.begin(), items[i].name.end());
+        offset = alignUp(offset + items[i].bytes.size());
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+        out.resize(alignUp(out.size()), 0);
+        out.insert(out.end(), items[i].bytes.begin(), items[i].bytes.end());
+    }
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(&out[0], 1, out.size(), f) == out.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+// Reads every item back through the game's loader.
+static bool verifyArchive(const std::string& path, const std::vector<PackItem>& items) {
+    if (!assetsOpen(path.c_str(), "")) return false;
+    bool ok = assetsStats().items == (int)items.size();
+    for (size_t i = 0; i < items.size() && ok; ++i) {
+        AssetData a;
+        ok = assetGet(items[i].name.c_str(), a) && a.size == items[i].bytes.size() &&
+             (a.size == 0 || std::memcmp(a.data, &items[i].bytes[0], a.size) == 0);
+    }
+    assetsClose();
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    PackOptions o;
+    if (!parseOptions(argc, argv, o)) {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<PackItem> items;
+    for (size_t i = 0; i < o.subdirs.size(); ++i) {
+        if (!collect(o.root, o.subdirs[i], items)) {
+            std::fprintf(stderr, "could not read %s/%s\n", o.root.c_str(), o.subdirs[i].c_str());
+            return 1;
+        }
+    }
+    std::sort(items.begin(), items.end(), byName);
+
+    size_t total = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        std::printf("  %-40s %10u bytes\n", items[i].name.c_str(), (unsigned)items[i].bytes.size());
+        total += items[i].bytes.size();
+    }
+
+    if (!writeArchive(o.out, items)) {
+        std::fprintf(stderr, "could not write %s\n", o.out.c_str());
+        return 1;
+    }
+    if (!verifyArchive(o.out, items)) {
+        std::fprintf(stderr, "%s does not read back correctly\n", o.out.c_str());
+        return 1;
+    }
+    std::printf("%s: %d items, %u bytes of data\n", o.out.c_str(), (int)items.size(), (unsigned)total);
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "particles.h"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PARTICLES_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "batch_renderer.h"
+#include "match_engine.h"   // MatchRng
+
+static const float dragPerSecond = 3.0f;    // speed falls to 1/e in 1/3 s
+
+// ===================== POOL =====================
+//
+// Capacity is a multiple of 4, so the vector update can run over the last
+// group of 4 even when it is only partly live.
+
+alignas(16) static float x[particleCapacity],  y[particleCapacity];
+alignas(16) static float vx[particleCapacity], vy[particleCapacity];
+alignas(16) static float life[particleCapacity];
+alignas(16) static float invLife[particleCapacity];   // 1 / starting life
+alignas(16) static float size[particleCapacity];
+alignas(16) static float drawSize[particleCapacity];  // shrinks as it fades
+alignas(16) static float fade[particleCapacity];      // life left, 1..0
+static float             alpha[particleCapacity];     // starting alpha
+static unsigned char     rgba[particleCapacity * 4];
+
+static int           live = 0;
+static int           budgetLeft = particleFrameBudget;
+static ParticleStats stats = { 0, 0, 0, 0 };
+static MatchRng      rng;
+static bool          rngReady = false;
+
+static void moveParticle(int to, int from) {
+    x[to]    = x[from];    y[to]    = y[from];
+    vx[to]   = vx[from];   vy[to]   = vy[from];
+    life[to] = life[from]; invLife[to] = invLife[from];
+    size[to] = size[from]; alpha[to]   = alpha[from];
+    for (int k = 0; k < 4; ++k) rgba[to * 4 + k] = rgba[from * 4 + k];
+}
+
+// ===================== SPAWN =====================
+
+int particlesSpawn(const ParticleBurst& b) {
+    if (!rngReady) {
+        rngSeed(rng, 0x5EED);
+        rngReady = true;
+    }
+
+    int n = b.count;
+    if (n > budgetLeft)              n = budgetLeft;
+    if (n > particleCapacity - live) n = particleCapacity - live;
+    if (n < 0)                       n = 0;
+    stats.culled           += b.count - n;
+    stats.spawned          += n;
+    stats.spawnedThisFrame += n;
+    budgetLeft             -= n;
+
+    for (int k = 0; k < n; ++k) {
+        int   i     = live++;
+        float dir   = b.angle + (rngFloat(rng) - 0.5f) * b.spread;
+        float speed = b.minSpeed + (b.maxSpeed - b.minSpeed) * rngFloat(rng);
+        float t     = b.life * (0.6f + 0.4f * rngFloat(rng));
+
+        x[i]  = b.x;                 y[i]  = b.y;
+        vx[i] = std::cos(dir) * speed;
+        vy[i] = std::sin(dir) * speed;
+        life[i]    = t;
+        invLife[i] = 1.0f / t;
+        size[i]    = b.size;
+        alpha[i]   = b.a;
+        rgba[i * 4 + 0] = (unsigned char)(b.r * 255.0f + 0.5f);
+        rgba[i * 4 + 1] = (unsigned char)(b.g * 255.0f + 0.5f);
+        rgba[i * 4 + 2] = (unsigned char)(b.b * 255.0f + 0.5f);
+    }
+    return n;
+}
+
+// ===================== UPDATE =====================
+
+// Integrate, drag, age and the draw size for [0, n), n a multiple of 4
+static void integrate(int n, float dt) {
+    float drag = std::exp(-dragPerSecond * dt);
+#ifdef PARTICLES_HAVE_SSE2
+    __m128 vdt   = _mm_set1_ps(dt);
+    __m128 vdrag = _mm_set1_ps(drag);
+    __m128 half  = _mm_set1_ps(0.5f);
+    __m128 zero  = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 4) {
+        __m128 px = _mm_load_ps(x + i),  py = _mm_load_ps(y + i);
+        __m128 sx = _mm_mul_ps(_mm_load_ps(vx + i), vdrag);
+        __m128 sy = _mm_mul_ps(_mm_load_ps(vy + i), vdrag);
+        _mm_store_ps(vx + i, sx);
+        _mm_store_ps(vy + i, sy);
+        _mm_store_ps(x + i, _mm_add_ps(px, _mm_mul_ps(sx, vdt)));
+        _mm_store_ps(y + i, _mm_add_ps(py, _mm_mul_ps(sy, vdt)));
+
+        __m128 t = _mm_sub_ps(_mm_load_ps(life + i), vdt);
+        _mm_store_ps(life + i, t);
+        __m128 f = _mm_max_ps(_mm_mul_ps(t, _mm_load_ps(invLife + i)), zero);
+        _mm_store_ps(fade + i, f);
+        _mm_store_ps(drawSize + i, _mm_mul_ps(_mm_load_ps(size + i), _mm_add_ps(half, _mm_mul_ps(half, f))));
+    }
+#else
+    for (int i = 0; i < n; ++i) {
+        vx[i] *= drag;
+        vy[i] *= drag;
+        x[i]  += vx[i] * dt;
+        y[i]  += vy[i] * dt;
+        life[i] -= dt;
+        float f = life[i] * invLife[i];
+        fade[i]     = f > 0.0f ? f : 0.0f;
+        drawSize[i] = size[i] * (0.5f + 0.5f * fade[i]);
+    }
+#endif
+}
+
+void particlesUpdate(float dt) {
+    budgetLeft             = particleFrameBudget;
+    stats.spawnedThisFrame = 0;
+    if (live == 0) return;
+
+    integrate((live + 3) & ~3, dt);
+
+    // Drop the dead (the last live one takes the slot), fade the rest
+    for (int i = 0; i < live; ) {
+        if (life[i] <= 0.0f) {
+            moveParticle(i, --live);
+            fade[i]     = fade[live];
+            drawSize[i] = drawSize[live];
+            continue;
+        }
+        rgba[i * 4 + 3] = (unsigned char)(alpha[i] * fade[i] * 255.0f + 0.5f);
+        ++i;
+    }
+}
+
+void particlesDraw() {
+    if (live == 0) return;
+    batchSetBlend(true);
+    batchSetTexture(batchDiscTexture());
+    batchSprites(x, y, drawSize, rgba, live);
+    batchSetTexture(0);
+    batchSetBlend(false);
+}
+
+void particlesClear() {
+    live = 0;
+}
+
+ParticleStats particlesStats() {
+    ParticleStats s = stats;
+    s.live = live;
+    return s;
+}
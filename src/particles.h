@@ -0,0 +1,56 @@
+#ifndef PADDLE_RIVALS_PARTICLES_H
+#define PADDLE_RIVALS_PARTICLES_H
+
+// Particles for hit sparks, goal bursts and ball trails.
+//
+// A fixed pool of particleCapacity slots, one array per field, allocated
+// once at startup. Live particles are packed at the front; one that dies
+// is replaced by the last live one. The update runs 4 particles at a time
+// (SSE2) and the whole pool is drawn as one batch.
+//
+// Effects can't cost more than the budget: at most particleFrameBudget
+// particles are spawned between two frames, and never more than fit in
+// the pool. What doesn't fit is dropped and counted as culled.
+//
+// Positions and sizes are in whatever units the caller draws with (the
+// game uses arena units). Visual only: nothing here feeds back into the
+// match.
+
+#include <cstdint>
+
+const int particleCapacity    = 8192;
+const int particleFrameBudget = 512;
+
+struct ParticleBurst {
+    float x, y;
+    float angle, spread;          // radians: directions within angle +- spread/2
+    float minSpeed, maxSpeed;     // units per second
+    float life;                   // seconds; each particle gets 60..100% of it
+    float size;                   // radius
+    float r, g, b, a;
+    int   count;
+};
+
+// Returns how many were spawned (the rest were culled).
+int  particlesSpawn(const ParticleBurst& b);
+
+// Moves and fades everything by dt and opens the next frame's budget.
+// Call once per drawn frame.
+void particlesUpdate(float dt);
+
+// Queues every live particle in the batch (one draw call). Leaves the
+// batch texture and blend mode off.
+void particlesDraw();
+
+void particlesClear();
+
+struct ParticleStats {
+    int      live;
+    int      spawnedThisFrame;
+    uint64_t spawned;             // since startup
+    uint64_t culled;              // over budget or pool full
+};
+
+ParticleStats particlesStats();
+
+#endif
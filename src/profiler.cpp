@@ -0,0 +1,114 @@
+#include "profiler.h"
+
+#include <algorithm>   // nth_element
+#include <chrono>
+#include <cstdio>
+
+// ===================== RING BUFFER =====================
+
+static FrameSample ring[profilerRingSize];
+static int         ringHead  = 0;      // next slot to write
+static int         ringCount = 0;
+
+static FrameSample current;            // being accumulated
+static double      lastFrameEndUs = 0.0;
+
+static const char* phaseNames[PHASE_COUNT] = {
+    "input",
+    "simulation",
+    "drawMainMenu",
+    "drawModeSelectMenu",
+    "drawDifficultySelect",
+    "drawNameInputScreen",
+    "drawAvatarSelectScreen",
+    "drawHowToPlay",
+    "drawSettings",
+    "drawGame",
+    "drawPaused",
+    "drawGameOver",
+    "drawMenuBackground",
+    "drawGameBackground",
+    "drawSpinningCube",
+    "particles",
+    "upscale",
+    "overlay",
+    "textFlush",
+    "batchFlush",
+    "glutSwapBuffers"
+};
+
+double profilerNowUs() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+void profilerAdd(ProfilePhase phase, double us) {
+    current.phaseUs[phase] += (float)us;
+}
+
+void profilerEndFrame() {
+    double now = profilerNowUs();
+    current.frameMs = lastFrameEndUs > 0.0 ? (float)((now - lastFrameEndUs) / 1000.0) : 0.0f;
+    lastFrameEndUs = now;
+
+    ring[ringHead] = current;
+    ringHead = (ringHead + 1) % profilerRingSize;
+    if (ringCount < profilerRingSize) ringCount++;
+
+    for (int i = 0; i < PHASE_COUNT; ++i) current.phaseUs[i] = 0.0f;
+}
+
+const char* profilerPhaseName(ProfilePhase phase) {
+    return phaseNames[phase];
+}
+
+int profilerSamples(FrameSample* out, int max) {
+    int n = ringCount < max ? ringCount : max;
+    int first = (ringHead - n + profilerRingSize) % profilerRingSize;
+    for (int i = 0; i < n; ++i) out[i] = ring[(first + i) % profilerRingSize];
+    return n;
+}
+
+// ===================== STATS =====================
+
+void profilerPercentiles(int phase, float& p50, float& p99) {
+    static float values[profilerRingSize];
+
+    int n = 0;
+    for (int i = 0; i < ringCount; ++i) {
+        values[n++] = (phase == PHASE_COUNT) ? ring[i].frameMs : ring[i].phaseUs[phase];
+    }
+    if (n == 0) {
+        p50 = p99 = 0.0f;
+        return;
+    }
+
+    int i50 = n / 2;
+    int i99 = (n * 99) / 100;
+    if (i99 >= n) i99 = n - 1;
+
+    std::nth_element(values, values + i50, values + n);
+    p50 = values[i50];
+    std::nth_element(values, values + i99, values + n);
+    p99 = values[i99];
+}
+
+bool profilerWriteCsv(const char* path) {
+    FILE* f = std::fopen(path, "w");
+    if (!f) return false;
+
+    std::fprintf(f, "frame,frame_ms");
+    for (int p = 0; p < PHASE_COUNT; ++p) std::fprintf(f, ",%s_us", phaseNames[p]);
+    std::fprintf(f, "\n");
+
+    int first = (ringHead - ringCount + profilerRingSize) % profilerRingSize;
+    for (int i = 0; i < ringCount; ++i) {
+        const FrameSample& s = ring[(first + i) % profilerRingSize];
+        std::fprintf(f, "%d,%.3f", i, s.frameMs);
+        for (int p = 0; p < PHASE_COUNT; ++p) std::fprintf(f, ",%.1f", s.phaseUs[p]);
+        std::fprintf(f, "\n");
+    }
+
+    std::fclose(f);
+    return true;
+}
@@ -0,0 +1,76 @@
+#ifndef PADDLE_RIVALS_PROFILER_H
+#define PADDLE_RIVALS_PROFILER_H
+
+// Frame-phase profiler.
+//
+// Code wraps each phase of the loop in PROFILE_SCOPE(phase). Time spent
+// per phase is summed until profilerEndFrame(), which stores one sample
+// per frame in a fixed-size ring buffer (no allocation while running).
+// The overlay / CSV export read from that ring.
+
+enum ProfilePhase {
+    PHASE_INPUT,
+    PHASE_SIMULATION,
+
+    PHASE_DRAW_MAIN_MENU,
+    PHASE_DRAW_MODE_SELECT,
+    PHASE_DRAW_DIFFICULTY,
+    PHASE_DRAW_NAME_INPUT,
+    PHASE_DRAW_AVATAR_SELECT,
+    PHASE_DRAW_HOW_TO_PLAY,
+    PHASE_DRAW_SETTINGS,
+    PHASE_DRAW_GAME,
+    PHASE_DRAW_PAUSED,
+    PHASE_DRAW_GAME_OVER,
+
+    // nested inside the screens above
+    PHASE_DRAW_MENU_BACKGROUND,
+    PHASE_DRAW_GAME_BACKGROUND,
+    PHASE_DRAW_CUBE,
+    PHASE_PARTICLES,
+
+    PHASE_UPSCALE,
+    PHASE_DRAW_OVERLAY,
+    PHASE_TEXT_FLUSH,
+    PHASE_BATCH_FLUSH,
+    PHASE_SWAP,
+
+    PHASE_COUNT
+};
+
+const int profilerRingSize = 600;   // frames kept (10 s at 60 FPS)
+
+struct FrameSample {
+    float frameMs;                  // time since the previous frame ended
+    float phaseUs[PHASE_COUNT];
+};
+
+// High-resolution monotonic time in microseconds.
+double profilerNowUs();
+
+void profilerAdd(ProfilePhase phase, double us);
+void profilerEndFrame();
+
+const char* profilerPhaseName(ProfilePhase phase);
+
+// Copies up to `max` most recent samples, oldest first. Returns the count.
+int profilerSamples(FrameSample* out, int max);
+
+// p50 / p99 over the ring for one phase (PHASE_COUNT = frame time, in ms
+// for frames and us for phases).
+void profilerPercentiles(int phase, float& p50, float& p99);
+
+// Writes the ring as CSV. Returns false if the file can't be opened.
+bool profilerWriteCsv(const char* path);
+
+struct ProfileScope {
+    ProfilePhase phase;
+    double       start;
+
+    explicit ProfileScope(ProfilePhase p) : phase(p), start(profilerNowUs()) {}
+    ~ProfileScope() { profilerAdd(phase, profilerNowUs() - start); }
+};
+
+#define PROFILE_SCOPE(phase) ProfileScope profileScope(phase)
+
+#endif
@@ -0,0 +1,232 @@
+#include "render_scale.h"
+
+#include "gl_ext.h"
+#include "batch_renderer.h"
+
+#include <GL/glu.h>
+#include <cmath>
+
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+
+// ===================== TARGET =====================
+
+struct RenderTarget {
+    GLuint texture;
+    GLuint depth;
+    GLuint fbo;
+    int    width, height;      // render size
+    int    texW, texH;         // allocated texture size (pow2 if needed)
+    bool   failed;             // FBO incomplete: don't try again
+};
+
+static RenderTarget target;
+static GLint        prevFbo = 0;
+static int          windowW = 0, windowH = 0;
+static bool         lastActive = false;
+
+static void releaseTarget() {
+    if (target.fbo)     glExt.deleteFramebuffers(1, &target.fbo);
+    if (target.depth)   glExt.deleteRenderbuffers(1, &target.depth);
+    if (target.texture) glDeleteTextures(1, &target.texture);
+    target.fbo     = 0;
+    target.depth   = 0;
+    target.texture = 0;
+    target.width   = 0;
+    target.height  = 0;
+}
+
+// (Re)allocates the target for a new render size
+static bool buildTarget(int w, int h) {
+    releaseTarget();
+
+    target.texW = glExt.hasNpotTextures ? w : glExtPow2(w);
+    target.texH = glExt.hasNpotTextures ? h : glExtPow2(h);
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, target.texW, target.texH, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // The menu cube is depth tested
+    glExt.genRenderbuffers(1, &target.depth);
+    glExt.bindRenderbuffer(GL_RENDERBUFFER, target.depth);
+    glExt.renderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, target.texW, target.texH);
+    glExt.bindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glExt.genFramebuffers(1, &target.fbo);
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glExt.framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    glExt.framebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+
+    bool ok = glExt.checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+    if (!ok) {
+        releaseTarget();
+        target.failed = true;
+        return false;
+    }
+
+    target.width  = w;
+    target.height = h;
+    return true;
+}
+
+bool renderScaleSupported() {
+    return glExt.hasRenderbuffers && !target.failed;
+}
+
+// ===================== FRAME =====================
+
+bool renderScaleBegin(int winW, int winH, float scale) {
+    windowW    = winW;
+    windowH    = winH;
+    lastActive = false;
+    if (scale >= 1.0f || !renderScaleSupported() || winW <= 0 || winH <= 0) return false;
+
+    int w = (int)(winW * scale + 0.5f);
+    int h = (int)(winH * scale + 0.5f);
+    if (w < 1) w = 1;
+    if (h < 1) h = 1;
+
+    batchFlush();
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+    if (w != target.width || h != target.height) {
+        if (!buildTarget(w, h)) return false;
+    }
+
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+    glViewport(0, 0, w, h);
+    lastActive = true;
+    return true;
+}
+
+// Whole multiples of the render size need no filtering: each render pixel
+// becomes a block, and nearest sampling is the cheaper copy
+static bool integerRatio() {
+    return windowW % target.width == 0 && windowH % target.height == 0 &&
+           windowW / target.width == windowH / target.height;
+}
+
+void renderScaleEnd() {
+    if (!lastActive) return;
+
+    batchFlush();
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+    glViewport(0, 0, windowW, windowH);
+
+    // One textured quad over the whole window, in plain pixel space. (A
+    // framebuffer blit was slower under llvmpipe.)
+    GLint filter = integerRatio() ? GL_NEAREST : GL_LINEAR;
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    gluOrtho2D(0, windowW, 0, windowH);
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+
+    float color[4], transform[4];
+    batchCurrentColor(color);
+    batchGetTransform(transform);
+
+    batchResetTransform();
+    batchSetBlend(false);
+    batchSetTexture(target.texture);
+    batchColor3f(1.0f, 1.0f, 1.0f);
+    batchTexturedQuad(0.0f, 0.0f, (float)windowW, (float)windowH,
+                      0.0f, 0.0f, (float)target.width / target.texW, (float)target.height / target.texH);
+    batchSetTexture(0);
+    batchFlush();
+
+    batchColor4f(color[0], color[1], color[2], color[3]);
+    batchSetTransform(transform[0], transform[1], transform[2], transform[3]);
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+}
+
+// ===================== AUTOMATIC MODE =====================
+//
+// In percent, so repeated steps don't drift. Below 100% the frame cost is
+// the scene, which goes with the pixel count (the scale squared), plus the
+// fixed cost of the copy: an overrun cuts the scale in one move to where
+// the frame should take headroomShare of the budget. Going back up is one
+// step at a time, and only while frames stay under raiseShare.
+//
+// A light scene can cost less than the copy, so scaling isn't always a
+// win. The last time measured at 100% is kept: a lower scale that isn't
+// clearly faster goes straight back to 100%, and if even the lowest one
+// isn't, 100% is kept for holdFrames before trying again.
+
+static const int    autoMinPercent  = 50;
+static const int    autoStepPercent = 5;
+static const double lowerShare      = 0.90;   // of the budget
+static const double headroomShare   = 0.75;
+static const double raiseShare      = 0.60;
+static const double payoffShare     = 0.95;   // of the time at 100%
+static const int    settleFrames    = 20;     // after a change, before judging it
+static const int    raiseFrames     = 90;     // in a row under raiseShare
+static const int    holdFrames      = 600;
+
+static int    autoPercent = 100;
+static double autoAvgMs   = 0.0;
+static int    autoFrames  = 0;      // since the last change
+static int    autoCalm    = 0;
+static double nativeMs    = 0.0;    // average at 100%, 0 = not measured
+static int    autoHold    = 0;
+
+static void autoSet(int percent) {
+    autoPercent = percent;
+    autoFrames  = 0;
+    autoCalm    = 0;
+}
+
+float renderScaleAuto(double frameMs, double budgetMs) {
+    autoAvgMs = (autoFrames == 0) ? frameMs : autoAvgMs + (frameMs - autoAvgMs) * 0.1;
+    if (autoHold > 0) autoHold--;
+    if (++autoFrames < settleFrames || budgetMs <= 0.0) return autoPercent / 100.0f;
+
+    bool over = autoAvgMs > budgetMs * lowerShare;
+    if (autoPercent == 100) {
+        nativeMs = autoAvgMs;
+    } else if (nativeMs > 0.0 && autoAvgMs >= nativeMs * payoffShare &&
+               (!over || autoPercent == autoMinPercent)) {
+        // No faster than 100%: in budget there too, or nothing lower to try
+        if (over) autoHold = holdFrames;
+        autoSet(100);
+        return 1.0f;
+    }
+
+    if (over && autoPercent > autoMinPercent && autoHold == 0) {
+        double fit = autoPercent * std::sqrt(budgetMs * headroomShare / autoAvgMs);
+        int    p   = (int)(fit / autoStepPercent) * autoStepPercent;
+        if (p > autoPercent - autoStepPercent) p = autoPercent - autoStepPercent;
+        if (p < autoMinPercent)                p = autoMinPercent;
+        autoSet(p);
+    } else if (!over && autoAvgMs < budgetMs * raiseShare && autoPercent < 100) {
+        if (++autoCalm >= raiseFrames) autoSet(autoPercent + autoStepPercent);
+    } else {
+        autoCalm = 0;
+    }
+    return autoPercent / 100.0f;
+}
+
+RenderScaleStats renderScaleStats() {
+    RenderScaleStats s;
+    s.active    = lastActive;
+    s.width     = lastActive ? target.width  : windowW;
+    s.height    = lastActive ? target.height : windowH;
+    s.autoScale = autoPercent / 100.0f;
+    return s;
+}
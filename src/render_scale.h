@@ -0,0 +1,44 @@
+#ifndef PADDLE_RIVALS_RENDER_SCALE_H
+#define PADDLE_RIVALS_RENDER_SCALE_H
+
+// Internal render resolution.
+//
+// Below 100% a frame's scene is drawn into an offscreen target of the
+// window size times the scale, then stretched over the window as one
+// textured quad: bilinear, or nearest when the window is a whole multiple
+// of the target (50% of an even window size). The projection stays in
+// window pixels and only the viewport shrinks, so nothing that draws (nor
+// the arena -> window mapping) depends on the render size. Text queued for
+// textFlush() and whatever is drawn after renderScaleEnd() lands at full
+// resolution.
+//
+// The copy costs about one full-window textured quad, so scaling pays off
+// when the scene draws more than that. The automatic mode picks the scale
+// from measured frame times: lower when frames take longer than the
+// display allows, one step back up after a stretch of frames with time to
+// spare, and 100% whenever scaling turns out no faster.
+
+// Sends the frame's drawing to the offscreen target. Returns false when it
+// draws straight to the window instead: scale >= 1, or no FBO support.
+bool renderScaleBegin(int winW, int winH, float scale);
+
+// Stretches the target over the window (after a true renderScaleBegin());
+// later draws go to the window.
+void renderScaleEnd();
+
+// FBOs with a depth buffer are available.
+bool renderScaleSupported();
+
+// Automatic mode: feed one frame's render time against the frame budget
+// (both ms); returns the scale to use from the next frame on.
+float renderScaleAuto(double frameMs, double budgetMs);
+
+struct RenderScaleStats {
+    bool  active;          // last frame went through the offscreen target
+    int   width, height;   // size it was drawn at
+    float autoScale;       // current pick of the automatic mode
+};
+
+RenderScaleStats renderScaleStats();
+
+#endif
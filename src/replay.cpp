@@ -0,0 +1,354 @@
+#include "replay.h"
+
+#include <algorithm>  // lower_bound
+#include <cstdio>
+#include <cstring>   // memcpy
+
+// ===================== FILE FORMAT =====================
+//
+// Little-endian, version 3 (version 1 files were played against the old
+// ball-chasing AI and can't be reproduced any more; version 2 is version 3
+// without sub-ticks and still loads):
+//
+//   "PRRP" u16 version u8 flags(bit0 = single player)
+//   u8 gameTimeIndex u8 maxScoreIndex u8 difficultyIndex u16 tickRate
+//   u64 seed
+//   f32 gameTime i32 maxScore f32 p1Speed f32 p2Speed
+//   u32 tickCount u16 finalScoreP1 u16 finalScoreP2 u64 finalHash
+//   u32 rleSize, then rleSize bytes of (u8 bits, varint runLength) pairs
+//   u32 subTickCount, then per sub-tick: varint ticks since the previous
+//   one (the first: since 0), u8 held[8]
+
+static const char     replayMagic[4] = { 'P', 'R', 'R', 'P' };
+static const uint16_t replayVersion  = 3;
+
+// ===================== RECORD / PLAYBACK =====================
+
+void replayStart(const Replay& r, MatchState& m, AiState& ai) {
+    matchInit(m, r.config, r.seed);
+    aiInit(ai, 1, r.difficultyIndex, r.seed);
+}
+
+void replayBegin(Replay& r, MatchState& m, AiState& ai) {
+    r.inputs.clear();
+    r.subTicks.clear();
+    r.finalScoreP1 = 0;
+    r.finalScoreP2 = 0;
+    r.finalHash    = 0;
+    replayStart(r, m, ai);
+}
+
+// plus/minus are bit numbers
+static float axis(uint8_t bits, const uint8_t* held, int plus, int minus) {
+    float v = 0.0f;
+    if (held) {
+        v += (float)held[plus]  / (float)replaySubSteps;
+        v -= (float)held[minus] / (float)replaySubSteps;
+        return v;
+    }
+    if (bits & (1 << plus))  v += 1.0f;
+    if (bits & (1 << minus)) v -= 1.0f;
+    return v;
+}
+
+void replayTickInputs(const Replay& r, const MatchState& m, AiState& ai, uint8_t bits,
+                      const uint8_t* held, PaddleInput& in1, PaddleInput& in2) {
+    float dt = 1.0f / (float)r.tickRate;
+
+    in1.moveX = axis(bits, held, 3, 2);    // REPLAY_P1_RIGHT, REPLAY_P1_LEFT
+    in1.moveY = axis(bits, held, 0, 1);    // REPLAY_P1_UP,    REPLAY_P1_DOWN
+
+    if (r.singlePlayer && r.difficultyIndex != expertDifficulty) {
+        in2 = aiUpdate(ai, m, dt);
+    } else {
+        in2.moveX = axis(bits, held, 7, 6);
+        in2.moveY = axis(bits, held, 4, 5);
+    }
+}
+
+uint8_t replayEncodeP2(const PaddleInput& in) {
+    uint8_t bits = 0;
+    if (in.moveY > 0.0f) bits |= REPLAY_P2_UP;
+    if (in.moveY < 0.0f) bits |= REPLAY_P2_DOWN;
+    if (in.moveX < 0.0f) bits |= REPLAY_P2_LEFT;
+    if (in.moveX > 0.0f) bits |= REPLAY_P2_RIGHT;
+    return bits;
+}
+
+static bool subTickBefore(const ReplaySubTick& s, uint32_t tick) {
+    return s.tick < tick;
+}
+
+// The sub-tick of m.tick, or 0
+static const uint8_t* heldAt(const Replay& r, uint32_t tick) {
+    std::vector<ReplaySubTick>::const_iterator it =
+        std::lower_bound(r.subTicks.begin(), r.subTicks.end(), tick, subTickBefore);
+    return it != r.subTicks.end() && it->tick == tick ? it->held : 0;
+}
+
+static void stepTick(const Replay& r, MatchState& m, AiState& ai, uint8_t bits, const uint8_t* held) {
+    PaddleInput in1, in2;
+    replayTickInputs(r, m, ai, bits, held, in1, in2);
+    matchStep(m, in1, in2, 1.0f / (float)r.tickRate);
+}
+
+void replayRecordTick(Replay& r, MatchState& m, AiState& ai, uint8_t bits) {
+    stepTick(r, m, ai, bits, 0);
+    r.inputs.push_back(bits);
+}
+
+void replayRecordSubTick(Replay& r, MatchState& m, AiState& ai, uint8_t bits, const uint8_t* held) {
+    ReplaySubTick s;
+    s.tick = (uint32_t)r.inputs.size();
+    std::memcpy(s.held, held, sizeof(s.held));
+    r.subTicks.push_back(s);
+
+    stepTick(r, m, ai, bits, s.held);
+    r.inputs.push_back(bits);
+}
+
+void replayFinish(Replay& r, const MatchState& m) {
+    r.finalScoreP1 = m.scoreP1;
+    r.finalScoreP2 = m.scoreP2;
+    r.finalHash    = replayStateHash(m);
+}
+
+bool replaySeek(const Replay& r, MatchState& m, AiState& ai, uint32_t untilTick) {
+    while (m.tick < untilTick) {
+        if (m.tick >= r.inputs.size() || m.over) return false;
+        stepTick(r, m, ai, r.inputs[m.tick], heldAt(r, m.tick));
+    }
+    return true;
+}
+
+bool replayVerify(const Replay& r, MatchState& out) {
+    AiState ai;
+    replayStart(r, out, ai);
+    replaySeek(r, out, ai, (uint32_t)r.inputs.size());
+
+    return out.tick == r.inputs.size()
+        && out.scoreP1 == r.finalScoreP1
+        && out.scoreP2 == r.finalScoreP2
+        && replayStateHash(out) == r.finalHash;
+}
+
+// ===================== HASH =====================
+
+struct Fnv {
+    uint64_t h;
+
+    Fnv() : h(0xcbf29ce484222325ull) {}
+
+    void bytes(const void* p, size_t n) {
+        const unsigned char* b = (const unsigned char*)p;
+        for (size_t i = 0; i < n; ++i) {
+            h ^= b[i];
+            h *= 0x100000001b3ull;
+        }
+    }
+    void f(float v)    { bytes(&v, sizeof v); }
+    void i(int32_t v)  { bytes(&v, sizeof v); }
+    void u(uint64_t v) { bytes(&v, sizeof v); }
+};
+
+static void hashPaddle(Fnv& h, const Paddle& p) {
+    h.f(p.x); h.f(p.y); h.f(p.width); h.f(p.height); h.f(p.speed);
+}
+
+// Field by field, so struct padding never enters the hash.
+uint64_t replayStateHash(const MatchState& m) {
+    Fnv h;
+    hashPaddle(h, m.p1);
+    hashPaddle(h, m.p2);
+    h.f(m.ball.x); h.f(m.ball.y); h.f(m.ball.radius); h.f(m.ball.vx); h.f(m.ball.vy);
+    h.f(m.prevBallX); h.f(m.prevBallY);
+    h.i(m.scoreP1); h.i(m.scoreP2);
+    h.f(m.timeLeft);
+    h.i(m.maxScore);
+    h.f(m.speedFactor);
+    h.i(m.hitsInRally); h.i(m.lastRallyHits);
+    h.u(m.tick);
+    h.i(m.over ? 1 : 0);
+    h.u(m.rng.state);
+    return h.h;
+}
+
+// ===================== SERIALIZATION =====================
+
+static void putU8(std::vector<uint8_t>& out, unsigned v) {
+    out.push_back((uint8_t)v);
+}
+
+static void putU16(std::vector<uint8_t>& out, unsigned v) {
+    putU8(out, v & 0xFF);
+    putU8(out, (v >> 8) & 0xFF);
+}
+
+static void putU32(std::vector<uint8_t>& out, uint32_t v) {
+    putU16(out, v & 0xFFFF);
+    putU16(out, v >> 16);
+}
+
+static void putU64(std::vector<uint8_t>& out, uint64_t v) {
+    putU32(out, (uint32_t)v);
+    putU32(out, (uint32_t)(v >> 32));
+}
+
+static void putF32(std::vector<uint8_t>& out, float f) {
+    uint32_t v;
+    std::memcpy(&v, &f, 4);
+    putU32(out, v);
+}
+
+static void putVarint(std::vector<uint8_t>& out, uint32_t v) {
+    while (v >= 0x80) {
+        putU8(out, (v & 0x7F) | 0x80);
+        v >>= 7;
+    }
+    putU8(out, v);
+}
+
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+
+    bool has(size_t n) {
+        if ((size_t)(end - p) < n) ok = false;
+        return ok;
+    }
+    unsigned u8() {
+        if (!has(1)) return 0;
+        return *p++;
+    }
+    unsigned u16() { unsigned lo = u8(); return lo | (u8() << 8); }
+    uint32_t u32() { uint32_t lo = u16(); return lo | ((uint32_t)u16() << 16); }
+    uint64_t u64() { uint64_t lo = u32(); return lo | ((uint64_t)u32() << 32); }
+    float f32() {
+        uint32_t v = u32();
+        float f;
+        std::memcpy(&f, &v, 4);
+        return f;
+    }
+    uint32_t varint() {
+        uint32_t v = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            unsigned b = u8();
+            v |= (uint32_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+bool replaySave(const Replay& r, const char* path) {
+    std::vector<uint8_t> rle;
+    for (size_t i = 0; i < r.inputs.size(); ) {
+        size_t run = 1;
+        while (i + run < r.inputs.size() && r.inputs[i + run] == r.inputs[i]) run++;
+        putU8(rle, r.inputs[i]);
+        putVarint(rle, (uint32_t)run);
+        i += run;
+    }
+
+    std::vector<uint8_t> out;
+    out.insert(out.end(), replayMagic, replayMagic + 4);
+    putU16(out, replayVersion);
+    putU8(out, r.singlePlayer ? 1 : 0);
+    putU8(out, r.gameTimeIndex);
+    putU8(out, r.maxScoreIndex);
+    putU8(out, r.difficultyIndex);
+    putU16(out, r.tickRate);
+    putU64(out, r.seed);
+    putF32(out, r.config.gameTime);
+    putU32(out, (uint32_t)r.config.maxScore);
+    putF32(out, r.config.p1Speed);
+    putF32(out, r.config.p2Speed);
+    putU32(out, (uint32_t)r.inputs.size());
+    putU16(out, r.finalScoreP1);
+    putU16(out, r.finalScoreP2);
+    putU64(out, r.finalHash);
+    putU32(out, (uint32_t)rle.size());
+    out.insert(out.end(), rle.begin(), rle.end());
+
+    putU32(out, (uint32_t)r.subTicks.size());
+    uint32_t lastTick = 0;
+    for (size_t i = 0; i < r.subTicks.size(); ++i) {
+        putVarint(out, r.subTicks[i].tick - lastTick);
+        lastTick = r.subTicks[i].tick;
+        out.insert(out.end(), r.subTicks[i].held, r.subTicks[i].held + 8);
+    }
+
+    FILE* f = std::fopen(path, "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(&out[0], 1, out.size(), f) == out.size();
+    return std::fclose(f) == 0 && ok;
+}
+
+bool replayLoad(Replay& r, const char* path) {
+    FILE* f = std::fopen(path, "rb");
+    if (!f) return false;
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof buf, f)) > 0) data.insert(data.end(), buf, buf + n);
+    std::fclose(f);
+
+    if (data.size() < 4 || std::memcmp(&data[0], replayMagic, 4) != 0) return false;
+
+    Reader in = { &data[0] + 4, &data[0] + data.size(), true };
+    unsigned version = in.u16();
+    if (version != replayVersion && version != 2) return false;
+
+    r.singlePlayer    = (in.u8() & 1) != 0;
+    r.gameTimeIndex   = in.u8();
+    r.maxScoreIndex   = in.u8();
+    r.difficultyIndex = in.u8();
+    r.tickRate        = in.u16();
+    r.seed            = in.u64();
+    r.config.gameTime = in.f32();
+    r.config.maxScore = (int)in.u32();
+    r.config.p1Speed  = in.f32();
+    r.config.p2Speed  = in.f32();
+
+    uint32_t ticks  = in.u32();
+    r.finalScoreP1  = in.u16();
+    r.finalScoreP2  = in.u16();
+    r.finalHash     = in.u64();
+    uint32_t rleSize = in.u32();
+    if (!in.ok || r.tickRate <= 0 || !in.has(rleSize)) return false;
+
+    const uint8_t* fileEnd = in.end;
+    in.end = in.p + rleSize;
+    r.inputs.clear();
+    r.inputs.reserve(ticks);
+    while (in.ok && in.p < in.end) {
+        uint8_t  bits = (uint8_t)in.u8();
+        uint32_t run  = in.varint();
+        if (!in.ok || run > ticks - r.inputs.size()) return false;
+        r.inputs.insert(r.inputs.end(), run, bits);
+    }
+    if (!in.ok || r.inputs.size() != ticks) return false;
+
+    r.subTicks.clear();
+    if (version == 2) return true;
+
+    in.end = fileEnd;
+    uint32_t count = in.u32();
+    uint32_t tick  = 0;
+    for (uint32_t i = 0; i < count && in.ok; ++i) {
+        ReplaySubTick s;
+        uint32_t delta = in.varint();
+        if ((i > 0 && delta == 0) || delta >= ticks - tick) return false;   // sorted, inside the log
+        tick  += delta;
+        s.tick = tick;
+        for (int k = 0; k < 8; ++k) {
+            s.held[k] = (uint8_t)in.u8();
+            if (s.held[k] > replaySubSteps) return false;
+        }
+        r.subTicks.push_back(s);
+    }
+    return in.ok;
+}
@@ -0,0 +1,104 @@
+#ifndef PADDLE_RIVALS_REPLAY_H
+#define PADDLE_RIVALS_REPLAY_H
+
+// Match recording and deterministic playback.
+//
+// A replay is the match seed, the settings the match was started with and
+// one input byte per simulation tick (the keys held, as REPLAY_* bits).
+// Keys pressed or released between two ticks also record how much of that
+// tick they were held (ReplaySubTick), so a tap shorter than a tick still
+// moves the paddle by what it was worth.
+// The AI side is not recorded: its state is seeded from the match seed and
+// it is recomputed every tick, so playback goes through exactly the same
+// code as the live game. The Expert AI is the exception: its threaded
+// search isn't reproducible, so its moves are recorded as P2 key bits.
+//
+// On disk the input bytes are run-length encoded (held keys repeat for
+// hundreds of ticks), so a 90 s match at 120 Hz takes a few KB.
+
+#include <cstdint>
+#include <vector>
+
+#include "ai.h"
+#include "match_engine.h"
+
+// Keys held during one tick.
+enum ReplayInputBits {
+    REPLAY_P1_UP    = 1 << 0,
+    REPLAY_P1_DOWN  = 1 << 1,
+    REPLAY_P1_LEFT  = 1 << 2,
+    REPLAY_P1_RIGHT = 1 << 3,
+    REPLAY_P2_UP    = 1 << 4,
+    REPLAY_P2_DOWN  = 1 << 5,
+    REPLAY_P2_LEFT  = 1 << 6,
+    REPLAY_P2_RIGHT = 1 << 7
+};
+
+// How long each key (ReplayInputBits order) was held during one tick, in
+// replaySubSteps-ths of the tick. Only ticks where a key changed mid-tick
+// have one; in every other tick a key is held all or none of it.
+const int replaySubSteps = 64;
+
+struct ReplaySubTick {
+    uint32_t tick;
+    uint8_t  held[8];
+};
+
+struct Replay {
+    uint64_t seed;
+    bool     singlePlayer;
+
+    // Menu settings, as indices into the game's option tables.
+    int gameTimeIndex;
+    int maxScoreIndex;
+    int difficultyIndex;
+    int tickRate;                  // Hz
+
+    MatchConfig config;            // what those settings resolved to
+
+    std::vector<uint8_t> inputs;   // one ReplayInputBits byte per tick
+    std::vector<ReplaySubTick> subTicks;   // sorted by tick
+
+    // Filled by replayFinish(), checked by replayVerify().
+    int      finalScoreP1, finalScoreP2;
+    uint64_t finalHash;
+};
+
+// Initializes the match and the AI opponent as the replay starts them.
+void replayStart(const Replay& r, MatchState& m, AiState& ai);
+
+// Starts a recording (clears the inputs, then replayStart()).
+void replayBegin(Replay& r, MatchState& m, AiState& ai);
+
+// Turns one tick's input bits into paddle inputs, scaled by the held
+// fractions when `held` isn't 0. P2 is the AI in single player. Both the
+// game and playback step matches through this.
+void replayTickInputs(const Replay& r, const MatchState& m, AiState& ai, uint8_t bits,
+                      const uint8_t* held, PaddleInput& in1, PaddleInput& in2);
+
+// P2 key bits for a move of the Expert AI (axes are -1, 0 or 1).
+uint8_t replayEncodeP2(const PaddleInput& in);
+
+// Records one tick: decodes bits, steps the match and appends the bits.
+void replayRecordTick(Replay& r, MatchState& m, AiState& ai, uint8_t bits);
+
+// The same for a tick in which keys changed: held[8] as in ReplaySubTick.
+void replayRecordSubTick(Replay& r, MatchState& m, AiState& ai, uint8_t bits, const uint8_t* held);
+
+// Stores the result the replay should reproduce.
+void replayFinish(Replay& r, const MatchState& m);
+
+// Plays the recorded ticks [m.tick, untilTick) on a match started with
+// replayStart(). Returns false once the inputs run out.
+bool replaySeek(const Replay& r, MatchState& m, AiState& ai, uint32_t untilTick);
+
+// Replays the whole log headless and compares against the stored result.
+bool replayVerify(const Replay& r, MatchState& out);
+
+// Hash of the full simulation state, for determinism checks.
+uint64_t replayStateHash(const MatchState& m);
+
+bool replaySave(const Replay& r, const char* path);
+bool replayLoad(Replay& r, const char* path);
+
+#endif
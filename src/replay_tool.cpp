@@ -0,0 +1,189 @@
+// Replay tool: inspects, verifies and scrubs recorded matches headless,
+// hundreds of times faster than real time.
+//
+//   replay_tool info   FILE
+//   replay_tool verify FILE...
+//   replay_tool seek   FILE TICK
+//   replay_tool record FILE [--seed S] [--d 0..3] [--tick-hz HZ]
+//
+// "record" plays P1 with the Hard AI (quantized to key presses) against
+// the single-player AI, which gives reproducible replays without a window.
+// With --d 3 the opponent is the Expert search AI, run synchronously.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+
+#include "ai.h"
+#include "match_engine.h"
+#include "replay.h"
+#include "search_ai.h"
+
+static void printUsage() {
+    std::printf("usage: replay_tool info   FILE\n"
+                "       replay_tool verify FILE...\n"
+                "       replay_tool seek   FILE TICK\n"
+                "       replay_tool record FILE [--seed S] [--d 0..3] [--tick-hz HZ]\n");
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now() - start).count();
+}
+
+static bool load(Replay& r, const char* path) {
+    if (replayLoad(r, path)) return true;
+    std::fprintf(stderr, "%s: not a readable replay\n", path);
+    return false;
+}
+
+static void printState(const MatchState& m) {
+    std::printf("tick %u  time left %.2f  score %d:%d  speed x%.2f  rally %d\n",
+                (unsigned)m.tick, m.timeLeft, m.scoreP1, m.scoreP2, m.speedFactor, m.hitsInRally);
+    std::printf("ball (%.2f, %.2f) v (%.2f, %.2f)\n", m.ball.x, m.ball.y, m.ball.vx, m.ball.vy);
+    std::printf("p1 (%.2f, %.2f)  p2 (%.2f, %.2f)\n", m.p1.x, m.p1.y, m.p2.x, m.p2.y);
+    std::printf("state hash %016llx\n", (unsigned long long)replayStateHash(m));
+}
+
+// ===================== COMMANDS =====================
+
+static int cmdInfo(const char* path) {
+    Replay r;
+    if (!load(r, path)) return 1;
+
+    std::printf("%s\n", path);
+    std::printf("  mode        %s\n", r.singlePlayer ? "single player" : "multiplayer");
+    std::printf("  seed        %llu\n", (unsigned long long)r.seed);
+    std::printf("  settings    game time #%d (%.0f s), max score #%d (%d), difficulty %d\n",
+                r.gameTimeIndex, r.config.gameTime, r.maxScoreIndex, r.config.maxScore,
+                r.difficultyIndex);
+    std::printf("  tick rate   %d Hz\n", r.tickRate);
+    std::printf("  ticks       %u (%.1f s)\n",
+                (unsigned)r.inputs.size(), r.inputs.size() / (double)r.tickRate);
+    std::printf("  sub-ticks   %u (keys changed between ticks)\n", (unsigned)r.subTicks.size());
+    std::printf("  result      %d:%d  hash %016llx\n",
+                r.finalScoreP1, r.finalScoreP2, (unsigned long long)r.finalHash);
+    return 0;
+}
+
+static int cmdVerify(int count, char** paths) {
+    int failures = 0;
+    for (int i = 0; i < count; ++i) {
+        Replay r;
+        if (!load(r, paths[i])) {
+            failures++;
+            continue;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        MatchState m;
+        bool ok = replayVerify(r, m);
+        double elapsed = secondsSince(start);
+
+        double gameSeconds = r.inputs.size() / (double)r.tickRate;
+        std::printf("%s: %s  %d:%d (expected %d:%d)  %u ticks in %.2f ms, %.0fx real time\n",
+                    paths[i], ok ? "OK" : "MISMATCH",
+                    m.scoreP1, m.scoreP2, r.finalScoreP1, r.finalScoreP2,
+                    (unsigned)m.tick, elapsed * 1000.0,
+                    elapsed > 0.0 ? gameSeconds / elapsed : 0.0);
+        if (!ok) failures++;
+    }
+    return failures ? 1 : 0;
+}
+
+static int cmdSeek(const char* path, uint32_t tick) {
+    Replay r;
+    if (!load(r, path)) return 1;
+
+    MatchState m;
+    AiState    ai;
+    replayStart(r, m, ai);
+    if (!replaySeek(r, m, ai, tick)) std::printf("(replay ends at tick %u)\n", (unsigned)m.tick);
+    printState(m);
+    return 0;
+}
+
+static uint8_t quantize(const PaddleInput& in) {
+    uint8_t bits = 0;
+    if (in.moveY >  0.5f) bits |= REPLAY_P1_UP;
+    if (in.moveY < -0.5f) bits |= REPLAY_P1_DOWN;
+    if (in.moveX >  0.5f) bits |= REPLAY_P1_RIGHT;
+    if (in.moveX < -0.5f) bits |= REPLAY_P1_LEFT;
+    return bits;
+}
+
+static int cmdRecord(const char* path, int argc, char** argv) {
+    uint64_t seed       = 1;
+    int      difficulty = 1;
+    int      tickHz     = 120;
+
+    for (int i = 0; i + 1 < argc; i += 2) {
+        if      (!std::strcmp(argv[i], "--seed"))    seed       = std::strtoull(argv[i + 1], 0, 10);
+        else if (!std::strcmp(argv[i], "--d"))       difficulty = std::atoi(argv[i + 1]);
+        else if (!std::strcmp(argv[i], "--tick-hz")) tickHz     = std::atoi(argv[i + 1]);
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+    if (difficulty < 0 || difficulty > expertDifficulty || tickHz <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    // Defaults of the settings menu: 90 s, first to 5
+    Replay r;
+    r.seed            = seed;
+    r.singlePlayer    = true;
+    r.gameTimeIndex   = 1;
+    r.maxScoreIndex   = 1;
+    r.difficultyIndex = difficulty;
+    r.tickRate        = tickHz;
+    r.config.gameTime = 90.0f;
+    r.config.maxScore = 5;
+    r.config.p1Speed  = 480.0f;
+    r.config.p2Speed  = difficulty == expertDifficulty ? searchAiSpeed
+                                                       : aiParams(difficulty).maxSpeed;
+
+    MatchState m;
+    AiState    opponent, player;
+    replayBegin(r, m, opponent);
+    aiInit(player, 0, 2, seed + 1);
+
+    SearchAi expert;
+    expert.reset(1, seed);
+
+    float dt = 1.0f / (float)tickHz;
+    while (!m.over) {
+        uint8_t bits = quantize(aiUpdate(player, m, dt));
+        if (difficulty == expertDifficulty) bits |= replayEncodeP2(expert.think(m, dt, 32));
+        replayRecordTick(r, m, opponent, bits);
+    }
+    replayFinish(r, m);
+
+    if (!replaySave(r, path)) {
+        std::fprintf(stderr, "could not write %s\n", path);
+        return 1;
+    }
+    std::printf("%s: %u ticks, %d:%d\n", path, (unsigned)r.inputs.size(), m.scoreP1, m.scoreP2);
+    return 0;
+}
+
+// ===================== MAIN =====================
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printUsage();
+        return 1;
+    }
+
+    const char* cmd = argv[1];
+    if (!std::strcmp(cmd, "info"))                return cmdInfo(argv[2]);
+    if (!std::strcmp(cmd, "verify"))              return cmdVerify(argc - 2, argv + 2);
+    if (!std::strcmp(cmd, "seek") && argc == 4)   return cmdSeek(argv[2], (uint32_t)std::strtoul(argv[3], 0, 10));
+    if (!std::strcmp(cmd, "record"))              return cmdRecord(argv[2], argc - 3, argv + 3);
+
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,238 @@
+#include "rl_env.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ai.h"
+#include "match_engine.h"
+
+static const float humanPaddleSpeed = 480.0f;   // the game's P1 speed
+
+struct EnvSlot {
+    MatchState m;
+    AiState    ai;
+    MatchRng   seeds;           // seeds of this env's next episodes
+    uint64_t   episodes;
+};
+
+struct RlEnv {
+    RlEnvConfig          cfg;
+    MatchConfig          match;
+    float                dt;
+    std::vector<EnvSlot> slots;
+    uint64_t             steps;
+
+    // The call being run, read by every worker
+    bool           resetting;
+    uint64_t       seed;
+    const uint8_t* actions;
+    float*         obs;
+    float*         rewards;
+    uint8_t*       dones;
+
+    // Worker w steps slice w + 1; the calling thread does slice 0
+    std::vector<std::thread> workers;
+    int                      slices;
+    std::mutex               lock;
+    std::condition_variable  wake;
+    std::condition_variable  finished;
+    unsigned                 generation;
+    int                      running;
+    bool                     stopping;
+};
+
+// ===================== ONE ENV =====================
+
+static float axis(uint8_t bits, int plus, int minus) {
+    return (float)((bits >> plus) & 1) - (float)((bits >> minus) & 1);
+}
+
+static void startEpisode(RlEnv& e, EnvSlot& s) {
+    uint64_t seed = ((uint64_t)rngNext(s.seeds) << 32) | rngNext(s.seeds);
+    matchInit(s.m, e.match, seed);
+    if (e.cfg.opponent >= 0) aiInit(s.ai, 1, e.cfg.opponent, seed);
+}
+
+static void writeObs(const RlEnv& e, const MatchState& m, float* o) {
+    const float sx = 1.0f / ARENA_WIDTH, sy = 1.0f / ARENA_HEIGHT;
+    o[0]  = m.ball.x * sx;
+    o[1]  = m.ball.y * sy;
+    o[2]  = m.ball.vx * m.speedFactor * sx;
+    o[3]  = m.ball.vy * m.speedFactor * sx;
+    o[4]  = m.p1.x * sx;
+    o[5]  = m.p1.y * sy;
+    o[6]  = m.p2.x * sx;
+    o[7]  = m.p2.y * sy;
+    o[8]  = m.speedFactor;
+    o[9]  = m.timeLeft / e.match.gameTime;
+    o[10] = (float)m.scoreP1;
+    o[11] = (float)m.scoreP2;
+}
+
+static void resetEnv(RlEnv& e, int i) {
+    EnvSlot& s = e.slots[i];
+    rngSeed(s.seeds, e.seed + (uint64_t)i);
+    startEpisode(e, s);
+    writeObs(e, s.m, e.obs + (size_t)i * RL_ENV_OBS_SIZE);
+}
+
+static void stepEnv(RlEnv& e, int i) {
+    EnvSlot& s    = e.slots[i];
+    uint8_t  bits = e.actions[i];
+
+    PaddleInput in1, in2;
+    in1.moveX = axis(bits, 3, 2);
+    in1.moveY = axis(bits, 0, 1);
+    in2.moveX = axis(bits, 7, 6);
+    in2.moveY = axis(bits, 4, 5);
+
+    float reward = 0.0f;
+    for (int k = 0; k < e.cfg.frameSkip && !s.m.over; ++k) {
+        if (e.cfg.opponent >= 0) in2 = aiUpdate(s.ai, s.m, e.dt);
+        matchStep(s.m, in1, in2, e.dt);
+
+        unsigned ev = s.m.events;
+        if (ev & EVENT_SCORE_P1) reward += 1.0f;
+        if (ev & EVENT_SCORE_P2) reward -= 1.0f;
+        if (ev & EVENT_HIT_P1)   reward += e.cfg.hitReward;
+    }
+
+    e.rewards[i] = reward;
+    e.dones[i]   = s.m.over ? 1 : 0;
+    if (s.m.over) {
+        s.episodes++;
+        startEpisode(e, s);
+    }
+    writeObs(e, s.m, e.obs + (size_t)i * RL_ENV_OBS_SIZE);
+}
+
+// ===================== WORKERS =====================
+
+static void runSlice(RlEnv& e, int slice) {
+    int n     = (int)e.slots.size();
+    int begin = (int)((long long)n * slice / e.slices);
+    int end   = (int)((long long)n * (slice + 1) / e.slices);
+    if (e.resetting) {
+        for (int i = begin; i < end; ++i) resetEnv(e, i);
+    } else {
+        for (int i = begin; i < end; ++i) stepEnv(e, i);
+    }
+}
+
+static void workerLoop(RlEnv* e, int slice) {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> hold(e->lock);
+            while (!e->stopping && e->generation == seen) e->wake.wait(hold);
+            if (e->stopping) return;
+            seen = e->generation;
+        }
+        runSlice(*e, slice);
+        {
+            std::lock_guard<std::mutex> hold(e->lock);
+            if (--e->running == 0) e->finished.notify_one();
+        }
+    }
+}
+
+// Runs the call set up in `e` on every slice and waits for all of them
+static void runAll(RlEnv& e) {
+    if (e.workers.empty()) {
+        runSlice(e, 0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> hold(e.lock);
+        e.generation++;
+        e.running = (int)e.workers.size();
+    }
+    e.wake.notify_all();
+    runSlice(e, 0);
+
+    std::unique_lock<std::mutex> hold(e.lock);
+    while (e.running > 0) e.finished.wait(hold);
+}
+
+// ===================== API =====================
+
+void rlEnvDefaultConfig(RlEnvConfig* cfg) {
+    cfg->envs      = 1;
+    cfg->threads   = 0;
+    cfg->tickHz    = 120;
+    cfg->frameSkip = 1;
+    cfg->gameTime  = 90.0f;
+    cfg->maxScore  = 5;
+    cfg->opponent  = 1;
+    cfg->hitReward = 0.0f;
+}
+
+RlEnv* rlEnvCreate(const RlEnvConfig* cfg) {
+    if (!cfg || cfg->envs <= 0 || cfg->tickHz <= 0 || cfg->frameSkip <= 0 ||
+        cfg->gameTime <= 0.0f || cfg->maxScore < 0 || cfg->opponent < -1 || cfg->opponent > 2) {
+        return 0;
+    }
+
+    RlEnv* e = new RlEnv();
+    e->cfg = *cfg;
+    e->match.gameTime = cfg->gameTime;
+    e->match.maxScore = cfg->maxScore;
+    e->match.p1Speed  = humanPaddleSpeed;
+    e->match.p2Speed  = cfg->opponent >= 0 ? aiParams(cfg->opponent).maxSpeed : humanPaddleSpeed;
+    e->dt    = 1.0f / (float)cfg->tickHz;
+    e->slots.resize(cfg->envs);
+    e->steps = 0;
+
+    int threads = cfg->threads > 0 ? cfg->threads : (int)std::thread::hardware_concurrency();
+    if (threads < 1)         threads = 1;
+    if (threads > cfg->envs) threads = cfg->envs;
+    e->slices     = threads;
+    e->generation = 0;
+    e->running    = 0;
+    e->stopping   = false;
+    e->resetting  = false;
+    for (int w = 1; w < threads; ++w) e->workers.push_back(std::thread(workerLoop, e, w));
+
+    for (int i = 0; i < cfg->envs; ++i) e->slots[i].episodes = 0;
+    return e;
+}
+
+void rlEnvDestroy(RlEnv* env) {
+    if (!env) return;
+    {
+        std::lock_guard<std::mutex> hold(env->lock);
+        env->stopping = true;
+    }
+    env->wake.notify_all();
+    for (size_t w = 0; w < env->workers.size(); ++w) env->workers[w].join();
+    delete env;
+}
+
+void rlEnvReset(RlEnv* env, uint64_t seed, float* obs) {
+    env->resetting = true;
+    env->seed      = seed;
+    env->obs       = obs;
+    runAll(*env);
+}
+
+void rlEnvStep(RlEnv* env, const uint8_t* actions, float* obs, float* rewards, uint8_t* dones) {
+    env->resetting = false;
+    env->actions   = actions;
+    env->obs       = obs;
+    env->rewards   = rewards;
+    env->dones     = dones;
+    runAll(*env);
+    env->steps += env->slots.size();
+}
+
+uint64_t rlEnvEpisodes(const RlEnv* env) {
+    uint64_t n = 0;
+    for (size_t i = 0; i < env->slots.size(); ++i) n += env->slots[i].episodes;
+    return n;
+}
+
+uint64_t rlEnvSteps(const RlEnv* env) {
+    return env->steps;
+}
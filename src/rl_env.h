@@ -0,0 +1,79 @@
+#ifndef PADDLE_RIVALS_RL_ENV_H
+#define PADDLE_RIVALS_RL_ENV_H
+
+// Batched match environments for training learned opponents.
+//
+// One RlEnv runs N independent matches (match_engine.h) side by side. A
+// call steps all of them and writes observations, rewards and done flags
+// into arrays the caller owns, env i at index i, so Python (ctypes +
+// numpy) or shared memory reads them without copies. No GL, and nothing
+// is allocated after rlEnvCreate(): the matches live in one array and a
+// fixed gang of worker threads each steps its own slice of it.
+//
+// The agent plays P1 (left). P2 is the built-in AI at a chosen difficulty,
+// or also comes from the actions (self-play). Every env is reproducible
+// from the reset seed.
+//
+// Plain C interface; build the engine as a shared library to load it
+// from Python (see README).
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Floats per env in the observation array, in this order (arena
+// coordinates scaled to 0..1, speeds to arena widths per second):
+//   0 ball x   1 ball y   2 ball vx   3 ball vy
+//   4 P1 x     5 P1 y     6 P2 x      7 P2 y
+//   8 speed factor (1 at a serve, grows in a rally)
+//   9 time left, 1 at the start to 0
+//  10 P1 score  11 P2 score
+enum { RL_ENV_OBS_SIZE = 12 };
+
+// Actions: one byte per env, the replay key bits (replay.h). Bits 0..3
+// move P1 up / down / left / right; bits 4..7 do the same for P2 and are
+// only read in self-play.
+
+typedef struct RlEnvConfig {
+    int   envs;
+    int   threads;          // 0 = one per hardware thread
+    int   tickHz;           // simulation rate, 120 like the game
+    int   frameSkip;        // ticks per step, the action held for all
+    float gameTime;         // seconds per episode
+    int   maxScore;         // 0 = play until the time is up
+    int   opponent;         // P2: 0..2 built-in AI (Easy..Hard), -1 self-play
+    float hitReward;        // added when P1 returns the ball (0 = goals only)
+} RlEnvConfig;
+
+typedef struct RlEnv RlEnv;
+
+// Fills in the defaults above (1 env, 120 Hz, frame skip 1, 90 s, max
+// score 5, Medium AI).
+void   rlEnvDefaultConfig(RlEnvConfig* cfg);
+
+// 0 on a bad config.
+RlEnv* rlEnvCreate(const RlEnvConfig* cfg);
+void   rlEnvDestroy(RlEnv* env);
+
+// Starts a new episode in every env (env i from seed + i) and writes the
+// first observations: obs[envs * RL_ENV_OBS_SIZE].
+void   rlEnvReset(RlEnv* env, uint64_t seed, float* obs);
+
+// One step of every env with actions[envs]. Writes obs[envs *
+// RL_ENV_OBS_SIZE], rewards[envs] (+1 P1 goal, -1 P2 goal, plus
+// hitReward per P1 hit; P2's reward in self-play is the negative) and
+// dones[envs]. An env whose episode ended is reset right away from its
+// own seed sequence, and its obs is the first one of the new episode.
+void   rlEnvStep(RlEnv* env, const uint8_t* actions, float* obs, float* rewards, uint8_t* dones);
+
+// Episodes finished and env steps taken since rlEnvCreate().
+uint64_t rlEnvEpisodes(const RlEnv* env);
+uint64_t rlEnvSteps(const RlEnv* env);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,111 @@
+// Environment runner: steps batched training environments (rl_env.h) with
+// random actions as fast as they go, and prints throughput and episode
+// stats. Also the smallest example of driving the API.
+//
+//   rl_runner [--envs N] [--threads T] [--steps S] [--frame-skip K]
+//             [--opponent -1..2] [--time SEC] [--max-score N] [--seed S]
+//
+// --steps is per env. Actions are drawn once up front (new ones every
+// step would time the random generator), so a step is the env alone.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "match_engine.h"   // MatchRng
+#include "rl_env.h"
+
+struct RunnerOptions {
+    RlEnvConfig env;
+    int         steps;
+    uint64_t    seed;
+};
+
+static void printUsage() {
+    std::printf("usage: rl_runner [--envs N] [--threads T] [--steps S] [--frame-skip K]\n"
+                "                 [--opponent -1..2] [--time SEC] [--max-score N] [--seed S]\n");
+}
+
+static bool parseOptions(int argc, char** argv, RunnerOptions& o) {
+    rlEnvDefaultConfig(&o.env);
+    o.env.envs = 4096;
+    o.steps    = 2000;
+    o.seed     = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+
+        if      (!std::strcmp(a, "--envs"))       o.env.envs      = std::atoi(v);
+        else if (!std::strcmp(a, "--threads"))    o.env.threads   = std::atoi(v);
+        else if (!std::strcmp(a, "--steps"))      o.steps         = std::atoi(v);
+        else if (!std::strcmp(a, "--frame-skip")) o.env.frameSkip = std::atoi(v);
+        else if (!std::strcmp(a, "--opponent"))   o.env.opponent  = std::atoi(v);
+        else if (!std::strcmp(a, "--time"))       o.env.gameTime  = (float)std::atof(v);
+        else if (!std::strcmp(a, "--max-score"))  o.env.maxScore  = std::atoi(v);
+        else if (!std::strcmp(a, "--seed"))       o.seed          = std::strtoull(v, 0, 10);
+        else return false;
+    }
+    return o.steps > 0;
+}
+
+int main(int argc, char** argv) {
+    RunnerOptions o;
+    if (!parseOptions(argc, argv, o)) {
+        printUsage();
+        return 1;
+    }
+    RlEnv* env = rlEnvCreate(&o.env);
+    if (!env) {
+        printUsage();
+        return 1;
+    }
+
+    int n = o.env.envs;
+    std::vector<float>   obs((size_t)n * RL_ENV_OBS_SIZE);
+    std::vector<float>   rewards(n);
+    std::vector<uint8_t> dones(n);
+
+    // A few hundred batches of random key bits, cycled
+    const int actionBatches = 256;
+    std::vector<uint8_t> actions((size_t)n * actionBatches);
+    MatchRng rng;
+    rngSeed(rng, o.seed);
+    for (size_t i = 0; i < actions.size(); ++i) actions[i] = (uint8_t)rngNext(rng);
+
+    rlEnvReset(env, o.seed, &obs[0]);
+
+    // P1's reward over each finished episode
+    std::vector<float> episodeReward(n, 0.0f);
+    double finishedReward = 0.0;
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < o.steps; ++s) {
+        rlEnvStep(env, &actions[(size_t)(s % actionBatches) * n], &obs[0], &rewards[0], &dones[0]);
+        for (int i = 0; i < n; ++i) {
+            episodeReward[i] += rewards[i];
+            if (dones[i]) {
+                finishedReward  += episodeReward[i];
+                episodeReward[i] = 0.0f;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    const char* opponents[] = { "self-play", "Easy", "Medium", "Hard" };
+    uint64_t steps    = rlEnvSteps(env);
+    uint64_t episodes = rlEnvEpisodes(env);
+    std::printf("Envs        : %d  (P2 %s, frame skip %d, %d Hz, %.0fs, max score %d)\n",
+                n, opponents[o.env.opponent + 1], o.env.frameSkip, o.env.tickHz,
+                o.env.gameTime, o.env.maxScore);
+    std::printf("Steps       : %llu in %.3f s\n", (unsigned long long)steps, seconds);
+    std::printf("Throughput  : %.2f M env steps/s  (%.2f M ticks/s)\n",
+                steps / seconds / 1e6, steps * (double)o.env.frameSkip / seconds / 1e6);
+    std::printf("Episodes    : %llu finished, mean P1 reward %.2f per episode\n",
+                (unsigned long long)episodes, episodes ? finishedReward / episodes : 0.0);
+
+    rlEnvDestroy(env);
+    return 0;
+}
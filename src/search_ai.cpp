@@ -0,0 +1,344 @@
+#include "search_ai.h"
+
+#include <chrono>
+#include <cmath>     // fabs
+#include <cstring>   // memmove
+#include <thread>    // hardware_concurrency
+
+#include "thread_pool.h"
+
+// ===================== MOVES & PLANS =====================
+
+// Moves are vertical only. Letting the search move the paddle forward made
+// it play worse: it rushed the ball for hits and got passed.
+static const uint8_t moveStay  = 1;
+static const int     moveCount = 3;
+
+// Game ticks per decision step at this tick length.
+static int ticksPerStep(float dt) {
+    int k = (int)(searchHorizon / searchPlanSteps / dt + 0.5f);
+    return k < 1 ? 1 : k;
+}
+
+static PaddleInput decodeMove(uint8_t move) {
+    PaddleInput in;
+    in.moveX = 0.0f;
+    in.moveY = (float)move - 1.0f;
+    return in;
+}
+
+static void fillPlan(SearchPlan& p, int from, uint8_t move) {
+    for (int i = from; i < searchPlanSteps; ++i) p.moves[i] = move;
+}
+
+// Moves the plan's start to the decision step containing `tick`, dropping
+// the steps already played and repeating the last move at the end.
+static void alignPlan(SearchPlan& p, uint32_t tick, int k) {
+    uint32_t base = tick - tick % (uint32_t)k;
+
+    if (!p.valid || base < p.baseTick) {   // no plan, or a new match
+        fillPlan(p, 0, moveStay);
+    } else {
+        uint32_t shift = (base - p.baseTick) / (uint32_t)k;
+        if (shift >= (uint32_t)searchPlanSteps) {
+            fillPlan(p, 0, p.moves[searchPlanSteps - 1]);
+        } else if (shift > 0) {
+            uint8_t last = p.moves[searchPlanSteps - 1];
+            std::memmove(p.moves, p.moves + shift, searchPlanSteps - shift);
+            fillPlan(p, searchPlanSteps - (int)shift, last);
+        }
+    }
+    p.baseTick = base;
+    p.valid    = true;
+}
+
+static void mutatePlan(SearchPlan& p, MatchRng& rng) {
+    uint8_t move = (uint8_t)(rngNext(rng) % moveCount);
+
+    // Now and then start over from "hold one move", else rewrite a short run
+    if ((rngNext(rng) & 15) == 0) {
+        fillPlan(p, 0, move);
+        return;
+    }
+    int at  = (int)(rngNext(rng) % searchPlanSteps);
+    int len = 1 + (int)(rngNext(rng) % 4);
+    for (int i = at; i < at + len && i < searchPlanSteps; ++i) p.moves[i] = move;
+}
+
+// ===================== EVALUATION =====================
+
+static const float goalScore   = 1000.0f;
+static const float hitScore    = 30.0f;
+static const float missPenalty = 500.0f;   // ball heading for a spot we can't reach
+
+// Where the ball will meet `target`'s face, and by how much the target
+// fails to get there in time (> 0: out of reach).
+static bool interceptSlack(const MatchState& m, const Paddle& target, bool rightSide,
+                           float& slack, float& gap) {
+    const Ball& ball = m.ball;
+    float face = rightSide ? target.x - target.width / 2 - ball.radius
+                           : target.x + target.width / 2 + ball.radius;
+    float landY;
+    if (!aiPredictIntercept(ball.x, ball.y, ball.vx, ball.vy, ball.radius, face, landY)) return false;
+
+    float t = std::fabs((face - ball.x) / (ball.vx * m.speedFactor));
+    gap   = std::fabs(landY - target.y) - target.height / 2;
+    slack = gap - target.speed * t;
+    return true;
+}
+
+// Score of the position at the end of a rollout.
+static float evaluateEnd(const MatchState& m, int side) {
+    const Paddle& me   = side ? m.p2 : m.p1;
+    const Paddle& them = side ? m.p1 : m.p2;
+    bool towardUs = side ? m.ball.vx > 0.0f : m.ball.vx < 0.0f;
+
+    float slack, gap;
+    if (towardUs) {
+        if (!interceptSlack(m, me, side == 1, slack, gap)) return 0.0f;
+        if (slack > 0.0f) return -missPenalty - slack;
+        return gap > 0.0f ? -0.2f * gap : 0.0f;
+    }
+
+    // Heading to the opponent: reward shots they can't reach
+    if (!interceptSlack(m, them, side == 0, slack, gap)) return 0.0f;
+    if (slack >  400.0f) slack =  400.0f;
+    if (slack < -400.0f) slack = -400.0f;
+    return 0.5f * slack;
+}
+
+// Plays the plan against a model opponent (a perfect intercept AI at its
+// own paddle speed) and scores the outcome.
+static float evaluatePlan(const SearchPlan& plan, const MatchState& start, int side, float dt) {
+    MatchState sim = start;
+
+    AiState opponent;
+    aiInit(opponent, 1 - side, 2, 0);
+    opponent.params.reactionDelay = 0.0f;
+    opponent.params.aimError      = 0.0f;
+
+    unsigned ourGoal   = side ? EVENT_SCORE_P2 : EVENT_SCORE_P1;
+    unsigned theirGoal = side ? EVENT_SCORE_P1 : EVENT_SCORE_P2;
+    unsigned ourHit    = side ? EVENT_HIT_P2   : EVENT_HIT_P1;
+
+    int   k     = ticksPerStep(dt);
+    int   ticks = k * searchPlanSteps;
+    float score = 0.0f;
+
+    for (int i = 0; i < ticks && !sim.over; ++i) {
+        int step = (int)((sim.tick - plan.baseTick) / (uint32_t)k);
+        if (step >= searchPlanSteps) step = searchPlanSteps - 1;
+
+        PaddleInput mine   = decodeMove(plan.moves[step]);
+        PaddleInput theirs = aiUpdate(opponent, sim, dt);
+        if (side) matchStep(sim, theirs, mine, dt);
+        else      matchStep(sim, mine, theirs, dt);
+
+        // Sooner goals count a little more, later ones against us a little less
+        if (sim.events & ourGoal)   return score + goalScore - i * 0.1f;
+        if (sim.events & theirGoal) return score - goalScore + i * 0.1f;
+        if (sim.events & ourHit)    score += hitScore;
+    }
+    return score + evaluateEnd(sim, side);
+}
+
+static uint8_t quantizeMove(const PaddleInput& in) {
+    if (in.moveY >  0.5f) return 2;
+    if (in.moveY < -0.5f) return 0;
+    return moveStay;
+}
+
+// The plan a perfect intercept AI would play from here: a strong starting
+// point that the search only has to beat.
+static void interceptPlan(SearchPlan& plan, const MatchState& start, int side, float dt) {
+    MatchState sim = start;
+
+    AiState me, opponent;
+    aiInit(me, side, 2, 0);
+    aiInit(opponent, 1 - side, 2, 0);
+    me.params.reactionDelay = opponent.params.reactionDelay = 0.0f;
+    me.params.aimError      = opponent.params.aimError      = 0.0f;
+
+    int k = ticksPerStep(dt);
+    for (int step = 0; step < searchPlanSteps; ++step) {
+        for (int i = 0; i < k; ++i) {
+            PaddleInput mine   = aiUpdate(me, sim, dt);
+            PaddleInput theirs = aiUpdate(opponent, sim, dt);
+            if (i == 0) {
+                plan.moves[step] = quantizeMove(mine);
+                mine = decodeMove(plan.moves[step]);
+            }
+            if (side) matchStep(sim, theirs, mine, dt);
+            else      matchStep(sim, mine, theirs, dt);
+        }
+    }
+}
+
+// Improves `plan` for `start` until stop() says so. Returns rollouts run.
+template <class Stop>
+static uint64_t refinePlan(SearchPlan& plan, const MatchState& start, int side, float dt,
+                           MatchRng& rng, Stop stop) {
+    alignPlan(plan, start.tick, ticksPerStep(dt));
+    plan.score = evaluatePlan(plan, start, side, dt);
+
+    SearchPlan intercept = plan;
+    interceptPlan(intercept, start, side, dt);
+    intercept.score = evaluatePlan(intercept, start, side, dt);
+    if (intercept.score > plan.score) plan = intercept;
+
+    uint64_t rollouts = 2;
+    while (!stop()) {
+        SearchPlan candidate = plan;
+        mutatePlan(candidate, rng);
+        candidate.score = evaluatePlan(candidate, start, side, dt);
+        if (candidate.score >= plan.score) plan = candidate;   // drift across ties
+        rollouts++;
+    }
+    return rollouts;
+}
+
+// ===================== SEARCH AI =====================
+
+SearchAi::SearchAi()
+    : side(1), snapshotDt(0.0f), generation(0), bestGeneration(0),
+      stopping(false), pool(0), budgetUs(0), seed(0),
+      currentGeneration(0), rolloutCount(0), sliceCount(0) {
+    syncPlan.valid = false;
+    best.valid     = false;
+    gamePlan.valid = false;
+    reset(1, 0);
+}
+
+SearchAi::~SearchAi() {
+    stopWorkers();
+}
+
+void SearchAi::reset(int aiSide, uint64_t matchSeed) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    side = aiSide;
+    seed = matchSeed;
+    aiInit(fallback, aiSide, 2, matchSeed);
+    rngSeed(rng, matchSeed ^ 0x5EA4C4ull);
+
+    syncPlan.valid = false;
+    best.valid     = false;
+    gamePlan.valid = false;
+
+    // Plans still being searched for the old match must not come back
+    bestGeneration = generation + 1;
+}
+
+void SearchAi::startWorkers(int threads, int tickBudgetUs) {
+    stopWorkers();
+
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency() - 1;
+    if (threads <= 0) threads = 1;
+
+    budgetUs = tickBudgetUs;
+    pool     = new ThreadPool(threads);
+    for (int i = 0; i < threads; ++i) pool->submit([this, i]() { workerLoop(i); });
+}
+
+void SearchAi::stopWorkers() {
+    if (!pool) return;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    newSnapshot.notify_all();
+
+    delete pool;                // waits for the worker loops to return
+    pool = 0;
+    stopping = false;
+}
+
+PaddleInput SearchAi::planMove(const SearchPlan& plan, const MatchState& m, float dt) {
+    int k = ticksPerStep(dt);
+    if (plan.valid && m.tick >= plan.baseTick) {
+        uint32_t step = (m.tick - plan.baseTick) / (uint32_t)k;
+        if (step < (uint32_t)searchPlanSteps) return decodeMove(plan.moves[step]);
+    }
+
+    // No usable plan yet: intercept AI, rounded to a plan move
+    return decodeMove(quantizeMove(aiUpdate(fallback, m, dt)));
+}
+
+PaddleInput SearchAi::act(const MatchState& m, float dt) {
+    // Hand over the state and pick up the newest plan, unless a worker is
+    // holding the lock right now; then keep playing the plan we have.
+    if (pool && lock.try_lock()) {
+        snapshot   = m;
+        snapshotDt = dt;
+        generation++;
+        currentGeneration.store(generation);
+        if (best.valid) gamePlan = best;
+        lock.unlock();
+        newSnapshot.notify_all();
+    }
+    return planMove(gamePlan, m, dt);
+}
+
+PaddleInput SearchAi::think(const MatchState& m, float dt, int rollouts) {
+    int k = ticksPerStep(dt);
+    if (!syncPlan.valid || m.tick % (uint32_t)k == 0 || m.tick < syncPlan.baseTick) {
+        int left = rollouts;
+        uint64_t n = refinePlan(syncPlan, m, side, dt, rng, [&left]() { return --left <= 0; });
+        rolloutCount += n;
+        sliceCount++;
+    }
+    return planMove(syncPlan, m, dt);
+}
+
+SearchStats SearchAi::stats() const {
+    SearchStats s;
+    s.rollouts = rolloutCount.load();
+    s.slices   = sliceCount.load();
+    return s;
+}
+
+void SearchAi::workerLoop(int index) {
+    using namespace std::chrono;
+
+    MatchRng workerRng;
+    rngSeed(workerRng, seed + 0x9E3779B97F4A7C15ull * (uint64_t)(index + 1));
+
+    SearchPlan plan;
+    plan.valid = false;
+    uint64_t seen = 0;
+
+    for (;;) {
+        MatchState start;
+        float      dt;
+        int        aiSide;
+        uint64_t   gen;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            newSnapshot.wait(guard, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+
+            start  = snapshot;
+            dt     = snapshotDt;
+            aiSide = side;
+            gen    = seen = generation;
+            if (best.valid) plan = best;   // carry the best plan forward
+        }
+
+        // Budget for this tick; also stop early when a newer state arrives
+        steady_clock::time_point deadline = steady_clock::now() + microseconds(budgetUs);
+        uint64_t n = refinePlan(plan, start, aiSide, dt, workerRng, [&]() {
+            return currentGeneration.load(std::memory_order_relaxed) != gen ||
+                   steady_clock::now() >= deadline;
+        });
+        rolloutCount += n;
+        sliceCount++;
+
+        std::lock_guard<std::mutex> guard(lock);
+        bool newer  = gen > bestGeneration || !best.valid;
+        bool better = gen == bestGeneration && plan.score > best.score;
+        if (gen >= bestGeneration && (newer || better)) {
+            best = plan;
+            bestGeneration = gen;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef PADDLE_RIVALS_SEARCH_AI_H
+#define PADDLE_RIVALS_SEARCH_AI_H
+
+// "Expert" AI: anytime search over future paddle moves.
+//
+// A plan is a short sequence of discrete moves (up / stay / down, one per
+// decision step of a few ticks; the paddle keeps to its home line). The
+// search keeps the best plan found so far and improves it by mutating it
+// and simulating each candidate on a copy of the match against a model
+// opponent, scoring goals, hits and how reachable the resulting ball is.
+// The best plan survives from tick to tick (shifted to the new current
+// tick), so work is refined rather than redone.
+//
+// In the game the search runs on worker threads: act() publishes the
+// current state and reads the best plan without ever blocking, and each
+// worker stops after its per-tick microsecond budget. think() runs the same
+// search synchronously with a fixed number of rollouts, for batch runs and
+// benchmarks where results must be reproducible.
+//
+// Moves are discrete (like keys), so the game records them as P2 key bits
+// and replays stay exact even though the threaded search is not.
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#include "ai.h"
+#include "match_engine.h"
+
+class ThreadPool;
+
+// Paddle speed of the Expert AI, units per second.
+const float searchAiSpeed = 600.0f;
+
+const int searchPlanSteps = 16;            // decisions per plan
+const float searchHorizon = 1.2f;          // seconds a plan covers
+
+struct SearchPlan {
+    uint8_t  moves[searchPlanSteps];       // 0 = down, 1 = stay, 2 = up
+    float    score;
+    uint32_t baseTick;                     // tick where moves[0] starts
+    bool     valid;
+};
+
+struct SearchStats {
+    uint64_t rollouts;                     // candidate plans simulated
+    uint64_t slices;                       // per-tick search slices run
+};
+
+class SearchAi {
+public:
+    SearchAi();
+    ~SearchAi();
+
+    // Starts a match: side 0 = left, 1 = right. Forgets the old plan.
+    void reset(int side, uint64_t seed);
+
+    // Background search on `threads` workers (<= 0: one per core, minus
+    // the game thread), each searching at most tickBudgetUs per tick.
+    void startWorkers(int threads, int tickBudgetUs);
+    void stopWorkers();
+
+    // Game thread, once per tick. Never blocks on the workers.
+    PaddleInput act(const MatchState& m, float dt);
+
+    // Same search on the calling thread, `rollouts` candidates per
+    // decision step. Deterministic for a given seed.
+    PaddleInput think(const MatchState& m, float dt, int rollouts);
+
+    SearchStats stats() const;
+
+private:
+    void workerLoop(int index);
+    PaddleInput planMove(const SearchPlan& plan, const MatchState& m, float dt);
+
+    int      side;
+    AiState  fallback;                     // used until a plan exists
+    MatchRng rng;                          // think() mutations
+
+    SearchPlan syncPlan;                   // think()'s plan
+
+    // Shared with the workers, guarded by `lock`
+    std::mutex              lock;
+    std::condition_variable newSnapshot;
+    MatchState              snapshot;
+    float                   snapshotDt;
+    uint64_t                generation;    // bumped per published snapshot
+    SearchPlan              best;          // best plan found, any generation
+    uint64_t                bestGeneration;
+    bool                    stopping;
+
+    SearchPlan gamePlan;                   // game thread's copy of `best`
+
+    ThreadPool*           pool;
+    int                   budgetUs;
+    uint64_t              seed;
+    std::atomic<uint64_t> currentGeneration;
+    std::atomic<uint64_t> rolloutCount;
+    std::atomic<uint64_t> sliceCount;
+};
+
+#endif
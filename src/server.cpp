@@ -0,0 +1,923 @@
+// Dedicated server: hosts thousands of concurrent matches headless, for
+// tournaments, and reports how long every match tick takes.
+//
+//   server [--port P] [--shards N] [--tick-hz HZ] [--max-matches N]
+//          [--time SEC] [--max-score N] [--send-every TICKS]
+//          [--idle-timeout SEC] [--report SEC] [--metrics FILE]
+//          [--replays DIR] [--max-viewers N] [--shard-viewers N]
+//
+// The main thread is the lobby: clients JOIN on --port and get assigned a
+// match (against the AI, or paired with the next client that wants a
+// player) on one of the shards. Each shard is a thread with its own UDP
+// socket (port + 1 + shard), epoll loop and timerfd ticking at --tick-hz.
+// Per tick a shard drains every input datagram that arrived in batches
+// (recvmmsg), steps all of its matches through the same code the game
+// uses (replayRecordTick), and sends the states back in batches
+// (sendmmsg). Every match step is timed; the lobby prints shard tick and
+// per-match step percentiles every --report seconds and writes one CSV
+// row per finished match to --metrics.
+//
+// Any match can be watched: viewers subscribe with WATCH, and every frame
+// the shard encodes the match once into a spectator stream packet
+// (spectator.h) and queues those same bytes to all of its viewers.
+// WATCH isn't authenticated, so a new viewer is refused (and counted as a
+// bad packet) once its match has --max-viewers or its shard --shard-viewers;
+// renewals of existing viewers always go through.
+//
+// Linux only (epoll, timerfd, signalfd, recvmmsg/sendmmsg).
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ai.h"
+#include "histogram.h"
+#include "match_engine.h"
+#include "replay.h"
+#include "server_protocol.h"
+#include "spectator.h"
+#include "udp_batch.h"
+
+// The game's Settings options: server matches use one of them, so their
+// replays open in the game with the right settings.
+static const int gameTimeChoices[] = { 60, 90, 120 };
+static const int maxScoreChoices[] = { 3, 5, 7, 0 };
+static const float humanPaddleSpeed = 480.0f;
+
+// ===================== OPTIONS =====================
+
+struct ServerOptions {
+    int         port;
+    int         shards;          // 0 = one per hardware thread
+    int         tickHz;
+    int         maxMatches;
+    int         gameTimeIndex;
+    int         maxScoreIndex;
+    int         sendEvery;       // ticks between state packets
+    float       idleTimeout;     // seconds without input before a match is abandoned
+    float       reportSec;
+    const char* metricsPath;     // CSV, one row per finished match (0 = none)
+    const char* replayDir;       // replays of finished matches (0 = none)
+    int         maxViewers;      // per match
+    int         shardViewers;    // per shard, over all of its matches
+};
+
+static void printUsage() {
+    std::printf("usage: server [--port P] [--shards N] [--tick-hz HZ] [--max-matches N]\n"
+                "              [--time 60|90|120] [--max-score 3|5|7|0] [--send-every TICKS]\n"
+                "              [--idle-timeout SEC] [--report SEC] [--metrics FILE]\n"
+                "              [--replays DIR] [--max-viewers N] [--shard-viewers N]\n");
+}
+
+static int choiceIndex(const int* choices, int count, int value) {
+    for (int i = 0; i < count; ++i) {
+        if (choices[i] == value) return i;
+    }
+    return -1;
+}
+
+static bool parseOptions(int argc, char** argv, ServerOptions& o) {
+    o.port          = serverDefaultPort;
+    o.shards        = 0;
+    o.tickHz        = 120;
+    o.maxMatches    = 10000;
+    o.gameTimeIndex = 1;
+    o.maxScoreIndex = 1;
+    o.sendEvery     = 2;
+    o.idleTimeout   = 5.0f;
+    o.reportSec     = 5.0f;
+    o.metricsPath   = 0;
+    o.replayDir     = 0;
+    o.maxViewers    = 4096;
+    o.shardViewers  = 16384;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        if (i + 1 >= argc) return false;
+        const char* v = argv[++i];
+
+        if      (!std::strcmp(a, "--port"))         o.port        = std::atoi(v);
+        else if (!std::strcmp(a, "--shards"))       o.shards      = std::atoi(v);
+        else if (!std::strcmp(a, "--tick-hz"))      o.tickHz      = std::atoi(v);
+        else if (!std::strcmp(a, "--max-matches"))  o.maxMatches  = std::atoi(v);
+        else if (!std::strcmp(a, "--time"))         o.gameTimeIndex = choiceIndex(gameTimeChoices, 3, std::atoi(v));
+        else if (!std::strcmp(a, "--max-score"))    o.maxScoreIndex = choiceIndex(maxScoreChoices, 4, std::atoi(v));
+        else if (!std::strcmp(a, "--send-every"))   o.sendEvery   = std::atoi(v);
+        else if (!std::strcmp(a, "--idle-timeout")) o.idleTimeout = (float)std::atof(v);
+        else if (!std::strcmp(a, "--report"))       o.reportSec   = (float)std::atof(v);
+        else if (!std::strcmp(a, "--metrics"))      o.metricsPath = v;
+        else if (!std::strcmp(a, "--replays"))      o.replayDir   = v;
+        else if (!std::strcmp(a, "--max-viewers"))  o.maxViewers  = std::atoi(v);
+        else if (!std::strcmp(a, "--shard-viewers")) o.shardViewers = std::atoi(v);
+        else return false;
+    }
+    if (o.shards <= 0) {
+        o.shards = (int)std::thread::hardware_concurrency();
+        if (o.shards <= 0) o.shards = 1;
+    }
+    return o.port > 0 && o.port + o.shards < 65536 && o.tickHz > 0 && o.tickHz <= 1000 &&
+           o.maxMatches > 0 && o.gameTimeIndex >= 0 && o.maxScoreIndex >= 0 &&
+           o.sendEvery > 0 && o.idleTimeout > 0.0f && o.reportSec > 0.0f &&
+           o.maxViewers >= 0 && o.shardViewers >= 0;
+}
+
+static uint64_t nowNs() {
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// ===================== MATCHES =====================
+
+enum HostedPhase {
+    HOSTED_WAITING,     // until every human slot has sent an input
+    HOSTED_PLAYING,
+    HOSTED_OVER         // still sending the final state for a moment
+};
+
+struct Viewer {
+    sockaddr_in addr;
+    uint64_t    renewedNs;          // last WATCH
+};
+
+struct HostedMatch {
+    uint32_t    id;
+    int         shard;
+    int         phase;
+    uint64_t    phaseSinceNs;
+    bool        abandoned;          // timed out or a player left
+
+    // Per slot (left, right). The right slot is the AI in vs-AI matches.
+    bool        human[2];
+    uint32_t    token[2];
+    sockaddr_in addr[2];
+    bool        heard[2];
+    uint64_t    lastHeardNs[2];
+    uint8_t     keys[2];
+    uint32_t    ackSeq[2];
+
+    Replay      log;                // setup + every tick's keys
+    MatchState  state;
+    AiState     ai;
+
+    Histogram   stepNs;             // this match's step times
+
+    // Spectators, by address. One packet per frame, shared by all of them.
+    std::unordered_map<uint64_t, Viewer> viewers;
+    SpectatorEncoder spectator;
+    uint8_t          spectatePacket[serverSpectateHeaderSize + spectatorMaxPacket];
+};
+
+struct ShardStats {
+    Histogram tickNs;               // a whole tick of the shard
+    Histogram stepNs;               // one match, one tick
+    uint64_t  lateTicks;            // timer periods lost to a tick running long
+    uint64_t  packetsIn, packetsOut, badPackets;
+    uint64_t  spectateFrames;       // encoded, one per watched match per frame
+    uint64_t  spectatePackets;      // sent to viewers
+    int       matches, playing;     // at the last tick
+    int       viewers;
+};
+
+struct Shard {
+    int         index;
+    int         port;
+    int         sock, epollFd, timerFd;
+    std::thread thread;
+
+    // Owned by the shard thread
+    std::vector<HostedMatch*>         matches;
+    std::unordered_map<uint32_t, int> byId;        // match id -> index in matches
+    uint64_t                          tickCount;
+    int                               viewerCount; // over all matches
+    ShardStats                        local;       // this tick, merged into stats
+    PacketBatch                       batch;
+
+    // Shared with the lobby
+    std::mutex                lock;
+    std::vector<HostedMatch*> incoming;            // new matches from the lobby
+    std::vector<HostedMatch*> finished;            // back to the lobby for metrics
+    ShardStats                stats;               // since the last report
+};
+
+static void clearStats(ShardStats& s) {
+    histogramClear(s.tickNs);
+    histogramClear(s.stepNs);
+    s.lateTicks = s.packetsIn = s.packetsOut = s.badPackets = 0;
+    s.spectateFrames = s.spectatePackets = 0;
+    s.matches = s.playing = s.viewers = 0;
+}
+
+static void setPhase(HostedMatch& m, int phase, uint64_t now) {
+    m.phase        = phase;
+    m.phaseSinceNs = now;
+}
+
+static uint64_t addressKey(const sockaddr_in& addr) {
+    return ((uint64_t)addr.sin_addr.s_addr << 16) | addr.sin_port;
+}
+
+// ===================== SHARD =====================
+
+static void handleWatch(Shard& sh, const ServerOptions& o, uint32_t matchId,
+                        const sockaddr_in& from, uint64_t now) {
+    std::unordered_map<uint32_t, int>::iterator it = sh.byId.find(matchId);
+    if (it == sh.byId.end()) return;
+
+    HostedMatch& m = *sh.matches[it->second];
+    uint64_t key = addressKey(from);
+    if (!m.viewers.count(key)) {
+        if ((int)m.viewers.size() >= o.maxViewers || sh.viewerCount >= o.shardViewers) {
+            sh.local.badPackets++;
+            return;
+        }
+        sh.viewerCount++;
+    }
+
+    Viewer& v   = m.viewers[key];
+    v.addr      = from;
+    v.renewedNs = now;
+}
+
+static void handleShardPacket(Shard& sh, const ServerOptions& o, const uint8_t* data, int size,
+                              const sockaddr_in& from, uint64_t now) {
+    int type = serverPacketType(data, size);
+    uint32_t matchId, token;
+    int slot;
+    ServerInput in;
+
+    if (type == SERVER_INPUT && serverDecodeInput(data, size, in)) {
+        matchId = in.matchId;
+        slot    = in.slot;
+        token   = in.token;
+    } else if (type == SERVER_LEAVE && serverDecodeLeave(data, size, matchId, slot, token)) {
+        // checked below
+    } else if (type == SERVER_WATCH && serverDecodeWatch(data, size, matchId)) {
+        handleWatch(sh, o, matchId, from, now);
+        return;
+    } else {
+        sh.local.badPackets++;
+        return;
+    }
+
+    std::unordered_map<uint32_t, int>::iterator it = sh.byId.find(matchId);
+    if (it == sh.byId.end()) return;                       // finished already
+    HostedMatch& m = *sh.matches[it->second];
+    if (!m.human[slot] || m.token[slot] != token) {
+        sh.local.badPackets++;
+        return;
+    }
+
+    m.addr[slot]        = from;
+    m.lastHeardNs[slot] = now;
+    if (type == SERVER_LEAVE) {
+        if (m.phase != HOSTED_OVER) {
+            m.abandoned = true;
+            setPhase(m, HOSTED_OVER, now);
+        }
+        return;
+    }
+
+    // Newest keys win; a late, reordered packet doesn't undo them
+    if (!m.heard[slot] || (int32_t)(in.seq - m.ackSeq[slot]) > 0) {
+        m.keys[slot]   = in.keys;
+        m.ackSeq[slot] = in.seq;
+    }
+    m.heard[slot] = true;
+}
+
+// Everything that has arrived, udpBatchSize datagrams per system call.
+static void receiveInputs(Shard& sh, const ServerOptions& o, uint64_t now) {
+    int n;
+    do {
+        n = udpReceive(sh.sock, sh.batch);
+        sh.local.packetsIn += (uint64_t)n;
+        for (int i = 0; i < n; ++i) {
+            handleShardPacket(sh, o, sh.batch.data[i], (int)sh.batch.msgs[i].msg_len,
+                              sh.batch.addrs[i], now);
+        }
+    } while (n == udpBatchSize);
+}
+
+static void flushSends(Shard& sh) {
+    sh.local.packetsOut += (uint64_t)udpSend(sh.sock, sh.batch);
+}
+
+static void queueState(Shard& sh, const HostedMatch& m, int slot) {
+    const MatchState& s = m.state;
+    ServerState st;
+    st.matchId  = m.id;
+    st.slot     = slot;
+    st.tick     = s.tick;
+    st.ackSeq   = m.ackSeq[slot];
+    st.started  = m.phase != HOSTED_WAITING;
+    st.over     = m.phase == HOSTED_OVER;
+    st.ballX    = s.ball.x;
+    st.ballY    = s.ball.y;
+    st.p1X      = s.p1.x;
+    st.p1Y      = s.p1.y;
+    st.p2X      = s.p2.x;
+    st.p2Y      = s.p2.y;
+    st.scoreP1  = s.scoreP1;
+    st.scoreP2  = s.scoreP2;
+    st.timeLeft = s.timeLeft;
+
+    int i = sh.batch.add(m.addr[slot]);
+    sh.batch.setSize(i, serverEncodeState(sh.batch.data[i], st));
+    if (sh.batch.full()) flushSends(sh);
+}
+
+static void stepMatch(Shard& sh, HostedMatch& m, uint64_t now, uint64_t idleNs) {
+    // Players who went quiet forfeit the match
+    for (int slot = 0; slot < 2; ++slot) {
+        if (!m.human[slot] || m.phase == HOSTED_OVER) continue;
+        uint64_t since = m.heard[slot] ? m.lastHeardNs[slot] : m.phaseSinceNs;
+        if (now - since > idleNs) {
+            m.abandoned = true;
+            setPhase(m, HOSTED_OVER, now);
+        }
+    }
+
+    if (m.phase == HOSTED_WAITING &&
+        (!m.human[0] || m.heard[0]) && (!m.human[1] || m.heard[1])) {
+        setPhase(m, HOSTED_PLAYING, now);
+    }
+    if (m.phase != HOSTED_PLAYING) return;
+
+    uint8_t bits = (uint8_t)(m.keys[0] | (m.keys[1] << 4));
+
+    uint64_t t0 = nowNs();
+    replayRecordTick(m.log, m.state, m.ai, bits);
+    uint64_t ns = nowNs() - t0;
+
+    histogramAdd(m.stepNs, ns);
+    histogramAdd(sh.local.stepNs, ns);
+    spectatorNoteEvents(m.spectator, m.state.events);
+    if (m.state.over) setPhase(m, HOSTED_OVER, now);
+}
+
+// Encodes the frame once and queues the same bytes to every viewer.
+static void broadcast(Shard& sh, HostedMatch& m, uint64_t now) {
+    const uint64_t expireNs = (uint64_t)(serverWatchExpireSec * 1e9);
+    std::unordered_map<uint64_t, Viewer>::iterator it = m.viewers.begin();
+    while (it != m.viewers.end()) {
+        if (now - it->second.renewedNs > expireNs) {
+            m.viewers.erase(it++);
+            sh.viewerCount--;
+        } else {
+            ++it;
+        }
+    }
+    if (m.viewers.empty()) return;
+
+    int size = serverEncodeSpectateHeader(m.spectatePacket, m.id);
+    if (m.phase == HOSTED_OVER && !m.state.over) {
+        MatchState ended = m.state;                        // abandoned: end it for viewers too
+        ended.over = true;
+        size += spectatorEncode(m.spectator, ended, m.spectatePacket + size);
+    } else {
+        size += spectatorEncode(m.spectator, m.state, m.spectatePacket + size);
+    }
+    sh.local.spectateFrames++;
+
+    for (it = m.viewers.begin(); it != m.viewers.end(); ++it) {
+        sh.batch.addShared(it->second.addr, m.spectatePacket, size);
+        if (sh.batch.full()) flushSends(sh);
+    }
+    sh.local.spectatePackets += m.viewers.size();
+}
+
+static void removeMatch(Shard& sh, int index) {
+    HostedMatch* m = sh.matches[index];
+    sh.byId.erase(m->id);
+    sh.viewerCount -= (int)m->viewers.size();
+    if (index != (int)sh.matches.size() - 1) {
+        sh.matches[index] = sh.matches.back();
+        sh.byId[sh.matches[index]->id] = index;
+    }
+    sh.matches.pop_back();
+    sh.finished.push_back(m);       // caller holds sh.lock
+}
+
+static void runTick(Shard& sh, const ServerOptions& o, uint64_t expirations) {
+    uint64_t start = nowNs();
+
+    {
+        std::lock_guard<std::mutex> guard(sh.lock);
+        for (size_t i = 0; i < sh.incoming.size(); ++i) {
+            sh.byId[sh.incoming[i]->id] = (int)sh.matches.size();
+            sh.matches.push_back(sh.incoming[i]);
+        }
+        sh.incoming.clear();
+    }
+
+    // All inputs since the last tick, then every match steps with them.
+    // If the thread fell behind, catch up a few ticks; beyond that the
+    // matches run slow rather than burning a backlog.
+    receiveInputs(sh, o, start);
+    uint64_t steps = expirations < 4 ? expirations : 4;
+    sh.local.lateTicks += expirations - 1;
+    uint64_t idleNs = (uint64_t)(o.idleTimeout * 1e9);
+    for (uint64_t k = 0; k < steps; ++k) {
+        for (size_t i = 0; i < sh.matches.size(); ++i) stepMatch(sh, *sh.matches[i], start, idleNs);
+    }
+    sh.tickCount++;
+
+    // States to the players: playing matches every sendEvery ticks, the
+    // rest a few times a second
+    bool playingSend = sh.tickCount % (uint64_t)o.sendEvery == 0;
+    bool slowSend    = sh.tickCount % (uint64_t)(o.tickHz / 4 > 0 ? o.tickHz / 4 : 1) == 0;
+    uint64_t lingerNs = 1000000000ULL;                     // final state, 1 s
+    int playing = 0, viewers = 0;
+
+    sh.batch.count = 0;
+    std::vector<int> done;
+    for (size_t i = 0; i < sh.matches.size(); ++i) {
+        HostedMatch& m = *sh.matches[i];
+        if (m.phase == HOSTED_PLAYING) playing++;
+        if (m.phase == HOSTED_OVER && start - m.phaseSinceNs > lingerNs) {
+            done.push_back((int)i);
+            continue;
+        }
+        if (m.phase == HOSTED_PLAYING ? playingSend : slowSend) {
+            for (int slot = 0; slot < 2; ++slot) {
+                if (m.human[slot] && m.heard[slot]) queueState(sh, m, slot);
+            }
+            broadcast(sh, m, start);
+        }
+        viewers += (int)m.viewers.size();
+    }
+    flushSends(sh);
+
+    histogramAdd(sh.local.tickNs, nowNs() - start);
+    sh.local.matches = (int)sh.matches.size();
+    sh.local.playing = playing;
+    sh.local.viewers = viewers;
+
+    std::lock_guard<std::mutex> guard(sh.lock);
+    for (size_t k = done.size(); k-- > 0;) removeMatch(sh, done[k]);   // highest index first
+
+    histogramMerge(sh.stats.tickNs, sh.local.tickNs);
+    histogramMerge(sh.stats.stepNs, sh.local.stepNs);
+    sh.stats.lateTicks  += sh.local.lateTicks;
+    sh.stats.packetsIn  += sh.local.packetsIn;
+    sh.stats.packetsOut += sh.local.packetsOut;
+    sh.stats.badPackets += sh.local.badPackets;
+    sh.stats.spectateFrames  += sh.local.spectateFrames;
+    sh.stats.spectatePackets += sh.local.spectatePackets;
+    sh.stats.matches     = sh.local.matches;
+    sh.stats.playing     = sh.local.playing;
+    sh.stats.viewers     = sh.local.viewers;
+    clearStats(sh.local);
+}
+
+static void shardLoop(Shard& sh, const ServerOptions& o, const std::atomic<bool>& running) {
+    epoll_event events[4];
+    while (running.load()) {
+        int n = epoll_wait(sh.epollFd, events, 4, 100);
+        for (int i = 0; i < n; ++i) {
+            if (events[i].data.fd == sh.timerFd) {
+                uint64_t expirations = timerRead(sh.timerFd);
+                if (expirations > 0) runTick(sh, o, expirations);
+            } else {
+                receiveInputs(sh, o, nowNs());
+            }
+        }
+    }
+}
+
+static bool startShard(Shard& sh, int index, const ServerOptions& o) {
+    sh.index     = index;
+    sh.port      = o.port + 1 + index;
+    sh.tickCount   = 0;
+    sh.viewerCount = 0;
+    clearStats(sh.local);
+    clearStats(sh.stats);
+
+    // Inputs for thousands of matches arrive between two ticks
+    sh.sock    = udpOpen(sh.port, 4 << 20);
+    sh.timerFd = timerOpen(1.0 / o.tickHz);
+    sh.epollFd = epoll_create1(0);
+    if (sh.sock < 0 || sh.timerFd < 0 || sh.epollFd < 0) return false;
+
+    epollWatch(sh.epollFd, sh.sock);
+    epollWatch(sh.epollFd, sh.timerFd);
+    return true;
+}
+
+// ===================== LOBBY =====================
+
+struct RecentAssign {
+    ServerAssign assign;
+    uint64_t     atNs;
+};
+
+// (address, port, nonce) of a client's JOIN
+typedef std::pair<uint64_t, uint32_t> ClientKey;
+
+struct Lobby {
+    int      sock;
+    MatchRng rng;
+    uint32_t nextMatchId;
+    int      hosted;                    // matches on all shards
+    std::vector<int> load;              // matches per shard
+
+    // A client waiting for an opponent
+    bool        waiting;
+    ClientKey   waitingKey;
+    sockaddr_in waitingAddr;
+    uint32_t    waitingNonce;
+    uint64_t    waitingSinceNs;
+
+    std::map<ClientKey, RecentAssign> recent;   // to answer repeated JOINs
+    std::unordered_map<uint32_t, int> matchShard;   // running match id -> shard, for WATCH
+
+    FILE*    metrics;
+    uint64_t finishedCount, abandonedCount;
+};
+
+static ClientKey clientKey(const sockaddr_in& addr, uint32_t nonce) {
+    return ClientKey(addressKey(addr), nonce);
+}
+
+static void sendTo(int sock, const uint8_t* data, int size, const sockaddr_in& to) {
+    sendto(sock, data, (size_t)size, 0, (const sockaddr*)&to, sizeof(to));
+}
+
+static HostedMatch* createMatch(Lobby& lobby, const ServerOptions& o, bool vsAi, int difficulty,
+                                uint64_t now) {
+    HostedMatch* m = new HostedMatch;
+    m->id        = lobby.nextMatchId++;
+    m->abandoned = false;
+    setPhase(*m, HOSTED_WAITING, now);
+
+    // Least loaded shard
+    m->shard = 0;
+    for (int i = 1; i < (int)lobby.load.size(); ++i) {
+        if (lobby.load[i] < lobby.load[m->shard]) m->shard = i;
+    }
+
+    for (int slot = 0; slot < 2; ++slot) {
+        m->human[slot]       = slot == 0 || !vsAi;
+        m->token[slot]       = rngNext(lobby.rng) | 1;
+        m->heard[slot]       = false;
+        m->lastHeardNs[slot] = 0;
+        m->keys[slot]        = 0;
+        m->ackSeq[slot]      = 0;
+        std::memset(&m->addr[slot], 0, sizeof(m->addr[slot]));
+    }
+
+    // The same setup the game uses for these settings
+    Replay& r = m->log;
+    r.seed            = ((uint64_t)rngNext(lobby.rng) << 32) | rngNext(lobby.rng);
+    r.singlePlayer    = vsAi;
+    r.gameTimeIndex   = o.gameTimeIndex;
+    r.maxScoreIndex   = o.maxScoreIndex;
+    r.difficultyIndex = vsAi ? difficulty : 0;
+    r.tickRate        = o.tickHz;
+    r.config.gameTime = (float)gameTimeChoices[o.gameTimeIndex];
+    r.config.maxScore = maxScoreChoices[o.maxScoreIndex];
+    r.config.p1Speed  = humanPaddleSpeed;
+    r.config.p2Speed  = vsAi ? aiParams(difficulty).maxSpeed : humanPaddleSpeed;
+    replayBegin(r, m->state, m->ai);
+    histogramClear(m->stepNs);
+    spectatorEncoderInit(m->spectator, o.tickHz / 2);     // a keyframe every half second
+
+    lobby.matchShard[m->id] = m->shard;
+    lobby.load[m->shard]++;
+    lobby.hosted++;
+    return m;
+}
+
+static ServerAssign assignFor(const HostedMatch& m, const std::vector<Shard*>& shards,
+                              uint32_t nonce, int slot) {
+    ServerAssign a;
+    a.nonce    = nonce;
+    a.port     = (uint16_t)shards[m.shard]->port;
+    a.matchId  = m.id;
+    a.slot     = slot;
+    a.token    = m.token[slot];
+    a.tickRate = m.log.tickRate;
+    a.gameTime = m.log.config.gameTime;
+    a.maxScore = m.log.config.maxScore;
+    return a;
+}
+
+static void sendAssign(Lobby& lobby, const ServerAssign& a, const ClientKey& key,
+                       const sockaddr_in& to, uint64_t now) {
+    uint8_t buf[udpMaxDatagram];
+    sendTo(lobby.sock, buf, serverEncodeAssign(buf, a), to);
+    RecentAssign& r = lobby.recent[key];
+    r.assign = a;
+    r.atNs   = now;
+}
+
+static void handOver(HostedMatch* m, std::vector<Shard*>& shards) {
+    std::lock_guard<std::mutex> guard(shards[m->shard]->lock);
+    shards[m->shard]->incoming.push_back(m);
+}
+
+static void handleJoin(Lobby& lobby, std::vector<Shard*>& shards, const ServerOptions& o,
+                       const ServerJoin& join, const sockaddr_in& from, uint64_t now) {
+    uint8_t buf[udpMaxDatagram];
+    ClientKey key = clientKey(from, join.nonce);
+
+    // A repeated JOIN: the ASSIGN got lost, or we're still pairing
+    std::map<ClientKey, RecentAssign>::iterator seen = lobby.recent.find(key);
+    if (seen != lobby.recent.end()) {
+        sendTo(lobby.sock, buf, serverEncodeAssign(buf, seen->second.assign), from);
+        return;
+    }
+    if (lobby.waiting && lobby.waitingKey == key) {
+        lobby.waitingSinceNs = now;
+        return;
+    }
+
+    if (lobby.hosted >= o.maxMatches) {
+        sendTo(lobby.sock, buf, serverEncodeFull(buf, join.nonce), from);
+        return;
+    }
+
+    if (join.vsAi) {
+        int difficulty = join.difficulty < 0 ? 0 : (join.difficulty > 2 ? 2 : join.difficulty);
+        HostedMatch* m = createMatch(lobby, o, true, difficulty, now);
+        sendAssign(lobby, assignFor(*m, shards, join.nonce, 0), key, from, now);
+        handOver(m, shards);
+        return;
+    }
+
+    if (!lobby.waiting) {
+        lobby.waiting        = true;
+        lobby.waitingKey     = key;
+        lobby.waitingAddr    = from;
+        lobby.waitingNonce   = join.nonce;
+        lobby.waitingSinceNs = now;
+        return;
+    }
+
+    // Pair with whoever has been waiting; the first comer gets the left paddle
+    HostedMatch* m = createMatch(lobby, o, false, 0, now);
+    sendAssign(lobby, assignFor(*m, shards, lobby.waitingNonce, 0), lobby.waitingKey,
+               lobby.waitingAddr, now);
+    sendAssign(lobby, assignFor(*m, shards, join.nonce, 1), key, from, now);
+    lobby.waiting = false;
+    handOver(m, shards);
+}
+
+// Where to watch a match; id 0 asks for the newest one.
+static void handleWatchRequest(Lobby& lobby, std::vector<Shard*>& shards, const ServerOptions& o,
+                               uint32_t matchId, const sockaddr_in& from) {
+    if (matchId == 0) {
+        std::unordered_map<uint32_t, int>::iterator it;
+        for (it = lobby.matchShard.begin(); it != lobby.matchShard.end(); ++it) {
+            if (it->first > matchId) matchId = it->first;
+        }
+    }
+
+    ServerWatchAt at;
+    at.matchId  = 0;
+    at.port     = 0;
+    at.tickRate = o.tickHz;
+    std::unordered_map<uint32_t, int>::iterator found = lobby.matchShard.find(matchId);
+    if (found != lobby.matchShard.end()) {
+        at.matchId = matchId;
+        at.port    = (uint16_t)shards[found->second]->port;
+    }
+
+    uint8_t buf[udpMaxDatagram];
+    sendTo(lobby.sock, buf, serverEncodeWatchAt(buf, at), from);
+}
+
+static void receiveJoins(Lobby& lobby, std::vector<Shard*>& shards, const ServerOptions& o) {
+    uint8_t buf[udpMaxDatagram];
+    for (;;) {
+        sockaddr_in from;
+        socklen_t   fromLen = sizeof(from);
+        ssize_t n = recvfrom(lobby.sock, buf, sizeof(buf), 0, (sockaddr*)&from, &fromLen);
+        if (n <= 0) return;
+
+        int type = serverPacketType(buf, (int)n);
+        ServerJoin join;
+        uint32_t matchId;
+        if (type == SERVER_JOIN && serverDecodeJoin(buf, (int)n, join)) {
+            handleJoin(lobby, shards, o, join, from, nowNs());
+        } else if (type == SERVER_WATCH && serverDecodeWatch(buf, (int)n, matchId)) {
+            handleWatchRequest(lobby, shards, o, matchId, from);
+        }
+    }
+}
+
+// ===================== REPORTS =====================
+
+static void writeMetricsHeader(FILE* f) {
+    std::fprintf(f, "match,shard,vs_ai,difficulty,ticks,score_p1,score_p2,abandoned,"
+                    "step_mean_ns,step_p50_ns,step_p99_ns,step_max_ns\n");
+}
+
+static void retireMatch(Lobby& lobby, const ServerOptions& o, HostedMatch* m) {
+    const Histogram& h = m->stepNs;
+    if (lobby.metrics) {
+        std::fprintf(lobby.metrics, "%u,%d,%d,%d,%u,%d,%d,%d,%.0f,%llu,%llu,%llu\n",
+                     m->id, m->shard, m->log.singlePlayer ? 1 : 0, m->log.difficultyIndex,
+                     (unsigned)m->state.tick, m->state.scoreP1, m->state.scoreP2, m->abandoned ? 1 : 0,
+                     histogramMean(h),
+                     (unsigned long long)histogramPercentile(h, 0.50),
+                     (unsigned long long)histogramPercentile(h, 0.99),
+                     (unsigned long long)h.maxValue);
+    }
+    if (o.replayDir && m->state.tick > 0) {
+        char path[1024];
+        std::snprintf(path, sizeof(path), "%s/match_%u.prr", o.replayDir, m->id);
+        replayFinish(m->log, m->state);
+        if (!replaySave(m->log, path)) std::fprintf(stderr, "could not write %s\n", path);
+    }
+
+    if (m->abandoned) lobby.abandonedCount++;
+    else              lobby.finishedCount++;
+    lobby.matchShard.erase(m->id);
+    lobby.load[m->shard]--;
+    lobby.hosted--;
+    delete m;
+}
+
+static void report(Lobby& lobby, std::vector<Shard*>& shards, const ServerOptions& o,
+                   double elapsed, double intervalSec) {
+    ShardStats total;
+    clearStats(total);
+    std::vector<uint64_t> shardP99(shards.size());
+    std::vector<HostedMatch*> finished;
+
+    for (size_t i = 0; i < shards.size(); ++i) {
+        Shard& sh = *shards[i];
+        std::lock_guard<std::mutex> guard(sh.lock);
+        histogramMerge(total.tickNs, sh.stats.tickNs);
+        histogramMerge(total.stepNs, sh.stats.stepNs);
+        total.lateTicks  += sh.stats.lateTicks;
+        total.packetsIn  += sh.stats.packetsIn;
+        total.packetsOut += sh.stats.packetsOut;
+        total.badPackets += sh.stats.badPackets;
+        total.spectateFrames  += sh.stats.spectateFrames;
+        total.spectatePackets += sh.stats.spectatePackets;
+        total.matches    += sh.stats.matches;
+        total.playing    += sh.stats.playing;
+        total.viewers    += sh.stats.viewers;
+        shardP99[i] = histogramPercentile(sh.stats.tickNs, 0.99);
+        finished.insert(finished.end(), sh.finished.begin(), sh.finished.end());
+        sh.finished.clear();
+
+        int matches = sh.stats.matches, playing = sh.stats.playing, viewers = sh.stats.viewers;
+        clearStats(sh.stats);
+        sh.stats.matches = matches;
+        sh.stats.playing = playing;
+        sh.stats.viewers = viewers;
+    }
+
+    uint64_t doneBefore = lobby.finishedCount, abandonedBefore = lobby.abandonedCount;
+    for (size_t i = 0; i < finished.size(); ++i) retireMatch(lobby, o, finished[i]);
+    if (lobby.metrics) std::fflush(lobby.metrics);
+
+    double budgetMs = 1000.0 / o.tickHz;
+    std::printf("[%6.0f s] %d matches (%d playing)  +%llu finished +%llu abandoned\n",
+                elapsed, total.matches, total.playing,
+                (unsigned long long)(lobby.finishedCount - doneBefore),
+                (unsigned long long)(lobby.abandonedCount - abandonedBefore));
+    std::printf("           tick  p50 %.3f  p99 %.3f  max %.3f ms of %.2f ms   late %llu\n",
+                histogramPercentile(total.tickNs, 0.50) / 1e6, histogramPercentile(total.tickNs, 0.99) / 1e6,
+                total.tickNs.maxValue / 1e6, budgetMs, (unsigned long long)total.lateTicks);
+    std::printf("           step  p50 %llu  p99 %llu  max %llu ns per match\n",
+                (unsigned long long)histogramPercentile(total.stepNs, 0.50),
+                (unsigned long long)histogramPercentile(total.stepNs, 0.99),
+                (unsigned long long)total.stepNs.maxValue);
+    std::printf("           packets in %.0f/s  out %.0f/s  bad %llu\n",
+                total.packetsIn / intervalSec, total.packetsOut / intervalSec,
+                (unsigned long long)total.badPackets);
+    if (total.viewers > 0 || total.spectatePackets > 0) {
+        std::printf("           spectators %d  frames encoded %.0f/s, sent %.0f/s\n",
+                    total.viewers, total.spectateFrames / intervalSec, total.spectatePackets / intervalSec);
+    }
+    if (shards.size() > 1) {
+        std::printf("           shard tick p99 (ms):");
+        for (size_t i = 0; i < shards.size(); ++i) std::printf(" %.3f", shardP99[i] / 1e6);
+        std::printf("\n");
+    }
+    std::fflush(stdout);
+}
+
+// Forgets JOIN answers and waiting clients nobody asked about for a while.
+static void expireLobby(Lobby& lobby, uint64_t now) {
+    const uint64_t keepNs = 30ULL * 1000000000ULL;
+    std::map<ClientKey, RecentAssign>::iterator it = lobby.recent.begin();
+    while (it != lobby.recent.end()) {
+        if (now - it->second.atNs > keepNs) lobby.recent.erase(it++);
+        else                                ++it;
+    }
+    if (lobby.waiting && now - lobby.waitingSinceNs > keepNs) lobby.waiting = false;
+}
+
+// ===================== MAIN =====================
+
+int main(int argc, char** argv) {
+    ServerOptions o;
+    if (!parseOptions(argc, argv, o)) {
+        printUsage();
+        return 1;
+    }
+
+    // SIGINT / SIGTERM arrive through the lobby's epoll
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, 0);   // before the shard threads inherit the mask
+    int signalFd = signalfd(-1, &signals, SFD_NONBLOCK);
+
+    Lobby lobby;
+    lobby.sock           = udpOpen(o.port, 1 << 20);
+    lobby.nextMatchId    = 1;
+    lobby.hosted         = 0;
+    lobby.load.assign(o.shards, 0);
+    lobby.waiting        = false;
+    lobby.metrics        = 0;
+    lobby.finishedCount  = 0;
+    lobby.abandonedCount = 0;
+    rngSeed(lobby.rng, nowNs() ^ ((uint64_t)getpid() << 32));
+    if (lobby.sock < 0) {
+        std::fprintf(stderr, "could not bind UDP port %d\n", o.port);
+        return 1;
+    }
+    if (o.metricsPath) {
+        lobby.metrics = std::fopen(o.metricsPath, "w");
+        if (!lobby.metrics) {
+            std::fprintf(stderr, "could not write %s\n", o.metricsPath);
+            return 1;
+        }
+        writeMetricsHeader(lobby.metrics);
+    }
+
+    std::atomic<bool> running(true);
+    std::vector<Shard*> shards(o.shards);
+    for (int i = 0; i < o.shards; ++i) {
+        shards[i] = new Shard;
+        if (!startShard(*shards[i], i, o)) {
+            std::fprintf(stderr, "could not start shard %d (UDP port %d)\n", i, o.port + 1 + i);
+            return 1;
+        }
+    }
+    for (int i = 0; i < o.shards; ++i) {
+        Shard* sh = shards[i];
+        sh->thread = std::thread([sh, &o, &running]() { shardLoop(*sh, o, running); });
+    }
+
+    std::printf("lobby on UDP %d, %d shard(s) on %d-%d, %d Hz, up to %d matches\n",
+                o.port, o.shards, o.port + 1, o.port + o.shards, o.tickHz, o.maxMatches);
+    std::fflush(stdout);
+
+    int reportFd = timerOpen(o.reportSec);
+    int epollFd  = epoll_create1(0);
+    epollWatch(epollFd, lobby.sock);
+    epollWatch(epollFd, reportFd);
+    epollWatch(epollFd, signalFd);
+
+    uint64_t started = nowNs();
+    bool quit = false;
+    while (!quit) {
+        epoll_event events[4];
+        int n = epoll_wait(epollFd, events, 4, -1);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == lobby.sock) {
+                receiveJoins(lobby, shards, o);
+            } else if (fd == reportFd) {
+                uint64_t expirations = timerRead(reportFd);
+                if (expirations == 0) continue;
+                uint64_t now = nowNs();
+                report(lobby, shards, o, (now - started) / 1e9, o.reportSec * (double)expirations);
+                expireLobby(lobby, now);
+            } else if (fd == signalFd) {
+                quit = true;
+            }
+        }
+    }
+
+    running = false;
+    for (int i = 0; i < o.shards; ++i) shards[i]->thread.join();
+    report(lobby, shards, o, (nowNs() - started) / 1e9, o.reportSec);
+
+    // Matches still running are left out of the metrics
+    std::printf("shutting down: %llu matches finished, %llu abandoned\n",
+                (unsigned long long)lobby.finishedCount, (unsigned long long)lobby.abandonedCount);
+    if (lobby.metrics) std::fclose(lobby.metrics);
+    return 0;
+}
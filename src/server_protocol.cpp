@@ -0,0 +1,205 @@
+#include "server_protocol.h"
+
+#include <cstring>
+
+#include "net_wire.h"
+
+// ===================== LAYOUT =====================
+//
+//   JOIN    u16 version u32 nonce u8 vsAi u8 difficulty
+//   ASSIGN  u32 nonce u16 port u32 matchId u8 slot u32 token u16 tickRate
+//           f32 gameTime i32 maxScore
+//   FULL    u32 nonce
+//   INPUT   u32 matchId u8 slot u32 token u32 seq u8 keys
+//   STATE   u32 matchId u8 slot u32 tick u32 ackSeq u8 flags (1 started, 2 over)
+//           f32 ballX ballY p1X p1Y p2X p2Y u8 scoreP1 u8 scoreP2 f32 timeLeft
+//   LEAVE   u32 matchId u8 slot u32 token
+//   WATCH     u32 matchId
+//   WATCH_AT  u32 matchId u16 port u16 tickRate
+//   SPECTATE  u32 matchId, then a spectator frame
+
+static const char* serverMagic = "PRS";
+
+static int finish(uint8_t* buf, const NetWriter& w) {
+    std::memcpy(buf, w.buf, w.size);
+    return w.size;
+}
+
+int serverEncodeJoin(uint8_t* buf, const ServerJoin& p) {
+    NetWriter w(serverMagic, SERVER_JOIN);
+    w.u16(serverProtocolVersion);
+    w.u32(p.nonce);
+    w.u8(p.vsAi ? 1 : 0);
+    w.u8(p.difficulty);
+    return finish(buf, w);
+}
+
+int serverEncodeAssign(uint8_t* buf, const ServerAssign& p) {
+    NetWriter w(serverMagic, SERVER_ASSIGN);
+    w.u32(p.nonce);
+    w.u16(p.port);
+    w.u32(p.matchId);
+    w.u8(p.slot);
+    w.u32(p.token);
+    w.u16(p.tickRate);
+    w.f32(p.gameTime);
+    w.u32((uint32_t)p.maxScore);
+    return finish(buf, w);
+}
+
+int serverEncodeFull(uint8_t* buf, uint32_t nonce) {
+    NetWriter w(serverMagic, SERVER_FULL);
+    w.u32(nonce);
+    return finish(buf, w);
+}
+
+int serverEncodeInput(uint8_t* buf, const ServerInput& p) {
+    NetWriter w(serverMagic, SERVER_INPUT);
+    w.u32(p.matchId);
+    w.u8(p.slot);
+    w.u32(p.token);
+    w.u32(p.seq);
+    w.u8(p.keys);
+    return finish(buf, w);
+}
+
+int serverEncodeState(uint8_t* buf, const ServerState& p) {
+    NetWriter w(serverMagic, SERVER_STATE);
+    w.u32(p.matchId);
+    w.u8(p.slot);
+    w.u32(p.tick);
+    w.u32(p.ackSeq);
+    w.u8((p.started ? 1 : 0) | (p.over ? 2 : 0));
+    w.f32(p.ballX);
+    w.f32(p.ballY);
+    w.f32(p.p1X);
+    w.f32(p.p1Y);
+    w.f32(p.p2X);
+    w.f32(p.p2Y);
+    w.u8(p.scoreP1);
+    w.u8(p.scoreP2);
+    w.f32(p.timeLeft);
+    return finish(buf, w);
+}
+
+int serverEncodeLeave(uint8_t* buf, uint32_t matchId, int slot, uint32_t token) {
+    NetWriter w(serverMagic, SERVER_LEAVE);
+    w.u32(matchId);
+    w.u8(slot);
+    w.u32(token);
+    return finish(buf, w);
+}
+
+int serverEncodeWatch(uint8_t* buf, uint32_t matchId) {
+    NetWriter w(serverMagic, SERVER_WATCH);
+    w.u32(matchId);
+    return finish(buf, w);
+}
+
+int serverEncodeWatchAt(uint8_t* buf, const ServerWatchAt& p) {
+    NetWriter w(serverMagic, SERVER_WATCH_AT);
+    w.u32(p.matchId);
+    w.u16(p.port);
+    w.u16(p.tickRate);
+    return finish(buf, w);
+}
+
+int serverEncodeSpectateHeader(uint8_t* buf, uint32_t matchId) {
+    NetWriter w(serverMagic, SERVER_SPECTATE);
+    w.u32(matchId);
+    return finish(buf, w);
+}
+
+// ===================== DECODING =====================
+
+int serverPacketType(const uint8_t* data, int size) {
+    NetReader r(data, size);
+    return netPacketType(r, serverMagic);
+}
+
+bool serverDecodeJoin(const uint8_t* data, int size, ServerJoin& out) {
+    NetReader r(data + 4, size - 4);
+    if (r.u16() != serverProtocolVersion) return false;
+    out.nonce      = r.u32();
+    out.vsAi       = r.u8() != 0;
+    out.difficulty = (int)r.u8();
+    return r.ok;
+}
+
+bool serverDecodeAssign(const uint8_t* data, int size, ServerAssign& out) {
+    NetReader r(data + 4, size - 4);
+    out.nonce    = r.u32();
+    out.port     = (uint16_t)r.u16();
+    out.matchId  = r.u32();
+    out.slot     = (int)r.u8();
+    out.token    = r.u32();
+    out.tickRate = (int)r.u16();
+    out.gameTime = r.f32();
+    out.maxScore = (int)r.u32();
+    return r.ok && out.slot <= 1 && out.tickRate > 0;
+}
+
+bool serverDecodeFull(const uint8_t* data, int size, uint32_t& nonce) {
+    NetReader r(data + 4, size - 4);
+    nonce = r.u32();
+    return r.ok;
+}
+
+bool serverDecodeInput(const uint8_t* data, int size, ServerInput& out) {
+    NetReader r(data + 4, size - 4);
+    out.matchId = r.u32();
+    out.slot    = (int)r.u8();
+    out.token   = r.u32();
+    out.seq     = r.u32();
+    out.keys    = (uint8_t)(r.u8() & 0x0F);
+    return r.ok && out.slot <= 1;
+}
+
+bool serverDecodeState(const uint8_t* data, int size, ServerState& out) {
+    NetReader r(data + 4, size - 4);
+    out.matchId  = r.u32();
+    out.slot     = (int)r.u8();
+    out.tick     = r.u32();
+    out.ackSeq   = r.u32();
+    unsigned flags = r.u8();
+    out.started  = (flags & 1) != 0;
+    out.over     = (flags & 2) != 0;
+    out.ballX    = r.f32();
+    out.ballY    = r.f32();
+    out.p1X      = r.f32();
+    out.p1Y      = r.f32();
+    out.p2X      = r.f32();
+    out.p2Y      = r.f32();
+    out.scoreP1  = (int)r.u8();
+    out.scoreP2  = (int)r.u8();
+    out.timeLeft = r.f32();
+    return r.ok && out.slot <= 1;
+}
+
+bool serverDecodeLeave(const uint8_t* data, int size, uint32_t& matchId, int& slot, uint32_t& token) {
+    NetReader r(data + 4, size - 4);
+    matchId = r.u32();
+    slot    = (int)r.u8();
+    token   = r.u32();
+    return r.ok && slot <= 1;
+}
+
+bool serverDecodeWatch(const uint8_t* data, int size, uint32_t& matchId) {
+    NetReader r(data + 4, size - 4);
+    matchId = r.u32();
+    return r.ok;
+}
+
+bool serverDecodeWatchAt(const uint8_t* data, int size, ServerWatchAt& out) {
+    NetReader r(data + 4, size - 4);
+    out.matchId  = r.u32();
+    out.port     = (uint16_t)r.u16();
+    out.tickRate = (int)r.u16();
+    return r.ok;
+}
+
+bool serverDecodeSpectateHeader(const uint8_t* data, int size, uint32_t& matchId) {
+    NetReader r(data + 4, size - 4);
+    matchId = r.u32();
+    return r.ok;
+}
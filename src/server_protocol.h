@@ -0,0 +1,110 @@
+#ifndef PADDLE_RIVALS_SERVER_PROTOCOL_H
+#define PADDLE_RIVALS_SERVER_PROTOCOL_H
+
+// Packets between the dedicated server and its clients (the load
+// generator, or a game build talking to it).
+//
+// The server is authoritative: clients send the keys they hold, the server
+// steps the match and sends the state back. A client first sends JOIN to
+// the lobby port until it gets ASSIGN (or FULL); ASSIGN names the shard
+// port, match and slot to use from then on. Every packet is "PRS" + a type
+// byte + little-endian fields (see net_wire.h).
+//
+// Spectators send WATCH (match id, 0 = any) to the lobby, which answers
+// WATCH_AT with the match's shard port. WATCH to that port, repeated every
+// couple of seconds, keeps SPECTATE packets coming: the match id and a
+// spectator stream frame (spectator.h).
+
+#include <cstdint>
+
+const uint16_t serverProtocolVersion = 1;
+const int      serverDefaultPort     = 7800;   // lobby; shards use the ports after it
+
+enum ServerPacketType {
+    SERVER_JOIN   = 1,     // client -> lobby
+    SERVER_ASSIGN = 2,     // lobby -> client
+    SERVER_FULL   = 3,     // lobby -> client: no room, try later
+    SERVER_INPUT  = 4,     // client -> shard
+    SERVER_STATE  = 5,     // shard -> client
+    SERVER_LEAVE  = 6,     // client -> shard
+
+    SERVER_WATCH    = 7,   // viewer -> lobby or shard
+    SERVER_WATCH_AT = 8,   // lobby -> viewer
+    SERVER_SPECTATE = 9    // shard -> viewer
+};
+
+const double serverWatchRenewSec  = 2.0;   // viewers repeat WATCH this often
+const double serverWatchExpireSec = 6.0;   // and are dropped after this long without
+
+struct ServerJoin {
+    uint32_t nonce;        // picked by the client; repeated JOINs get the same answer
+    bool     vsAi;         // false: paired with the next client asking for a player
+    int      difficulty;   // AI difficulty 0..2
+};
+
+struct ServerAssign {
+    uint32_t nonce;
+    uint16_t port;         // shard port
+    uint32_t matchId;
+    int      slot;         // 0 = left paddle, 1 = right
+    uint32_t token;        // proves the slot is ours
+    int      tickRate;     // Hz
+    float    gameTime;     // seconds
+    int      maxScore;     // 0 means infinite
+};
+
+struct ServerInput {
+    uint32_t matchId;
+    int      slot;
+    uint32_t token;
+    uint32_t seq;          // client's send counter, echoed in STATE for round trips
+    uint8_t  keys;         // REPLAY_P1_* bits for our own paddle
+};
+
+struct ServerState {
+    uint32_t matchId;
+    int      slot;         // whose state this is (both players may share an address)
+    uint32_t tick;
+    uint32_t ackSeq;       // newest INPUT seq the server had from this slot
+    bool     started;      // false while waiting for the other player
+    bool     over;
+    float    ballX, ballY;
+    float    p1X, p1Y, p2X, p2Y;
+    int      scoreP1, scoreP2;
+    float    timeLeft;
+};
+
+struct ServerWatchAt {
+    uint32_t matchId;      // the match found (0 = none running)
+    uint16_t port;         // its shard
+    int      tickRate;
+};
+
+// Encoders write into buf (at least netMaxDatagram bytes) and return the
+// size. serverPacketType() returns 0 for anything that isn't ours; the
+// decoders return false on short or malformed packets.
+int serverEncodeJoin(uint8_t* buf, const ServerJoin& p);
+int serverEncodeAssign(uint8_t* buf, const ServerAssign& p);
+int serverEncodeFull(uint8_t* buf, uint32_t nonce);
+int serverEncodeInput(uint8_t* buf, const ServerInput& p);
+int serverEncodeState(uint8_t* buf, const ServerState& p);
+int serverEncodeLeave(uint8_t* buf, uint32_t matchId, int slot, uint32_t token);
+int serverEncodeWatch(uint8_t* buf, uint32_t matchId);
+int serverEncodeWatchAt(uint8_t* buf, const ServerWatchAt& p);
+
+// SPECTATE is this header and the stream frame right after it.
+const int serverSpectateHeaderSize = 8;
+int serverEncodeSpectateHeader(uint8_t* buf, uint32_t matchId);
+
+int  serverPacketType(const uint8_t* data, int size);
+bool serverDecodeJoin(const uint8_t* data, int size, ServerJoin& out);
+bool serverDecodeAssign(const uint8_t* data, int size, ServerAssign& out);
+bool serverDecodeFull(const uint8_t* data, int size, uint32_t& nonce);
+bool serverDecodeInput(const uint8_t* data, int size, ServerInput& out);
+bool serverDecodeState(const uint8_t* data, int size, ServerState& out);
+bool serverDecodeLeave(const uint8_t* data, int size, uint32_t& matchId, int& slot, uint32_t& token);
+bool serverDecodeWatch(const uint8_t* data, int size, uint32_t& matchId);
+bool serverDecodeWatchAt(const uint8_t* data, int size, ServerWatchAt& out);
+bool serverDecodeSpectateHeader(const uint8_t* data, int size, uint32_t& matchId);
+
+#endif
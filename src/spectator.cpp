@@ -0,0 +1,258 @@
+#include "spectator.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "net_wire.h"
+
+// ===================== FRAMES =====================
+//
+// Packet: u8 kind (1 keyframe, 2 delta) u32 tick u8 events u16 keyAge
+// (ticks since the keyframe, 0 in one) u16 fieldMask, then one zigzag
+// varint per set bit: the value in a keyframe, value - keyframe value in
+// a delta.
+
+enum SpectatorKind {
+    SPEC_KEYFRAME = 1,
+    SPEC_DELTA    = 2
+};
+
+static const float positionScale = 16.0f;
+
+static int32_t quantize(float v, float scale) {
+    return (int32_t)std::floor(v * scale + 0.5f);
+}
+
+void spectatorCapture(const MatchState& m, unsigned events, SpectatorFrame& out) {
+    out.tick   = m.tick;
+    out.events = events;
+
+    int32_t* v = out.v;
+    v[SPEC_BALL_X]       = quantize(m.ball.x, positionScale);
+    v[SPEC_BALL_Y]       = quantize(m.ball.y, positionScale);
+    v[SPEC_P1_X]         = quantize(m.p1.x, positionScale);
+    v[SPEC_P1_Y]         = quantize(m.p1.y, positionScale);
+    v[SPEC_P2_X]         = quantize(m.p2.x, positionScale);
+    v[SPEC_P2_Y]         = quantize(m.p2.y, positionScale);
+    v[SPEC_TIME_LEFT]    = quantize(m.timeLeft > 0.0f ? m.timeLeft : 0.0f, 1000.0f);
+    v[SPEC_SPEED_FACTOR] = quantize(m.speedFactor, 1000.0f);
+    v[SPEC_SCORE_P1]     = m.scoreP1;
+    v[SPEC_SCORE_P2]     = m.scoreP2;
+    v[SPEC_BALL_RADIUS]  = quantize(m.ball.radius, positionScale);
+    v[SPEC_P1_WIDTH]     = quantize(m.p1.width, positionScale);
+    v[SPEC_P1_HEIGHT]    = quantize(m.p1.height, positionScale);
+    v[SPEC_P2_WIDTH]     = quantize(m.p2.width, positionScale);
+    v[SPEC_P2_HEIGHT]    = quantize(m.p2.height, positionScale);
+    v[SPEC_OVER]         = m.over ? 1 : 0;
+}
+
+void spectatorApply(const SpectatorFrame& f, MatchState& m) {
+    const int32_t* v = f.v;
+    m.ball.x      = v[SPEC_BALL_X] / positionScale;
+    m.ball.y      = v[SPEC_BALL_Y] / positionScale;
+    m.ball.radius = v[SPEC_BALL_RADIUS] / positionScale;
+    m.ball.vx     = 0.0f;
+    m.ball.vy     = 0.0f;
+    m.p1.x        = v[SPEC_P1_X] / positionScale;
+    m.p1.y        = v[SPEC_P1_Y] / positionScale;
+    m.p1.width    = v[SPEC_P1_WIDTH] / positionScale;
+    m.p1.height   = v[SPEC_P1_HEIGHT] / positionScale;
+    m.p2.x        = v[SPEC_P2_X] / positionScale;
+    m.p2.y        = v[SPEC_P2_Y] / positionScale;
+    m.p2.width    = v[SPEC_P2_WIDTH] / positionScale;
+    m.p2.height   = v[SPEC_P2_HEIGHT] / positionScale;
+    m.prevP1      = m.p1;
+    m.prevP2      = m.p2;
+    m.prevBallX   = m.ball.x;
+    m.prevBallY   = m.ball.y;
+
+    m.scoreP1     = v[SPEC_SCORE_P1];
+    m.scoreP2     = v[SPEC_SCORE_P2];
+    m.timeLeft    = v[SPEC_TIME_LEFT] / 1000.0f;
+    m.speedFactor = v[SPEC_SPEED_FACTOR] / 1000.0f;
+    m.tick        = f.tick;
+    m.over        = v[SPEC_OVER] != 0;
+    m.events      = f.events;
+}
+
+// ===================== ENCODER =====================
+
+struct ByteWriter {
+    uint8_t* p;
+
+    void u8(unsigned v)  { *p++ = (uint8_t)v; }
+    void u16(unsigned v) { u8(v & 0xFF); u8((v >> 8) & 0xFF); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+
+    // Zigzag, then 7 bits per byte: small differences of either sign
+    // take one byte
+    void varint(int32_t v) {
+        uint32_t z = ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+        while (z >= 0x80) {
+            u8((z & 0x7F) | 0x80);
+            z >>= 7;
+        }
+        u8(z);
+    }
+};
+
+void spectatorEncoderInit(SpectatorEncoder& e, int keyIntervalTicks) {
+    std::memset(&e, 0, sizeof(e));
+    e.keyInterval = keyIntervalTicks > 1 ? keyIntervalTicks : 1;
+}
+
+void spectatorNoteEvents(SpectatorEncoder& e, unsigned events) {
+    e.pendingEvents |= events;
+}
+
+int spectatorEncode(SpectatorEncoder& e, const MatchState& m, uint8_t* out) {
+    SpectatorFrame f;
+    spectatorCapture(m, e.pendingEvents, f);
+    e.pendingEvents = 0;
+
+    bool keyframe = !e.hasKey || f.tick < e.key.tick || f.tick - e.key.tick >= (uint32_t)e.keyInterval;
+    if (keyframe) {
+        e.key    = f;
+        e.hasKey = true;
+    }
+
+    unsigned mask = 0;
+    for (int i = 0; i < SPEC_FIELD_COUNT; ++i) {
+        if (keyframe || f.v[i] != e.key.v[i]) mask |= 1u << i;
+    }
+
+    ByteWriter w = { out };
+    w.u8(keyframe ? SPEC_KEYFRAME : SPEC_DELTA);
+    w.u32(f.tick);
+    w.u8(f.events);
+    w.u16(f.tick - e.key.tick);
+    w.u16(mask);
+    for (int i = 0; i < SPEC_FIELD_COUNT; ++i) {
+        if (mask & (1u << i)) w.varint(keyframe ? f.v[i] : f.v[i] - e.key.v[i]);
+    }
+    return (int)(w.p - out);
+}
+
+// ===================== FEED =====================
+
+void spectatorFeedInit(SpectatorFeed& f) {
+    std::memset(&f, 0, sizeof(f));
+    f.spacing = 1.0f;
+}
+
+static int32_t readVarint(NetReader& r) {
+    uint32_t z = 0;
+    for (int shift = 0; shift < 35 && r.ok; shift += 7) {
+        unsigned b = r.u8();
+        z |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+
+bool spectatorDecode(SpectatorFeed& f, const uint8_t* data, int size) {
+    NetReader r(data, size);
+    unsigned kind   = r.u8();
+    SpectatorFrame frame;
+    frame.tick      = r.u32();
+    frame.events    = r.u8();
+    uint32_t keyAge = r.u16();
+    unsigned mask   = r.u16();
+
+    int32_t values[SPEC_FIELD_COUNT];
+    for (int i = 0; i < SPEC_FIELD_COUNT; ++i) values[i] = (mask & (1u << i)) ? readVarint(r) : 0;
+    if (!r.ok || (kind != SPEC_KEYFRAME && kind != SPEC_DELTA)) return false;
+    f.stats.bytes += (uint64_t)size;
+
+    if (kind == SPEC_KEYFRAME) {
+        std::memcpy(frame.v, values, sizeof(values));
+        if (!f.hasKey || frame.tick > f.key.tick) {
+            f.key    = frame;
+            f.hasKey = true;
+        }
+        f.stats.keyframes++;
+    } else {
+        if (!f.hasKey || f.key.tick != frame.tick - keyAge) {
+            f.stats.orphans++;
+            return false;
+        }
+        for (int i = 0; i < SPEC_FIELD_COUNT; ++i) frame.v[i] = f.key.v[i] + values[i];
+        f.stats.deltas++;
+    }
+
+    int slot = (int)(frame.tick % spectatorRingSize);
+    if ((f.playing && frame.tick <= f.lastPlayed) ||
+        (f.filled[slot] && f.frames[slot].tick == frame.tick)) {
+        f.stats.late++;
+        return false;
+    }
+    f.frames[slot] = frame;
+    f.filled[slot] = true;
+
+    if (!f.any || frame.tick > f.newestTick) {
+        if (f.any) f.spacing += 0.1f * ((float)(frame.tick - f.newestTick) - f.spacing);
+        f.newestTick = frame.tick;
+        f.any        = true;
+    }
+    return true;
+}
+
+unsigned spectatorPlay(SpectatorFeed& f, int minDelayTicks, MatchState& m) {
+    if (!f.any) return 0;
+
+    double delay  = minDelayTicks > 3.0f * f.spacing ? (double)minDelayTicks : 3.0 * f.spacing;
+    double target = (double)f.newestTick - delay;
+    if (target < 0.0) target = 0.0;
+
+    if (!f.playing || std::fabs(f.playTick - target) > 2.0 * delay + 30.0) {
+        // First frame, or far off after a stall: jump
+        f.playTick   = target;
+        f.playing    = true;
+        f.lastPlayed = (uint32_t)target;
+    } else {
+        f.playTick += 1.0;
+        if (f.playTick < target - delay) f.playTick += 1.0;    // fell behind: double speed
+    }
+    if (f.playTick > (double)f.newestTick) f.playTick = (double)f.newestTick;   // starved: hold
+
+    // Frames around the playback position
+    const SpectatorFrame* a = 0;
+    const SpectatorFrame* b = 0;
+    for (int i = 0; i < spectatorRingSize; ++i) {
+        if (!f.filled[i]) continue;
+        const SpectatorFrame& fr = f.frames[i];
+        if ((double)fr.tick <= f.playTick) {
+            if (!a || fr.tick > a->tick) a = &fr;
+        } else if (!b || fr.tick < b->tick) {
+            b = &fr;
+        }
+    }
+    if (!a) return 0;
+
+    SpectatorFrame shown = *a;
+    if (b && !(b->events & (EVENT_SCORE_P1 | EVENT_SCORE_P2))) {
+        // Not across a goal: the ball is re-served in the middle
+        float t = (float)((f.playTick - a->tick) / (double)(b->tick - a->tick));
+        static const int moving[] = { SPEC_BALL_X, SPEC_BALL_Y, SPEC_P1_X, SPEC_P1_Y,
+                                      SPEC_P2_X, SPEC_P2_Y, SPEC_TIME_LEFT };
+        for (int k = 0; k < 7; ++k) {
+            int i = moving[k];
+            shown.v[i] = a->v[i] + (int32_t)std::floor((b->v[i] - a->v[i]) * t + 0.5f);
+        }
+    }
+
+    // Events of every frame passed since the last call
+    unsigned events = 0;
+    if (a->tick > f.lastPlayed) {
+        for (int i = 0; i < spectatorRingSize; ++i) {
+            if (f.filled[i] && f.frames[i].tick > f.lastPlayed && f.frames[i].tick <= a->tick) {
+                events |= f.frames[i].events;
+            }
+        }
+        f.lastPlayed = a->tick;
+    }
+
+    shown.events = events;
+    spectatorApply(shown, m);
+    return events;
+}
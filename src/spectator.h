@@ -0,0 +1,110 @@
+#ifndef PADDLE_RIVALS_SPECTATOR_H
+#define PADDLE_RIVALS_SPECTATOR_H
+
+// Spectator stream: what a viewer needs to draw a match, small enough to
+// broadcast every frame to thousands of viewers.
+//
+// A frame is the drawable state quantized to integers (positions in 1/16
+// arena units, the clock in ms, speedFactor in 1/1000) plus the match
+// events since the previous frame (goals and hits drive the flash and
+// shake). Every keyInterval ticks the encoder emits a keyframe with every
+// field; the frames in between only carry the fields that differ from that
+// keyframe, as zigzag varints of the difference. Deltas never depend on
+// each other, so a lost packet costs one frame, and a viewer can start at
+// any keyframe. The encoder runs once per frame per match and the bytes
+// are the same for every viewer, whoever is watching.
+//
+// The feed on the viewer's side reorders frames by tick and plays them
+// back a few frames behind the newest, interpolating in between, so
+// network jitter doesn't show.
+
+#include <cstdint>
+
+#include "match_engine.h"
+
+enum SpectatorField {
+    SPEC_BALL_X, SPEC_BALL_Y,
+    SPEC_P1_X, SPEC_P1_Y,
+    SPEC_P2_X, SPEC_P2_Y,
+    SPEC_TIME_LEFT,            // ms
+    SPEC_SPEED_FACTOR,         // 1/1000
+    SPEC_SCORE_P1, SPEC_SCORE_P2,
+    SPEC_BALL_RADIUS,
+    SPEC_P1_WIDTH, SPEC_P1_HEIGHT,
+    SPEC_P2_WIDTH, SPEC_P2_HEIGHT,
+    SPEC_OVER,
+    SPEC_FIELD_COUNT           // <= 16: the delta mask is a u16
+};
+
+const int spectatorMaxPacket = 64;    // a keyframe is ~42 bytes, deltas ~22
+const int spectatorRingSize  = 64;    // frames the feed keeps
+
+struct SpectatorFrame {
+    uint32_t tick;
+    unsigned events;                  // MatchEvent flags since the previous frame
+    int32_t  v[SPEC_FIELD_COUNT];
+};
+
+void spectatorCapture(const MatchState& m, unsigned events, SpectatorFrame& out);
+
+// Writes the drawable parts of a frame into m (positions, sizes, scores,
+// clock, speedFactor, tick, over, events). Velocities are zeroed.
+void spectatorApply(const SpectatorFrame& f, MatchState& m);
+
+// ===================== ENCODER =====================
+
+struct SpectatorEncoder {
+    SpectatorFrame key;
+    bool           hasKey;
+    int            keyInterval;       // ticks between keyframes
+    unsigned       pendingEvents;     // since the last encoded frame
+};
+
+void spectatorEncoderInit(SpectatorEncoder& e, int keyIntervalTicks);
+
+// Call after every step: frames may be sent less often than the match
+// ticks, and a goal between two frames must still reach the viewers.
+void spectatorNoteEvents(SpectatorEncoder& e, unsigned events);
+
+// Encodes the current state into out (spectatorMaxPacket bytes), as a
+// keyframe when one is due. Returns the size.
+int spectatorEncode(SpectatorEncoder& e, const MatchState& m, uint8_t* out);
+
+// ===================== FEED =====================
+
+struct SpectatorStats {
+    uint64_t keyframes, deltas;
+    uint64_t orphans;                 // deltas whose keyframe we never got
+    uint64_t late;                    // older than the frame on screen, or duplicates
+    uint64_t bytes;
+};
+
+struct SpectatorFeed {
+    SpectatorFrame key;
+    bool           hasKey;
+
+    SpectatorFrame frames[spectatorRingSize];   // by tick % spectatorRingSize
+    bool           filled[spectatorRingSize];
+    uint32_t       newestTick;
+    bool           any;
+    float          spacing;           // ticks between frames (smoothed)
+
+    double         playTick;          // what's on screen
+    bool           playing;
+    uint32_t       lastPlayed;        // newest frame whose events were delivered
+
+    SpectatorStats stats;
+};
+
+void spectatorFeedInit(SpectatorFeed& f);
+
+// Decodes one packet into the feed. Returns true if it added a frame.
+bool spectatorDecode(SpectatorFeed& f, const uint8_t* data, int size);
+
+// Advances playback by one tick, at least minDelayTicks (and three frame
+// spacings) behind the newest frame, and writes the interpolated state
+// into m. Returns the events of the frames passed, 0 before the first
+// frame arrives.
+unsigned spectatorPlay(SpectatorFeed& f, int minDelayTicks, MatchState& m);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef PADDLE_RIVALS_SPSC_QUEUE_H
+#define PADDLE_RIVALS_SPSC_QUEUE_H
+
+// Bounded single-producer / single-consumer queue without locks.
+//
+// One thread pushes, one other thread pops; neither ever blocks or
+// allocates, which is what the audio thread needs. Capacity is a power of
+// two. The two indices are padded apart so the threads don't fight over
+// one cache line.
+
+#include <atomic>
+#include <cstdint>
+
+template <typename T, unsigned Capacity>
+class SpscQueue {
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer. False (and nothing queued) when full.
+    bool push(const T& item) {
+        unsigned t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer. False when empty.
+    bool pop(T& out) {
+        unsigned h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        out = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Either side; a snapshot that may be stale by the time it's used.
+    unsigned size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+private:
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    std::atomic<unsigned> head;                // next to pop
+    char                  padHead[64];
+    std::atomic<unsigned> tail;                // next to push
+    char                  padTail[64];
+    T                     items[Capacity];
+};
+
+#endif
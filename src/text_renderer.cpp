@@ -0,0 +1,344 @@
+#include "text_renderer.h"
+
+#include "gl_ext.h"
+#include "batch_renderer.h"
+
+#include <GL/freeglut.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// ===================== ATLAS =====================
+
+const int firstGlyph = 32;    // ' '
+const int glyphCount = 95;    // ' ' .. '~'
+const int atlasWidth = 512;
+const int glyphPad   = 3;
+
+struct AtlasFont {
+    void* font;
+    float scale;               // stroke fonts only
+    bool  stroke;
+
+    float advance[glyphCount];
+    int   cellW, cellH;
+    int   baseline;            // baseline height inside a cell
+    int   originY;             // first row of this font in the atlas
+    int   cols;
+};
+
+static std::vector<AtlasFont> fonts;
+static GLuint atlasTexture = 0;
+static int    atlasHeight  = 0;
+static bool   atlasReady   = false;
+
+static void addBitmapFont(void* font) {
+    AtlasFont f;
+    f.font   = font;
+    f.scale  = 1.0f;
+    f.stroke = false;
+
+    int maxAdvance = 0;
+    for (int i = 0; i < glyphCount; ++i) {
+        int w = glutBitmapWidth(font, firstGlyph + i);
+        f.advance[i] = (float)w;
+        if (w > maxAdvance) maxAdvance = w;
+    }
+
+    int height = glutBitmapHeight(font);
+    f.cellW    = maxAdvance + 2 * glyphPad;
+    f.cellH    = height + 2 * glyphPad;
+    f.baseline = glyphPad + (height + 3) / 4;   // room for descenders
+    fonts.push_back(f);
+}
+
+static void addStrokeFont(void* font, float scale) {
+    AtlasFont f;
+    f.font   = font;
+    f.scale  = scale;
+    f.stroke = true;
+
+    float maxAdvance = 0.0f;
+    for (int i = 0; i < glyphCount; ++i) {
+        float w = glutStrokeWidth(font, firstGlyph + i) * scale;
+        f.advance[i] = w;
+        if (w > maxAdvance) maxAdvance = w;
+    }
+
+    // Roman: 119.05 units above the baseline, 33.33 below
+    f.cellW    = (int)std::ceil(maxAdvance) + 2 * glyphPad;
+    f.cellH    = (int)std::ceil((119.05f + 33.33f) * scale) + 2 * glyphPad;
+    f.baseline = (int)std::ceil(33.33f * scale) + glyphPad;
+    fonts.push_back(f);
+}
+
+static void rasterizeFonts() {
+    for (size_t fi = 0; fi < fonts.size(); ++fi) {
+        const AtlasFont& f = fonts[fi];
+        for (int i = 0; i < glyphCount; ++i) {
+            int cx = (i % f.cols) * f.cellW + glyphPad;
+            int cy = f.originY + (i / f.cols) * f.cellH + f.baseline;
+
+            if (f.stroke) {
+                glPushMatrix();
+                    glTranslatef((float)cx, (float)cy, 0.0f);
+                    glScalef(f.scale, f.scale, 1.0f);
+                    glutStrokeCharacter(f.font, firstGlyph + i);
+                glPopMatrix();
+            } else {
+                glRasterPos2i(cx, cy);
+                glutBitmapCharacter(f.font, firstGlyph + i);
+            }
+        }
+    }
+}
+
+bool textInit() {
+    if (atlasReady) return true;
+    if (!glExt.hasFramebuffers) return false;
+
+    fonts.clear();
+    addBitmapFont(GLUT_BITMAP_HELVETICA_18);
+    addBitmapFont(GLUT_BITMAP_HELVETICA_12);
+    addStrokeFont(GLUT_STROKE_ROMAN, 0.20f);   // menu title
+
+    // Stack the fonts as grids, one under the other
+    int y = 0;
+    for (size_t i = 0; i < fonts.size(); ++i) {
+        AtlasFont& f = fonts[i];
+        f.cols    = atlasWidth / f.cellW;
+        f.originY = y;
+        y += ((glyphCount + f.cols - 1) / f.cols) * f.cellH;
+    }
+    atlasHeight = glExtPow2(y);
+
+    // Render white glyphs on black into a temporary RGBA target
+    GLuint target = 0, fbo = 0;
+    glGenTextures(1, &target);
+    glBindTexture(GL_TEXTURE_2D, target);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, atlasWidth, atlasHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint prevFbo = 0;
+    GLint prevViewport[4];
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFbo);
+    glGetIntegerv(GL_VIEWPORT, prevViewport);
+
+    glExt.genFramebuffers(1, &fbo);
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glExt.framebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+
+    bool ok = glExt.checkFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    std::vector<unsigned char> coverage;
+
+    if (ok) {
+        glViewport(0, 0, atlasWidth, atlasHeight);
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glLoadIdentity();
+        glOrtho(0, atlasWidth, 0, atlasHeight, -1, 1);
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+        glLoadIdentity();
+
+        glColor3f(1.0f, 1.0f, 1.0f);
+        rasterizeFonts();
+
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopMatrix();
+
+        coverage.resize((size_t)atlasWidth * atlasHeight);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, atlasWidth, atlasHeight, GL_RED, GL_UNSIGNED_BYTE, &coverage[0]);
+    }
+
+    glExt.bindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+    glExt.deleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &target);
+
+    if (!ok) return false;
+
+    // Red channel becomes the atlas alpha; color comes from the vertices
+    glGenTextures(1, &atlasTexture);
+    glBindTexture(GL_TEXTURE_2D, atlasTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA8, atlasWidth, atlasHeight, 0, GL_ALPHA, GL_UNSIGNED_BYTE, &coverage[0]);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    atlasReady = true;
+    return true;
+}
+
+static int findFont(void* font, float scale) {
+    if (!atlasReady) return -1;
+    for (size_t i = 0; i < fonts.size(); ++i) {
+        if (fonts[i].font != font) continue;
+        if (fonts[i].stroke && std::fabs(fonts[i].scale - scale) > 0.0001f) continue;
+        return (int)i;
+    }
+    return -1;
+}
+
+// ===================== LAYOUT CACHE =====================
+
+struct GlyphQuad {
+    float x, y, w, h;          // relative to the pen origin
+    float u0, v0, u1, v1;
+};
+
+struct TextLayout {
+    bool        used;
+    int         font;
+    unsigned    hash;
+    std::string text;
+    float       width;
+    std::vector<GlyphQuad> quads;
+};
+
+const int layoutCacheSize = 512;          // power of two
+static TextLayout layoutCache[layoutCacheSize];
+static int        layoutsCached = 0;
+static int        layoutsBuilt  = 0;
+
+static unsigned hashText(int font, const char* text) {
+    unsigned h = 2166136261u ^ (unsigned)font;
+    for (const char* p = text; *p; ++p) h = (h ^ (unsigned char)*p) * 16777619u;
+    return h;
+}
+
+static void buildLayout(TextLayout& L, int fontIndex, const char* text) {
+    const AtlasFont& f = fonts[fontIndex];
+
+    L.quads.clear();
+    float pen = 0.0f;
+    for (const char* p = text; *p; ++p) {
+        int g = (unsigned char)*p - firstGlyph;
+        if (g < 0 || g >= glyphCount) continue;
+
+        if (*p != ' ') {
+            int cx = (g % f.cols) * f.cellW;
+            int cy = f.originY + (g / f.cols) * f.cellH;
+
+            GlyphQuad q;
+            q.x  = std::floor(pen) - glyphPad;
+            q.y  = (float)-f.baseline;
+            q.w  = (float)f.cellW;
+            q.h  = (float)f.cellH;
+            q.u0 = (float)cx / atlasWidth;
+            q.v0 = (float)cy / atlasHeight;
+            q.u1 = (float)(cx + f.cellW) / atlasWidth;
+            q.v1 = (float)(cy + f.cellH) / atlasHeight;
+            L.quads.push_back(q);
+        }
+        pen += f.advance[g];
+    }
+    L.width = pen;
+    layoutsBuilt++;
+}
+
+static const TextLayout& layoutFor(int fontIndex, const char* text) {
+    unsigned h = hashText(fontIndex, text);
+
+    for (;;) {
+        for (int i = 0; i < layoutCacheSize; ++i) {
+            TextLayout& L = layoutCache[(h + i) & (layoutCacheSize - 1)];
+            if (!L.used) {
+                if (layoutsCached >= layoutCacheSize * 3 / 4) break;   // too full
+                L.used = true;
+                L.font = fontIndex;
+                L.hash = h;
+                L.text = text;
+                buildLayout(L, fontIndex, text);
+                layoutsCached++;
+                return L;
+            }
+            if (L.hash == h && L.font == fontIndex && L.text == text) return L;
+        }
+
+        // Cache full (lots of changing HUD strings): start over
+        for (int i = 0; i < layoutCacheSize; ++i) layoutCache[i].used = false;
+        layoutsCached = 0;
+    }
+}
+
+// ===================== DRAW =====================
+
+struct QueuedGlyph {
+    float x, y, w, h;
+    float u0, v0, u1, v1;
+    float color[4];
+};
+
+static std::vector<QueuedGlyph> queued;    // reused every frame
+
+bool textDraw(void* font, float scale, const char* text, float x, float y) {
+    int fi = findFont(font, scale);
+    if (fi < 0) return false;
+
+    const TextLayout& L = layoutFor(fi, text);
+
+    float color[4];
+    batchCurrentColor(color);
+    batchTransformPoint(x, y);
+    x = std::floor(x + 0.5f);
+    y = std::floor(y + 0.5f);
+
+    for (size_t i = 0; i < L.quads.size(); ++i) {
+        const GlyphQuad& q = L.quads[i];
+        QueuedGlyph g;
+        g.x = x + q.x;  g.y = y + q.y;
+        g.w = q.w;      g.h = q.h;
+        g.u0 = q.u0; g.v0 = q.v0; g.u1 = q.u1; g.v1 = q.v1;
+        std::memcpy(g.color, color, sizeof(color));
+        queued.push_back(g);
+    }
+    return true;
+}
+
+float textWidth(void* font, float scale, const char* text) {
+    int fi = findFont(font, scale);
+    if (fi < 0) return -1.0f;
+    return layoutFor(fi, text).width;
+}
+
+void textFlush() {
+    if (queued.empty()) return;
+
+    float savedColor[4], savedTransform[4];
+    batchCurrentColor(savedColor);
+    batchGetTransform(savedTransform);
+
+    // Glyph positions were transformed when queued
+    batchResetTransform();
+    batchSetBlend(true);
+    batchSetTexture(atlasTexture);
+
+    for (size_t i = 0; i < queued.size(); ++i) {
+        const QueuedGlyph& g = queued[i];
+        batchColor4f(g.color[0], g.color[1], g.color[2], g.color[3]);
+        batchTexturedQuad(g.x, g.y, g.w, g.h, g.u0, g.v0, g.u1, g.v1);
+    }
+
+    batchSetTexture(0);
+    batchSetBlend(false);
+
+    batchColor4f(savedColor[0], savedColor[1], savedColor[2], savedColor[3]);
+    batchSetTransform(savedTransform[0], savedTransform[1], savedTransform[2], savedTransform[3]);
+    queued.clear();
+}
+
+TextStats textStats() {
+    TextStats st;
+    st.layouts = layoutsBuilt;
+    st.cached  = layoutsCached;
+    return st;
+}
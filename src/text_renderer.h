@@ -0,0 +1,36 @@
+#ifndef PADDLE_RIVALS_TEXT_RENDERER_H
+#define PADDLE_RIVALS_TEXT_RENDERER_H
+
+// Glyph-atlas text.
+//
+// The GLUT fonts we use are rasterized once into a single alpha texture.
+// Strings are laid out into glyph quads once and cached by (font, text),
+// so static labels never get re-measured and a HUD string like the score
+// is only laid out again when its value changes.
+//
+// textDraw() only queues glyphs; textFlush() submits every queued glyph of
+// the frame as one batch, on top of the frame's shapes.
+
+// Rasterizes the atlas (needs a GL context with FBO support).
+// Returns false if text has to fall back to direct GLUT drawing.
+bool textInit();
+
+// Draws text with its baseline origin at (x, y), in the current batch
+// color and transform. font is a GLUT bitmap font, or GLUT_STROKE_ROMAN
+// with a scale. Returns false if the font isn't in the atlas.
+bool textDraw(void* font, float scale, const char* text, float x, float y);
+
+// Width in pixels of text (uses the layout cache). -1 if not in the atlas.
+float textWidth(void* font, float scale, const char* text);
+
+// Submits the frame's queued glyphs.
+void textFlush();
+
+struct TextStats {
+    int layouts;       // strings laid out since start (cache misses)
+    int cached;        // layouts currently held
+};
+
+TextStats textStats();
+
+#endif
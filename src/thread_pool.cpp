@@ -0,0 +1,107 @@
+#include "thread_pool.h"
+
+static thread_local int workerIndex = -1;
+
+ThreadPool::ThreadPool(int threads) : pending(0), nextQueue(0), stopping(false) {
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency();
+    if (threads <= 0) threads = 1;
+
+    for (int i = 0; i < threads; ++i) queues.push_back(new Queue());
+    for (int i = 0; i < threads; ++i) workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
+    for (size_t i = 0; i < queues.size(); ++i) delete queues[i];
+}
+
+int ThreadPool::currentWorker() {
+    return workerIndex;
+}
+
+void ThreadPool::submit(Task task) {
+    pending.fetch_add(1);
+
+    // Workers push onto their own deque; outsiders spread the load
+    int q = workerIndex;
+    if (q < 0) q = (int)(nextQueue.fetch_add(1) % queues.size());
+
+    {
+        std::lock_guard<std::mutex> guard(queues[q]->lock);
+        queues[q]->tasks.push_back(task);
+    }
+    {
+        // Taking the lock orders this with a worker going to sleep
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wakeUp.notify_one();
+}
+
+bool ThreadPool::popLocal(int self, Task& out) {
+    Queue* q = queues[self];
+    std::lock_guard<std::mutex> guard(q->lock);
+    if (q->tasks.empty()) return false;
+    out = q->tasks.back();
+    q->tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(int self, Task& out) {
+    int n = (int)queues.size();
+    for (int i = 1; i < n; ++i) {
+        Queue* q = queues[(self + i) % n];
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (q->tasks.empty()) continue;
+        out = q->tasks.front();
+        q->tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(int self) {
+    workerIndex = self;
+
+    for (;;) {
+        Task task;
+        if (popLocal(self, task) || steal(self, task)) {
+            task();
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                allDone.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleepLock);
+        if (stopping) return;
+        // Re-check under the lock: submit() takes it after queueing
+        bool anyQueued = false;
+        for (size_t i = 0; i < queues.size() && !anyQueued; ++i) {
+            std::lock_guard<std::mutex> qguard(queues[i]->lock);
+            anyQueued = !queues[i]->tasks.empty();
+        }
+        if (!anyQueued) wakeUp.wait(guard);
+    }
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> guard(sleepLock);
+    while (pending.load() != 0) allDone.wait(guard);
+}
+
+void ThreadPool::parallelFor(int count, int grain, const std::function<void(int, int)>& fn) {
+    if (grain < 1) grain = 1;
+    for (int begin = 0; begin < count; begin += grain) {
+        int end = begin + grain;
+        if (end > count) end = count;
+        submit([&fn, begin, end]() { fn(begin, end); });
+    }
+    wait();
+}
@@ -0,0 +1,63 @@
+#ifndef PADDLE_RIVALS_THREAD_POOL_H
+#define PADDLE_RIVALS_THREAD_POOL_H
+
+// Work-stealing thread pool.
+//
+// Every worker owns a deque. Tasks submitted from outside are spread
+// round-robin across the deques; a worker pops from the back of its own
+// deque (LIFO, cache friendly) and, when empty, steals from the front of
+// the others. Tasks may submit more tasks.
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+
+    // threads <= 0 means one per hardware thread.
+    explicit ThreadPool(int threads = 0);
+    ~ThreadPool();
+
+    int  size() const { return (int)workers.size(); }
+
+    void submit(Task task);
+
+    // Blocks until every submitted task has finished.
+    void wait();
+
+    // Runs fn(begin, end) over [0, count) in chunks of `grain` and waits.
+    // Call from outside the pool (wait() would block a worker).
+    void parallelFor(int count, int grain, const std::function<void(int, int)>& fn);
+
+    // Index of the calling worker thread, or -1 outside the pool.
+    static int currentWorker();
+
+private:
+    struct Queue {
+        std::mutex       lock;
+        std::deque<Task> tasks;
+    };
+
+    bool popLocal(int self, Task& out);
+    bool steal(int self, Task& out);
+    void workerLoop(int self);
+
+    std::vector<std::thread> workers;
+    std::vector<Queue*>      queues;
+
+    std::mutex              sleepLock;
+    std::condition_variable wakeUp;
+    std::condition_variable allDone;
+
+    std::atomic<int>      pending;     // submitted but not finished
+    std::atomic<unsigned> nextQueue;
+    bool                  stopping;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "udp_batch.h"
+
+#include <netdb.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ===================== BATCHES =====================
+
+int PacketBatch::add(const sockaddr_in& to) {
+    int i = count++;
+    addrs[i] = to;
+    std::memset(&msgs[i], 0, sizeof(msgs[i]));
+    iov[i].iov_base             = data[i];
+    iov[i].iov_len              = 0;
+    msgs[i].msg_hdr.msg_iov     = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen  = 1;
+    msgs[i].msg_hdr.msg_name    = &addrs[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    return i;
+}
+
+void PacketBatch::setSize(int i, int size) {
+    iov[i].iov_len = (size_t)size;
+}
+
+void PacketBatch::addShared(const sockaddr_in& to, const uint8_t* shared, int size) {
+    int i = add(to);
+    iov[i].iov_base = const_cast<uint8_t*>(shared);
+    iov[i].iov_len  = (size_t)size;
+}
+
+int udpOpen(int port, int bufferBytes) {
+    int s = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+    if (s < 0) return -1;
+
+    setsockopt(s, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+    setsockopt(s, SOL_SOCKET, SO_SNDBUF, &bufferBytes, sizeof(bufferBytes));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port        = htons((unsigned short)port);
+    if (bind(s, (const sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+int udpReceive(int sock, PacketBatch& b) {
+    std::memset(b.msgs, 0, sizeof(b.msgs));
+    for (int i = 0; i < udpBatchSize; ++i) {
+        b.iov[i].iov_base             = b.data[i];
+        b.iov[i].iov_len              = udpMaxDatagram;
+        b.msgs[i].msg_hdr.msg_iov     = &b.iov[i];
+        b.msgs[i].msg_hdr.msg_iovlen  = 1;
+        b.msgs[i].msg_hdr.msg_name    = &b.addrs[i];
+        b.msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+
+    int n = recvmmsg(sock, b.msgs, udpBatchSize, 0, 0);
+    b.count = n > 0 ? n : 0;
+    for (int i = 0; i < b.count; ++i) {
+        if (b.msgs[i].msg_hdr.msg_flags & MSG_TRUNC) b.msgs[i].msg_len = 0;
+    }
+    return b.count;
+}
+
+int udpSend(int sock, PacketBatch& b) {
+    int sent = 0;
+    while (sent < b.count) {
+        int n = sendmmsg(sock, b.msgs + sent, b.count - sent, 0);
+        if (n <= 0) break;
+        sent += n;
+    }
+    b.count = 0;
+    return sent;
+}
+
+// ===================== EVENTS =====================
+
+int timerOpen(double periodSec) {
+    int t = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (t < 0) return -1;
+
+    long long ns = (long long)(periodSec * 1e9);
+    if (ns < 1) ns = 1;
+    itimerspec spec;
+    spec.it_interval.tv_sec  = (time_t)(ns / 1000000000LL);
+    spec.it_interval.tv_nsec = (long)(ns % 1000000000LL);
+    spec.it_value            = spec.it_interval;
+    timerfd_settime(t, 0, &spec, 0);
+    return t;
+}
+
+uint64_t timerRead(int fd) {
+    uint64_t expirations = 0;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) return 0;
+    return expirations;
+}
+
+void epollWatch(int epollFd, int fd) {
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events  = EPOLLIN;
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+bool udpResolve(const char* text, int defaultPort, sockaddr_in& out) {
+    char host[256];
+    std::strncpy(host, text, sizeof(host) - 1);
+    host[sizeof(host) - 1] = '\0';
+
+    int port = defaultPort;
+    char* colon = std::strrchr(host, ':');
+    if (colon) {
+        *colon = '\0';
+        port   = std::atoi(colon + 1);
+    }
+    if (port <= 0 || port > 65535) return false;
+
+    addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+
+    char service[16];
+    std::sprintf(service, "%d", port);
+
+    addrinfo* found = 0;
+    if (getaddrinfo(host, service, &hints, &found) != 0 || !found) return false;
+    std::memcpy(&out, found->ai_addr, sizeof(out));
+    freeaddrinfo(found);
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef PADDLE_RIVALS_UDP_BATCH_H
+#define PADDLE_RIVALS_UDP_BATCH_H
+
+// Batched UDP and event-loop helpers for the dedicated server and the load
+// generator. Linux only: recvmmsg / sendmmsg move up to udpBatchSize
+// datagrams per system call, timerfd ticks and epoll waits on both.
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstdint>
+
+const int udpBatchSize   = 64;
+const int udpMaxDatagram = 128;   // server packets are all smaller; longer ones are dropped
+
+struct PacketBatch {
+    mmsghdr     msgs[udpBatchSize];
+    iovec       iov[udpBatchSize];
+    sockaddr_in addrs[udpBatchSize];
+    uint8_t     data[udpBatchSize][udpMaxDatagram];
+    int         count;              // received, or queued to send
+
+    // Room for a datagram to `to`; fill at most udpMaxDatagram bytes and
+    // set its size with setSize(). Returns its index.
+    int add(const sockaddr_in& to);
+    void setSize(int i, int size);
+
+    // Queues `data` itself (no copy) to `to`: for the same bytes to many
+    // receivers. data must stay untouched until the batch is sent.
+    void addShared(const sockaddr_in& to, const uint8_t* data, int size);
+
+    bool full() const { return count == udpBatchSize; }
+};
+
+// Non-blocking UDP socket bound to port (0 = any) with the given kernel
+// buffer sizes. -1 on failure.
+int udpOpen(int port, int bufferBytes);
+
+// Receives up to udpBatchSize datagrams into b (count, data, msgs[i].msg_len,
+// addrs). Truncated datagrams get size 0. Returns the count.
+int udpReceive(int sock, PacketBatch& b);
+
+// Sends what's queued in b and empties it. Returns how many went out; the
+// rest are dropped when the socket buffer is full, like on the wire.
+int udpSend(int sock, PacketBatch& b);
+
+// Periodic non-blocking timerfd; reads return the expirations since the
+// last read. -1 on failure.
+int timerOpen(double periodSec);
+
+// Reads a timerfd: expirations since the last read, 0 if none.
+uint64_t timerRead(int fd);
+
+// Adds fd to the epoll set for input readiness; the event carries fd.
+void epollWatch(int epollFd, int fd);
+
+// "host:port" or "host" (then defaultPort) into an IPv4 address.
+bool udpResolve(const char* text, int defaultPort, sockaddr_in& out);
+
+#endif